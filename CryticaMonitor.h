@@ -14,11 +14,18 @@
 #include <net/if.h>
 #include <openssl/md5.h>
 #include <czmq.h>
+#include <pthread.h>
 
 #include <time.h>
 #include "csl_crypto.h"
 #include "csl_constants.h"
 #include "csl_utilities.h"
+#include "csl_config.h"
+#include "csl_scheduler.h"
+#include "csl_metrics.h"
+#include "csl_trace.h"
+#include "csl_capture.h"
+#include "csl_diff.h"
 
 /************************************************
  * **********************************************
@@ -92,13 +99,16 @@ typedef struct
  * A Table for Scans
  * There is a counter for the number of scans in
  * the table, and then an array consisting of one
- * row per scan
+ * row per scan. The array grows as needed, up to
+ * the configured max_elements
  * **********************************************/
 typedef struct
 {
-    unsigned short      scan_element_ctr;
+    unsigned int        scan_element_ctr;
+    unsigned int        scan_element_capacity;      // rows allocated in scan_elements
     short               device_index;
-    csl_scan_record     scan_elements[MAX_ELEMENTS];
+    bool                ordered;                    // every row so far came in element_name_hash order
+    csl_scan_record     *scan_elements;
 } scan_structure;
 
 
@@ -193,8 +203,16 @@ typedef struct
     zsock_t  *broadcaster;
     // Probe handshake request responder (ZMQ_RESP)
     zsock_t *responder;
-    // Probe file scan receiver (ZMQ_PULL)
-    zsock_t *scan_receiver;
+    // Probe file scan receivers (ZMQ_PULL) - each is owned by its own decode worker
+    zactor_t        *scan_decoders[CONFIG_MAX_SCAN_RECEIVERS];
+    int             scan_ports[CONFIG_MAX_SCAN_RECEIVERS];
+    unsigned int    scan_receiver_ctr;
+    // Decoded scan messages from every decode worker (ZMQ_PULL, inproc)
+    zsock_t *scan_decoded;
+    // Metrics for local collectors (ZMQ_PUB on the loopback), NULL when metrics_port is 0
+    zsock_t *metrics;
+    // Whether the broadcaster is bound, and so publishing alert events (see csl_alert_event)
+    bool broadcaster_bound;
     // A zmq poller is just a way to combine multiple sockets and switch between them checking for incoming
     // incoming data on a socket
     zpoller_t *poller;
@@ -268,12 +286,14 @@ typedef struct
     byte                device_identifier[SIZE_DEVICE_IDENTIFIER];
     short               device_index;
     byte                device_mac_address[SIZE_MAC_ADDRESS];
-    unsigned short      status_element_ctr;
+    unsigned int        status_element_ctr;
     double              probe_id;           // currently the device_id
     bool                cs_standard_flag;
     int64_t             last_heartbeat;
-    bool                currently_scanning;
+    bool                currently_scanning; // true while the device holds a scan grant
+    int64_t             scan_granted_at;    // zclock_mono() of the grant
     time_t              last_scan;
+    unsigned int        probe_capabilities; // PROBE_CAPABILITY_* agreed at the device's last handshake
 } device_record;
 
 /************************************************
@@ -284,9 +304,10 @@ typedef struct
 {
     unsigned long long  monitor_id;         // Value obtained from the monitor table in the config database
     short               device_ctr;         // The number of devices currently being monitored
-    short               max_devices;        // Maximum number of devices this monitor can support (later feature)
+    short               max_devices;        // Maximum number of devices this monitor can support (from the config)
     short               monitor_sync;       // Flag indicating whether the monitor needs a config update
     monitor_comm_params comm_params;        // The information the monitor needs to communicate via ZeroMQ
+    size_t              memory_bytes;       // Memory currently used by all of the device tables
 
 } monitor_info_table;
 
@@ -328,8 +349,33 @@ typedef struct
     unsigned int        scan_id;                    // not yet used
     byte                scan_value[SIZE_HASH_ELEMENT];
     time_t              scan_date;                  // not yet used
+    unsigned int        alert_count;                // 1, or the alerts a summary record stands for
+    time_t              first_alert_date;           // of a summary record's first alert
 } scan_alert_record;
 
+/************************************************
+ * Alert Event
+ * Each alert written to the alert log is also published on the broadcaster socket, as two frames:
+ *      the topic       - ALERT_TOPIC_FORMAT, "alert.<device_id>.<alert_type>.", so that a subscriber can filter
+ *                        on "alert.", on one device or on one device's alerts of one type
+ *      the event       - this struct, then its element_name_size bytes of element name (no NUL)
+ * The event is in the monitor's own byte order, and every field is at its natural alignment.
+ ************************************************/
+typedef struct
+{
+    uint8_t             version;                    // ALERT_EVENT_VERSION
+    uint8_t             element_type;
+    int16_t             alert_type;
+    uint32_t            alert_count;                // 1, or the alerts a summary record stands for
+    uint64_t            monitor_id;
+    uint64_t            device_id;
+    int64_t             alert_date;                 // seconds since the epoch
+    int64_t             first_alert_date;           // the same as alert_date, except for a summary record
+    uint8_t             scan_value[SIZE_HASH_ELEMENT];
+    uint32_t            element_name_size;
+    uint32_t            reserved;
+} csl_alert_event;
+
 /************************************************
  * Crytica Standard Record
  ************************************************/
@@ -368,6 +414,19 @@ typedef struct
     time_t              cs_standard_date;
 } csl_monitor_device_record;
 
+/************************************************
+ * Monitor Device List
+ * The monitor's devices as monitorConfigUpdate() reads them, before they are swapped in as device shards.
+ * It holds at most max_devices rows - the devices past those are only counted, in dropped_ctr.
+ ************************************************/
+typedef struct
+{
+    csl_monitor_device_record   *rows;
+    unsigned int                row_ctr;
+    unsigned int                max_rows;
+    unsigned int                dropped_ctr;
+} monitor_device_list;
+
 
 /************************************************
  * Status Quo Table
@@ -386,6 +445,91 @@ typedef struct
 //    char            alerting_probe;     not yet needed     // This is bit array in the one byte char
 } status_quo_record;
 
+/************************************************
+ * Status Quo Diff
+ * The scan elements statusQuoTableSearch() has matched to a status quo row, waiting to be compared a block at a
+ * time (see csl_diff.h). Row r of the block is scan element scan_rows[r] against status quo row status_quo_rows[r],
+ * and the compare bitmaps hold the rows whose element type is checked for that change (element_compare_masks[]).
+ ************************************************/
+typedef struct
+{
+    csl_diff_block      block;
+    unsigned int        scan_rows[DIFF_BLOCK_ROWS];
+    unsigned int        status_quo_rows[DIFF_BLOCK_ROWS];
+    uint64_t            compare_contents;
+    uint64_t            compare_attributes;
+} status_quo_diff;
+
+/************************************************
+ * Scan Session
+ * A scan session follows one device's scan from PROBE_START_SCAN to PROBE_END_SCAN. Each device has its own,
+ * so the monitor can receive scans from several devices at once.
+ *  - A session that hears nothing from its device (no scan record and no heart beat) for scan_session_timeout_sec
+ *    is suspended and the device's scan grant is returned
+ *  - A suspended session keeps the rows already received for scan_resume_window_sec. If the device starts its
+ *    scan again with SCAN_RESUME_DIRECTIVE naming exactly that many rows, the session carries on from there.
+ *    Otherwise the rows are discarded and the scan starts afresh.
+ ************************************************/
+typedef struct
+{
+    short               state;              // SCAN_SESSION_IDLE, SCAN_SESSION_ACTIVE or SCAN_SESSION_SUSPENDED
+    int64_t             last_activity;      // zclock_mono() of the last scan record or heart beat
+    int64_t             suspended_at;       // zclock_mono() of the suspension
+} scan_session;
+
+/************************************************
+ * Alert Aggregation
+ * A device's scan alerts are collapsed by directory and alert type over alert_window_sec:
+ *  - The first alert of each directory and type in a window is written as it happens, up to alert_device_rate
+ *    of them per device per window
+ *  - The rest are held as a count, and written as one summary record when the window closes. Its element_name
+ *    is the directory (or the element, when every held alert named the same one) and its alert_data the count.
+ * A package upgrade touching thousands of files in a few directories so writes a few alerts and a few summaries,
+ * and a file that changes on every scan alerts about twice per window rather than on every scan.
+ ************************************************/
+typedef struct
+{
+    short           alert_type;
+    unsigned short  element_type;
+    bool            leading_written;        // the window's first alert of this kind went out as it happened
+    char            *directory;
+    char            *element_name;          // the element all the held alerts name, NULL once they differ
+    unsigned int    held_ctr;               // alerts counted but not yet written
+    time_t          first_date;             // of the held alerts
+    time_t          last_date;
+} alert_bucket;
+
+typedef struct
+{
+    time_t          window_start;           // 0 when no window is open
+    unsigned int    written_ctr;            // alerts written as they happened this window
+    alert_bucket    *buckets;
+    unsigned int    bucket_ctr;
+    unsigned int    bucket_capacity;
+} alert_aggregator;
+
+/************************************************
+ * Device Shard
+ * A device shard holds all of the per-device state: the device record, its status quo column and the
+ * scan table of its current scan. Each shard carries its own lock, so scans, heart beats and config updates
+ * for different devices never contend with one another.
+ * The shard registry (the array of shard pointers and the device_ctr) is guarded separately by a
+ * read/write lock in main.c.
+ ************************************************/
+typedef struct
+{
+    pthread_mutex_t     shard_lock;         // Guards every field below
+    device_record       device;
+    status_quo_record   *status_quo;        // One row per scanned element
+    unsigned int        status_quo_capacity;    // rows allocated in status_quo
+    bool                status_quo_ordered; // status_quo is in element_identifier order
+    scan_structure      *scan_table;        // Allocated when the device's first scan arrives
+    scan_session        session;            // The device's scan in progress, if any
+    size_t              memory_bytes;       // Memory used by this device's tables
+    alert_aggregator    alerts;             // The scan alerts held back this window
+    unsigned long long  spool_sequence;     // The last spooled write of its standard or element names (csl_spool.h)
+} device_shard;
+
 
 /**************************************************************************************************
  * ************************************************************************************************
@@ -462,8 +606,8 @@ bool alertOnElementAddition(unsigned short device_index, csl_scan_record scan_el
 /************************************************
  * bool alertOnElementDeletion
  *  @param
+ *          unsigned short      device_index
  *          status_quo_record   deleted_record
- *          unsigned long long  device_id
  *          time_t              scan_date
  *
  *  @brief
@@ -474,7 +618,7 @@ bool alertOnElementAddition(unsigned short device_index, csl_scan_record scan_el
  *
  *  @return true on success, false on failure
  ************************************************/
-bool alertOnElementDeletion (status_quo_record deleted_record, unsigned long long device_id, time_t scan_date);
+bool alertOnElementDeletion (unsigned short device_index, status_quo_record deleted_record, time_t scan_date);
 
 /************************************************
  * bool alertOnElementModification()
@@ -507,6 +651,77 @@ bool    alertOnElementModification(unsigned short device_index, csl_scan_record
  ************************************************/
 int     alertScanWriteRecord (scan_alert_record *alert_record);
 
+/************************************************
+ * int alertScanSubmit()
+ *  @param
+ *          unsigned short      device_index
+ *          scan_alert_record   *alert_record
+ *
+ *  @brief  Writes a scan alert, or holds it for the window's summary (see Alert Aggregation in CryticaMonitor.h)
+ *
+ *  @author Kerry
+ *
+ *  @note   The caller holds the device's shard_lock
+ *
+ *  @return CS_SUCCESS  - on a successful write, or when the alert is held
+ *          error-code  - on failure
+ ************************************************/
+int     alertScanSubmit(unsigned short device_index, scan_alert_record *alert_record);
+
+/************************************************
+ * alert_bucket *alertBucketFind()
+ *  @param
+ *          alert_aggregator    *aggregator
+ *          scan_alert_record   *alert_record
+ *
+ *  @brief  Finds, or adds, the bucket for the alert's directory and type
+ *
+ *  @author Kerry
+ *
+ *  @note   Once a device has ALERT_MAX_BUCKETS - ALERT_SCAN_TYPES buckets, alerts from any other directory share
+ *          an ALERT_OTHER_DIRECTORY bucket for their type, so a device never has more than ALERT_MAX_BUCKETS
+ *
+ *  @return The bucket, or NULL if there was no memory for it
+ ************************************************/
+alert_bucket *alertBucketFind(alert_aggregator *aggregator, scan_alert_record *alert_record);
+
+/************************************************
+ * void alertAggregateFlush()
+ *  @param
+ *          unsigned short  device_index
+ *          bool            force           - Close the window even if it is not over
+ *
+ *  @brief  Closes a device's alert window once it is over, writing a summary record for each bucket holding alerts
+ *
+ *  @author Kerry
+ *
+ *  @note   The caller holds the device's shard_lock (or the registry's write lock)
+ ************************************************/
+void    alertAggregateFlush(unsigned short device_index, bool force);
+
+/************************************************
+ * void alertAggregateFlushAll()
+ *  @param  - None
+ *
+ *  @brief  Closes every device's alert window, writing the summaries still held
+ *
+ *  @author Kerry
+ *
+ *  @note   Called at shut down, while the database can still take them, and by monitorConfigUpdate() before
+ *          it releases the shards
+ ************************************************/
+void    alertAggregateFlushAll();
+
+/************************************************
+ * void alertAggregateRelease()
+ *  @param  alert_aggregator *aggregator
+ *
+ *  @brief  Frees an aggregator's buckets, without writing what they hold
+ *
+ *  @author Kerry
+ ************************************************/
+void    alertAggregateRelease(alert_aggregator *aggregator);
+
 /************************************************
  *      Config File Processing Functions
  ************************************************/
@@ -549,7 +764,10 @@ bool    configFileCreate(monitor_comm_params *comms);
  *
  *          This function queries the cs_monitor database to find any devices that require a new Crytica Standard.
  *          For those that do, it sets:
- *              device_table->cs_standard_flag = true   // the device needs a new Crytica Standard
+ *              shard->device.cs_standard_flag = true   // the device needs a new Crytica Standard
+ *
+ *          A device whose last Crytica Standard is still in the spool (see csl_spool.h) is passed over - its
+ *          date update has not reached the database yet, so it would be found again.
  *
  *  @return Success - number of devices found
  *          Failure - ERROR Code
@@ -562,11 +780,13 @@ int    cStandardNeeded();
  *          unsigned long long   monitor_id
  *          unsigned long long   device_id
  *          unsigned short       element_identifier
+ *          unsigned long long   spool_sequence     - The device's last spooled standard write (see device_shard)
  *
  *  @brief  Queries the cs_monitor.v_cs_standard View to find the current record of a CS-Standard for
  *          a specific element on a specific device.
  *
- *  @note   At the moment, all we are retrieving are the element_name and element_type
+ *  @note   At the moment, all we are retrieving are the element_name and element_type.
+ *          The device's own spooled writes are waited for first, so that its latest standard is read
  *
  *  @author Kerry
  *
@@ -576,7 +796,8 @@ int    cStandardNeeded();
 cs_standard_record *cStandardReadRecord(
         unsigned long long  monitor_id,
         unsigned long long  device_id,
-        byte                *element_identifier);
+        byte                *element_identifier,
+        unsigned long long  spool_sequence);
 
 /************************************************
  * int cStandardWriteRecord()
@@ -749,7 +970,7 @@ short   deviceFindByDeviceIdentifier(byte *device_identifier);
  *          This function returns the row number corresponding to a
  *          specific device, identified by the device's unique probe_id
  *
- *          The probe_id is monitor_id + ((device_index + 1) / MAX_DEVICES)
+ *          The probe_id is monitor_id + ((device_index + 1) / PROBE_ID_DEVICE_BASE)
  *
  * @return the row number (the device_index) of the found device or an error code: CS_DEVICE_NOT_FOUND
  ************************************************/
@@ -771,6 +992,100 @@ short   deviceFindByProbeID(double probe_id);
  ************************************************/
 short   deviceRegisterNew(byte *device_identifier, unsigned long long device_id, byte *device_mac_address);
 
+/************************************************
+ * bool deviceMemoryCharge()
+ *  @param
+ *          device_shard    *shard
+ *          long long       delta_bytes     - positive when memory is allocated, negative when it is freed
+ *
+ *  @brief  Accounts for memory allocated to (or freed from) a device's tables
+ *
+ *  @author Kerry
+ *
+ *  @note   An allocation that would take the monitor past the configured max_memory_mb is refused
+ *
+ *  @return true if the memory was charged, false if it would exceed the budget
+ ************************************************/
+bool    deviceMemoryCharge(device_shard *shard, long long delta_bytes);
+
+/************************************************
+ * bool deviceShardGrowTable()
+ *  @param
+ *          device_shard    *shard
+ *          void            **table         - The table to grow (status quo rows or scan rows)
+ *          unsigned int    *capacity       - The number of rows currently allocated in the table
+ *          size_t          row_size
+ *          unsigned int    needed_rows     - The number of rows the table must hold
+ *
+ *  @brief  Grows one of a device's tables so that it holds at least needed_rows rows
+ *
+ *  @author Kerry
+ *
+ *  @note   The caller must hold the shard's lock (or own the shard exclusively)
+ *
+ *  @return true on success, false if the table would exceed max_elements or the memory budget
+ ************************************************/
+bool    deviceShardGrowTable(device_shard *shard, void **table, unsigned int *capacity, size_t row_size,
+                             unsigned int needed_rows);
+
+/************************************************
+ * device_shard *deviceShardLock()
+ *  @param
+ *          short device_index
+ *
+ *  @brief  Returns the shard of a registered device with its shard_lock held
+ *
+ *  @author Kerry
+ *
+ *  @note   Every deviceShardLock() must be paired with a deviceShardUnlock() of the same shard. The registry
+ *          read lock is held until then, so the shard cannot be released under its holder - never take the
+ *          registry write lock while holding a shard
+ *
+ *  @return Success - a pointer to the locked shard
+ *          Failure - NULL if the device_index is not registered
+ ************************************************/
+device_shard *deviceShardLock(short device_index);
+
+/************************************************
+ * device_shard *deviceShardNew()
+ *  @param
+ *          short device_index
+ *
+ *  @brief  Allocates and initializes the shard for the device at device_index
+ *
+ *  @author Kerry
+ *
+ *  @note   The caller must hold the device registry lock for writing
+ *
+ *  @return Success - a pointer to the new shard
+ *          Failure - NULL
+ ************************************************/
+device_shard *deviceShardNew(short device_index);
+
+/************************************************
+ * void deviceShardsRelease()
+ *  @param  - None
+ *
+ *  @brief  Frees every device shard and resets the device counter
+ *
+ *  @author Kerry
+ *
+ *  @note   The caller must hold the device registry lock for writing. Alert summaries still held are dropped -
+ *          write them first, with alertAggregateFlushAll()
+ ************************************************/
+void    deviceShardsRelease();
+
+/************************************************
+ * void deviceShardUnlock()
+ *  @param
+ *          device_shard *shard
+ *
+ *  @brief  Releases a shard obtained from deviceShardLock(), and the registry read lock taken with it
+ *
+ *  @author Kerry
+ ************************************************/
+void    deviceShardUnlock(device_shard *shard);
+
 
 /************************************************
  * char *elementNameRetrieve(()
@@ -778,11 +1093,13 @@ short   deviceRegisterNew(byte *device_identifier, unsigned long long device_id,
  *          unsigned long long   monitor_id
  *          unsigned long long   device_id
  *          unsigned short       element_identifier
+ *          unsigned long long   spool_sequence     - The device's last spooled name write (see device_shard)
  *
  *  @brief  Queries the cs_monitor.v_element_names View to find the full element name fo
  *          a specific element on a specific device.
  *
- *  @note   This is not necessary for releases prior to 0.5.0, since we are storing the element name in those
+ *  @note   This is not necessary for releases prior to 0.5.0, since we are storing the element name in those.
+ *          The device's own spooled writes are waited for first, so that a name just added is found
  *
  *  @author Kerry
  *
@@ -791,7 +1108,8 @@ short   deviceRegisterNew(byte *device_identifier, unsigned long long device_id,
 char *elementNameRetrieve(
         unsigned long long  monitor_id,
         unsigned long long  device_id,
-        byte                *element_identifier);
+        byte                *element_identifier,
+        unsigned long long  spool_sequence);
 
 
 /************************************************
@@ -806,9 +1124,9 @@ char *elementNameRetrieve(
  *  @brief
  *      Checks to see if a message has originated from:
  *          A device the monitor has already registered
- *              - the global variable current_device_index is set, and CS_SUCCESS is returned
+ *              - its device_index is returned
  *          An authorized device the monitor has not yet registered
- *              - the new device is registered, current_device_index is set and CS_SUCCESS is returned
+ *              - the new device is registered and its new device_index is returned
  *          An unauthorized device
  *              - an alert is issued (CS_ALERT_DEVICE_UNKNOWN) and CS_DEVICE_UNKNOWN is returned
  *
@@ -824,14 +1142,18 @@ int     messageCheckOrigin();
  * int messageHandshakeProccess()
  *  @param csl_zmessage     *current_message    - The incoming message
  *  @param monitor_comms_t  *comms              - The CZMQ parameter file
+ *  @param short            device_index        - The device that sent the handshake
  *
  *  @brief  Calls the csl_AcknowledgeHandshake function after a handshake message is received
  *
  *  @author Kerry
  *
+ *  @note   The device keeps the capabilities the probe offered that the monitor agrees to (ordered_scans in the
+ *          monitor config allows PROBE_CAPABILITY_ORDERED_SCAN), and the reply names them
+ *
  *  @return the result of the csl_AcknowledgeHandshake function
  ************************************************/
-int     messageHandshakeProccess(csl_zmessage *current_message, monitor_comms_t *comms);
+int     messageHandshakeProccess(csl_zmessage *current_message, monitor_comms_t *comms, short device_index);
 
 /************************************************
  * bool messageHeartBeatProcess()
@@ -882,8 +1204,39 @@ int     messageUnknownProcess(int message_type, short device_id);
 
 int     monitorConfigDBQuery (bool db_sync_just_launched);
 
+/************************************************
+ * int monitorConfigUpdate()
+ *  @param  - None
+ *
+ *  @brief  Reloads the monitor's devices from the database, replacing every device shard
+ *
+ *  @author Kerry
+ *
+ *  @note   The devices are read into a monitor_device_list first, and the registry write lock is only held to
+ *          swap them in - no database work is done under it
+ *
+ *  @return CS_SUCCESS, or an error code
+ ************************************************/
 int monitorConfigUpdate();
 
+/************************************************
+ * int monitorDeviceRowLoad()
+ *  @param
+ *          void            *context        - The monitor_device_list being read
+ *          unsigned int    column_ctr
+ *          char            **fields        - device_id, device_identifier
+ *
+ *  @brief  A storage row function (see csl_storage.h) that adds a row of the monitor device view to a
+ *          monitor_device_list
+ *
+ *  @author Kerry
+ *
+ *  @note   Called by monitorConfigUpdate() without the registry lock - no device shard is touched
+ *
+ *  @return CS_SUCCESS for the next row (a row past max_devices is counted as dropped), an error code on failure
+ ************************************************/
+int monitorDeviceRowLoad(void *context, unsigned int column_ctr, char **fields);
+
 /************************************************
  * int monitorInitialize()
  *  @param  None
@@ -909,6 +1262,21 @@ int monitorConfigUpdate();
  ************************************************/
 int    monitorInitialize();
 
+/************************************************
+ * int monitorTablesInitialize()
+ *  @param  None
+ *
+ *  @brief  Sets up the monitor's in-memory tables - the G_monitor_table, the scheduler and the metrics - from
+ *          the runtime config, without touching the network or the database
+ *
+ *  @author Kerry
+ *
+ *  @note   Split out of monitorInitialize() so that csl_bench can drive the scan and status quo functions
+ *
+ *  @return CS_SUCCESS or CS_FATAL_ERROR
+ ************************************************/
+int    monitorTablesInitialize();
+
 /************************************************
  * bool monitorShutdown()
  *  @param  None
@@ -930,7 +1298,6 @@ bool    monitorShutDown();
  *      Scan Functions
  *      ==============
  ************************************************/
-short scan_get_next_index(short previous_scan_index);
 
 /************************************************
  * bool scanEvaluate()
@@ -945,10 +1312,57 @@ short scan_get_next_index(short previous_scan_index);
  *
  *  @author Kerry
  *
+ *  @note   A scan from a device that agreed to PROBE_CAPABILITY_ORDERED_SCAN, and that did arrive in order, is
+ *          evaluated by statusQuoTableMerge() instead
+ *
  *  @return true on success, false on failure
  ************************************************/
 bool scanEvaluate(short device_index);
 
+/************************************************
+ * bool scanGrantTake()
+ *  @param  device_shard *shard  - The device asking, whose shard lock the caller holds
+ *
+ *  @brief  Decides whether a heartbeating device may be told to start a scan.
+ *          A grant is given only if:
+ *              the device does not already hold one
+ *              fewer than max_concurrent_scans grants are out
+ *              the decoded-scan queue is no deeper than scan_queue_high
+ *              the scan scheduler says the device is next (see csl_scheduler.h)
+ *
+ *  @author Kerry
+ *
+ *  @note   A grant not returned within scan_grant_timeout_sec (the probe died mid-scan, or the scan was
+ *          dropped) is reclaimed here, on the device's next heartbeat
+ *
+ *  @return true if the device may scan, false if it should wait
+ ************************************************/
+bool scanGrantTake(device_shard *shard);
+
+/************************************************
+ * void scanGrantReturn()
+ *  @param
+ *          device_shard    *shard      - The device whose shard lock the caller holds
+ *          bool            scanned     - true if the device's scan was received and evaluated
+ *
+ *  @brief  Gives back the device's scan grant, if it holds one, and tells the scheduler how the scan went
+ *
+ *  @author Kerry
+ ************************************************/
+void scanGrantReturn(device_shard *shard, bool scanned);
+
+/************************************************
+ * void scanGrantRelease()
+ *  @param
+ *          short   device_index
+ *          bool    scanned         - true if the device's scan was received and evaluated
+ *
+ *  @brief  Gives back the device's scan grant under its shard lock, once its scan has been evaluated
+ *
+ *  @author Kerry
+ ************************************************/
+void scanGrantRelease(short device_index, bool scanned);
+
 /************************************************
  * bool scanRequest()
  *  @param
@@ -969,34 +1383,88 @@ bool    scanRequest(short device_index);
 
 /************************************************
  * int scanTableAddRow()
- *  @param  csl_scan_record *new_scan
+ *  @param
+ *          csl_scan_record *new_scan
+ *          short           device_index
  *
- *  @brief  Adds a row to the scan table
+ *  @brief  Adds a row to the scan table of the device's active scan session
  *
  *  @author Kerry
  *
- * @return CS_SUCCESS
+ * @return CS_SUCCESS, CS_ERROR if the device has no active scan session, or CS_TABLE_OVERFLOW
  ************************************************/
 int scanTableAddRow(csl_scan_record *new_scan, short device_index);
 
 /************************************************
- * short scanTableInitialize()
+ * int scanSessionStart()
+ *  @param
+ *          short           device_index
+ *          unsigned int    resume_from     - The rows the probe says were already sent, 0 for a fresh scan
+ *
+ *  @brief  Opens the device's scan session when its PROBE_START_SCAN arrives
+ *
+ *  @author Kerry
+ *
+ *  @note   A suspended session holding exactly resume_from rows is resumed. Anything else starts a fresh scan:
+ *          the scan table is allocated the first time the device scans and is then reused.
+ *
+ * @return the scan rows already held (0 for a fresh scan) on success, an error code on failure
+ ************************************************/
+int scanSessionStart(short device_index, unsigned int resume_from);
+
+/************************************************
+ * bool scanSessionEnd()
+ *  @param  short device_index
+ *
+ *  @brief  Closes the device's scan session when its PROBE_END_SCAN arrives
+ *
+ *  @author Kerry
+ *
+ * @return true if the session was active and its scan table is ready to evaluate, false otherwise
+ ************************************************/
+bool scanSessionEnd(short device_index);
+
+/************************************************
+ * void scanSessionsExpire()
  *  @param  - None
  *
- *  @brief  Initializes all of the values in the scan_table
+ *  @brief  Suspends the scan sessions that have stalled, and discards the suspended sessions that were not
+ *          resumed in time (see Scan Session)
  *
  *  @author Kerry
  *
- *  @note   This is called each time a new scan is received from a probe. It is possible that
- *          we can get away with setting:
- *              scan_table.scan_element_ctr = ZERO;
- *          or perhaps setting
- *              scan_table.scan_elements[i].scan_id = 0L;
- *          but we shall see
+ *  @note   This is called on every pass of the message loop, but only looks at the sessions once every
+ *          SCAN_SESSION_CHECK_MSEC
+ ************************************************/
+void scanSessionsExpire();
+
+/************************************************
+ * unsigned int scanSessionResumePoint()
+ *  @param  device_shard *shard  - The device, whose shard lock the caller holds
+ *
+ *  @brief  Returns the scan rows a suspended session holds, so its device can resume after them
+ *
+ *  @author Kerry
  *
- * @return CS_SUCCESS
+ * @return the rows held, or 0 if the device has no suspended session
  ************************************************/
-int scanTableInitialize(short device_index);
+unsigned int scanSessionResumePoint(device_shard *shard);
+
+/************************************************
+ * int scanTableReset()
+ *  @param
+ *          scan_structure  *scan_table
+ *          short           device_index
+ *
+ *  @brief  Initializes all of the values in a scan table and marks it as belonging to device_index
+ *
+ *  @author Kerry
+ *
+ *  @note   The caller must hold the owning shard's lock. A device_index of -1 marks the table as idle.
+ *
+ * @return scan_element_ctr
+ ************************************************/
+int scanTableReset(scan_structure *scan_table, short device_index);
 
 
 /************************************************
@@ -1008,7 +1476,7 @@ int scanTableInitialize(short device_index);
  * bool statusQuoTableAddRow ()
  *  @param
  *          unsigned short device_index
- *          unsigned short sq_table_row
+ *          unsigned int   sq_table_row
  *          csl_scan_record scanRecord
  *
  *  @brief  This function adds a row to the column in the Status Quo Table associated with a specific device.
@@ -1019,7 +1487,7 @@ int scanTableInitialize(short device_index);
  *
  * @return  true on success, false on failure
  ************************************************/
-bool    statusQuoTableAddRow(unsigned short device_index, unsigned short sq_table_position, csl_scan_record scanRecord);
+bool    statusQuoTableAddRow(unsigned short device_index, unsigned int sq_table_position, csl_scan_record scanRecord);
 
 /************************************************
  * bool statusQuoTableBuild()
@@ -1040,7 +1508,7 @@ bool    statusQuoTableBuild(unsigned short device_index);
  * bool statusQuoTableRemoveRow()
  *  @param
  *          unsigned short device_index
- *          unsigned short row_number
+ *          unsigned int   row_number
  *
  *  @brief  Removes the specified row from the column in the Status Quo Table associated with a specific device.
  *          It then "closes up the gap" by moving all of the lower rows up.
@@ -1049,10 +1517,10 @@ bool    statusQuoTableBuild(unsigned short device_index);
  *
  *  @return true on success, false on failure
  ************************************************/
-bool    statusQuoTableRemoveRow(unsigned short device_index, unsigned short row_number);
+bool    statusQuoTableRemoveRow(unsigned short device_index, unsigned int row_number);
 
 /************************************************
- * short statusQuoTableSearch
+ * int statusQuoTableSearch
  *  @param
  *          short           device_index    - The device column to search
  *          scan_structure  the_scan        - The scan data from the latest scan
@@ -1077,7 +1545,8 @@ bool    statusQuoTableRemoveRow(unsigned short device_index, unsigned short row_
  *
  *      Pass #1
  *      -------
- *      Modified Elements are determined by a direct comparison with the associated values in the Status Quo Table
+ *      Modified Elements are determined by a direct comparison with the associated values in the Status Quo Table,
+ *      made DIFF_BLOCK_ROWS matched elements at a time by csl_DiffBlock() (see statusQuoTableDiffFlush())
  *      Additions are determined by there not being an associated value in the Status Quo Table
  *      For additions and modifications, each discrepancy is flagged and the alert_code field in the
  *      Status Quo Table is updated appropriately. The alert_code field is a single byte (unsigned char) field
@@ -1099,10 +1568,98 @@ bool    statusQuoTableRemoveRow(unsigned short device_index, unsigned short row_
  *      For every entry touched on Pass #2, when it is examined, its COMPARED bit is set back to 0x0.
  *
  * @return  on success, the number of alerts found
- *          On failure, an error code (not yet implemented)
+ *          On failure, CS_ERROR (a count is never negative)
+ ************************************************/
+int     statusQuoTableSearch(short device_index);
+//int     statusQuoTableSearch(short device_index, scan_structure the_scan);
+
+/************************************************
+ * int statusQuoTableMerge
+ *  @param  short device_index  - The device column to search
+ *
+ *  @brief  Compares an ordered scan with the Status Quo Table in one merge of the two, and finds the same
+ *          modifications, additions and deletions statusQuoTableSearch() does
+ *
+ *  @author Kerry
+ *
+ *  @note
+ *      **** Caution: This function uses bit-wise operators ****
+ *
+ *      The scan must be in element_name_hash order (scan_structure.ordered). The Status Quo Table is sorted into
+ *      element_identifier order first, if it is not already, and kept in that order, so each scan after the first
+ *      is one pass down both tables:
+ *          * The same element in both  - compared a block at a time, as in statusQuoTableSearch()
+ *          * Only in the scan          - an addition. The row is appended, and merged into place at the end.
+ *          * Only in the table         - a deletion. The row is left without its COMPARED bit, and the table is
+ *                                        closed up in one pass once the alerts are sent.
+ *      A duplicated element_name_hash is not in order, so such a scan is always searched.
+ *
+ * @return  on success, the number of alerts found
+ *          On failure, CS_ERROR
+ ************************************************/
+int     statusQuoTableMerge(short device_index);
+
+/************************************************
+ * int statusQuoTableAddElement
+ *  @param
+ *          short           device_index
+ *          unsigned int    scan_index      - The scan element that is not in the Status Quo Table
+ *
+ *  @brief  Appends a row for an added element, flags it, alerts on it and records it in the element_added_names view
+ *
+ *  @author Kerry
+ *
+ *  @note   An appended row is out of order, so status_quo_ordered is cleared
+ *
+ *  @return the number of alerts raised
+ ************************************************/
+int     statusQuoTableAddElement(short device_index, unsigned int scan_index);
+
+/************************************************
+ * int statusQuoRowCompare
+ *  @param
+ *          const void  *row_one    - status_quo_record
+ *          const void  *row_two    - status_quo_record
+ *
+ *  @brief  Orders Status Quo Table rows by element_identifier, for qsort()
+ *
+ *  @author Kerry
+ *
+ *  @return <0, 0 or >0, as memcmp()
+ ************************************************/
+int     statusQuoRowCompare(const void *row_one, const void *row_two);
+
+/************************************************
+ * int statusQuoTableDiffAddRow
+ *  @param
+ *          short               device_index
+ *          status_quo_diff     *diff
+ *          unsigned int        scan_index      - The scan element
+ *          unsigned int        sq_index        - The status quo row it matched
+ *
+ *  @brief  Adds a matched pair to the diff block, and compares the block once it is full
+ *
+ *  @author Kerry
+ *
+ *  @return the number of alerts raised
+ ************************************************/
+int     statusQuoTableDiffAddRow(short device_index, status_quo_diff *diff, unsigned int scan_index,
+                                 unsigned int sq_index);
+
+/************************************************
+ * int statusQuoTableDiffFlush
+ *  @param
+ *          short               device_index
+ *          status_quo_diff     *diff
+ *
+ *  @brief  Compares the pairs in the diff block, and for each set bit of the change bitmaps raises the alert and
+ *          updates the status quo row, as statusQuoTableSearch() describes. The block is then emptied.
+ *
+ *  @author Kerry
+ *
+ *  @return the number of alerts raised
  ************************************************/
-short   statusQuoTableSearch(short device_index);
-//short   statusQuoTableSearch(short device_index, scan_structure the_scan);
+int     statusQuoTableDiffFlush(short device_index, status_quo_diff *diff);
 
 #endif //CRYTICAMONITOR_CRYTICAMONITOR_H
 
@@ -0,0 +1,196 @@
+//
+// Created by kerry on 10/19/26.
+//
+
+#include "csl_arena.h"
+
+/************************************************
+ * The Thread Arenas
+ * =================
+ * Each thread gets its own message and scan arena, so no locking is ever needed.
+ * A block_size of zero marks an arena that has not yet been initialized.
+ ************************************************/
+static __thread csl_arena G_message_arena;
+static __thread csl_arena G_scan_arena;
+
+/************************************************
+ * void csl_ArenaInit()
+ *  @param
+ *          csl_arena   *arena
+ *          size_t      block_size
+ *
+ *  @brief  Prepares an empty arena. No memory is allocated until the first csl_ArenaAlloc()
+ *
+ *  @author Kerry
+ ************************************************/
+void    csl_ArenaInit(csl_arena *arena, size_t block_size)
+{
+    arena->head         = NULL;
+    arena->current      = NULL;
+    arena->block_size   = block_size;
+    arena->high_water   = 0;
+    arena->in_use       = 0;
+}
+
+/************************************************
+ * void *csl_ArenaAlloc()
+ *  @param
+ *          csl_arena   *arena
+ *          size_t      size
+ *
+ *  @brief  Returns size bytes of zeroed memory, aligned to ARENA_ALIGNMENT
+ *
+ *  @author Kerry
+ *
+ *  @note   The current block is used if it has room, then any spare blocks kept from before the last reset,
+ *          and only then is a new block allocated.
+ *
+ *  @return Success - a pointer to the memory
+ *          Failure - NULL
+ ************************************************/
+void    *csl_ArenaAlloc(csl_arena *arena, size_t size)
+{
+    size = (size + ARENA_ALIGNMENT - 1) & ~((size_t) ARENA_ALIGNMENT - 1);
+
+    csl_arena_block *block = arena->current;
+    while (block != NULL && block->size - block->used < size)
+    {
+        block = block->next;
+        if (block != NULL)
+        {
+            block->used = 0;
+        }
+    }
+
+    if (block == NULL)
+    {
+        size_t block_size = size > arena->block_size ? size : arena->block_size;
+        block = malloc(sizeof(csl_arena_block) + block_size);
+        if (block == NULL)
+        {
+            printf("\t<%s> ERROR: Could not allocate arena block of [%zu] bytes\n", __PRETTY_FUNCTION__, block_size);
+            return NULL;
+        }
+        block->size = block_size;
+        block->used = 0;
+        block->next = NULL;
+        if (arena->current == NULL)
+        {
+            block->next = arena->head;
+            arena->head = block;
+        }
+        else
+        {
+            // Splice in after the current block so any spare blocks after it are still reachable
+            block->next             = arena->current->next;
+            arena->current->next    = block;
+        }
+    }
+    arena->current  = block;
+
+    void *memory    = block->data + block->used;
+    block->used     += size;
+    arena->in_use   += size;
+    if (arena->in_use > arena->high_water)
+    {
+        arena->high_water = arena->in_use;
+    }
+    memset(memory, NULL_BINARY, size);
+    return memory;
+}
+
+/************************************************
+ * char *csl_ArenaStrdup()
+ *  @param
+ *          csl_arena   *arena
+ *          const char  *string
+ *
+ *  @brief  Copies a string into the arena
+ *
+ *  @author Kerry
+ *
+ *  @return Success - a pointer to the copy
+ *          Failure - NULL
+ ************************************************/
+char    *csl_ArenaStrdup(csl_arena *arena, const char *string)
+{
+    size_t length   = strlen(string);
+    char *copy      = csl_ArenaAlloc(arena, length + 1);
+    if (copy != NULL)
+    {
+        memcpy(copy, string, length);
+    }
+    return copy;
+}
+
+/************************************************
+ * void csl_ArenaReset()
+ *  @param  csl_arena *arena
+ *
+ *  @brief  Gives back everything allocated from the arena, keeping its blocks for reuse
+ *
+ *  @author Kerry
+ ************************************************/
+void    csl_ArenaReset(csl_arena *arena)
+{
+    if (arena->head != NULL)
+    {
+        arena->head->used   = 0;
+    }
+    arena->current  = arena->head;
+    arena->in_use   = 0;
+}
+
+/************************************************
+ * void csl_ArenaDestroy()
+ *  @param  csl_arena *arena
+ *
+ *  @brief  Frees every block of the arena
+ *
+ *  @author Kerry
+ ************************************************/
+void    csl_ArenaDestroy(csl_arena *arena)
+{
+    csl_arena_block *block = arena->head;
+    while (block != NULL)
+    {
+        csl_arena_block *next = block->next;
+        free(block);
+        block = next;
+    }
+    csl_ArenaInit(arena, arena->block_size);
+}
+
+/************************************************
+ * csl_arena *csl_ArenaMessage()
+ *  @param  - None
+ *
+ *  @brief  Returns the calling thread's per-message arena
+ *
+ *  @author Kerry
+ ************************************************/
+csl_arena *csl_ArenaMessage()
+{
+    if (G_message_arena.block_size == 0)
+    {
+        csl_ArenaInit(&G_message_arena, ARENA_MESSAGE_BLOCK_SIZE);
+    }
+    return &G_message_arena;
+}
+
+/************************************************
+ * csl_arena *csl_ArenaScan()
+ *  @param  - None
+ *
+ *  @brief  Returns the calling thread's per-scan arena
+ *
+ *  @author Kerry
+ ************************************************/
+csl_arena *csl_ArenaScan()
+{
+    if (G_scan_arena.block_size == 0)
+    {
+        csl_ArenaInit(&G_scan_arena, ARENA_SCAN_BLOCK_SIZE);
+    }
+    return &G_scan_arena;
+}
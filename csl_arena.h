@@ -0,0 +1,151 @@
+
+/************************************************
+ * csl_arena.h
+ * ===========
+ *
+ * This is the header file for the CS Arena Library
+ *
+ * Author:      Kerry
+ * Version:     00.00.00
+ * Comments:    Bump allocators for short-lived temporaries
+ ************************************************/
+
+#ifndef CRYTICAMONITOR_CSL_ARENA_H
+#define CRYTICAMONITOR_CSL_ARENA_H
+
+#include <stdio.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "csl_constants.h"
+
+/************************************************
+ * #defines
+ * ========
+ ************************************************/
+#define ARENA_ALIGNMENT             16
+#define ARENA_MESSAGE_BLOCK_SIZE    (64 * 1024)     // One message never needs more than a few KB
+#define ARENA_SCAN_BLOCK_SIZE       (1024 * 1024)   // A scan evaluation formats a few strings per changed element
+
+/************************************************
+ * Arena
+ * =====
+ * An arena hands out memory by bumping a pointer through a chain of large blocks, and gives it all back at once
+ * with csl_ArenaReset(). Nothing allocated from an arena is ever freed individually.
+ *
+ * csl_ArenaReset() keeps the blocks, so once an arena has grown to its working size the hot path makes no
+ * further calls to malloc or free.
+ *
+ * Each thread has two arenas of its own:
+ *      csl_ArenaMessage()  - for temporaries of the message currently being handled, reset before the next receive
+ *      csl_ArenaScan()     - for temporaries of the scan currently being evaluated, reset once the scan is evaluated
+ ************************************************/
+typedef struct csl_arena_block
+{
+    struct csl_arena_block  *next;
+    size_t                  size;           // usable bytes in data[]
+    size_t                  used;
+    byte                    data[];
+} csl_arena_block;
+
+typedef struct
+{
+    csl_arena_block     *head;
+    csl_arena_block     *current;
+    size_t              block_size;         // size of each new block, unless a single request is larger
+    size_t              high_water;         // most bytes ever in use between two resets
+    size_t              in_use;
+} csl_arena;
+
+/************************************************
+ * **********************************************
+ * Function Prototypes
+ * **********************************************
+ ************************************************/
+
+/************************************************
+ * void csl_ArenaInit()
+ *  @param
+ *          csl_arena   *arena
+ *          size_t      block_size
+ *
+ *  @brief  Prepares an empty arena. No memory is allocated until the first csl_ArenaAlloc()
+ *
+ *  @author Kerry
+ ************************************************/
+void    csl_ArenaInit(csl_arena *arena, size_t block_size);
+
+/************************************************
+ * void *csl_ArenaAlloc()
+ *  @param
+ *          csl_arena   *arena
+ *          size_t      size
+ *
+ *  @brief  Returns size bytes of zeroed memory, aligned to ARENA_ALIGNMENT
+ *
+ *  @author Kerry
+ *
+ *  @note   The memory stays valid until the next csl_ArenaReset() of the arena
+ *
+ *  @return Success - a pointer to the memory
+ *          Failure - NULL
+ ************************************************/
+void    *csl_ArenaAlloc(csl_arena *arena, size_t size);
+
+/************************************************
+ * char *csl_ArenaStrdup()
+ *  @param
+ *          csl_arena   *arena
+ *          const char  *string
+ *
+ *  @brief  Copies a string into the arena
+ *
+ *  @author Kerry
+ *
+ *  @return Success - a pointer to the copy
+ *          Failure - NULL
+ ************************************************/
+char    *csl_ArenaStrdup(csl_arena *arena, const char *string);
+
+/************************************************
+ * void csl_ArenaReset()
+ *  @param  csl_arena *arena
+ *
+ *  @brief  Gives back everything allocated from the arena, keeping its blocks for reuse
+ *
+ *  @author Kerry
+ ************************************************/
+void    csl_ArenaReset(csl_arena *arena);
+
+/************************************************
+ * void csl_ArenaDestroy()
+ *  @param  csl_arena *arena
+ *
+ *  @brief  Frees every block of the arena
+ *
+ *  @author Kerry
+ ************************************************/
+void    csl_ArenaDestroy(csl_arena *arena);
+
+/************************************************
+ * csl_arena *csl_ArenaMessage()
+ *  @param  - None
+ *
+ *  @brief  Returns the calling thread's per-message arena
+ *
+ *  @author Kerry
+ ************************************************/
+csl_arena *csl_ArenaMessage();
+
+/************************************************
+ * csl_arena *csl_ArenaScan()
+ *  @param  - None
+ *
+ *  @brief  Returns the calling thread's per-scan arena
+ *
+ *  @author Kerry
+ ************************************************/
+csl_arena *csl_ArenaScan();
+
+#endif //CRYTICAMONITOR_CSL_ARENA_H
@@ -0,0 +1,765 @@
+//
+// Created by kerry on 10/19/26.
+//
+
+/************************************************
+ * csl_bench
+ * =========
+ * Microbenchmarks for the monitor's hot-path primitives, built from the monitor's own sources (with main.c's
+ * main() left out - see CSL_NO_MAIN), so what is measured is exactly what ships.
+ *
+ *      csl_bench [-o results.json] [-b baseline.json] [-t threshold_pct] [-f filter] [-m max_rows] [-T msec]
+ *
+ *          -o  Write the results to this file instead of stdout
+ *          -b  Compare against the results of an earlier run, and exit non-zero if anything got slower
+ *          -t  How many percent slower than the baseline counts as a regression, BENCH_DEFAULT_THRESHOLD by default
+ *          -f  Only run the benchmarks whose name contains this
+ *          -m  Skip the status quo searches larger than this many rows
+ *          -T  Milliseconds to spend on each benchmark, BENCH_DEFAULT_BUDGET_MSEC by default
+ *
+ * The results are one JSON object per line, so they can be kept with each release and diffed or compared (-b):
+ *
+ *      {"name":"wire_serialize","iterations":4194304,"ns_per_op":61.250,"ops_per_sec":16326530.6}
+ *
+ * Each figure is the best of several timed runs, which is the least noisy on a shared machine.
+ * Anything the monitor functions print goes to stderr, so stdout only ever holds results.
+ *
+ * The status quo searches run statusQuoTableSearch() against a scan identical to the status quo, which is the
+ * common case and never reaches the database. The search is O(scan rows * status quo rows), so the 100k row
+ * search takes seconds, and its scan table alone needs 100k csl_scan_records (about 530 MB).
+ * The status quo merges run statusQuoTableMerge() on the same scans sent in order, as an ordered scan probe would.
+ ************************************************/
+
+#include <getopt.h>
+#include <unistd.h>
+#include "CryticaMonitor.h"
+#include "csl_message.h"
+#include "csl_arena.h"
+#include "csl_diff.h"
+
+#define BENCH_DEFAULT_BUDGET_MSEC       1000
+#define BENCH_DEFAULT_THRESHOLD         10          // percent
+#define BENCH_REPEATS                   5           // Timed runs per benchmark, the best is reported
+#define BENCH_MAX_RESULTS               64
+#define BENCH_LINE_SIZE                 256
+#define SIZE_BENCH_NAME                 48
+#define BENCH_FILE_NAME                 "/opt/crytica/bin/CryticaMonitor"
+#define BENCH_FILE_TEMPLATE             "/tmp/csl_bench_XXXXXX"
+#define BENCH_DEVICE_FORMAT             "02:cf:be:00:00:%02x"
+#define BENCH_TABLE_ROWS                1000        // about a monitor's device list
+
+/************************************************
+ * Benchmarks
+ * ==========
+ * A benchmark is a function doing one operation on its context. If it has a prepare function, that is run
+ * (untimed) before every operation, and each operation is timed on its own - only worth it when one
+ * operation takes far longer than reading the clock.
+ ************************************************/
+typedef void (*bench_function)(void *context);
+
+typedef struct
+{
+    char                name[SIZE_BENCH_NAME];
+    unsigned long long  iterations;
+    double              ns_per_op;
+} bench_result;
+
+typedef struct
+{
+    const char      *filter;
+    unsigned int    max_rows;
+    int64_t         budget_nsec;
+    bench_result    results[BENCH_MAX_RESULTS];
+    unsigned int    result_ctr;
+} bench_state;
+
+static bench_state G_bench;
+
+// Results are written here, so the compiler cannot drop the work that produced them
+static volatile unsigned long long G_bench_sink;
+
+/************************************************
+ * int64_t bench_nsecs()
+ *  @param  - None
+ *
+ *  @brief  Returns the monotonic clock in nanoseconds
+ *
+ *  @author Kerry
+ ************************************************/
+static int64_t bench_nsecs()
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (int64_t) now.tv_sec * 1000000000 + now.tv_nsec;
+}
+
+/************************************************
+ * void bench_record()
+ *  @param
+ *          const char          *name
+ *          unsigned long long  iterations      - The operations behind ns_per_op
+ *          double              ns_per_op
+ *
+ *  @brief  Keeps one result for the report
+ *
+ *  @author Kerry
+ ************************************************/
+static void bench_record(const char *name, unsigned long long iterations, double ns_per_op)
+{
+    if (G_bench.result_ctr >= BENCH_MAX_RESULTS)
+    {
+        return;
+    }
+    bench_result *result = &G_bench.results[G_bench.result_ctr++];
+    snprintf(result->name, SIZE_BENCH_NAME, "%s", name);
+    result->iterations  = iterations;
+    result->ns_per_op   = ns_per_op;
+    fprintf(stderr, "%-24s %14.1f ns/op\n", name, ns_per_op);
+}
+
+/************************************************
+ * bool bench_selected()
+ *  @param  const char *name
+ *
+ *  @brief  Checks the benchmark against the -f filter
+ *
+ *  @author Kerry
+ ************************************************/
+static bool bench_selected(const char *name)
+{
+    return G_bench.filter == NULL || strstr(name, G_bench.filter) != NULL;
+}
+
+/************************************************
+ * void bench_run()
+ *  @param
+ *          const char      *name
+ *          bench_function  operation
+ *          void            *context
+ *
+ *  @brief  Times a fast operation in batches
+ *
+ *  @author Kerry
+ *
+ *  @note   The batch size doubles until one batch takes a tenth of the budget, then BENCH_REPEATS batches
+ *          of that size are timed
+ ************************************************/
+static void bench_run(const char *name, bench_function operation, void *context)
+{
+    if (! bench_selected(name))
+    {
+        return;
+    }
+
+    unsigned long long batch = 1;
+    int64_t elapsed = 0;
+    while (true)
+    {
+        int64_t start = bench_nsecs();
+        for (unsigned long long i = 0; i < batch; i++)
+        {
+            operation(context);
+        }
+        elapsed = bench_nsecs() - start;
+        if (elapsed >= G_bench.budget_nsec / 10 || batch >= (1ULL << 40))
+        {
+            break;
+        }
+        batch *= 2;
+    }
+
+    double best = (double) elapsed / (double) batch;
+    for (int r = 0; r < BENCH_REPEATS; r++)
+    {
+        int64_t start = bench_nsecs();
+        for (unsigned long long i = 0; i < batch; i++)
+        {
+            operation(context);
+        }
+        double ns_per_op = (double) (bench_nsecs() - start) / (double) batch;
+        if (ns_per_op < best)
+        {
+            best = ns_per_op;
+        }
+    }
+    bench_record(name, batch, best);
+}
+
+/************************************************
+ * void bench_run_prepared()
+ *  @param
+ *          const char      *name
+ *          bench_function  prepare         - Run before every operation, untimed
+ *          bench_function  operation
+ *          void            *context
+ *
+ *  @brief  Times a slow operation one call at a time
+ *
+ *  @author Kerry
+ *
+ *  @note   Runs up to BENCH_REPEATS times, or fewer if the budget runs out, but always at least once
+ ************************************************/
+static void bench_run_prepared(const char *name, bench_function prepare, bench_function operation, void *context)
+{
+    if (! bench_selected(name))
+    {
+        return;
+    }
+
+    double  best        = 0;
+    int64_t deadline    = bench_nsecs() + G_bench.budget_nsec;
+    int     r           = 0;
+    do
+    {
+        prepare(context);
+        int64_t start   = bench_nsecs();
+        operation(context);
+        double elapsed  = (double) (bench_nsecs() - start);
+        if (r == 0 || elapsed < best)
+        {
+            best = elapsed;
+        }
+        r++;
+    } while (r < BENCH_REPEATS && bench_nsecs() < deadline);
+    bench_record(name, 1, best);
+}
+
+/************************************************
+ *      Wire Format and Message Benchmarks
+ ************************************************/
+typedef struct
+{
+    csl_zmessage            message;
+    csl_zmessage            decoded;
+    csl_complete_message    converted;
+    byte                    buffer[CSL_MAX_MESSAGE_LENGTH];
+} bench_message_context;
+
+static void bench_serialize(void *context)
+{
+    bench_message_context *bench = context;
+    G_bench_sink += (unsigned long long) csl_serializeMessageByte(&bench->message, bench->buffer);
+}
+
+static void bench_deserialize(void *context)
+{
+    bench_message_context *bench = context;
+    G_bench_sink += (unsigned long long) csl_deserializeMessageByte(&bench->decoded, bench->buffer);
+}
+
+static void bench_convert(void *context)
+{
+    bench_message_context *bench = context;
+    csl_ConvertFromZMessage(&bench->converted, &bench->message);
+    G_bench_sink += bench->converted.message_body.message_scan.element_name_hash[0];
+    csl_ArenaReset(csl_ArenaMessage());
+}
+
+/************************************************
+ *      Utility and Crypto Benchmarks
+ ************************************************/
+typedef struct
+{
+    byte    short_mac[IFHWADDRLEN];
+    byte    hash[SIZE_HASH_NAME];
+    char    name[SIZE_ELEMENT_NAME + 1];
+    char    hash_string[SIZE_HASH_NAME + 1];
+    char    file_name[PATH_MAX];
+} bench_utility_context;
+
+static void bench_mac_expand(void *context)
+{
+    bench_utility_context *bench = context;
+    byte *long_mac = csl_MacAddressExpand(bench->short_mac);
+    G_bench_sink += long_mac[0];
+    free(long_mac);
+}
+
+static void bench_arena_mac_expand(void *context)
+{
+    bench_utility_context *bench = context;
+    G_bench_sink += csl_ArenaMacAddressExpand(csl_ArenaMessage(), bench->short_mac)[0];
+    csl_ArenaReset(csl_ArenaMessage());
+}
+
+static void bench_arena_hash2string(void *context)
+{
+    bench_utility_context *bench = context;
+    G_bench_sink += (unsigned char) csl_ArenaHash2String(csl_ArenaMessage(), bench->hash, SIZE_HASH_NAME)[0];
+    csl_ArenaReset(csl_ArenaMessage());
+}
+
+static void bench_md5_name(void *context)
+{
+    bench_utility_context *bench = context;
+    MD5CharModule(bench->name, bench->hash_string);
+    G_bench_sink += (unsigned char) bench->hash_string[0];
+}
+
+static void bench_md5_file(void *context)
+{
+    bench_utility_context *bench = context;
+    MD5Module(bench->file_name, bench->hash_string, 0);
+    G_bench_sink += (unsigned char) bench->hash_string[0];
+}
+
+/************************************************
+ *      Byte Table Benchmarks
+ *      A table of BENCH_TABLE_ROWS rows shaped like a monitor device row: id, identifier, name, date
+ ************************************************/
+typedef struct
+{
+    CS_byte_table   table;
+    byte            *buffer;
+    size_t          buffer_length;
+} bench_table_context;
+
+static void bench_table_build(void *context)
+{
+    bench_table_context *bench = context;
+    char identifier[SIZE_DEVICE_IDENTIFIER];
+    time_t now = 1700000000;
+    csl_ByteTableReset(&bench->table);
+    for (unsigned long long row = 0; row < BENCH_TABLE_ROWS; row++)
+    {
+        snprintf(identifier, SIZE_DEVICE_IDENTIFIER, BENCH_DEVICE_FORMAT, (unsigned int) (row & 0xff));
+        csl_ByteTableAddRow(&bench->table);
+        csl_ByteTableAddField(&bench->table, &row, sizeof(row));
+        csl_ByteTableAddString(&bench->table, identifier);
+        csl_ByteTableAddString(&bench->table, BENCH_FILE_NAME);
+        csl_ByteTableAddField(&bench->table, &now, sizeof(now));
+    }
+    G_bench_sink += bench->table.byte_ctr;
+}
+
+static void bench_table_serialize(void *context)
+{
+    bench_table_context *bench = context;
+    G_bench_sink += csl_ByteTableSerialize(&bench->table, bench->buffer, bench->buffer_length);
+}
+
+static void bench_table_deserialize(void *context)
+{
+    bench_table_context *bench = context;
+    G_bench_sink += csl_ByteTableDeserialize(&bench->table, bench->buffer, bench->buffer_length);
+}
+
+/************************************************
+ * bool bench_file_create()
+ *  @param
+ *          char    *file_name  - Receives the name, at least PATH_MAX bytes
+ *          size_t  size
+ *
+ *  @brief  Writes a temporary file of size pseudo-random bytes for MD5Module() to hash
+ *
+ *  @author Kerry
+ *
+ *  @return true on success, false if the file could not be written
+ ************************************************/
+static bool bench_file_create(char *file_name, size_t size)
+{
+    snprintf(file_name, PATH_MAX, "%s", BENCH_FILE_TEMPLATE);
+    int file_descriptor = mkstemp(file_name);
+    if (file_descriptor == -1)
+    {
+        return false;
+    }
+
+    byte    block[4096];
+    size_t  written = 0;
+    unsigned int seed = (unsigned int) size;
+    while (written < size)
+    {
+        for (size_t i = 0; i < sizeof(block); i++)
+        {
+            block[i] = (byte) rand_r(&seed);
+        }
+        size_t chunk = size - written < sizeof(block) ? size - written : sizeof(block);
+        if (write(file_descriptor, block, chunk) != (ssize_t) chunk)
+        {
+            close(file_descriptor);
+            unlink(file_name);
+            return false;
+        }
+        written += chunk;
+    }
+    close(file_descriptor);
+    return true;
+}
+
+/************************************************
+ *      Diff Kernel Benchmarks
+ *      A full block of unchanged rows, the common case, with each kernel this CPU has
+ ************************************************/
+static void bench_diff_block(void *context)
+{
+    uint64_t contents_changed;
+    uint64_t attributes_changed;
+    csl_DiffBlock(context, &contents_changed, &attributes_changed);
+    G_bench_sink += contents_changed | attributes_changed;
+}
+
+/************************************************
+ *      Status Quo Search Benchmarks
+ ************************************************/
+typedef struct
+{
+    short           device_index;
+    unsigned int    rows;
+    bool            merge;              // statusQuoTableMerge() rather than statusQuoTableSearch()
+    char            (*name_hashes)[SIZE_HASH_NAME + 1];
+    csl_scan_record record;
+    int             alert_ctr;
+} bench_search_context;
+
+static int bench_name_hash_compare(const void *hash_one, const void *hash_two)
+{
+    return memcmp(hash_one, hash_two, SIZE_HASH_NAME);
+}
+
+/************************************************
+ * void bench_search_fill()
+ *  @param  void *context   - bench_search_context
+ *
+ *  @brief  Loads the device's scan table with the same rows as its status quo, through a real scan session
+ *
+ *  @author Kerry
+ ************************************************/
+static void bench_search_fill(void *context)
+{
+    bench_search_context *bench = context;
+    scanSessionStart(bench->device_index, 0);
+    for (unsigned int r = 0; r < bench->rows; r++)
+    {
+        snprintf(bench->record.element_name, SIZE_ELEMENT_NAME, "/opt/bench/file%07u", r);
+        memcpy(bench->record.element_name_hash, bench->name_hashes[r], SIZE_HASH_NAME);
+        // The scan value only has to be stable, so the name hash does
+        memcpy(bench->record.scan_value, bench->name_hashes[r], SIZE_HASH_ELEMENT);
+        scanTableAddRow(&bench->record, bench->device_index);
+    }
+}
+
+static void bench_search(void *context)
+{
+    bench_search_context *bench = context;
+    bench->alert_ctr = bench->merge ? statusQuoTableMerge(bench->device_index)
+                                    : statusQuoTableSearch(bench->device_index);
+}
+
+/************************************************
+ * void bench_search_rows()
+ *  @param
+ *          unsigned int    rows
+ *          bool            merge   - Send the scan in order, and time statusQuoTableMerge()
+ *
+ *  @brief  Registers a device with a status quo of rows elements and times searching an identical scan
+ *
+ *  @author Kerry
+ ************************************************/
+static void bench_search_rows(unsigned int rows, bool merge)
+{
+    char name[SIZE_BENCH_NAME];
+    snprintf(name, SIZE_BENCH_NAME, merge ? "sq_merge_%u" : "sq_search_%u", rows);
+    if (! bench_selected(name) || rows > G_bench.max_rows)
+    {
+        return;
+    }
+
+    bench_search_context *bench = calloc(1, sizeof(bench_search_context));
+    if (bench == NULL || (bench->name_hashes = calloc(rows, SIZE_HASH_NAME + 1)) == NULL)
+    {
+        fprintf(stderr, "%s: could not allocate [%u] rows\n", name, rows);
+        free(bench);
+        return;
+    }
+
+    byte device_identifier[SIZE_DEVICE_IDENTIFIER] = {0};
+    snprintf((char *) device_identifier, SIZE_DEVICE_IDENTIFIER, BENCH_DEVICE_FORMAT, G_bench.result_ctr);
+    bench->device_index = deviceRegisterNew(device_identifier, G_bench.result_ctr + 1, device_identifier);
+    bench->rows         = rows;
+    bench->merge        = merge;
+    if (bench->device_index < 0)
+    {
+        fprintf(stderr, "%s: could not register a device\n", name);
+        free(bench->name_hashes);
+        free(bench);
+        return;
+    }
+
+    for (unsigned int r = 0; r < rows; r++)
+    {
+        char element_name[SIZE_BENCH_NAME];
+        snprintf(element_name, SIZE_BENCH_NAME, "/opt/bench/file%07u", r);
+        MD5CharModule(element_name, bench->name_hashes[r]);
+    }
+    if (merge)
+    {
+        qsort(bench->name_hashes, rows, SIZE_HASH_NAME + 1, bench_name_hash_compare);
+    }
+    bench->record.element_type          = ELEMENT_EXEC_FILE;
+    bench->record.element_attributes    = 0100755;
+    bench->record.scan_date             = time(NULL);
+    memcpy(bench->record.device_mac_address, device_identifier, SIZE_MAC_ADDRESS);
+
+    bench_search_fill(bench);
+    if (statusQuoTableBuild(bench->device_index) == false)
+    {
+        fprintf(stderr, "%s: could not build the status quo\n", name);
+    }
+    else
+    {
+        bench_run_prepared(name, bench_search_fill, bench_search, bench);
+        if (bench->alert_ctr != 0)
+        {
+            fprintf(stderr, "%s: WARNING: an identical scan raised [%d] alerts\n", name, bench->alert_ctr);
+        }
+    }
+    free(bench->name_hashes);
+    free(bench);
+}
+
+/************************************************
+ *      Reporting
+ ************************************************/
+
+/************************************************
+ * int bench_report()
+ *  @param  FILE *results_file
+ *
+ *  @brief  Writes every result as a line of JSON
+ *
+ *  @author Kerry
+ *
+ *  @return CS_SUCCESS on success, CS_ERROR if the results could not be written
+ ************************************************/
+static int bench_report(FILE *results_file)
+{
+    for (unsigned int i = 0; i < G_bench.result_ctr; i++)
+    {
+        bench_result *result = &G_bench.results[i];
+        fprintf(results_file, "{\"name\":\"%s\",\"iterations\":%llu,\"ns_per_op\":%.3f,\"ops_per_sec\":%.1f}\n",
+                result->name, result->iterations, result->ns_per_op,
+                result->ns_per_op > 0 ? 1e9 / result->ns_per_op : 0.0);
+    }
+    return fflush(results_file) == 0 ? CS_SUCCESS : CS_ERROR;
+}
+
+/************************************************
+ * int bench_compare()
+ *  @param
+ *          const char      *baseline_file_name
+ *          unsigned int    threshold_pct
+ *
+ *  @brief  Compares this run with an earlier run's results, printing every benchmark that got slower by more
+ *          than threshold_pct
+ *
+ *  @author Kerry
+ *
+ *  @note   Only reads lines bench_report() wrote. Benchmarks missing from either run are skipped.
+ *
+ *  @return CS_SUCCESS if nothing regressed, CS_ERROR if something did or the baseline could not be read
+ ************************************************/
+static int bench_compare(const char *baseline_file_name, unsigned int threshold_pct)
+{
+    FILE *baseline_file = fopen(baseline_file_name, "r");
+    if (baseline_file == NULL)
+    {
+        fprintf(stderr, "Could not open baseline [%s]\n", baseline_file_name);
+        return CS_ERROR;
+    }
+
+    int     return_value    = CS_SUCCESS;
+    char    line[BENCH_LINE_SIZE];
+    while (fgets(line, BENCH_LINE_SIZE, baseline_file) != NULL)
+    {
+        char                name[SIZE_BENCH_NAME];
+        unsigned long long  iterations;
+        double              baseline_ns;
+        if (sscanf(line, "{\"name\":\"%47[^\"]\",\"iterations\":%llu,\"ns_per_op\":%lf",
+                   name, &iterations, &baseline_ns) != 3 || baseline_ns <= 0)
+        {
+            continue;
+        }
+        for (unsigned int i = 0; i < G_bench.result_ctr; i++)
+        {
+            bench_result *result = &G_bench.results[i];
+            if (strcmp(result->name, name) != 0)
+            {
+                continue;
+            }
+            double change_pct = (result->ns_per_op - baseline_ns) * 100.0 / baseline_ns;
+            if (change_pct > threshold_pct)
+            {
+                fprintf(stderr, "REGRESSION %-24s %14.1f ns/op, was %.1f (%+.1f%%)\n",
+                        name, result->ns_per_op, baseline_ns, change_pct);
+                return_value = CS_ERROR;
+            }
+        }
+    }
+    fclose(baseline_file);
+    return return_value;
+}
+
+static void bench_usage(const char *program_name)
+{
+    fprintf(stderr, "Usage: %s [-o results.json] [-b baseline.json] [-t threshold_pct] [-f filter] [-m max_rows] "
+                    "[-T msec]\n", program_name);
+}
+
+int main(int argc, char *argv[])
+{
+    const char      *results_file_name  = NULL;
+    const char      *baseline_file_name = NULL;
+    unsigned int    threshold_pct       = BENCH_DEFAULT_THRESHOLD;
+    G_bench.max_rows                    = UINT_MAX;
+    G_bench.budget_nsec                 = (int64_t) BENCH_DEFAULT_BUDGET_MSEC * 1000000;
+
+    int option;
+    while ((option = getopt(argc, argv, "o:b:t:f:m:T:")) != -1)
+    {
+        switch (option)
+        {
+            case 'o':   results_file_name   = optarg;                                               break;
+            case 'b':   baseline_file_name  = optarg;                                               break;
+            case 't':   threshold_pct       = (unsigned int) atoi(optarg);                          break;
+            case 'f':   G_bench.filter      = optarg;                                               break;
+            case 'm':   G_bench.max_rows    = (unsigned int) atoi(optarg);                          break;
+            case 'T':   G_bench.budget_nsec = (int64_t) atoi(optarg) * 1000000;                     break;
+            default:
+                bench_usage(argv[0]);
+                return CS_ERROR;
+        }
+    }
+    if (G_bench.budget_nsec <= 0)
+    {
+        bench_usage(argv[0]);
+        return CS_ERROR;
+    }
+
+    // **** Keep stdout for the results - the monitor functions' own printing goes to stderr **** //
+    FILE *results_file = results_file_name != NULL ? fopen(results_file_name, "w")
+                                                   : fdopen(dup(STDOUT_FILENO), "w");
+    if (results_file == NULL)
+    {
+        fprintf(stderr, "Could not open [%s]\n", results_file_name != NULL ? results_file_name : "stdout");
+        return CS_ERROR;
+    }
+    fflush(stdout);
+    dup2(STDERR_FILENO, STDOUT_FILENO);
+
+    if (monitorTablesInitialize() != CS_SUCCESS)
+    {
+        return CS_ERROR;
+    }
+
+    // **** Wire format and messages - a typical scan message **** //
+    bench_message_context *message_bench = calloc(1, sizeof(bench_message_context));
+    if (message_bench == NULL)
+    {
+        return CS_ERROR;
+    }
+    csl_zmessage *message = &message_bench->message;
+    byte mac_address[IFHWADDRLEN] = {0x02, 0xcf, 0xbe, 0x00, 0x00, 0x01};
+    snprintf(message->license_key, SIZE_LICENSE_KEY, "crytica-bench");
+    snprintf(message->file_name, SIZE_ELEMENT_NAME, "%s", BENCH_FILE_NAME);
+    message->file_name_size     = (uint32_t) strlen(message->file_name);
+    memset(message->hash, 'a', SIZE_HASH_ELEMENT);
+    snprintf(message->hostname, SIZE_HOST_NAME, "bench-probe");
+    snprintf(message->probe_uuid, SIZE_ZUUID, "%032x", 1);
+    snprintf(message->probe_ip, SIZE_IP4_ADDRESS, "10.207.0.1");
+    memcpy(message->probe_mac_address, mac_address, IFHWADDRLEN);
+    message->probe_event        = PROBE_RECURRING_SCAN;
+    message->probe_id           = 1;
+    message->file_attribute     = 0100755;
+    message->message_total_size = csl_MessageWireSize(message);
+    csl_serializeMessageByte(message, message_bench->buffer);
+
+    bench_run("wire_serialize", bench_serialize, message_bench);
+    bench_run("wire_deserialize", bench_deserialize, message_bench);
+    bench_run("convert_zmessage", bench_convert, message_bench);
+    free(message_bench);
+
+    // **** Utilities and crypto **** //
+    bench_utility_context *utility_bench = calloc(1, sizeof(bench_utility_context));
+    if (utility_bench == NULL)
+    {
+        return CS_ERROR;
+    }
+    memcpy(utility_bench->short_mac, mac_address, IFHWADDRLEN);
+    memset(utility_bench->hash, 0x5a, SIZE_HASH_NAME);
+    snprintf(utility_bench->name, SIZE_ELEMENT_NAME, "%s", BENCH_FILE_NAME);
+
+    bench_run("mac_expand", bench_mac_expand, utility_bench);
+    bench_run("arena_mac_expand", bench_arena_mac_expand, utility_bench);
+    bench_run("arena_hash2string", bench_arena_hash2string, utility_bench);
+    bench_run("md5_name", bench_md5_name, utility_bench);
+
+    size_t file_sizes[] = {4 * 1024, 64 * 1024, 1024 * 1024, 16 * 1024 * 1024};
+    const char *file_size_names[] = {"4k", "64k", "1m", "16m"};
+    for (size_t i = 0; i < sizeof(file_sizes) / sizeof(file_sizes[0]); i++)
+    {
+        char name[SIZE_BENCH_NAME];
+        snprintf(name, SIZE_BENCH_NAME, "md5_file_%s", file_size_names[i]);
+        if (! bench_selected(name))
+        {
+            continue;
+        }
+        if (bench_file_create(utility_bench->file_name, file_sizes[i]) == false)
+        {
+            fprintf(stderr, "%s: could not write a temporary file\n", name);
+            continue;
+        }
+        bench_run(name, bench_md5_file, utility_bench);
+        unlink(utility_bench->file_name);
+    }
+    free(utility_bench);
+
+    // **** Byte tables **** //
+    bench_table_context table_bench;
+    csl_ByteTableInit(&table_bench.table);
+    bench_table_build(&table_bench);
+    table_bench.buffer_length   = csl_ByteTableSerializedSize(&table_bench.table);
+    table_bench.buffer          = malloc(table_bench.buffer_length);
+    if (table_bench.buffer != NULL)
+    {
+        bench_run("byte_table_build_1000", bench_table_build, &table_bench);
+        bench_run("byte_table_serialize_1000", bench_table_serialize, &table_bench);
+        bench_run("byte_table_deserialize_1000", bench_table_deserialize, &table_bench);
+        free(table_bench.buffer);
+    }
+    csl_ByteTableFree(&table_bench.table);
+
+    // **** Diff kernels **** //
+    static csl_diff_block diff_block;
+    const char *kernel_names[]          = {DIFF_KERNEL_SCALAR, DIFF_KERNEL_SSE42, DIFF_KERNEL_AVX2};
+    const char *kernel_bench_names[]    = {"diff_block_scalar", "diff_block_sse42", "diff_block_avx2"};
+    memset(&diff_block, 0x5a, sizeof(csl_diff_block));
+    diff_block.row_ctr = DIFF_BLOCK_ROWS;
+    for (size_t i = 0; i < sizeof(kernel_names) / sizeof(kernel_names[0]); i++)
+    {
+        if (csl_DiffSelect(kernel_names[i]) == false)
+        {
+            fprintf(stderr, "%s: not supported on this CPU\n", kernel_bench_names[i]);
+            continue;
+        }
+        bench_run(kernel_bench_names[i], bench_diff_block, &diff_block);
+    }
+    csl_DiffSelect(NULL);
+
+    // **** Status quo search **** //
+    unsigned int search_rows[] = {1000, 15000, 100000};
+    for (size_t i = 0; i < sizeof(search_rows) / sizeof(search_rows[0]); i++)
+    {
+        bench_search_rows(search_rows[i], false);
+        bench_search_rows(search_rows[i], true);
+    }
+    deviceShardsRelease();
+
+    int return_value = bench_report(results_file);
+    fclose(results_file);
+    if (baseline_file_name != NULL && bench_compare(baseline_file_name, threshold_pct) != CS_SUCCESS)
+    {
+        return_value = CS_ERROR;
+    }
+    return return_value == CS_SUCCESS ? 0 : 1;
+}
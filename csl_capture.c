@@ -0,0 +1,181 @@
+//
+// Created by kerry on 10/19/26.
+//
+
+#include "csl_capture.h"
+
+/************************************************
+ * The Capture File
+ * ================
+ * G_capture_file is NULL unless a capture is open. It is only opened and closed by the message thread,
+ * while the decode workers are running, so they check it again under the lock before writing.
+ ************************************************/
+static FILE             *G_capture_file;
+static int64_t          G_capture_opened_usecs;
+static pthread_mutex_t  G_capture_lock = PTHREAD_MUTEX_INITIALIZER;
+
+/************************************************
+ * int64_t capture_usecs()
+ *  @param  - None
+ *
+ *  @brief  Returns the monotonic clock in microseconds
+ *
+ *  @author Kerry
+ ************************************************/
+static int64_t capture_usecs()
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (int64_t) now.tv_sec * 1000000 + now.tv_nsec / 1000;
+}
+
+/************************************************
+ * int csl_CaptureOpen()
+ *  @param  const char *file_name
+ *
+ *  @brief  Starts recording every frame passed to csl_CaptureFrame() in a new capture file
+ *
+ *  @author Kerry
+ *
+ *  @return CS_SUCCESS on success, CS_ERROR if the file could not be created
+ ************************************************/
+int     csl_CaptureOpen(const char *file_name)
+{
+    FILE *capture_file = fopen(file_name, "wb");
+    if (capture_file == NULL)
+    {
+        printf("\t<%s> ERROR: Could not create capture file [%s]\n", __PRETTY_FUNCTION__, file_name);
+        return CS_ERROR;
+    }
+    if (fwrite(CAPTURE_MAGIC, SIZE_CAPTURE_MAGIC, 1, capture_file) != 1)
+    {
+        printf("\t<%s> ERROR: Could not write capture file [%s]\n", __PRETTY_FUNCTION__, file_name);
+        fclose(capture_file);
+        return CS_ERROR;
+    }
+
+    pthread_mutex_lock(&G_capture_lock);
+    G_capture_opened_usecs  = capture_usecs();
+    G_capture_file          = capture_file;
+    pthread_mutex_unlock(&G_capture_lock);
+
+    printf("\t<%s> Capturing probe frames to [%s]\n", __PRETTY_FUNCTION__, file_name);
+    return CS_SUCCESS;
+}
+
+/************************************************
+ * void csl_CaptureFrame()
+ *  @param
+ *          unsigned char   lane        - CAPTURE_LANE_CONTROL or CAPTURE_LANE_SCAN
+ *          unsigned char   receiver    - The scan endpoint the frame arrived on
+ *          const void      *data
+ *          size_t          size
+ *
+ *  @brief  Records one received frame
+ *
+ *  @author Kerry
+ *
+ *  @note   Does nothing unless a capture is open, so it may be called unconditionally
+ ************************************************/
+void    csl_CaptureFrame(unsigned char lane, unsigned char receiver, const void *data, size_t size)
+{
+    if (__atomic_load_n(&G_capture_file, __ATOMIC_RELAXED) == NULL || size > CAPTURE_MAX_FRAME)
+    {
+        return;
+    }
+
+    pthread_mutex_lock(&G_capture_lock);
+    if (G_capture_file != NULL)
+    {
+        csl_capture_frame frame = {capture_usecs() - G_capture_opened_usecs, (uint32_t) size, lane, receiver, 0};
+        if (fwrite(&frame, sizeof(csl_capture_frame), 1, G_capture_file) != 1 ||
+            fwrite(data, 1, size, G_capture_file) != size)
+        {
+            // A full disk should not stop the monitor - give up on the capture instead
+            printf("\t<%s> ERROR: Could not write capture file - capture stopped\n", __PRETTY_FUNCTION__);
+            fclose(G_capture_file);
+            G_capture_file = NULL;
+        }
+    }
+    pthread_mutex_unlock(&G_capture_lock);
+}
+
+/************************************************
+ * void csl_CaptureClose()
+ *  @param  - None
+ *
+ *  @brief  Flushes and closes the capture file
+ *
+ *  @author Kerry
+ ************************************************/
+void    csl_CaptureClose()
+{
+    pthread_mutex_lock(&G_capture_lock);
+    if (G_capture_file != NULL)
+    {
+        fclose(G_capture_file);
+        G_capture_file = NULL;
+    }
+    pthread_mutex_unlock(&G_capture_lock);
+}
+
+/************************************************
+ * FILE *csl_CaptureReadOpen()
+ *  @param  const char *file_name
+ *
+ *  @brief  Opens a capture file for reading and checks that it is one
+ *
+ *  @author Kerry
+ *
+ *  @return The open file, positioned at the first record, or NULL
+ ************************************************/
+FILE   *csl_CaptureReadOpen(const char *file_name)
+{
+    FILE *capture_file = fopen(file_name, "rb");
+    if (capture_file == NULL)
+    {
+        printf("\t<%s> ERROR: Could not open capture file [%s]\n", __PRETTY_FUNCTION__, file_name);
+        return NULL;
+    }
+
+    char magic[SIZE_CAPTURE_MAGIC];
+    if (fread(magic, SIZE_CAPTURE_MAGIC, 1, capture_file) != 1 || memcmp(magic, CAPTURE_MAGIC, SIZE_CAPTURE_MAGIC) != 0)
+    {
+        printf("\t<%s> ERROR: [%s] is not a capture file\n", __PRETTY_FUNCTION__, file_name);
+        fclose(capture_file);
+        return NULL;
+    }
+    return capture_file;
+}
+
+/************************************************
+ * int csl_CaptureReadFrame()
+ *  @param
+ *          FILE                *capture_file
+ *          csl_capture_frame   *frame
+ *          byte                *buffer         - At least CAPTURE_MAX_FRAME bytes
+ *
+ *  @brief  Reads the next record
+ *
+ *  @author Kerry
+ *
+ *  @return CS_SUCCESS with the record in frame and buffer, CS_END_OF_RUN at the end of the file (or at a
+ *          partial last record), CS_ERROR if the record is corrupt
+ ************************************************/
+int     csl_CaptureReadFrame(FILE *capture_file, csl_capture_frame *frame, byte *buffer)
+{
+    if (fread(frame, sizeof(csl_capture_frame), 1, capture_file) != 1)
+    {
+        // A monitor that was killed mid-write leaves a partial record at the end - treat it as the end
+        return CS_END_OF_RUN;
+    }
+    if (frame->size > CAPTURE_MAX_FRAME || frame->lane > CAPTURE_LANE_SCAN)
+    {
+        return CS_ERROR;
+    }
+    if (fread(buffer, 1, frame->size, capture_file) != frame->size)
+    {
+        return CS_END_OF_RUN;
+    }
+    return CS_SUCCESS;
+}
@@ -0,0 +1,131 @@
+
+/************************************************
+ * csl_capture.h
+ * =============
+ *
+ * This is the header file for the CS Capture Library
+ *
+ * Author:      Kerry
+ * Version:     00.00.00
+ * Comments:    Records the raw probe frames the monitor receives, for csl_replay to send back at it later
+ ************************************************/
+
+#ifndef CRYTICAMONITOR_CSL_CAPTURE_H
+#define CRYTICAMONITOR_CSL_CAPTURE_H
+
+#include <stdio.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <time.h>
+#include <pthread.h>
+
+#include "csl_constants.h"
+
+/************************************************
+ * #defines
+ * ========
+ ************************************************/
+#define CAPTURE_MAGIC               "CSLCAP01"
+#define SIZE_CAPTURE_MAGIC          8
+#define CAPTURE_FILE_FORMAT         "crytica_capture_%d_%lld.cap"   // pid, time
+#define SIZE_CAPTURE_FILE_NAME      64
+#define CAPTURE_MAX_FRAME           (1024 * 1024)   // Larger frames are not from a probe and are not recorded
+#define CAPTURE_LANE_CONTROL        0               // Handshakes and heartbeats, received on the responder
+#define CAPTURE_LANE_SCAN           1               // Scan messages, received on a scan endpoint
+
+/************************************************
+ * Capture Files
+ * =============
+ * A capture file is CAPTURE_MAGIC followed by one record per frame, in the order the monitor received them:
+ *
+ *      csl_capture_frame   - when, which lane and which scan endpoint, and the frame's size
+ *      the frame           - exactly the bytes the probe sent, after CurveZMQ decryption
+ *
+ * The records are written in the monitor's own byte order, so a capture is replayed on the same kind of machine.
+ * Control frames are captured by the message thread and scan frames by the decode workers, so the file is
+ * written under a lock. Frames from one scan endpoint are always in the order they were received.
+ ************************************************/
+typedef struct
+{
+    int64_t     usecs;          // since the capture was opened
+    uint32_t    size;
+    uint8_t     lane;           // CAPTURE_LANE_CONTROL or CAPTURE_LANE_SCAN
+    uint8_t     receiver;       // the scan endpoint (see scan_receivers), 0 for the control lane
+    uint16_t    reserved;
+} csl_capture_frame;
+
+/************************************************
+ * **********************************************
+ * Function Prototypes
+ * **********************************************
+ ************************************************/
+
+/************************************************
+ * int csl_CaptureOpen()
+ *  @param  const char *file_name
+ *
+ *  @brief  Starts recording every frame passed to csl_CaptureFrame() in a new capture file
+ *
+ *  @author Kerry
+ *
+ *  @return CS_SUCCESS on success, CS_ERROR if the file could not be created
+ ************************************************/
+int     csl_CaptureOpen(const char *file_name);
+
+/************************************************
+ * void csl_CaptureFrame()
+ *  @param
+ *          unsigned char   lane        - CAPTURE_LANE_CONTROL or CAPTURE_LANE_SCAN
+ *          unsigned char   receiver    - The scan endpoint the frame arrived on
+ *          const void      *data
+ *          size_t          size
+ *
+ *  @brief  Records one received frame
+ *
+ *  @author Kerry
+ *
+ *  @note   Does nothing unless a capture is open, so it may be called unconditionally
+ ************************************************/
+void    csl_CaptureFrame(unsigned char lane, unsigned char receiver, const void *data, size_t size);
+
+/************************************************
+ * void csl_CaptureClose()
+ *  @param  - None
+ *
+ *  @brief  Flushes and closes the capture file
+ *
+ *  @author Kerry
+ ************************************************/
+void    csl_CaptureClose();
+
+/************************************************
+ * FILE *csl_CaptureReadOpen()
+ *  @param  const char *file_name
+ *
+ *  @brief  Opens a capture file for reading and checks that it is one
+ *
+ *  @author Kerry
+ *
+ *  @return The open file, positioned at the first record, or NULL
+ ************************************************/
+FILE   *csl_CaptureReadOpen(const char *file_name);
+
+/************************************************
+ * int csl_CaptureReadFrame()
+ *  @param
+ *          FILE                *capture_file
+ *          csl_capture_frame   *frame
+ *          byte                *buffer         - At least CAPTURE_MAX_FRAME bytes
+ *
+ *  @brief  Reads the next record
+ *
+ *  @author Kerry
+ *
+ *  @return CS_SUCCESS with the record in frame and buffer, CS_END_OF_RUN at the end of the file (or at a
+ *          partial last record), CS_ERROR if the record is corrupt
+ ************************************************/
+int     csl_CaptureReadFrame(FILE *capture_file, csl_capture_frame *frame, byte *buffer);
+
+#endif //CRYTICAMONITOR_CSL_CAPTURE_H
@@ -0,0 +1,54 @@
+//
+// Created by kerry on 10/19/26.
+//
+
+#include <stdio.h>
+
+#include "csl_client.h"
+
+/************************************************
+ * zsock_t *csl_ClientSocket()
+ *  @param
+ *          int         type                - ZMQ_REQ or ZMQ_PUSH
+ *          const char  *host               - At most HOST_NAME_MAX characters
+ *          int         port
+ *          zcert_t     *client_cert        - The client's own (ephemeral) certificate
+ *          const char  *server_key         - The monitor's public key
+ *          int         reply_timeout_msec
+ *          int         linger_msec         - How long queued frames may take to go out when the socket is destroyed
+ *
+ *  @brief  Creates a CurveZMQ client socket and connects it to one of the monitor's ports
+ *
+ *  @author Kerry
+ *
+ *  @return The socket, or NULL
+ ************************************************/
+zsock_t *csl_ClientSocket(int type, const char *host, int port, zcert_t *client_cert, const char *server_key,
+                          int reply_timeout_msec, int linger_msec)
+{
+    char endpoint[SIZE_CLIENT_ENDPOINT];
+    int endpoint_size = snprintf(endpoint, SIZE_CLIENT_ENDPOINT, "tcp://%s:%d", host, port);
+    if (endpoint_size < 0 || (size_t) endpoint_size >= SIZE_CLIENT_ENDPOINT)
+    {
+        printf("\t<%s> ERROR: The endpoint for host [%s] port [%d] is too long\n", __PRETTY_FUNCTION__, host, port);
+        return NULL;
+    }
+
+    zsock_t *socket = zsock_new(type);
+    if (socket == NULL)
+    {
+        return NULL;
+    }
+    zcert_apply(client_cert, socket);
+    zsock_set_curve_serverkey(socket, server_key);
+    zsock_set_rcvtimeo(socket, reply_timeout_msec);
+    zsock_set_linger(socket, linger_msec);
+
+    if (zsock_connect(socket, "%s", endpoint) == -1)
+    {
+        printf("\t<%s> ERROR: Could not connect to [%s]\n", __PRETTY_FUNCTION__, endpoint);
+        zsock_destroy(&socket);
+        return NULL;
+    }
+    return socket;
+}
@@ -0,0 +1,52 @@
+/************************************************
+ * csl_client.h
+ * ============
+ *
+ * This is the header file for the CS Client Library
+ *
+ * Author:      Kerry
+ * Version:     00.00.00
+ * Comments:    CurveZMQ client sockets, for the tools that talk to a monitor the way a probe does
+ ************************************************/
+
+#ifndef CRYTICAMONITOR_CSL_CLIENT_H
+#define CRYTICAMONITOR_CSL_CLIENT_H
+
+#include <limits.h>
+#include <czmq.h>
+
+#include "csl_constants.h"
+
+/************************************************
+ * #defines
+ * ========
+ ************************************************/
+#define SIZE_CLIENT_ENDPOINT        (sizeof("tcp://") + HOST_NAME_MAX + sizeof(":65535"))    // fits any host name
+
+/************************************************
+ * **********************************************
+ * Function Prototypes
+ * **********************************************
+ ************************************************/
+
+/************************************************
+ * zsock_t *csl_ClientSocket()
+ *  @param
+ *          int         type                - ZMQ_REQ or ZMQ_PUSH
+ *          const char  *host               - At most HOST_NAME_MAX characters
+ *          int         port
+ *          zcert_t     *client_cert        - The client's own (ephemeral) certificate
+ *          const char  *server_key         - The monitor's public key
+ *          int         reply_timeout_msec
+ *          int         linger_msec         - How long queued frames may take to go out when the socket is destroyed
+ *
+ *  @brief  Creates a CurveZMQ client socket and connects it to one of the monitor's ports
+ *
+ *  @author Kerry
+ *
+ *  @return The socket, or NULL
+ ************************************************/
+zsock_t *csl_ClientSocket(int type, const char *host, int port, zcert_t *client_cert, const char *server_key,
+                          int reply_timeout_msec, int linger_msec);
+
+#endif //CRYTICAMONITOR_CSL_CLIENT_H
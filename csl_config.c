@@ -0,0 +1,237 @@
+//
+// Created by kerry on 10/19/26.
+//
+
+#include "csl_config.h"
+
+/************************************************
+ * The Monitor Config
+ * ==================
+ * There is one config per monitor process. It is written only by csl_ConfigLoad() during start-up
+ * and is read-only after that.
+ ************************************************/
+static csl_monitor_config G_config =
+        {
+                CONFIG_DEFAULT_MAX_DEVICES,
+                CONFIG_DEFAULT_INITIAL_ELEMENTS,
+                CONFIG_DEFAULT_MAX_ELEMENTS,
+                CONFIG_DEFAULT_MAX_MEMORY_MB,
+                CONFIG_DEFAULT_SCAN_RECEIVERS,
+                CONFIG_DEFAULT_IO_THREADS,
+                CONFIG_DEFAULT_RCVHWM,
+                CONFIG_DEFAULT_SNDHWM,
+                CONFIG_DEFAULT_RCVBUF,
+                CONFIG_DEFAULT_TCP_KEEPALIVE_IDLE,
+                CONFIG_DEFAULT_POLL_MSEC,
+                CONFIG_DEFAULT_MAX_CONCURRENT_SCANS,
+                CONFIG_DEFAULT_SCAN_QUEUE_HIGH,
+                CONFIG_DEFAULT_SCAN_GRANT_TIMEOUT,
+                CONFIG_DEFAULT_SCAN_INTERVAL,
+                CONFIG_DEFAULT_SCAN_JITTER_PCT,
+                CONFIG_DEFAULT_SCAN_STARTUP_SPREAD,
+                CONFIG_DEFAULT_SCAN_STARTS_PER_MIN,
+                CONFIG_DEFAULT_SCAN_BATCH_MAX,
+                CONFIG_DEFAULT_SESSION_TIMEOUT,
+                CONFIG_DEFAULT_RESUME_WINDOW,
+                CONFIG_DEFAULT_METRICS_PORT,
+                CONFIG_DEFAULT_METRICS_PUBLISH_SEC,
+                CONFIG_DEFAULT_CAPTURE_FRAMES,
+                CONFIG_DEFAULT_STORAGE_BACKEND,
+                CONFIG_DEFAULT_DB_POOL_SIZE,
+                CONFIG_DEFAULT_DB_TIMEOUT,
+                CONFIG_DEFAULT_SPOOL_WRITES,
+                CONFIG_DEFAULT_SPOOL_FSYNC_MSEC,
+                CONFIG_DEFAULT_ALERT_WINDOW,
+                CONFIG_DEFAULT_ALERT_DEVICE_RATE,
+                CONFIG_DEFAULT_ALERT_PUBLISH,
+                CONFIG_DEFAULT_ORDERED_SCANS
+        };
+
+/************************************************
+ * Config Keys
+ * ===========
+ * One entry per key accepted in the config file, with the field it sets and its valid range
+ ************************************************/
+typedef struct
+{
+    char            *key;
+    unsigned int    *value;
+    unsigned int    min_value;
+    unsigned int    max_value;
+} csl_config_key;
+
+static csl_config_key G_config_keys[] =
+        {
+                {"max_devices",              &G_config.max_devices,                  1,  PROBE_ID_DEVICE_BASE - 1},
+                {"initial_elements",         &G_config.initial_elements,             1,  UINT32_MAX},
+                {"max_elements",             &G_config.max_elements,                 1,  UINT32_MAX},
+                {"max_memory_mb",            &G_config.max_memory_mb,                0,  UINT32_MAX},
+                {"scan_receivers",           &G_config.scan_receivers,               1,  CONFIG_MAX_SCAN_RECEIVERS},
+                {"io_threads",               &G_config.io_threads,                   0,  CONFIG_MAX_IO_THREADS},
+                {"rcvhwm",                   &G_config.rcvhwm,                       0,  INT32_MAX},
+                {"sndhwm",                   &G_config.sndhwm,                       0,  INT32_MAX},
+                {"rcvbuf",                   &G_config.rcvbuf,                       0,  INT32_MAX},
+                {"tcp_keepalive_idle",       &G_config.tcp_keepalive_idle,           0,  INT32_MAX},
+                {"poll_msec",                &G_config.poll_msec,                    1,  CONFIG_MAX_POLL_MSEC},
+                {"max_concurrent_scans",     &G_config.max_concurrent_scans,         1,  PROBE_ID_DEVICE_BASE - 1},
+                {"scan_queue_high",          &G_config.scan_queue_high,              0,  UINT32_MAX},
+                {"scan_grant_timeout_sec",   &G_config.scan_grant_timeout_sec,       1,  UINT32_MAX},
+                {"scan_interval_sec",        &G_config.scan_interval_sec,            1,  INT32_MAX},
+                {"scan_jitter_pct",          &G_config.scan_jitter_pct,              0,  100},
+                {"scan_startup_spread_sec",  &G_config.scan_startup_spread_sec,      0,  INT32_MAX},
+                {"scan_starts_per_minute",   &G_config.scan_starts_per_minute,       0,  UINT32_MAX},
+                {"scan_batch_max",           &G_config.scan_batch_max,               1,  UINT32_MAX},
+                {"scan_session_timeout_sec", &G_config.scan_session_timeout_sec,     1,  INT32_MAX / 1000},
+                {"scan_resume_window_sec",   &G_config.scan_resume_window_sec,       0,  INT32_MAX / 1000},
+                {"metrics_port",             &G_config.metrics_port,                 0,  65535},
+                {"metrics_publish_sec",      &G_config.metrics_publish_sec,          1,  INT32_MAX / 1000},
+                {"capture_frames",           &G_config.capture_frames,               0,  1},
+                {"storage_backend",          &G_config.storage_backend,              0,  1},
+                {"db_pool_size",             &G_config.db_pool_size,                 1,  CONFIG_MAX_DB_POOL_SIZE},
+                {"db_timeout_sec",           &G_config.db_timeout_sec,               1,  3600},
+                {"spool_writes",             &G_config.spool_writes,                 0,  1},
+                {"spool_fsync_msec",         &G_config.spool_fsync_msec,             1,  1000},
+                {"alert_window_sec",         &G_config.alert_window_sec,             0,  86400},
+                {"alert_device_rate",        &G_config.alert_device_rate,            0,  UINT32_MAX},
+                {"alert_publish",            &G_config.alert_publish,                0,  1},
+                {"ordered_scans",            &G_config.ordered_scans,                0,  1},
+        };
+
+/************************************************
+ * char *config_trim()
+ *  @param  char *text
+ *
+ *  @brief  Strips leading and trailing white space in place
+ *
+ *  @author Kerry
+ *
+ *  @return A pointer to the first non-blank character of text
+ ************************************************/
+static char *config_trim(char *text)
+{
+    while (*text == BLANK || *text == '\t')
+    {
+        text++;
+    }
+    char *end = text + strlen(text);
+    while (end > text && (end[-1] == BLANK || end[-1] == '\t' || end[-1] == '\n' || end[-1] == '\r'))
+    {
+        end--;
+    }
+    *end = CS_NULL;
+    return text;
+}
+
+/************************************************
+ * int csl_ConfigLoad()
+ *  @param
+ *          char *file_name  - The config file to read
+ *
+ *  @brief  Overrides the default config values with those found in the config file
+ *
+ *  @author Kerry
+ *
+ *  @note   A missing file is not an error - the monitor simply runs with the defaults
+ *
+ *  @return CS_SUCCESS on success, CS_ERROR if a value in the file is invalid
+ ************************************************/
+int     csl_ConfigLoad(char *file_name)
+{
+    int return_value    = CS_SUCCESS;
+
+    FILE *config_file   = fopen(file_name, "r");
+    if (config_file == NULL)
+    {
+        printf("\t<%s> No config file [%s] - using defaults\n", __PRETTY_FUNCTION__, file_name);
+        return CS_SUCCESS;
+    }
+
+    char    line[CONFIG_LINE_SIZE];
+    int     line_number = 0;
+    while (fgets(line, CONFIG_LINE_SIZE, config_file) != NULL)
+    {
+        line_number++;
+        char *key = config_trim(line);
+        if (*key == CS_NULL || *key == '#')
+        {
+            continue;
+        }
+
+        char *separator = strchr(key, '=');
+        if (separator == NULL)
+        {
+            printf("\t<%s> WARNING: [%s] line %d has no '=' - ignored\n", __PRETTY_FUNCTION__, file_name, line_number);
+            continue;
+        }
+        *separator  = CS_NULL;
+        key         = config_trim(key);
+        char *value = config_trim(separator + 1);
+
+        bool known_key = false;
+        for (size_t i = 0; i < sizeof(G_config_keys) / sizeof(G_config_keys[0]); i++)
+        {
+            if (strcmp(key, G_config_keys[i].key) != 0)
+            {
+                continue;
+            }
+            known_key = true;
+
+            char                *value_end;
+            unsigned long long  number = strtoull(value, &value_end, BASE_TEN);
+            if (*value == CS_NULL || *value_end != CS_NULL ||
+                number < G_config_keys[i].min_value || number > G_config_keys[i].max_value)
+            {
+                printf("\t<%s> ERROR: [%s] line %d: %s = [%s] must be between %u and %u\n",
+                       __PRETTY_FUNCTION__, file_name, line_number, key, value,
+                       G_config_keys[i].min_value, G_config_keys[i].max_value);
+                return_value = CS_ERROR;
+                break;
+            }
+            *G_config_keys[i].value = (unsigned int) number;
+            break;
+        }
+        if (known_key == false)
+        {
+            printf("\t<%s> WARNING: [%s] line %d: unknown key [%s] - ignored\n",
+                   __PRETTY_FUNCTION__, file_name, line_number, key);
+        }
+    }
+    fclose(config_file);
+
+    if (G_config.initial_elements > G_config.max_elements)
+    {
+        G_config.initial_elements = G_config.max_elements;
+    }
+    return return_value;
+}
+
+/************************************************
+ * const csl_monitor_config *csl_Config()
+ *  @param  - None
+ *
+ *  @brief  Returns the monitor's current config
+ *
+ *  @author Kerry
+ *
+ *  @return A pointer to the loaded (or default) config
+ ************************************************/
+const csl_monitor_config *csl_Config()
+{
+    return &G_config;
+}
+
+/************************************************
+ * void csl_ConfigPrint()
+ *  @param  - None
+ *
+ *  @brief  Prints the monitor's current config
+ *
+ *  @author Kerry
+ ************************************************/
+void    csl_ConfigPrint()
+{
+    for (size_t i = 0; i < sizeof(G_config_keys) / sizeof(G_config_keys[0]); i++)
+    {
+        printf("\t\t%-24s = %u\n", G_config_keys[i].key, *G_config_keys[i].value);
+    }
+}
@@ -0,0 +1,188 @@
+
+/************************************************
+ * csl_config.h
+ * ============
+ *
+ * This is the header file for the CS Monitor Config Library
+ *
+ * Author:      Kerry
+ * Version:     00.00.00
+ * Comments:    Runtime settings for the monitor, read once at start-up from FILE_MONITOR_CONFIG
+ ************************************************/
+
+#ifndef CRYTICAMONITOR_CSL_CONFIG_H
+#define CRYTICAMONITOR_CSL_CONFIG_H
+
+#include <stdio.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+
+#include "csl_constants.h"
+
+/************************************************
+ * #defines
+ * ========
+ * The default values used when a key is missing from the config file
+ ************************************************/
+#define CONFIG_DEFAULT_MAX_DEVICES          1000
+#define CONFIG_DEFAULT_INITIAL_ELEMENTS     1024
+#define CONFIG_DEFAULT_MAX_ELEMENTS         1000000
+#define CONFIG_DEFAULT_MAX_MEMORY_MB        0           // 0 = no limit
+#define CONFIG_DEFAULT_SCAN_RECEIVERS       1
+#define CONFIG_MAX_SCAN_RECEIVERS           10          // Endpoint ports step by 100, so 10 fill a monitor's 1000-port block
+#define CONFIG_DEFAULT_IO_THREADS           0           // 0 = one per scan receiver
+#define CONFIG_MAX_IO_THREADS               64
+#define CONFIG_DEFAULT_RCVHWM               10000
+#define CONFIG_DEFAULT_SNDHWM               1000
+#define CONFIG_DEFAULT_RCVBUF               0           // 0 = the OS default
+#define CONFIG_DEFAULT_TCP_KEEPALIVE_IDLE   0           // 0 = the OS default
+#define CONFIG_DEFAULT_POLL_MSEC            1
+#define CONFIG_MAX_POLL_MSEC                1000
+#define CONFIG_DEFAULT_MAX_CONCURRENT_SCANS 4           // Each device's scan has its own session
+#define CONFIG_DEFAULT_SCAN_QUEUE_HIGH      5000
+#define CONFIG_DEFAULT_SCAN_GRANT_TIMEOUT   300         // seconds
+#define CONFIG_DEFAULT_SCAN_INTERVAL        60          // seconds
+#define CONFIG_DEFAULT_SCAN_JITTER_PCT      10
+#define CONFIG_DEFAULT_SCAN_STARTUP_SPREAD  60          // seconds
+#define CONFIG_DEFAULT_SCAN_STARTS_PER_MIN  0           // 0 = no limit
+#define CONFIG_DEFAULT_SCAN_BATCH_MAX       256
+#define CONFIG_DEFAULT_SESSION_TIMEOUT      60          // seconds
+#define CONFIG_DEFAULT_RESUME_WINDOW        300         // seconds
+#define CONFIG_DEFAULT_METRICS_PORT         0           // 0 = metrics are not published
+#define CONFIG_DEFAULT_METRICS_PUBLISH_SEC  10
+#define CONFIG_DEFAULT_CAPTURE_FRAMES       0           // 0 = off
+#define CONFIG_DEFAULT_STORAGE_BACKEND      0           // 0 = MySQL
+#define CONFIG_DEFAULT_DB_POOL_SIZE         4
+#define CONFIG_DEFAULT_DB_TIMEOUT           10          // seconds
+#define CONFIG_DEFAULT_SPOOL_WRITES         1
+#define CONFIG_DEFAULT_SPOOL_FSYNC_MSEC     20
+#define CONFIG_DEFAULT_ALERT_WINDOW         300         // seconds, 0 = every alert is written
+#define CONFIG_DEFAULT_ALERT_DEVICE_RATE    50          // 0 = no limit
+#define CONFIG_DEFAULT_ALERT_PUBLISH        1
+#define CONFIG_DEFAULT_ORDERED_SCANS        1
+#define CONFIG_MAX_DB_POOL_SIZE             64
+#define CONFIG_LINE_SIZE                    256
+
+/************************************************
+ * Monitor Config
+ * ==============
+ * The file is plain "key = value" lines. Blank lines and lines starting with '#' are ignored.
+ * Unknown keys are reported and skipped, so an older monitor can read a newer file.
+ *
+ *      max_devices         - The most devices this monitor will register (at most PROBE_ID_DEVICE_BASE - 1)
+ *      initial_elements    - The rows first allocated for a device's status quo and scan tables
+ *      max_elements        - The most elements a single device scan may hold
+ *      max_memory_mb       - The most memory all device tables together may use, 0 for no limit
+ *      scan_receivers      - The scan endpoints (each with its own decode worker) the probes are spread across
+ *      io_threads          - ZeroMQ I/O threads, 0 for one per scan receiver
+ *      rcvhwm              - Receive high water mark (messages) of every probe-facing socket, 0 for no limit
+ *      sndhwm              - Send high water mark (messages) of every probe-facing socket, 0 for no limit
+ *      rcvbuf              - SO_RCVBUF (bytes) of every probe-facing socket, 0 for the OS default
+ *      tcp_keepalive_idle  - Seconds before TCP keepalive probes start, 0 for the OS default
+ *      poll_msec           - How long the message loop waits on its sockets before checking again
+ *      max_concurrent_scans    - The most devices told to scan at once (scan grants out)
+ *      scan_queue_high         - No new scan grants while more decoded scan messages than this are waiting
+ *      scan_grant_timeout_sec  - A scan grant not returned in this many seconds is reclaimed
+ *      scan_interval_sec       - How often each device is scanned
+ *      scan_jitter_pct         - How far (percent of scan_interval_sec) each next scan is moved at random
+ *      scan_startup_spread_sec - The window over which the first scans (and retries) are spread
+ *      scan_starts_per_minute  - The most scans started across the fleet per minute, 0 for no limit
+ *      scan_batch_max          - The most scan messages handled in a row before control messages get a turn
+ *      scan_session_timeout_sec - A scan that hears nothing from its device for this long is suspended
+ *      scan_resume_window_sec   - How long a suspended scan is kept for its device to resume, 0 to never resume
+ *      metrics_port            - Loopback port of the metrics PUB socket (see csl_metrics.h), 0 for none
+ *      metrics_publish_sec     - How often the metrics are published
+ *      capture_frames          - 1 to record every probe frame received in a capture file (see csl_capture.h)
+ *      storage_backend         - 0 for the MySQL database, 1 for the embedded SQLite one (see csl_storage.h)
+ *      db_pool_size            - MySQL connections, one per thread that uses the database
+ *      db_timeout_sec          - MySQL connect, read and write timeout, and the longest wait for a free connection
+ *      spool_writes            - 1 to write alerts and standards through the local spool (see csl_spool.h), 0 to write directly
+ *      spool_fsync_msec        - How long the spool's drain lets synced writes gather before running them
+ *      alert_window_sec        - A device's scan alerts are collapsed by directory and type over this long, 0 for never
+ *      alert_device_rate       - The most alerts a device writes as they happen per window, 0 for no limit
+ *      alert_publish           - 1 to publish every alert on the broadcaster socket (see csl_alert_event), 0 for none
+ *      ordered_scans           - 1 to agree to ordered scans with the probes that offer them (see statusQuoTableMerge), 0 not to
+ ************************************************/
+typedef struct
+{
+    unsigned int    max_devices;
+    unsigned int    initial_elements;
+    unsigned int    max_elements;
+    unsigned int    max_memory_mb;
+    unsigned int    scan_receivers;
+    unsigned int    io_threads;
+    unsigned int    rcvhwm;
+    unsigned int    sndhwm;
+    unsigned int    rcvbuf;
+    unsigned int    tcp_keepalive_idle;
+    unsigned int    poll_msec;
+    unsigned int    max_concurrent_scans;
+    unsigned int    scan_queue_high;
+    unsigned int    scan_grant_timeout_sec;
+    unsigned int    scan_interval_sec;
+    unsigned int    scan_jitter_pct;
+    unsigned int    scan_startup_spread_sec;
+    unsigned int    scan_starts_per_minute;
+    unsigned int    scan_batch_max;
+    unsigned int    scan_session_timeout_sec;
+    unsigned int    scan_resume_window_sec;
+    unsigned int    metrics_port;
+    unsigned int    metrics_publish_sec;
+    unsigned int    capture_frames;
+    unsigned int    storage_backend;
+    unsigned int    db_pool_size;
+    unsigned int    db_timeout_sec;
+    unsigned int    spool_writes;
+    unsigned int    spool_fsync_msec;
+    unsigned int    alert_window_sec;
+    unsigned int    alert_device_rate;
+    unsigned int    alert_publish;
+    unsigned int    ordered_scans;
+} csl_monitor_config;
+
+/************************************************
+ * **********************************************
+ * Function Prototypes
+ * **********************************************
+ ************************************************/
+
+/************************************************
+ * int csl_ConfigLoad()
+ *  @param
+ *          char *file_name  - The config file to read
+ *
+ *  @brief  Overrides the default config values with those found in the config file
+ *
+ *  @author Kerry
+ *
+ *  @note   A missing file is not an error - the monitor simply runs with the defaults
+ *
+ *  @return CS_SUCCESS on success, CS_ERROR if a value in the file is invalid
+ ************************************************/
+int     csl_ConfigLoad(char *file_name);
+
+/************************************************
+ * const csl_monitor_config *csl_Config()
+ *  @param  - None
+ *
+ *  @brief  Returns the monitor's current config
+ *
+ *  @author Kerry
+ *
+ *  @return A pointer to the loaded (or default) config
+ ************************************************/
+const csl_monitor_config *csl_Config();
+
+/************************************************
+ * void csl_ConfigPrint()
+ *  @param  - None
+ *
+ *  @brief  Prints the monitor's current config
+ *
+ *  @author Kerry
+ ************************************************/
+void    csl_ConfigPrint();
+
+#endif //CRYTICAMONITOR_CSL_CONFIG_H
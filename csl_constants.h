@@ -53,6 +53,7 @@
 #define FILE_MAC_ADDRESS                "myMACaddress"
 #define FILE_MONITOR_EXTERNAL_CONFIG    "External_Config"
 #define FILE_MONITOR_INTERNAL_CONFIG    "Internal_Config"
+#define FILE_MONITOR_CONFIG             "Monitor_Config"
 #define DB_SYNC_INVOKE                  "/usr/crytica/db_sync /usr/crytica/cfgfile-production.txt > /home/kerry/db_sync.log @"
 
 /**** MySQL DB Access Constants ************************/
@@ -60,6 +61,7 @@
 #define CS_SQL_MONITOR_SCHEMA           "cs_monitor"
 #define CS_SQL_LOCAL_DB                 "localhost"
 #define CS_SQL_DB_PORT                  3306
+#define CS_SQL_FROM_EPOCH               "FROM_UNIXTIME(%lld)"  // Pass time_t columns as epoch seconds - no string formatting
 /**** MySQL DB Table/View Constants ************************/
 #define CS_SQL_ALERT_TABLE                  "alert_log"
 #define CS_SQL_ALERT_LOG_VIEW               "v_alert_log"
@@ -114,6 +116,15 @@ static char *element_types[] =
                 "Firmware"
         };
 
+// The changes statusQuoTableSearch() looks for in each element type, indexed as element_types[]. A type missing
+// from the table (a newer probe's) is checked for every change.
+static unsigned char element_compare_masks[] =
+        {
+                0x4 | 0x10,     // Executable File  - MASK_MOD_CONTENTS | MASK_MOD_ATTRIBS
+                0x4 | 0x10,     // Data File        - MASK_MOD_CONTENTS | MASK_MOD_ATTRIBS
+                0x4 | 0x10      // Firmware         - MASK_MOD_CONTENTS | MASK_MOD_ATTRIBS
+        };
+
 #define ELEMENT_DATA_FILE       1
 #define ELEMENT_EXEC_FILE       0
 #define ELEMENT_FIRMWARE        2
@@ -158,9 +169,12 @@ static char *cs_standard_types[] =
 #define SCAN_RECEIVED           120
 #define MESSAGE_TIMEOUT         1001
 #define CSL_MAX_MESSAGE_LENGTH  5012
-#define MAX_ELEMENTS            15000
-#define MAX_DEVICES             1000      // todo - this for testing only and MUST be changed
+#define PROBE_ID_DEVICE_BASE    10000     // probe_id = monitor_id + (device_index + 1) / PROBE_ID_DEVICE_BASE
 #define MAX_PROBES_PER_DEVICE   1       // this is a version 1 constraint
+#define SCAN_SESSION_IDLE       0
+#define SCAN_SESSION_ACTIVE     1
+#define SCAN_SESSION_SUSPENDED  2
+#define SCAN_SESSION_CHECK_MSEC 1000      // how often the scan sessions are checked for stalls
 
 /************************************************
  * Miscellaneous Constants
@@ -188,6 +202,10 @@ static char *cs_standard_types[] =
 #define ALERT_DEL_ELEMENT       0x8
 #define ALERT_MOD_ATTRIBS       0x10
 
+#define ALERT_SCAN_TYPES        4               // ADD_ELEMENT, MOD_CONTENTS, DEL_ELEMENT and MOD_ATTRIBS
+#define ALERT_MAX_BUCKETS       1024            // per device, ALERT_OTHER_DIRECTORY's (one per type) included
+#define ALERT_OTHER_DIRECTORY   "*"
+
 /**** Bit-wise operators - which #define does not handle well ****/
 static unsigned char MASK_COMPARED      = 0x1;
 static unsigned char MASK_ADD_ELEMENT   = 0x2;
@@ -261,6 +279,8 @@ static unsigned char CS_SYNC_CONFIG     = 0x4;
 #define SIZE_CS_SQL_COMMAND             6144
 #define SIZE_PROBE_EVENT_NAME           32
 #define SIZE_OF_TIME                    64
+#define TIME_STRING_SECONDS             17      // Offset of the seconds in "YYYY-MM-DD HH:MM:SS"
+#define SECONDS_PER_MINUTE              60
 #define SIZE_PORT_ADDRESS               8
 #define SIZE_PUBLIC_KEY                 516
 #define SIZE_SCAN_RECORD                5012
@@ -0,0 +1,285 @@
+//
+// Created by kerry on 10/19/26.
+//
+
+#include <string.h>
+#include <pthread.h>
+
+#include "csl_diff.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#define DIFF_X86
+#include <immintrin.h>
+#endif
+
+// The kernels load a scan value as one 32 byte (or two 16 byte) word(s)
+#if SIZE_HASH_ELEMENT != 32
+#error "csl_diff.c assumes a 32 byte SIZE_HASH_ELEMENT"
+#endif
+
+/************************************************
+ * The Kernels
+ * ===========
+ * Each kernel compares the rows of a block below row_ctr a register's worth at a time, so may go a few rows past
+ * row_ctr - those rows are in the block, so reading them is safe, and their bits are masked off by csl_DiffBlock().
+ * The SSE4.2 and AVX2 kernels are compiled for their instruction sets whatever the build's target, and only
+ * chosen on a CPU that has them.
+ ************************************************/
+typedef void (*diff_kernel)(const csl_diff_block *block, uint64_t *contents_changed, uint64_t *attributes_changed);
+
+typedef struct
+{
+    const char      *name;
+    diff_kernel     kernel;
+    bool            (*supported)();
+} diff_kernel_entry;
+
+static diff_kernel      G_diff_kernel       = NULL;
+static const char       *G_diff_kernel_name = NULL;
+static pthread_once_t   G_diff_once         = PTHREAD_ONCE_INIT;
+
+// A scan value read as 64-bit words
+typedef uint64_t __attribute__((may_alias)) diff_word;
+
+/************************************************
+ * unsigned int diff_rows()
+ *  @brief  The rows of a block to compare, never more than it holds
+ ************************************************/
+static inline unsigned int diff_rows(const csl_diff_block *block)
+{
+    return block->row_ctr < DIFF_BLOCK_ROWS ? block->row_ctr : DIFF_BLOCK_ROWS;
+}
+
+/************************************************
+ * void diff_block_scalar()
+ *  @brief  Compares a scan value as four 64-bit words
+ ************************************************/
+static void diff_block_scalar(const csl_diff_block *block, uint64_t *contents_changed, uint64_t *attributes_changed)
+{
+    uint64_t contents   = 0;
+    uint64_t attributes = 0;
+    unsigned int rows   = diff_rows(block);
+    for (unsigned int r = 0; r < rows; r++)
+    {
+        const diff_word *status_quo_words   = (const diff_word *) block->status_quo_values[r];
+        const diff_word *scan_words         = (const diff_word *) block->scan_values[r];
+        uint64_t difference = (status_quo_words[0] ^ scan_words[0]) | (status_quo_words[1] ^ scan_words[1]) |
+                              (status_quo_words[2] ^ scan_words[2]) | (status_quo_words[3] ^ scan_words[3]);
+        contents    |= (uint64_t) (difference != 0) << r;
+        attributes  |= (uint64_t) (block->status_quo_attributes[r] != block->scan_attributes[r]) << r;
+    }
+    *contents_changed   = contents;
+    *attributes_changed = attributes;
+}
+
+static bool diff_supported_scalar()
+{
+    return true;
+}
+
+#ifdef DIFF_X86
+/************************************************
+ * __m128i diff_row_sse42()
+ *  @brief  A row's scan values XORed, folded to one 128-bit word - zero if they are the same
+ ************************************************/
+__attribute__((target("sse4.2")))
+static inline __m128i diff_row_sse42(const csl_diff_block *block, unsigned int r)
+{
+    const __m128i *status_quo   = (const __m128i *) block->status_quo_values[r];
+    const __m128i *scan         = (const __m128i *) block->scan_values[r];
+    return _mm_or_si128(_mm_xor_si128(_mm_load_si128(status_quo), _mm_load_si128(scan)),
+                        _mm_xor_si128(_mm_load_si128(status_quo + 1), _mm_load_si128(scan + 1)));
+}
+
+/************************************************
+ * void diff_block_sse42()
+ *  @brief  Compares the scan values 2 rows at a time, and the attributes 16 rows at a time
+ ************************************************/
+__attribute__((target("sse4.2")))
+static void diff_block_sse42(const csl_diff_block *block, uint64_t *contents_changed, uint64_t *attributes_changed)
+{
+    uint64_t contents   = 0;
+    uint64_t attributes = 0;
+    unsigned int rows   = diff_rows(block);
+    for (unsigned int r = 0; r < rows; r += 2)
+    {
+        __m128i difference_0    = diff_row_sse42(block, r);
+        __m128i difference_1    = diff_row_sse42(block, r + 1);
+        // One 64-bit word per row, zero if the row is unchanged
+        __m128i difference      = _mm_or_si128(_mm_unpacklo_epi64(difference_0, difference_1),
+                                               _mm_unpackhi_epi64(difference_0, difference_1));
+        int same = _mm_movemask_pd(_mm_castsi128_pd(_mm_cmpeq_epi64(difference, _mm_setzero_si128())));
+        contents |= (uint64_t) (~same & 0x3) << r;
+    }
+    for (unsigned int r = 0; r < rows; r += 16)
+    {
+        const __m128i *status_quo   = (const __m128i *) &block->status_quo_attributes[r];
+        const __m128i *scan         = (const __m128i *) &block->scan_attributes[r];
+        __m128i same = _mm_packs_epi16(_mm_cmpeq_epi16(_mm_load_si128(status_quo), _mm_load_si128(scan)),
+                                       _mm_cmpeq_epi16(_mm_load_si128(status_quo + 1), _mm_load_si128(scan + 1)));
+        attributes |= (uint64_t) (~_mm_movemask_epi8(same) & 0xffff) << r;
+    }
+    *contents_changed   = contents;
+    *attributes_changed = attributes;
+}
+
+static bool diff_supported_sse42()
+{
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("sse4.2");
+}
+
+/************************************************
+ * __m256i diff_row_avx2()
+ *  @brief  A row's scan values XORed - zero if they are the same
+ ************************************************/
+__attribute__((target("avx2")))
+static inline __m256i diff_row_avx2(const csl_diff_block *block, unsigned int r)
+{
+    return _mm256_xor_si256(_mm256_load_si256((const __m256i *) block->status_quo_values[r]),
+                            _mm256_load_si256((const __m256i *) block->scan_values[r]));
+}
+
+/************************************************
+ * void diff_block_avx2()
+ *  @brief  Compares the scan values 4 rows at a time, and the attributes 32 rows at a time
+ ************************************************/
+__attribute__((target("avx2")))
+static void diff_block_avx2(const csl_diff_block *block, uint64_t *contents_changed, uint64_t *attributes_changed)
+{
+    uint64_t contents   = 0;
+    uint64_t attributes = 0;
+    unsigned int rows   = diff_rows(block);
+    for (unsigned int r = 0; r < rows; r += 4)
+    {
+        __m256i difference_0    = diff_row_avx2(block, r);
+        __m256i difference_1    = diff_row_avx2(block, r + 1);
+        __m256i difference_2    = diff_row_avx2(block, r + 2);
+        __m256i difference_3    = diff_row_avx2(block, r + 3);
+        // Fold each row to two 64-bit words, rows 0 and 1 in one register and 2 and 3 in the other ...
+        __m256i difference_01   = _mm256_or_si256(_mm256_unpacklo_epi64(difference_0, difference_1),
+                                                  _mm256_unpackhi_epi64(difference_0, difference_1));
+        __m256i difference_23   = _mm256_or_si256(_mm256_unpacklo_epi64(difference_2, difference_3),
+                                                  _mm256_unpackhi_epi64(difference_2, difference_3));
+        // ... then to one 64-bit word per row, in row order, zero if the row is unchanged
+        __m256i difference      = _mm256_or_si256(_mm256_permute2x128_si256(difference_01, difference_23, 0x20),
+                                                  _mm256_permute2x128_si256(difference_01, difference_23, 0x31));
+        int same = _mm256_movemask_pd(_mm256_castsi256_pd(_mm256_cmpeq_epi64(difference, _mm256_setzero_si256())));
+        contents |= (uint64_t) (~same & 0xf) << r;
+    }
+    for (unsigned int r = 0; r < rows; r += 32)
+    {
+        const __m256i *status_quo   = (const __m256i *) &block->status_quo_attributes[r];
+        const __m256i *scan         = (const __m256i *) &block->scan_attributes[r];
+        // packs works within each 128-bit lane, so the permute puts the rows back in order
+        __m256i same = _mm256_packs_epi16(_mm256_cmpeq_epi16(_mm256_load_si256(status_quo), _mm256_load_si256(scan)),
+                                          _mm256_cmpeq_epi16(_mm256_load_si256(status_quo + 1),
+                                                             _mm256_load_si256(scan + 1)));
+        same = _mm256_permute4x64_epi64(same, 0xd8);
+        attributes |= (uint64_t) (uint32_t) ~_mm256_movemask_epi8(same) << r;
+    }
+    *contents_changed   = contents;
+    *attributes_changed = attributes;
+}
+
+static bool diff_supported_avx2()
+{
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("avx2");
+}
+#endif
+
+// Fastest first
+static const diff_kernel_entry G_diff_kernels[] =
+        {
+#ifdef DIFF_X86
+                {DIFF_KERNEL_AVX2,      diff_block_avx2,    diff_supported_avx2},
+                {DIFF_KERNEL_SSE42,     diff_block_sse42,   diff_supported_sse42},
+#endif
+                {DIFF_KERNEL_SCALAR,    diff_block_scalar,  diff_supported_scalar}
+        };
+
+/************************************************
+ * bool csl_DiffSelect()
+ *  @param  const char *kernel_name     - DIFF_KERNEL_SCALAR, DIFF_KERNEL_SSE42, DIFF_KERNEL_AVX2, or NULL
+ *
+ *  @brief  Chooses the kernel csl_DiffBlock() runs
+ *
+ *  @author Kerry
+ *
+ *  @note   With NULL, the fastest kernel this CPU supports is chosen
+ *
+ *  @return true, or false if this CPU (or this build) lacks the kernel asked for
+ ************************************************/
+bool    csl_DiffSelect(const char *kernel_name)
+{
+    for (size_t k = 0; k < sizeof(G_diff_kernels) / sizeof(G_diff_kernels[0]); k++)
+    {
+        if (kernel_name != NULL && strcmp(kernel_name, G_diff_kernels[k].name) != 0)
+        {
+            continue;
+        }
+        if (G_diff_kernels[k].supported() == false)
+        {
+            if (kernel_name != NULL)
+            {
+                return false;
+            }
+            continue;
+        }
+        G_diff_kernel_name  = G_diff_kernels[k].name;
+        G_diff_kernel       = G_diff_kernels[k].kernel;
+        return true;
+    }
+    return false;
+}
+
+/************************************************
+ * void diff_select_default()
+ *  @brief  Run once, by the first csl_DiffBlock() before any csl_DiffSelect()
+ ************************************************/
+static void diff_select_default()
+{
+    if (G_diff_kernel == NULL)
+    {
+        csl_DiffSelect(NULL);
+    }
+}
+
+/************************************************
+ * const char *csl_DiffKernelName()
+ *  @param  - None
+ *
+ *  @brief  The name of the kernel csl_DiffBlock() runs
+ *
+ *  @author Kerry
+ ************************************************/
+const char  *csl_DiffKernelName()
+{
+    pthread_once(&G_diff_once, diff_select_default);
+    return G_diff_kernel_name;
+}
+
+/************************************************
+ * void csl_DiffBlock()
+ *  @param
+ *          const csl_diff_block    *block
+ *          uint64_t                *contents_changed   - Bit r is set if row r's scan values differ
+ *          uint64_t                *attributes_changed - Bit r is set if row r's attributes differ
+ *
+ *  @brief  Compares the rows of a diff block
+ *
+ *  @author Kerry
+ ************************************************/
+void    csl_DiffBlock(const csl_diff_block *block, uint64_t *contents_changed, uint64_t *attributes_changed)
+{
+    if (G_diff_kernel == NULL)
+    {
+        pthread_once(&G_diff_once, diff_select_default);
+    }
+    G_diff_kernel(block, contents_changed, attributes_changed);
+
+    uint64_t rows = block->row_ctr >= DIFF_BLOCK_ROWS ? ~0ULL : (1ULL << block->row_ctr) - 1;
+    *contents_changed   &= rows;
+    *attributes_changed &= rows;
+}
@@ -0,0 +1,97 @@
+
+/************************************************
+ * csl_diff.h
+ * ==========
+ *
+ * This is the header file for the CS Diff Library
+ *
+ * Author:      Kerry
+ * Version:     00.00.00
+ * Comments:    Compares blocks of scan values and attributes against the status quo, a block at a time
+ ************************************************/
+
+#ifndef CRYTICAMONITOR_CSL_DIFF_H
+#define CRYTICAMONITOR_CSL_DIFF_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "csl_constants.h"
+
+/************************************************
+ * #defines
+ * ========
+ ************************************************/
+#define DIFF_BLOCK_ROWS             64              // One bit per row in a uint64_t change bitmap
+#define DIFF_ALIGNMENT              32              // An AVX2 register
+
+#define DIFF_KERNEL_SCALAR          "scalar"
+#define DIFF_KERNEL_SSE42           "sse4.2"
+#define DIFF_KERNEL_AVX2            "avx2"
+
+/************************************************
+ * Diff Block
+ * ==========
+ * statusQuoTableSearch() pairs each scan element with its status quo row, and copies the pair's scan values and
+ * attributes into the next row of a diff block. A full block (or the last, partial one) is compared in one call
+ * to csl_DiffBlock(), which sets a bit in the contents and attributes bitmaps for each row that differs; only the
+ * rows whose bits are set are looked at again.
+ *
+ * The scan values are held one after another, each on its own DIFF_ALIGNMENT boundary, so that a row is one
+ * aligned load, and the attributes likewise, so that 16 rows of them are one load.
+ * The rows past row_ctr are never reported, whatever they hold.
+ ************************************************/
+typedef struct
+{
+    byte            status_quo_values[DIFF_BLOCK_ROWS][SIZE_HASH_ELEMENT]   __attribute__((aligned(DIFF_ALIGNMENT)));
+    byte            scan_values[DIFF_BLOCK_ROWS][SIZE_HASH_ELEMENT]         __attribute__((aligned(DIFF_ALIGNMENT)));
+    unsigned short  status_quo_attributes[DIFF_BLOCK_ROWS]                  __attribute__((aligned(DIFF_ALIGNMENT)));
+    unsigned short  scan_attributes[DIFF_BLOCK_ROWS]                        __attribute__((aligned(DIFF_ALIGNMENT)));
+    unsigned int    row_ctr;
+} csl_diff_block;
+
+/************************************************
+ * **********************************************
+ * Function Prototypes
+ * **********************************************
+ ************************************************/
+
+/************************************************
+ * bool csl_DiffSelect()
+ *  @param  const char *kernel_name     - DIFF_KERNEL_SCALAR, DIFF_KERNEL_SSE42, DIFF_KERNEL_AVX2, or NULL
+ *
+ *  @brief  Chooses the kernel csl_DiffBlock() runs
+ *
+ *  @author Kerry
+ *
+ *  @note   With NULL, the fastest kernel this CPU supports is chosen. Until a kernel is chosen, the first call to
+ *          csl_DiffBlock() makes that choice.
+ *
+ *  @return true, or false if this CPU (or this build) lacks the kernel asked for - the choice is then unchanged
+ ************************************************/
+bool    csl_DiffSelect(const char *kernel_name);
+
+/************************************************
+ * const char *csl_DiffKernelName()
+ *  @param  - None
+ *
+ *  @brief  The name of the kernel csl_DiffBlock() runs
+ *
+ *  @author Kerry
+ ************************************************/
+const char  *csl_DiffKernelName();
+
+/************************************************
+ * void csl_DiffBlock()
+ *  @param
+ *          const csl_diff_block    *block
+ *          uint64_t                *contents_changed   - Bit r is set if row r's scan values differ
+ *          uint64_t                *attributes_changed - Bit r is set if row r's attributes differ
+ *
+ *  @brief  Compares the rows of a diff block
+ *
+ *  @author Kerry
+ ************************************************/
+void    csl_DiffBlock(const csl_diff_block *block, uint64_t *contents_changed, uint64_t *attributes_changed);
+
+#endif //CRYTICAMONITOR_CSL_DIFF_H
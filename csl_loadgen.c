@@ -0,0 +1,711 @@
+//
+// Created by kerry on 10/19/26.
+//
+
+/************************************************
+ * csl_loadgen
+ * ===========
+ * Simulates a fleet of probes against a running monitor, speaking the real protocol: the csl_serializeMessageByte()
+ * wire format over CurveZMQ, keyed with the monitor's public key file.
+ *
+ * Each simulated probe handshakes on the responder, is told its scan endpoint, and then heartbeats. Whenever a
+ * heartbeat's reply grants it a scan it pushes PROBE_START_SCAN, one PROBE_RECURRING_SCAN per file and
+ * PROBE_END_SCAN. Between scans a share of its files change (a new hash), which the monitor should alert on.
+ *
+ *      csl_loadgen -b port_base [-H host] [-k monitor.pub] [-p probes] [-f files] [-c change_pct]
+ *                  [-i heartbeat_sec] [-t threads] [-d duration_sec] [-M metrics_port] [-l]
+ *
+ *          -b  The monitor's port base - the last octet of its internal IP address * 1000
+ *          -H  The monitor's host, 127.0.0.1 by default
+ *          -k  The monitor's public key file, MONITOR_PUB_KEY_FILE_NAME by default
+ *          -p  Probes to simulate
+ *          -f  Files each probe scans
+ *          -c  Percent of a probe's files that change between its scans
+ *          -i  Seconds between a probe's heartbeats - how soon it can see a scan grant
+ *          -t  Threads the probes are spread across
+ *          -d  Seconds to run, 0 to run until interrupted
+ *          -M  The monitor's metrics_port, to measure alert latency (see below)
+ *          -l  List the device identifiers (MAC addresses) the probes use, and exit
+ *
+ * How often each device is scanned is up to the monitor's scheduler (scan_interval_sec and the rest of its
+ * scan config), exactly as for real probes.
+ *
+ * The monitor only talks to devices assigned to it, so the probes' MAC addresses (see -l) must be in its
+ * database before the run.
+ *
+ * Alert latency is measured from a probe sending PROBE_END_SCAN to the monitor's alert counter
+ * (crytica_alerts_total, on its metrics socket) covering that scan's changes. It is only as fine as the
+ * monitor's metrics_publish_sec.
+ ************************************************/
+
+#include <getopt.h>
+#include "csl_message.h"
+#include "csl_client.h"
+
+#define LOADGEN_DEFAULT_HOST            "127.0.0.1"
+#define LOADGEN_DEFAULT_PROBES          100
+#define LOADGEN_DEFAULT_FILES           1000
+#define LOADGEN_DEFAULT_CHANGE_PCT      1
+#define LOADGEN_DEFAULT_HEARTBEAT_SEC   2
+#define LOADGEN_DEFAULT_THREADS         4
+#define LOADGEN_MAX_THREADS             64
+#define LOADGEN_REPLY_TIMEOUT_MSEC      5000
+#define LOADGEN_LINGER_MSEC             10000
+#define LOADGEN_REPORT_SECONDS          10
+#define LOADGEN_PENDING_SCANS           4096        // Scans whose alerts have not been seen yet
+#define LOADGEN_LATENCY_INITIAL         4096
+#define LOADGEN_LICENSE_KEY             "crytica-loadgen"
+#define LOADGEN_FILE_FORMAT             "/opt/loadgen/probe%05u/file%07u"
+#define LOADGEN_ALERTS_METRIC           "crytica_alerts_total "
+
+/************************************************
+ * The Simulated Probes
+ * ====================
+ * Each probe belongs to one thread, which owns its sockets. A probe's file f has the hash of
+ * (probe, f, versions[f]) - a change is simply a new version.
+ ************************************************/
+typedef struct
+{
+    unsigned int    index;
+    byte            mac_address[IFHWADDRLEN];
+    char            uuid[SIZE_ZUUID];
+    char            hostname[SIZE_HOST_NAME];
+    char            ip_address[SIZE_IP4_ADDRESS];
+    uint32_t        probe_id;
+    zsock_t         *requester;
+    zsock_t         *pusher;                    // NULL until the probe's handshake is acknowledged
+    int64_t         next_heartbeat;             // zclock_mono()
+    unsigned int    *versions;
+    unsigned long long scan_ctr;
+} loadgen_probe;
+
+enum
+{
+    LOADGEN_HANDSHAKE,
+    LOADGEN_HEARTBEAT,
+    LOADGEN_SCAN,
+    LOADGEN_MESSAGE_TYPES
+};
+
+typedef struct
+{
+    int64_t         ended_usecs;                // when PROBE_END_SCAN was sent
+    unsigned int    changes;                    // alerts still to be seen for the scan
+} loadgen_pending_scan;
+
+typedef struct
+{
+    char            host[HOST_NAME_MAX + 1];
+    int             port_base;
+    const char      *server_key;
+    zcert_t         *client_cert;
+    unsigned int    probe_ctr;
+    unsigned int    file_ctr;
+    unsigned int    change_pct;
+    unsigned int    heartbeat_sec;
+    unsigned int    thread_ctr;
+    loadgen_probe   *probes;
+
+    // **** Updated by every thread **** //
+    unsigned long long  message_ctr[LOADGEN_MESSAGE_TYPES];
+    unsigned long long  byte_ctr;
+    unsigned long long  scan_ctr;
+    unsigned long long  change_ctr;
+    unsigned long long  refused_ctr;            // handshakes from devices the monitor does not know
+    unsigned long long  timeout_ctr;
+    volatile int        stopping;               // set when the run is over
+
+    // **** The scans waiting for their alerts, oldest first, under pending_lock **** //
+    pthread_mutex_t         pending_lock;
+    loadgen_pending_scan    pending[LOADGEN_PENDING_SCANS];
+    unsigned int            pending_head;
+    unsigned int            pending_ctr;
+
+    // **** Alert latencies, only touched by the main thread **** //
+    int64_t         *latencies;
+    size_t          latency_ctr;
+    size_t          latency_size;
+} loadgen_state;
+
+static loadgen_state G_loadgen;
+
+/************************************************
+ * zsock_t *loadgen_socket()
+ *  @param
+ *          int type    - ZMQ_REQ or ZMQ_PUSH
+ *          int port
+ *
+ *  @brief  Connects a client socket with the tool's timeouts (csl_client.h)
+ *
+ *  @author Kerry
+ *
+ *  @return The socket, or NULL
+ ************************************************/
+static zsock_t *loadgen_socket(int type, int port)
+{
+    return csl_ClientSocket(type, G_loadgen.host, port, G_loadgen.client_cert, G_loadgen.server_key,
+                            LOADGEN_REPLY_TIMEOUT_MSEC, LOADGEN_LINGER_MSEC);
+}
+
+/************************************************
+ * void loadgen_message()
+ *  @param
+ *          csl_zmessage    *message
+ *          loadgen_probe   *probe
+ *          uint32_t        probe_event
+ *          const char      *file_name      - NULL for none
+ *          const char      *hash           - NULL for none
+ *
+ *  @brief  Fills in a message from the probe, the way a real probe does
+ *
+ *  @author Kerry
+ ************************************************/
+static void loadgen_message(csl_zmessage *message, loadgen_probe *probe, uint32_t probe_event,
+                            const char *file_name, const char *hash)
+{
+    memset(message, 0, sizeof(csl_zmessage));
+    snprintf(message->license_key, SIZE_LICENSE_KEY, "%s", LOADGEN_LICENSE_KEY);
+    if (file_name != NULL)
+    {
+        snprintf(message->file_name, SIZE_ELEMENT_NAME, "%s", file_name);
+        message->file_name_size = (uint32_t) strlen(message->file_name);
+    }
+    if (hash != NULL)
+    {
+        memcpy(message->hash, hash, SIZE_HASH_ELEMENT);
+    }
+    memcpy(message->hostname, probe->hostname, SIZE_HOST_NAME);
+    memcpy(message->probe_uuid, probe->uuid, SIZE_ZUUID);
+    memcpy(message->probe_ip, probe->ip_address, SIZE_IP4_ADDRESS);
+    memcpy(message->probe_mac_address, probe->mac_address, IFHWADDRLEN);
+    message->probe_event        = probe_event;
+    message->probe_id           = probe->probe_id;
+    message->file_attribute     = 0100755;
+    message->message_total_size = csl_MessageWireSize(message);
+}
+
+/************************************************
+ * int loadgen_send()
+ *  @param
+ *          zsock_t         *socket
+ *          csl_zmessage    *message
+ *          int             message_type    - LOADGEN_HANDSHAKE, LOADGEN_HEARTBEAT or LOADGEN_SCAN
+ *
+ *  @brief  Serializes and sends one message
+ *
+ *  @author Kerry
+ *
+ *  @return CS_SUCCESS on success, CS_ERROR if it could not be sent
+ ************************************************/
+static int loadgen_send(zsock_t *socket, csl_zmessage *message, int message_type)
+{
+    byte buffer[CSL_MAX_MESSAGE_LENGTH];
+    csl_serializeMessageByte(message, buffer);
+    if (zmq_send(zsock_resolve(socket), buffer, message->message_total_size, 0) == -1)
+    {
+        return CS_ERROR;
+    }
+    __atomic_add_fetch(&G_loadgen.message_ctr[message_type], 1, __ATOMIC_RELAXED);
+    __atomic_add_fetch(&G_loadgen.byte_ctr, message->message_total_size, __ATOMIC_RELAXED);
+    return CS_SUCCESS;
+}
+
+/************************************************
+ * int loadgen_request()
+ *  @param
+ *          loadgen_probe   *probe
+ *          csl_zmessage    *message    - The request, replaced by the monitor's reply
+ *          int             message_type
+ *
+ *  @brief  Sends a request on the responder and waits for the reply
+ *
+ *  @author Kerry
+ *
+ *  @return CS_SUCCESS with the reply in message, CS_ERROR if there was no reply
+ ************************************************/
+static int loadgen_request(loadgen_probe *probe, csl_zmessage *message, int message_type)
+{
+    if (probe->requester == NULL)
+    {
+        probe->requester = loadgen_socket(ZMQ_REQ, G_loadgen.port_base + RESPONDER_PORT);
+        if (probe->requester == NULL)
+        {
+            return CS_ERROR;
+        }
+    }
+    if (loadgen_send(probe->requester, message, message_type) != CS_SUCCESS)
+    {
+        return CS_ERROR;
+    }
+
+    zmq_msg_t reply;
+    zmq_msg_init(&reply);
+    if (zmq_msg_recv(&reply, zsock_resolve(probe->requester), 0) == -1)
+    {
+        // A REQ socket that missed its reply can not send again, so start over with a new one
+        zmq_msg_close(&reply);
+        zsock_destroy(&probe->requester);
+        __atomic_add_fetch(&G_loadgen.timeout_ctr, 1, __ATOMIC_RELAXED);
+        return CS_ERROR;
+    }
+    memset(message, 0, sizeof(csl_zmessage));
+    csl_deserializeMessageByte(message, zmq_msg_data(&reply));
+    zmq_msg_close(&reply);
+    return CS_SUCCESS;
+}
+
+/************************************************
+ * void loadgen_handshake()
+ *  @param  loadgen_probe *probe
+ *
+ *  @brief  Handshakes and connects the probe to the scan endpoint the monitor names
+ *
+ *  @author Kerry
+ ************************************************/
+static void loadgen_handshake(loadgen_probe *probe)
+{
+    csl_zmessage message;
+    loadgen_message(&message, probe, PROBE_HANDSHAKE, NULL, NULL);
+    if (loadgen_request(probe, &message, LOADGEN_HANDSHAKE) != CS_SUCCESS)
+    {
+        return;
+    }
+
+    // Only a device the monitor knows is told its scan endpoint
+    int scan_port = 0;
+    if (sscanf(message.file_name, HANDSHAKE_SCAN_PORT_DIRECTIVE, &scan_port) != 1)
+    {
+        __atomic_add_fetch(&G_loadgen.refused_ctr, 1, __ATOMIC_RELAXED);
+        return;
+    }
+    probe->probe_id = message.probe_id;
+    probe->pusher   = loadgen_socket(ZMQ_PUSH, scan_port);
+}
+
+/************************************************
+ * void loadgen_hash()
+ *  @param
+ *          char            hash[SIZE_HASH_ELEMENT_Z]
+ *          unsigned int    probe_index
+ *          unsigned int    file_index
+ *          unsigned int    version
+ *
+ *  @brief  Makes up a file's hash - 32 hex digits that change with its version
+ *
+ *  @author Kerry
+ ************************************************/
+static void loadgen_hash(char hash[SIZE_HASH_ELEMENT_Z], unsigned int probe_index, unsigned int file_index,
+                         unsigned int version)
+{
+    uint64_t seed = ((uint64_t) probe_index << 40) ^ ((uint64_t) file_index << 16) ^ version;
+    uint64_t words[2];
+    for (int i = 0; i < 2; i++)
+    {
+        // splitmix64
+        seed        += 0x9E3779B97F4A7C15ULL;
+        uint64_t z  = seed;
+        z           = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+        z           = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+        words[i]    = z ^ (z >> 31);
+    }
+    snprintf(hash, SIZE_HASH_ELEMENT_Z, "%016llx%016llx", (unsigned long long) words[0], (unsigned long long) words[1]);
+}
+
+/************************************************
+ * void loadgen_scan()
+ *  @param
+ *          loadgen_probe   *probe
+ *          unsigned int    *random_seed    - The thread's rand_r() seed
+ *
+ *  @brief  Changes some of the probe's files and sends a whole scan of them
+ *
+ *  @author Kerry
+ ************************************************/
+static void loadgen_scan(loadgen_probe *probe, unsigned int *random_seed)
+{
+    csl_zmessage    message;
+    char            file_name[SIZE_ELEMENT_NAME];
+    char            hash[SIZE_HASH_ELEMENT_Z];
+    unsigned int    changes = 0;
+
+    // The first scan is the device's standard, so there is nothing to change yet
+    if (probe->scan_ctr > 0)
+    {
+        for (unsigned int f = 0; f < G_loadgen.file_ctr; f++)
+        {
+            if ((unsigned int) (rand_r(random_seed) % 100) < G_loadgen.change_pct)
+            {
+                probe->versions[f]++;
+                changes++;
+            }
+        }
+    }
+
+    loadgen_message(&message, probe, PROBE_START_SCAN, NULL, NULL);
+    if (loadgen_send(probe->pusher, &message, LOADGEN_SCAN) != CS_SUCCESS)
+    {
+        return;
+    }
+    for (unsigned int f = 0; f < G_loadgen.file_ctr; f++)
+    {
+        snprintf(file_name, SIZE_ELEMENT_NAME, LOADGEN_FILE_FORMAT, probe->index, f);
+        loadgen_hash(hash, probe->index, f, probe->versions[f]);
+        loadgen_message(&message, probe, PROBE_RECURRING_SCAN, file_name, hash);
+        if (loadgen_send(probe->pusher, &message, LOADGEN_SCAN) != CS_SUCCESS)
+        {
+            return;
+        }
+    }
+    loadgen_message(&message, probe, PROBE_END_SCAN, NULL, NULL);
+    if (loadgen_send(probe->pusher, &message, LOADGEN_SCAN) != CS_SUCCESS)
+    {
+        return;
+    }
+    probe->scan_ctr++;
+    __atomic_add_fetch(&G_loadgen.scan_ctr, 1, __ATOMIC_RELAXED);
+    __atomic_add_fetch(&G_loadgen.change_ctr, changes, __ATOMIC_RELAXED);
+
+    if (changes > 0)
+    {
+        pthread_mutex_lock(&G_loadgen.pending_lock);
+        if (G_loadgen.pending_ctr < LOADGEN_PENDING_SCANS)
+        {
+            unsigned int tail = (G_loadgen.pending_head + G_loadgen.pending_ctr) % LOADGEN_PENDING_SCANS;
+            G_loadgen.pending[tail].ended_usecs = zclock_usecs();
+            G_loadgen.pending[tail].changes     = changes;
+            G_loadgen.pending_ctr++;
+        }
+        pthread_mutex_unlock(&G_loadgen.pending_lock);
+    }
+}
+
+/************************************************
+ * void *loadgen_thread()
+ *  @param  void *args  - The thread's number
+ *
+ *  @brief  Runs every probe whose index % thread_ctr is the thread's number until the run is over
+ *
+ *  @author Kerry
+ ************************************************/
+static void *loadgen_thread(void *args)
+{
+    unsigned int thread_number  = (unsigned int) (uintptr_t) args;
+    unsigned int random_seed    = thread_number + 1;
+
+    while (! zsys_interrupted && ! G_loadgen.stopping)
+    {
+        int64_t now         = zclock_mono();
+        int64_t next_due    = now + (int64_t) G_loadgen.heartbeat_sec * 1000;
+        for (unsigned int p = thread_number; p < G_loadgen.probe_ctr && ! G_loadgen.stopping; p += G_loadgen.thread_ctr)
+        {
+            loadgen_probe *probe = &G_loadgen.probes[p];
+            if (probe->next_heartbeat <= now)
+            {
+                if (probe->pusher == NULL)
+                {
+                    loadgen_handshake(probe);
+                }
+                else
+                {
+                    csl_zmessage message;
+                    loadgen_message(&message, probe, PROBE_HEARTBEAT, NULL, NULL);
+                    if (loadgen_request(probe, &message, LOADGEN_HEARTBEAT) == CS_SUCCESS &&
+                        message.probe_event == PROBE_RECURRING_SCAN)
+                    {
+                        // A resume directive is ignored - the probe simply scans afresh
+                        loadgen_scan(probe, &random_seed);
+                    }
+                }
+                probe->next_heartbeat = zclock_mono() + (int64_t) G_loadgen.heartbeat_sec * 1000;
+            }
+            if (probe->next_heartbeat < next_due)
+            {
+                next_due = probe->next_heartbeat;
+            }
+        }
+        int64_t wait_msec = next_due - zclock_mono();
+        if (wait_msec > 0)
+        {
+            zclock_sleep((int) wait_msec);
+        }
+    }
+
+    for (unsigned int p = thread_number; p < G_loadgen.probe_ctr; p += G_loadgen.thread_ctr)
+    {
+        zsock_destroy(&G_loadgen.probes[p].requester);
+        zsock_destroy(&G_loadgen.probes[p].pusher);
+    }
+    return NULL;
+}
+
+/************************************************
+ * void loadgen_alerts_seen()
+ *  @param  unsigned long long alert_ctr    - How many more alerts the monitor has written
+ *
+ *  @brief  Settles the oldest pending scans against the new alerts, recording each alert's latency
+ *
+ *  @author Kerry
+ ************************************************/
+static void loadgen_alerts_seen(unsigned long long alert_ctr)
+{
+    int64_t now = zclock_usecs();
+    pthread_mutex_lock(&G_loadgen.pending_lock);
+    while (alert_ctr > 0 && G_loadgen.pending_ctr > 0)
+    {
+        loadgen_pending_scan *scan = &G_loadgen.pending[G_loadgen.pending_head];
+        unsigned int settled = alert_ctr < scan->changes ? (unsigned int) alert_ctr : scan->changes;
+        for (unsigned int i = 0; i < settled; i++)
+        {
+            if (G_loadgen.latency_ctr == G_loadgen.latency_size)
+            {
+                size_t  new_size        = G_loadgen.latency_size == 0 ? LOADGEN_LATENCY_INITIAL : G_loadgen.latency_size * 2;
+                int64_t *new_latencies  = realloc(G_loadgen.latencies, new_size * sizeof(int64_t));
+                if (new_latencies == NULL)
+                {
+                    break;
+                }
+                G_loadgen.latencies     = new_latencies;
+                G_loadgen.latency_size  = new_size;
+            }
+            G_loadgen.latencies[G_loadgen.latency_ctr++] = now - scan->ended_usecs;
+        }
+        scan->changes   -= settled;
+        alert_ctr       -= settled;
+        if (scan->changes == 0)
+        {
+            G_loadgen.pending_head = (G_loadgen.pending_head + 1) % LOADGEN_PENDING_SCANS;
+            G_loadgen.pending_ctr--;
+        }
+    }
+    pthread_mutex_unlock(&G_loadgen.pending_lock);
+}
+
+/************************************************
+ * int loadgen_latency_compare()
+ *  @param
+ *          const void *left
+ *          const void *right
+ *
+ *  @brief  qsort() comparison for the alert latencies
+ *
+ *  @author Kerry
+ ************************************************/
+static int loadgen_latency_compare(const void *left, const void *right)
+{
+    int64_t left_usecs  = *(const int64_t *) left;
+    int64_t right_usecs = *(const int64_t *) right;
+    return (left_usecs > right_usecs) - (left_usecs < right_usecs);
+}
+
+/************************************************
+ * void loadgen_report()
+ *  @param
+ *          int64_t elapsed_usecs
+ *          bool    final_report    - Also print the alert latencies
+ *
+ *  @brief  Prints the messages sent per second, the scans and, at the end, the alert latencies
+ *
+ *  @author Kerry
+ ************************************************/
+static void loadgen_report(int64_t elapsed_usecs, bool final_report)
+{
+    double elapsed_secs = elapsed_usecs > 0 ? (double) elapsed_usecs / 1000000.0 : 1.0;
+    char *type_names[LOADGEN_MESSAGE_TYPES] = {"handshake", "heartbeat", "scan"};
+
+    printf("\n\t[%.0f sec] %u probes  %llu scans  %llu changes  %llu refused  %llu timeouts\n",
+           elapsed_secs, G_loadgen.probe_ctr, G_loadgen.scan_ctr, G_loadgen.change_ctr,
+           G_loadgen.refused_ctr, G_loadgen.timeout_ctr);
+    unsigned long long total_ctr = 0;
+    for (int type = 0; type < LOADGEN_MESSAGE_TYPES; type++)
+    {
+        printf("\t\t%-10s %12llu messages %12.1f messages/sec\n",
+               type_names[type], G_loadgen.message_ctr[type], (double) G_loadgen.message_ctr[type] / elapsed_secs);
+        total_ctr += G_loadgen.message_ctr[type];
+    }
+    printf("\t\t%-10s %12llu messages %12.1f messages/sec %10.3f MB/sec\n", "total", total_ctr,
+           (double) total_ctr / elapsed_secs, (double) G_loadgen.byte_ctr / elapsed_secs / (1024.0 * 1024.0));
+
+    if (final_report && G_loadgen.latency_ctr > 0)
+    {
+        qsort(G_loadgen.latencies, G_loadgen.latency_ctr, sizeof(int64_t), loadgen_latency_compare);
+        size_t last = G_loadgen.latency_ctr - 1;
+        printf("\t\talert latency msecs (%zu alerts): min %.1f  p50 %.1f  p90 %.1f  p99 %.1f  max %.1f\n",
+               G_loadgen.latency_ctr,
+               (double) G_loadgen.latencies[0] / 1000.0,
+               (double) G_loadgen.latencies[last * 50 / 100] / 1000.0,
+               (double) G_loadgen.latencies[last * 90 / 100] / 1000.0,
+               (double) G_loadgen.latencies[last * 99 / 100] / 1000.0,
+               (double) G_loadgen.latencies[last] / 1000.0);
+    }
+}
+
+/************************************************
+ * void loadgen_usage()
+ *  @param  const char *program_name
+ *
+ *  @brief  Prints the command line
+ *
+ *  @author Kerry
+ ************************************************/
+static void loadgen_usage(const char *program_name)
+{
+    printf("Usage: %s -b port_base [-H host] [-k monitor.pub] [-p probes] [-f files] [-c change_pct]\n"
+           "\t\t[-i heartbeat_sec] [-t threads] [-d duration_sec] [-M metrics_port] [-l]\n", program_name);
+}
+
+int main(int argc, char *argv[])
+{
+    const char      *key_file_name  = MONITOR_PUB_KEY_FILE_NAME;
+    unsigned int    duration_sec    = 0;
+    int             metrics_port    = 0;
+    bool            list_devices    = false;
+
+    snprintf(G_loadgen.host, sizeof(G_loadgen.host), "%s", LOADGEN_DEFAULT_HOST);
+    G_loadgen.probe_ctr     = LOADGEN_DEFAULT_PROBES;
+    G_loadgen.file_ctr      = LOADGEN_DEFAULT_FILES;
+    G_loadgen.change_pct    = LOADGEN_DEFAULT_CHANGE_PCT;
+    G_loadgen.heartbeat_sec = LOADGEN_DEFAULT_HEARTBEAT_SEC;
+    G_loadgen.thread_ctr    = LOADGEN_DEFAULT_THREADS;
+    pthread_mutex_init(&G_loadgen.pending_lock, NULL);
+
+    int option;
+    while ((option = getopt(argc, argv, "b:H:k:p:f:c:i:t:d:M:l")) != -1)
+    {
+        switch (option)
+        {
+            case 'b':   G_loadgen.port_base     = atoi(optarg);                                     break;
+            case 'H':   snprintf(G_loadgen.host, sizeof(G_loadgen.host), "%s", optarg);             break;
+            case 'k':   key_file_name           = optarg;                                           break;
+            case 'p':   G_loadgen.probe_ctr     = (unsigned int) atoi(optarg);                      break;
+            case 'f':   G_loadgen.file_ctr      = (unsigned int) atoi(optarg);                      break;
+            case 'c':   G_loadgen.change_pct    = (unsigned int) atoi(optarg);                      break;
+            case 'i':   G_loadgen.heartbeat_sec = (unsigned int) atoi(optarg);                      break;
+            case 't':   G_loadgen.thread_ctr    = (unsigned int) atoi(optarg);                      break;
+            case 'd':   duration_sec            = (unsigned int) atoi(optarg);                      break;
+            case 'M':   metrics_port            = atoi(optarg);                                     break;
+            case 'l':   list_devices            = true;                                             break;
+            default:
+                loadgen_usage(argv[0]);
+                return CS_ERROR;
+        }
+    }
+    if ((G_loadgen.port_base <= 0 && ! list_devices) || G_loadgen.probe_ctr < 1 ||
+        G_loadgen.probe_ctr >= PROBE_ID_DEVICE_BASE || G_loadgen.change_pct > 100 || G_loadgen.heartbeat_sec < 1 ||
+        G_loadgen.thread_ctr < 1 || G_loadgen.thread_ctr > LOADGEN_MAX_THREADS)
+    {
+        loadgen_usage(argv[0]);
+        return CS_ERROR;
+    }
+
+    // **** Make up the probes - locally administered MAC addresses 02:cf:00:00:hi:lo **** //
+    G_loadgen.probes = calloc(G_loadgen.probe_ctr, sizeof(loadgen_probe));
+    if (G_loadgen.probes == NULL)
+    {
+        return CS_ERROR;
+    }
+    int64_t now = zclock_mono();
+    for (unsigned int p = 0; p < G_loadgen.probe_ctr; p++)
+    {
+        loadgen_probe *probe    = &G_loadgen.probes[p];
+        byte mac_address[IFHWADDRLEN] = {0x02, 0xcf, 0x00, 0x00, (byte) (p >> 8), (byte) p};
+        probe->index            = p;
+        memcpy(probe->mac_address, mac_address, IFHWADDRLEN);
+        snprintf(probe->uuid, SIZE_ZUUID, "%032x", p + 1);
+        snprintf(probe->hostname, SIZE_HOST_NAME, "loadgen-%05u", p);
+        snprintf(probe->ip_address, SIZE_IP4_ADDRESS, "10.207.%u.%u", (p >> 8) & 0xff, p & 0xff);
+        // Spread the first handshakes over one heartbeat interval
+        probe->next_heartbeat   = now + (int64_t) p * G_loadgen.heartbeat_sec * 1000 / G_loadgen.probe_ctr;
+        probe->versions         = calloc(G_loadgen.file_ctr > 0 ? G_loadgen.file_ctr : 1, sizeof(unsigned int));
+        if (probe->versions == NULL)
+        {
+            return CS_ERROR;
+        }
+        if (list_devices)
+        {
+            printf("%02x:%02x:%02x:%02x:%02x:%02x\n", mac_address[0], mac_address[1], mac_address[2],
+                   mac_address[3], mac_address[4], mac_address[5]);
+        }
+    }
+    if (list_devices)
+    {
+        return CS_SUCCESS;
+    }
+
+    zsys_init();
+    zcert_t *server_cert = zcert_load(key_file_name);
+    if (server_cert == NULL)
+    {
+        printf("\t<%s> ERROR: Could not load the monitor's public key from [%s]\n", __PRETTY_FUNCTION__, key_file_name);
+        return CS_ERROR;
+    }
+    G_loadgen.server_key    = zcert_public_txt(server_cert);
+    G_loadgen.client_cert   = zcert_new();
+
+    zsock_t *metrics = NULL;
+    if (metrics_port > 0)
+    {
+        metrics = zsock_new(ZMQ_SUB);
+        zsock_set_subscribe(metrics, METRICS_TOPIC);
+        zsock_connect(metrics, METRICS_ENDPOINT, (unsigned int) metrics_port);
+    }
+
+    pthread_t threads[LOADGEN_MAX_THREADS];
+    for (unsigned int t = 0; t < G_loadgen.thread_ctr; t++)
+    {
+        pthread_create(&threads[t], NULL, loadgen_thread, (void *) (uintptr_t) t);
+    }
+
+    // **** Watch the monitor's alert counter and report until the run is over **** //
+    int64_t             start_usecs     = zclock_usecs();
+    int64_t             reported_usecs  = start_usecs;
+    unsigned long long  alerts_base     = 0;
+    bool                alerts_known    = false;
+    while (! zsys_interrupted &&
+           (duration_sec == 0 || zclock_usecs() - start_usecs < (int64_t) duration_sec * 1000000))
+    {
+        if (metrics != NULL && zsock_events(metrics) & ZMQ_POLLIN)
+        {
+            char *topic = zstr_recv(metrics);
+            char *text  = zsock_rcvmore(metrics) ? zstr_recv(metrics) : NULL;
+            char *line  = text != NULL ? strstr(text, "\n" LOADGEN_ALERTS_METRIC) : NULL;
+            unsigned long long alerts = 0;
+            if (line != NULL && sscanf(line + 1 + strlen(LOADGEN_ALERTS_METRIC), "%llu", &alerts) == 1)
+            {
+                // The first sample is only the starting point - the alerts in it were not ours
+                if (alerts_known && alerts > alerts_base)
+                {
+                    loadgen_alerts_seen(alerts - alerts_base);
+                }
+                alerts_base     = alerts;
+                alerts_known    = true;
+            }
+            zstr_free(&topic);
+            zstr_free(&text);
+            continue;
+        }
+        zclock_sleep(metrics != NULL ? 10 : 100);
+        if (zclock_usecs() - reported_usecs >= LOADGEN_REPORT_SECONDS * 1000000LL)
+        {
+            reported_usecs = zclock_usecs();
+            loadgen_report(reported_usecs - start_usecs, false);
+        }
+    }
+
+    G_loadgen.stopping = 1;
+    for (unsigned int t = 0; t < G_loadgen.thread_ctr; t++)
+    {
+        pthread_join(threads[t], NULL);
+    }
+    loadgen_report(zclock_usecs() - start_usecs, true);
+
+    zsock_destroy(&metrics);
+    for (unsigned int p = 0; p < G_loadgen.probe_ctr; p++)
+    {
+        free(G_loadgen.probes[p].versions);
+    }
+    free(G_loadgen.probes);
+    free(G_loadgen.latencies);
+    zcert_destroy(&G_loadgen.client_cert);
+    zcert_destroy(&server_cert);
+    return CS_SUCCESS;
+}
@@ -6,9 +6,453 @@
 #include "csl_message.h"
 
 
-static bool   G_scan_in_process;
-static short  G_current_device_index;
-static short  G_current_scan_ctr;
+/************************************************
+ * The Scan Queue Depth
+ * ====================
+ * The decode workers count the scans they forward and csl_zmessage_get() counts the ones it takes.
+ * The difference is the backlog waiting for the message thread.
+ ************************************************/
+static unsigned long long   G_scan_forwarded_ctr;
+static unsigned long long   G_scan_taken_ctr;
+
+/************************************************
+ * The Message Lanes
+ * =================
+ * Control messages (handshakes and heartbeats on the responder) and bulk scan messages (from the decode
+ * workers) are two lanes. csl_zmessage_get() drains at most scan_batch_max scan messages in a row before
+ * it polls again, and the poller always offers the responder first, so a heartbeat never waits behind
+ * more than one batch of a big scan.
+ *
+ * Each lane keeps its latency:
+ *      LANE_CONTROL    - from receiving a request to sending its reply
+ *      LANE_SCAN       - from a decode worker forwarding a scan message to the message thread taking it
+ ************************************************/
+enum
+{
+    LANE_CONTROL,
+    LANE_SCAN,
+    LANE_CTR
+};
+
+typedef struct
+{
+    unsigned long long  message_ctr;
+    int64_t             total_usecs;
+    int64_t             max_usecs;
+} lane_stats;
+
+static char         *G_lane_names[LANE_CTR] = {"control", "scan"};
+static lane_stats   G_lane_stats[LANE_CTR];
+static int64_t      G_lane_stats_reported;
+static int64_t      G_control_received_usecs;       // 0 when no request is waiting for its reply
+
+/************************************************
+ * void lane_stats_record()
+ *  @param
+ *          int     lane
+ *          int64_t usecs   - The latency of one message
+ *
+ *  @brief  Adds one message's latency to its lane
+ *
+ *  @author Kerry
+ ************************************************/
+static void lane_stats_record(int lane, int64_t usecs)
+{
+    G_lane_stats[lane].message_ctr++;
+    G_lane_stats[lane].total_usecs += usecs;
+    if (usecs > G_lane_stats[lane].max_usecs)
+    {
+        G_lane_stats[lane].max_usecs = usecs;
+    }
+}
+
+/************************************************
+ * void lane_stats_report()
+ *  @param  - None
+ *
+ *  @brief  Every LANE_STATS_REPORT_SECONDS, logs each lane's message count and its average and worst
+ *          latency since the last report, then starts over
+ *
+ *  @author Kerry
+ ************************************************/
+static void lane_stats_report()
+{
+    int64_t now = zclock_mono();
+    if (now - G_lane_stats_reported < LANE_STATS_REPORT_SECONDS * 1000)
+    {
+        return;
+    }
+    G_lane_stats_reported = now;
+
+    for (int lane = 0; lane < LANE_CTR; lane++)
+    {
+        lane_stats *stats = &G_lane_stats[lane];
+        if (stats->message_ctr > 0)
+        {
+            zsys_info("\t<%s> %-7s lane: %llu messages, avg %lld us, max %lld us", __PRETTY_FUNCTION__,
+                      G_lane_names[lane], stats->message_ctr,
+                      (long long) (stats->total_usecs / (int64_t) stats->message_ctr), (long long) stats->max_usecs);
+        }
+        memset(stats, 0, sizeof(lane_stats));
+    }
+}
+
+/************************************************
+ * The Metrics Publisher
+ * =====================
+ * Every metrics_publish_sec the message thread renders all of the metrics (see csl_metrics.h) and publishes
+ * them on the metrics socket as two frames: METRICS_TOPIC, then the Prometheus text.
+ ************************************************/
+static int64_t      G_metrics_published;
+
+/************************************************
+ * void metrics_publish()
+ *  @param  monitor_comms_t *comms
+ *
+ *  @brief  Publishes the metrics, if the metrics socket is open and metrics_publish_sec has passed
+ *
+ *  @author Kerry
+ *
+ *  @note   The text is rendered into the message arena, so it is given back before the next message
+ ************************************************/
+static void metrics_publish(monitor_comms_t *comms)
+{
+    if (comms->metrics == NULL)
+    {
+        return;
+    }
+    int64_t now = zclock_mono();
+    if (now - G_metrics_published < (int64_t) csl_Config()->metrics_publish_sec * 1000)
+    {
+        return;
+    }
+    G_metrics_published = now;
+
+    csl_MetricGaugeSet(METRIC_SCAN_QUEUE_DEPTH, (long long) csl_ScanQueueDepth());
+    char *text = csl_ArenaAlloc(csl_ArenaMessage(), SIZE_METRICS_TEXT);
+    if (text == NULL)
+    {
+        return;
+    }
+    csl_MetricsRender(text, SIZE_METRICS_TEXT);
+    zstr_sendm(comms->metrics, METRICS_TOPIC);
+    zstr_send(comms->metrics, text);
+}
+
+/************************************************
+ * The Reply Pool
+ * ==============
+ * Replies to the probes are serialized into pooled buffers and handed to ZeroMQ without a copy.
+ * ZeroMQ gives a buffer back through reply_buffer_release() once it has been sent, which may be
+ * on one of its own I/O threads, so the free list has its own lock.
+ ************************************************/
+typedef struct reply_buffer
+{
+    struct reply_buffer *next;
+    byte                data[CSL_MAX_MESSAGE_LENGTH];
+} reply_buffer;
+
+static reply_buffer     *G_reply_pool;
+static unsigned int     G_reply_pool_free_ctr;
+static pthread_mutex_t  G_reply_pool_lock = PTHREAD_MUTEX_INITIALIZER;
+
+/************************************************
+ * reply_buffer *reply_buffer_acquire()
+ *  @param  - None
+ *
+ *  @brief  Takes a buffer from the reply pool, or allocates one if the pool is empty
+ *
+ *  @author Kerry
+ *
+ *  @return Success - a reply buffer
+ *          Failure - NULL
+ ************************************************/
+static reply_buffer *reply_buffer_acquire()
+{
+    pthread_mutex_lock(&G_reply_pool_lock);
+    reply_buffer *buffer = G_reply_pool;
+    if (buffer != NULL)
+    {
+        G_reply_pool = buffer->next;
+        G_reply_pool_free_ctr--;
+    }
+    pthread_mutex_unlock(&G_reply_pool_lock);
+
+    if (buffer == NULL)
+    {
+        buffer = malloc(sizeof(reply_buffer));
+        if (buffer == NULL)
+        {
+            printf("\t<%s> ERROR: Could not allocate a reply buffer\n", __PRETTY_FUNCTION__);
+        }
+    }
+    return buffer;
+}
+
+/************************************************
+ * void reply_buffer_release()
+ *  @param
+ *          void *data  - The data of the sent zmq_msg_t (unused)
+ *          void *hint  - The reply_buffer holding the data
+ *
+ *  @brief  The zmq_free_fn for every reply. Returns the buffer to the pool, unless the pool
+ *          already holds REPLY_POOL_MAX_FREE buffers
+ *
+ *  @author Kerry
+ ************************************************/
+static void reply_buffer_release(void *data, void *hint)
+{
+    (void) data;
+    reply_buffer *buffer = hint;
+
+    pthread_mutex_lock(&G_reply_pool_lock);
+    if (G_reply_pool_free_ctr < REPLY_POOL_MAX_FREE)
+    {
+        buffer->next = G_reply_pool;
+        G_reply_pool = buffer;
+        G_reply_pool_free_ctr++;
+        buffer       = NULL;
+    }
+    pthread_mutex_unlock(&G_reply_pool_lock);
+
+    free(buffer);
+}
+
+/************************************************
+ * void reply_pool_preload()
+ *  @param  - None
+ *
+ *  @brief  Fills the reply pool so that the first replies do not allocate
+ *
+ *  @author Kerry
+ ************************************************/
+static void reply_pool_preload()
+{
+    for (int i = 0; i < REPLY_POOL_PRELOAD; i++)
+    {
+        reply_buffer *buffer = malloc(sizeof(reply_buffer));
+        if (buffer == NULL)
+        {
+            break;
+        }
+        reply_buffer_release(buffer->data, buffer);
+    }
+}
+
+/************************************************
+ * void reply_pool_destroy()
+ *  @param  - None
+ *
+ *  @brief  Frees every buffer in the reply pool
+ *
+ *  @author Kerry
+ ************************************************/
+static void reply_pool_destroy()
+{
+    pthread_mutex_lock(&G_reply_pool_lock);
+    while (G_reply_pool != NULL)
+    {
+        reply_buffer *next = G_reply_pool->next;
+        free(G_reply_pool);
+        G_reply_pool = next;
+    }
+    G_reply_pool_free_ctr = 0;
+    pthread_mutex_unlock(&G_reply_pool_lock);
+}
+
+/************************************************
+ * int reply_send()
+ *  @param
+ *          zsock_t         *socket     - The socket to reply on
+ *          csl_zmessage    *message    - The reply
+ *
+ *  @brief  Serializes the reply into a pooled buffer and sends it without copying
+ *
+ *  @author Kerry
+ *
+ *  @note   Once zmq_msg_init_data() succeeds the buffer belongs to ZeroMQ. On a failed send
+ *          zmq_msg_close() still hands it back through reply_buffer_release()
+ *
+ *  @return CS_SUCCESS on success, CS_ERROR if the reply could not be sent
+ ************************************************/
+static int reply_send(zsock_t *socket, csl_zmessage *message)
+{
+    reply_buffer *buffer = reply_buffer_acquire();
+    if (buffer == NULL)
+    {
+        return CS_ERROR;
+    }
+    CSL_TRACE_BEGIN(serialize_span);
+    csl_serializeMessageByte(message, buffer->data);
+    CSL_TRACE_END(serialize_span, "serialize reply", -1);
+
+    zmq_msg_t reply;
+    if (zmq_msg_init_data(&reply, buffer->data, message->message_total_size, reply_buffer_release, buffer) != 0)
+    {
+        reply_buffer_release(buffer->data, buffer);
+        return CS_ERROR;
+    }
+    if (zmq_msg_send(&reply, zsock_resolve(socket), 0) < 0)
+    {
+        zmq_msg_close(&reply);
+        return CS_ERROR;
+    }
+    if (G_control_received_usecs != 0)
+    {
+        lane_stats_record(LANE_CONTROL, zclock_usecs() - G_control_received_usecs);
+        G_control_received_usecs = 0;
+    }
+    return CS_SUCCESS;
+}
+
+/************************************************
+ * The Scan Decoders
+ * =================
+ * Each scan endpoint is a PULL socket owned by its own decode worker (a zactor thread). The worker
+ * deserializes each scan message and converts it (including the element name hash) into a
+ * csl_complete_message, then forwards both over SCAN_DECODED_ENDPOINT to csl_zmessage_get().
+ *
+ * A probe always pushes to the same endpoint, so its messages stay in order.
+ ************************************************/
+typedef struct
+{
+    csl_zmessage            zmessage;
+    csl_complete_message    message;
+    int64_t                 decoded_usecs;      // zclock_usecs() when the worker forwarded it
+} scan_decoded;
+
+typedef struct
+{
+    zcert_t     *server_cert;
+    int         port;
+    unsigned int receiver;          // the scan endpoint's index, for csl_CaptureFrame()
+} scan_decoder_args;
+
+/************************************************
+ * void comms_socket_tune()
+ *  @param  zsock_t *socket
+ *
+ *  @brief  Applies the config's high water marks, receive buffer and TCP keepalive to a probe-facing socket
+ *
+ *  @author Kerry
+ *
+ *  @note   Must be called before the socket is bound
+ ************************************************/
+static void comms_socket_tune(zsock_t *socket)
+{
+    const csl_monitor_config *config = csl_Config();
+
+    zsock_set_rcvhwm(socket, (int) config->rcvhwm);
+    zsock_set_sndhwm(socket, (int) config->sndhwm);
+    if (config->rcvbuf > 0)
+    {
+        zsock_set_rcvbuf(socket, (int) config->rcvbuf);
+    }
+    if (config->tcp_keepalive_idle > 0)
+    {
+        zsock_set_tcp_keepalive(socket, 1);
+        zsock_set_tcp_keepalive_idle(socket, (int) config->tcp_keepalive_idle);
+    }
+}
+
+/************************************************
+ * void scan_decoder_actor()
+ *  @param
+ *          zsock_t *pipe   - The actor's command pipe
+ *          void    *args   - The scan_decoder_args, only valid until the actor signals it is ready
+ *
+ *  @brief  Receives scans on one endpoint, decodes them and forwards them to the message thread
+ *
+ *  @author Kerry
+ ************************************************/
+static void scan_decoder_actor(zsock_t *pipe, void *args)
+{
+    scan_decoder_args *decoder_args = args;
+    unsigned char receiver_index    = (unsigned char) decoder_args->receiver;
+
+    zsock_t *receiver = zsock_new(ZMQ_PULL);
+    zcert_apply(decoder_args->server_cert, receiver);
+    zsock_set_curve_server(receiver, 1);
+    zsock_set_zap_domain(receiver, "global");
+    comms_socket_tune(receiver);
+    if (zsock_bind(receiver, "tcp://*:%d", decoder_args->port) == -1)
+    {
+        printf("\t<%s> ERROR: Could not bind scan receiver port [%d]\n", __PRETTY_FUNCTION__, decoder_args->port);
+    }
+
+    zsock_t         *forward    = zsock_new_push(SCAN_DECODED_ENDPOINT);
+    zpoller_t       *poller     = zpoller_new(pipe, receiver, NULL);
+    scan_decoded    *decoded    = malloc(sizeof(scan_decoded));
+    CSL_TRACE_THREAD("scan decoder");
+    zsock_signal(pipe, 0);
+
+    while (decoded != NULL)
+    {
+        zsock_t *which = (zsock_t *) zpoller_wait(poller, -1);
+        if (which == NULL)
+        {
+            break;                                      // interrupted
+        }
+        if (which == pipe)
+        {
+            char *command = zstr_recv(pipe);            // the only command is $TERM
+            zstr_free(&command);
+            break;
+        }
+
+        // CurveZMQ decryption has already happened on a ZeroMQ I/O thread, so receive is only the copy out
+        CSL_TRACE_BEGIN(receive_span);
+        zmq_msg_t frame;
+        zmq_msg_init(&frame);
+        if (zmq_msg_recv(&frame, zsock_resolve(receiver), 0) == -1)
+        {
+            zmq_msg_close(&frame);
+            continue;
+        }
+        CSL_TRACE_END(receive_span, "receive", -1);
+        csl_CaptureFrame(CAPTURE_LANE_SCAN, receiver_index, zmq_msg_data(&frame), zmq_msg_size(&frame));
+
+        CSL_TRACE_BEGIN(deserialize_span);
+        memset(&decoded->zmessage, 0, sizeof(csl_zmessage));
+        csl_deserializeMessageByte(&decoded->zmessage, zmq_msg_data(&frame));
+        zmq_msg_close(&frame);
+        CSL_TRACE_END(deserialize_span, "deserialize", -1);
+
+        CSL_TRACE_BEGIN(convert_span);
+        csl_ConvertFromZMessage(&decoded->message, &decoded->zmessage);
+        csl_ArenaReset(csl_ArenaMessage());
+        decoded->decoded_usecs = zclock_usecs();
+        CSL_TRACE_END(convert_span, "convert", -1);
+
+        CSL_TRACE_BEGIN(forward_span);
+        if (zmq_send(zsock_resolve(forward), decoded, sizeof(scan_decoded), 0) != -1)
+        {
+            __atomic_add_fetch(&G_scan_forwarded_ctr, 1, __ATOMIC_RELAXED);
+        }
+        CSL_TRACE_END(forward_span, "forward", -1);
+    }
+
+    free(decoded);
+    zpoller_destroy(&poller);
+    zsock_destroy(&forward);
+    zsock_destroy(&receiver);
+    csl_ArenaDestroy(csl_ArenaMessage());              // the __thread arena goes with the thread, its blocks would not
+}
+
+/************************************************
+ * unsigned long long csl_ScanQueueDepth()
+ *  @param  - None
+ *
+ *  @brief  Returns how many decoded scan messages are waiting for the message thread
+ *
+ *  @author Kerry
+ ************************************************/
+unsigned long long csl_ScanQueueDepth()
+{
+    unsigned long long taken = __atomic_load_n(&G_scan_taken_ctr, __ATOMIC_RELAXED);
+    return __atomic_load_n(&G_scan_forwarded_ctr, __ATOMIC_RELAXED) - taken;
+}
+
 /************************************************
  * int monitor_comm_params *comm_params_initialize()
  *  @params
@@ -35,9 +479,6 @@ int comm_params_initialize(monitor_comm_params *returnStruct,
     sprintf(returnStruct->data_pipeline_address,"%d", data_pipeline_port);
     sprintf(returnStruct->scan_address,"%d", scan_port);
 
-    G_scan_in_process     = false;
-    G_current_device_index = -1;
-
     return CS_SUCCESS;
 //    return returnStruct;
 }
@@ -81,18 +522,38 @@ short csl_zmessage_get(csl_zmessage *current_zmessage, monitor_comms_t *comms, c
 
 
 //    int buff_size = sizeof(buffer);
-    unsigned long long msg_bandwidth_bytes = 0L;
+
+    const csl_monitor_config *config = csl_Config();
+    unsigned int scan_batch_ctr = 0;
 
 //    int debug_ctr   = 0;
     while (! zsys_interrupted)
     {
         byte *data;     // **** This is INTENTIONALLY NOT initialized. If we do, it causes a memory leak **** //
 
+        // **** Everything the previous message put in the message arena has now been used **** //
+        csl_ArenaReset(csl_ArenaMessage());
+
         memset(current_zmessage, 0, sizeof(csl_zmessage));       // todo check to see if we want a null character here
 
-        // Switch between every responder (probe handshake) and scan_receiver every millisecond
-        //todo: We need weights on the sockets so we prioritize things like heartbeats.
-        zsock_t *which = (zsock_t *) zpoller_wait(comms->poller, ZMQ_POLL_MSEC);
+        lane_stats_report();
+        metrics_publish(comms);
+        CSL_TRACE_POLL();
+        scanSessionsExpire();
+
+        // Keep draining the current scan batch, but once it reaches scan_batch_max go back to the poller,
+        // which offers the responder (control lane) first
+        zsock_t *which = NULL;
+        if (scan_batch_ctr > 0 && scan_batch_ctr < config->scan_batch_max &&
+            (zsock_events(comms->scan_decoded) & ZMQ_POLLIN))
+        {
+            which = comms->scan_decoded;
+        }
+        else
+        {
+            which = (zsock_t *) zpoller_wait(comms->poller, (int) config->poll_msec);
+        }
+        scan_batch_ctr = (which == comms->scan_decoded) ? scan_batch_ctr + 1 : 0;
 
         // If there is no data on the current socket, continue to loop through the other sockets
         if (which == NULL)
@@ -109,26 +570,58 @@ short csl_zmessage_get(csl_zmessage *current_zmessage, monitor_comms_t *comms, c
                 continue;
             }
         }
-        size_t msg_size = CSL_MAX_MESSAGE_LENGTH;       //was sizeof(csl_message);
-
-        // Important note: The "b" here signals to czmq that we are expecting binary data.
-        // And it won't try to append any null chars
-        // or try and treat it like a c-string
-        int resp = zsock_recv(which, "b", &data, &msg_size);
-
-        if (resp == -1)
+        if (which == comms->scan_decoded)
         {
-            zsys_error("CryticaMonitor - main() - Failed to receive");
-            continue; //We probably don't want to deserialize data that wasn't received properly
+            // **** A decode worker has already deserialized and converted the scan message **** //
+            CSL_TRACE_BEGIN(receive_span);
+            zmq_msg_t frame;
+            zmq_msg_init(&frame);
+            if (zmq_msg_recv(&frame, zsock_resolve(which), 0) == -1)
+            {
+                zmq_msg_close(&frame);
+                zsys_error("CryticaMonitor - main() - Failed to receive");
+                continue;
+            }
+            scan_decoded *decoded = zmq_msg_data(&frame);
+            memcpy(current_zmessage, &decoded->zmessage, sizeof(csl_zmessage));
+            memcpy(cs_message, &decoded->message, sizeof(csl_complete_message));
+            lane_stats_record(LANE_SCAN, zclock_usecs() - decoded->decoded_usecs);
+            csl_MetricObserve(METRIC_SCAN_QUEUE_WAIT, zclock_usecs() - decoded->decoded_usecs);
+            zmq_msg_close(&frame);
+            __atomic_add_fetch(&G_scan_taken_ctr, 1, __ATOMIC_RELAXED);
+            CSL_TRACE_END(receive_span, "receive scan", -1);
         }
+        else
+        {
+            size_t msg_size = CSL_MAX_MESSAGE_LENGTH;       //was sizeof(csl_message);
 
-        csl_deserializeMessageByte(current_zmessage, data);
-        msg_bandwidth_bytes += (unsigned long long) current_zmessage->message_total_size;  //was msg_size; and earlier
+            // Important note: The "b" here signals to czmq that we are expecting binary data.
+            // And it won't try to append any null chars
+            // or try and treat it like a c-string
+            CSL_TRACE_BEGIN(receive_span);
+            int resp = zsock_recv(which, "b", &data, &msg_size);
+            CSL_TRACE_END(receive_span, "receive", -1);
 
-        free(data);
+            if (resp == -1)
+            {
+                zsys_error("CryticaMonitor - main() - Failed to receive");
+                continue; //We probably don't want to deserialize data that wasn't received properly
+            }
 
-//        csl_complete_message *cs_message = calloc(1, sizeof(csl_complete_message));
-        cs_message = csl_ConvertFromZMessage(cs_message,current_zmessage);
+            G_control_received_usecs = zclock_usecs();
+            csl_CaptureFrame(CAPTURE_LANE_CONTROL, 0, data, msg_size);
+            CSL_TRACE_BEGIN(deserialize_span);
+            csl_deserializeMessageByte(current_zmessage, data);
+            free(data);
+            CSL_TRACE_END(deserialize_span, "deserialize", -1);
+
+//          csl_complete_message *cs_message = calloc(1, sizeof(csl_complete_message));
+            CSL_TRACE_BEGIN(convert_span);
+            cs_message = csl_ConvertFromZMessage(cs_message,current_zmessage);
+            CSL_TRACE_END(convert_span, "convert", -1);
+        }
+        csl_MetricCount(METRIC_BYTES_RECEIVED, (unsigned long long) current_zmessage->message_total_size);
+        csl_MetricMessage((unsigned int) cs_message->message_header.message_type);
 // **** Check to provenance of the message ****
         int device_index = messageCheckOrigin();
         if (device_index == CS_DEVICE_UNKNOWN)
@@ -136,7 +629,7 @@ short csl_zmessage_get(csl_zmessage *current_zmessage, monitor_comms_t *comms, c
             // If bad provenance, we issue an error code in the messageCheckOrigin() function and then continue the while loop
 
             // The following is a kluge - We need to respond to the bad device so that the monitor can continue
-            csl_AcknowledgeHandshake(current_zmessage, comms);
+            csl_AcknowledgeHandshake(current_zmessage, comms, CS_DEVICE_UNKNOWN, 0);
             return CS_DEVICE_UNKNOWN;
         }
         // add the device index to the current cs_message
@@ -146,7 +639,8 @@ short csl_zmessage_get(csl_zmessage *current_zmessage, monitor_comms_t *comms, c
 //        csl_print_message(current_zmessage);
 #endif
 
-        if (G_scan_in_process == false && which == comms->responder) // We do not want to drop in here in the middle of a scan
+        // Control messages are answered even in the middle of a scan - the REP socket must reply to every request
+        if (which == comms->responder)
         {
             //Check probe event to determine what to do
             switch (cs_message->message_header.message_type)
@@ -157,12 +651,8 @@ short csl_zmessage_get(csl_zmessage *current_zmessage, monitor_comms_t *comms, c
 
                 case PROBE_HEARTBEAT:
                 {
-                    //todo: Heartbeat needs it's own thread/socket. This solution gets overwhelemd, but is functional
-                    //                   process_Heartbeat(comms, &current_zmessage, &device_table);
-                    if (G_scan_in_process == true && cs_message->message_body.message_scan.device_index != G_current_device_index)
-                    {
-                        cs_message->message_header.message_type = PROBE_WAITING;
-                    }
+                    // A heartbeat during another device's scan is still answered - the scan grant decides
+                    // whether the reply tells the device to scan or to wait
                     break;
                 }
 
@@ -178,93 +668,76 @@ short csl_zmessage_get(csl_zmessage *current_zmessage, monitor_comms_t *comms, c
 
         }
 
-        if (which == comms->scan_receiver)
+        if (which == comms->scan_decoded)
         {
-            if (G_scan_in_process == true && cs_message->message_body.message_scan.device_index != G_current_device_index)
-            {
-                continue;
-            }
-            else
+            // **** Each device's scan has its own session, so scans from several devices may interleave **** //
+            short scan_device_index = (short) cs_message->message_body.message_scan.device_index;
+            switch (cs_message->message_header.message_type)
             {
-                switch (cs_message->message_header.message_type)
+                case PROBE_START_SCAN:
                 {
-                    case PROBE_START_SCAN:
-                        if (G_scan_in_process == true)
-                        {
-                            break;      // We don't want to start a new scan while one is in process
-                        }
-                        G_scan_in_process = true;
-                        time_t start_time = time(NULL);
-                        char *time_string = csl_Time2String(start_time);
-                        G_current_device_index = (short) cs_message->message_body.message_scan.device_index;
-
-                        zsys_info("\t<%s> Scan Started  at %s for probe_id: %.4f, hostname: %s, ip: %s",
-                                  __PRETTY_FUNCTION__, time_string,
-                                  cs_message->message_body.message_scan.probe_id,
-                                  current_zmessage->hostname, current_zmessage->probe_ip);
-                        free(time_string);
-                        /**********
-                        zsys_info("Scan started at %ld for probe_id: %u, hostname: %s, ip: %s", start_time,
-                                  current_zmessage->probe_id, current_zmessage->hostname, current_zmessage->probe_ip,
-                                  csl_Time2String(start_time));
-                         **********/
-                        // **** Zero Out the Scan Table and prepare it to start anew **** //
-                        if (scanTableInitialize(G_current_device_index) != 0)
-                        {
-                            printf("\t<%s> Failed to initial scan table for device[%d]",
-                                   __PRETTY_FUNCTION__, G_current_device_index);
-                        }
-                        G_current_scan_ctr = 0;
-                        break;
+                    // A probe resuming a suspended scan names the rows the monitor already holds
+                    unsigned int resume_from = 0;
+                    if (sscanf(current_zmessage->file_name, SCAN_RESUME_DIRECTIVE, &resume_from) != 1)
+                    {
+                        resume_from = 0;
+                    }
+                    time_t start_time = time(NULL);
+                    char time_string[SIZE_OF_TIME];
+                    csl_TimeFormat(time_string, start_time);
 
-                    case PROBE_RECURRING_SCAN:  // **** Build the scan record and add it to the scan_table **** //
-                        if (G_scan_in_process != true)
-                        {
-                            break;      // We don't want to process a scan while one is not in process
-                        }
-/**** Debug Code ****/
-                        if (cs_message->message_body.message_scan.device_index != G_current_device_index)
-                        {
-                            printf("\t<%s> Wrong Device[%d] in the midst of [%d] device scan\n",
-                                   __PRETTY_FUNCTION__,
-                                   cs_message->message_body.message_scan.device_index, G_current_device_index);
-                            //break;
-                        }
-/**********************/
-                        csl_scan_record *new_scan = csl_MessageToScanRecord(&cs_message->message_body);
-                        scanTableAddRow(new_scan, (short) cs_message->message_body.message_scan.device_index);
-                        G_current_scan_ctr++;
-                        free(new_scan);
+                    // **** Open the device's scan session - a fresh scan zeroes out its scan table **** //
+                    int rows_held = scanSessionStart(scan_device_index, resume_from);
+                    if (rows_held < 0)
+                    {
+                        printf("\t<%s> Failed to initial scan table for device[%d]",
+                               __PRETTY_FUNCTION__, scan_device_index);
                         break;
+                    }
+                    zsys_info("\t<%s> Scan %s at %s for probe_id: %.4f, hostname: %s, ip: %s",
+                              __PRETTY_FUNCTION__, rows_held > 0 ? "Resumed" : "Started",
+                              time_string,
+                              cs_message->message_body.message_scan.probe_id,
+                              current_zmessage->hostname, current_zmessage->probe_ip);
+                    /**********
+                    zsys_info("Scan started at %ld for probe_id: %u, hostname: %s, ip: %s", start_time,
+                              current_zmessage->probe_id, current_zmessage->hostname, current_zmessage->probe_ip,
+                              csl_Time2String(start_time));
+                     **********/
+                    break;
+                }
 
-                    case PROBE_END_SCAN:
-                        if (G_scan_in_process != true)
-                        {
-                            break;      // We don't want to end a scan before one is started
-                        }
-                        start_time = time(NULL);
-                        time_string = csl_Time2String(start_time);
-                        zsys_info("\t<%s> Scan Finished at %s for probe_id: %.4f, hostname: %s, ip: %s\n",
-                                  __PRETTY_FUNCTION__, time_string,
-                                  cs_message->message_body.message_scan.probe_id,
-                                  current_zmessage->hostname, current_zmessage->probe_ip);
-//                        printf("\t<%s> Finished Scan of [%d] records for device [%d]\n",
-//                               __PRETTY_FUNCTION__, G_current_scan_ctr, G_current_device_index);
-                        G_scan_in_process = false;
-                        G_current_device_index = -1;
-                        return SCAN_RECEIVED;
-                        break;
+                case PROBE_RECURRING_SCAN:  // **** Build the scan record and add it to the device's scan_table **** //
+                {
+                    // scanTableAddRow() drops the record unless the device's scan session is active
+                    CSL_TRACE_BEGIN(record_span);
+                    csl_scan_record *new_scan = csl_MessageToScanRecord(csl_ArenaMessage(), &cs_message->message_body);
+                    scanTableAddRow(new_scan, scan_device_index);
+                    CSL_TRACE_END(record_span, "scan record", scan_device_index);
+                    break;
+                }
 
-                    default:
-                        fprintf(stderr, "Received unregistred probe event! Is probe a Crytica Probe?\n");
-                        break;
+                case PROBE_END_SCAN:
+                {
+                    if (scanSessionEnd(scan_device_index) != true)
+                    {
+                        break;      // We don't want to end a scan before one is started
+                    }
+                    char time_string[SIZE_OF_TIME];
+                    csl_TimeFormat(time_string, time(NULL));
+                    zsys_info("\t<%s> Scan Finished at %s for probe_id: %.4f, hostname: %s, ip: %s\n",
+                              __PRETTY_FUNCTION__, time_string,
+                              cs_message->message_body.message_scan.probe_id,
+                              current_zmessage->hostname, current_zmessage->probe_ip);
+                    return SCAN_RECEIVED;
+                }
 
-                } //end switch
-            }
+                default:
+                    fprintf(stderr, "Received unregistred probe event! Is probe a Crytica Probe?\n");
+                    break;
+
+            } //end switch
         } //endif
-#ifdef NDEBUG
-        zsys_debug("Bandwidth usage: ~%u (KB) or ~%u (MB)", msg_bandwidth_bytes / 1000, msg_bandwidth_bytes / 1000000);
-#endif
     }   // end while
     printf("\n\t<%s> We should NEVER get here!\n", __PRETTY_FUNCTION__ );
     return CS_FATAL_ERROR;          // We should NEVER get here
@@ -278,6 +751,11 @@ monitor_comms_t* monitor_comms_new(int broadcaster_port, int responder_port, int
 
     monitor_comms_t *self = (monitor_comms_t*) malloc(sizeof(monitor_comms_t));
 
+    // CurveZMQ decryption runs on the ZeroMQ I/O threads, so by default give each scan endpoint one of its own.
+    // This must happen before the first socket is created
+    self->scan_receiver_ctr = csl_Config()->scan_receivers;
+    zsys_set_io_threads(csl_Config()->io_threads > 0 ? csl_Config()->io_threads : self->scan_receiver_ctr);
+
     self->auth = zactor_new(zauth, NULL);
     assert(self->auth);
 
@@ -343,31 +821,54 @@ monitor_comms_t* monitor_comms_new(int broadcaster_port, int responder_port, int
     zcert_apply(self->server_cert, self->broadcaster);
     zsock_set_curve_server(self->broadcaster, 1);
     zsock_set_zap_domain(self->broadcaster, "global");
+    comms_socket_tune(self->broadcaster);
 
     self->responder = zsock_new(ZMQ_REP);
     zcert_apply(self->server_cert, self->responder);
     zsock_set_curve_server(self->responder, 1);
     zsock_set_zap_domain(self->responder, "global");
+    comms_socket_tune(self->responder);
     int resp_bind_success = zsock_bind(self->responder, "%s", self->responder_address);
     if (resp_bind_success != -1)
     {
         printf("\t<%s> **** resp_bind_success == %d\n", __PRETTY_FUNCTION__, resp_bind_success);
     }
 
-    self->scan_receiver = zsock_new(ZMQ_PULL);
-    zcert_apply(self->server_cert, self->scan_receiver);
-    zsock_set_curve_server(self->scan_receiver, 1);
-    zsock_set_zap_domain(self->scan_receiver, "global");
-    zsock_set_rcvhwm (self->scan_receiver, RECEIVE_HIGH_WATER_MARK);
-    int scan_bind_success = zsock_bind(self->scan_receiver, "%s", self->scan_address);
-    if (scan_bind_success != -1)
+    // The decode workers connect to this, so it is bound first
+    self->scan_decoded = zsock_new_pull("@" SCAN_DECODED_ENDPOINT);
+    assert(self->scan_decoded);
+    zsock_set_rcvhwm (self->scan_decoded, (int) csl_Config()->rcvhwm);
+
+    // Endpoint 0 is the scan_address every probe is configured with, the others are handed out at handshake
+    for (unsigned int i = 0; i < self->scan_receiver_ctr; i++)
     {
-        printf("\t<%s> **** scan_bind_success == %d\n", __PRETTY_FUNCTION__, scan_bind_success);
+        scan_decoder_args decoder_args = {self->server_cert, scan_port + (int) i * SCAN_RECEIVER_PORT_STRIDE, i};
+        self->scan_ports[i]     = decoder_args.port;
+        self->scan_decoders[i]  = zactor_new(scan_decoder_actor, &decoder_args);
+        assert(self->scan_decoders[i]);
     }
+    printf("\t<%s> **** [%u] scan receivers from port [%d]\n", __PRETTY_FUNCTION__, self->scan_receiver_ctr, scan_port);
 
-    self->poller = zpoller_new(self->responder, self->scan_receiver, NULL);
+    self->poller = zpoller_new(self->responder, self->scan_decoded, NULL);
     assert(self->poller);
 
+    // Metrics are for collectors on this host only, so the socket is bound to the loopback and not encrypted
+    self->metrics = NULL;
+    if (csl_Config()->metrics_port > 0)
+    {
+        self->metrics = zsock_new(ZMQ_PUB);
+        if (self->metrics == NULL || zsock_bind(self->metrics, METRICS_ENDPOINT, csl_Config()->metrics_port) == -1)
+        {
+            printf("\t<%s> WARNING: Could not bind metrics to port [%u] - metrics will not be published\n",
+                   __PRETTY_FUNCTION__, csl_Config()->metrics_port);
+            zsock_destroy(&self->metrics);
+        }
+    }
+
+    // The broadcaster is bound by monitor_comms_bind_command_publisher(), once the monitor is ready to publish
+    self->broadcaster_bound = false;
+
+    reply_pool_preload();
     return self;
 }
 
@@ -378,21 +879,70 @@ int monitor_comms_destroy(monitor_comms_t* self)
 
     zsock_destroy(&self->broadcaster);
     zsock_destroy(&self->responder);
-    zsock_destroy(&self->scan_receiver);
+    for (unsigned int i = 0; i < self->scan_receiver_ctr; i++)
+    {
+        zactor_destroy(&self->scan_decoders[i]);
+    }
+    zsock_destroy(&self->scan_decoded);
+    zsock_destroy(&self->metrics);
     zpoller_destroy(&self->poller);
+    reply_pool_destroy();
 
     free (self);
     return CS_SUCCESS; // todo
 }
 
-/**** CKN Removed ... Never Used ****************
+/************************************************
+ * int monitor_comms_bind_command_publisher()
+ *  @param  monitor_comms_t *self
+ *
+ *  @brief  Binds the broadcaster, which then publishes the alert events (see csl_alert_event)
+ *
+ *  @author Kerry
+ *
+ *  @return The port bound, or -1 on failure (alerts are then not published)
+ ************************************************/
 int monitor_comms_bind_command_publisher(monitor_comms_t* self)
 {
-    int bind_err = zsock_bind(self->broadcaster, self->broadcasting_address);
-    assert(bind_err != -1);
+    int bind_err = zsock_bind(self->broadcaster, "%s", self->broadcasting_address);
+    self->broadcaster_bound = bind_err != -1;
     return bind_err;
 }
-*************************************************/
+
+/************************************************
+ * void csl_PublishAlert()
+ *  @param
+ *          monitor_comms_t         *comms
+ *          const csl_alert_event   *event          - Every field but element_name_size
+ *          const char              *element_name
+ *
+ *  @brief  Publishes an alert event on the broadcaster, under its "alert.<device_id>.<alert_type>." topic
+ *
+ *  @author Kerry
+ *
+ *  @note   Called on the message thread, which owns the broadcaster. A PUB socket never blocks - with no
+ *          subscriber, or one past its high water mark, the event is dropped.
+ ************************************************/
+void csl_PublishAlert(monitor_comms_t *comms, const csl_alert_event *event, const char *element_name)
+{
+    if (comms == NULL || comms->broadcaster_bound == false)
+    {
+        return;
+    }
+
+    byte    buffer[sizeof(csl_alert_event) + SIZE_ELEMENT_NAME];
+    size_t  name_size = strnlen(element_name, SIZE_ELEMENT_NAME);
+    memcpy(buffer, event, sizeof(csl_alert_event));
+    ((csl_alert_event *) buffer)->element_name_size = (uint32_t) name_size;
+    memcpy(buffer + sizeof(csl_alert_event), element_name, name_size);
+
+    char topic[SIZE_ALERT_TOPIC];
+    snprintf(topic, SIZE_ALERT_TOPIC, ALERT_TOPIC_FORMAT, (unsigned long long) event->device_id, event->alert_type);
+    if (zsock_send(comms->broadcaster, "sb", topic, buffer, sizeof(csl_alert_event) + name_size) == 0)
+    {
+        csl_MetricCount(METRIC_ALERTS_PUBLISHED, 1);
+    }
+}
 
 void monitor_comms_set_verbose_auth(monitor_comms_t *self, bool verbosity)
 {
@@ -492,47 +1042,67 @@ void csl_createNewMessage (csl_zmessage* message,
 }
 
 
-int csl_ProcessHeartbeat (monitor_comms_t *comms, csl_zmessage *pcurrMessage, device_record *device_table_row)
+/************************************************
+ * int csl_ProcessHeartbeat()
+ *  @param
+ *          monitor_comms_t *comms
+ *          csl_zmessage    *pcurrMessage       - The heartbeat, reused as the reply
+ *          device_record   *device_table_row   - The device that sent it
+ *          bool            scan_granted        - Whether the device has been given a scan grant
+ *          unsigned int    resume_from         - The rows of the device's suspended scan already held, or 0
+ *
+ *  @brief  Beats back. A device with a scan grant is told to scan (PROBE_RECURRING_SCAN),
+ *          every other device is told to wait (PROBE_READY)
+ *
+ *  @author Kerry
+ *
+ *  @note   When resume_from is not 0 the reply's file name carries SCAN_RESUME_DIRECTIVE, so the probe can resume
+ *          its scan after those rows. A probe that ignores the directive simply scans afresh.
+ *
+ *  @return CS_SUCCESS on success, CS_ERROR if the reply could not be sent
+ ************************************************/
+int csl_ProcessHeartbeat (monitor_comms_t *comms, csl_zmessage *pcurrMessage, device_record *device_table_row,
+                          bool scan_granted, unsigned int resume_from)
 {
     int return_flag = CS_SUCCESS;
-    byte *buffer    = calloc(CSL_MAX_MESSAGE_LENGTH, sizeof(byte));
 
 //  TODO: Heartbeat needs it's own thread/socket. This solution gets overwhelmed, but is functional.  Comment from Madi
-#ifdef NDEBUG
+#ifndef NDEBUG
     fprintf(stderr, "Received heartbeat \u2665\n");
 #endif
 
     device_table_row->last_heartbeat = zclock_mono();
 //    registerHeartbeat(&device->probeTable, pcurrMessage->probe_id);
 
-    if (device_table_row->currently_scanning == false )
+    if (scan_granted == true)
     {
-//        device_table[device_index].currently_scanning = true;
         pcurrMessage->probe_event = PROBE_RECURRING_SCAN;
+        if (resume_from > 0)
+        {
+            // The file name travels with its size, so the reply's total size follows the new name
+            pcurrMessage->message_total_size -= pcurrMessage->file_name_size;
+            snprintf(pcurrMessage->file_name, SIZE_ELEMENT_NAME, SCAN_RESUME_DIRECTIVE, resume_from);
+            pcurrMessage->file_name_size     = (uint32_t) strlen(pcurrMessage->file_name);
+            pcurrMessage->message_total_size += pcurrMessage->file_name_size;
+        }
     }
     else
     {
         pcurrMessage->probe_event = PROBE_READY;
     }
 
-    csl_serializeMessageByte(pcurrMessage, buffer);
-
-    if (zsock_send(comms->responder, "b", buffer, pcurrMessage->message_total_size))
+    if (reply_send(comms->responder, pcurrMessage) != CS_SUCCESS)
     {
-#ifndef DEBUG
         printf("\t<%s> WARNING: For device_index[%d] - Couldn't beat back </3\n", __PRETTY_FUNCTION__,
                device_table_row->device_index);
-        fprintf(stderr, "Couldn't beat back </3\n");
-#endif
         return_flag = CS_ERROR;
     }
     else
     {
-#ifndef DEBUG
+#ifndef NDEBUG
         fprintf(stderr, "Beat back \u2665\n");
 #endif
     }
-    free(buffer);
 
     return return_flag;
 }
@@ -556,7 +1126,7 @@ int csl_ProcessHeartbeat (monitor_comms_t *comms, csl_zmessage *pcurrMessage, de
     byte *buffer = calloc(CSL_MAX_MESSAGE_LENGTH, sizeof(byte));
 
 //  TODO: Heartbeat needs it's own thread/socket. This solution gets overwhelmed, but is functional.  Comment from Madi
-#ifdef NDEBUG
+#ifndef NDEBUG
     fprintf(stderr, "Received heartbeat \u2665\n");
 #endif
 
@@ -581,7 +1151,7 @@ int csl_ProcessHeartbeat (monitor_comms_t *comms, csl_zmessage *pcurrMessage, de
     }
     else
     {
-#ifndef DEBUG
+#ifndef NDEBUG
         fprintf(stderr, "Beat back \u2665\n");
 #endif
     }
@@ -595,9 +1165,6 @@ int csl_RequestScan (monitor_comms_t *comms, csl_zmessage *pcurrMessage, device_
 {
     int return_flag = CS_SUCCESS;
 
-//    byte buffer[CSL_MAX_MESSAGE_LENGTH] = {0x00};
-    byte *buffer = calloc(CSL_MAX_MESSAGE_LENGTH, sizeof(byte));
-
 //  TODO: Heartbeat needs it's own thread/socket. This solution gets overwhelmed, but is functional.  Comment from Madi
 #ifndef NDEBUG
     fprintf(stderr, "Received heartbeat \u2665\n");
@@ -607,15 +1174,14 @@ int csl_RequestScan (monitor_comms_t *comms, csl_zmessage *pcurrMessage, device_
 //    registerHeartbeat(&device->probeTable, pcurrMessage->probe_id);
     pcurrMessage->probe_event = PROBE_READY;
 
-    csl_serializeMessageByte(pcurrMessage, buffer);
-
-    if (zsock_send(comms->responder, "b", buffer, pcurrMessage->message_total_size))
+    if (reply_send(comms->responder, pcurrMessage) != CS_SUCCESS)
     {
         fprintf(stderr, "Couldn't beat back </3\n");
+        return_flag = CS_ERROR;
     }
     else
     {
-#ifndef DEBUG
+#ifndef NDEBUG
         fprintf(stderr, "Beat back \u2665\n");
 #endif
     }
@@ -673,11 +1239,10 @@ csl_complete_message *csl_ConvertFromZMessage(csl_complete_message *new_message,
     memcpy(new_message->message_header.from_address.device_ip_address,z_source_message->probe_ip, SIZE_IP4_ADDRESS);
 
     // **** Convert the short MAC address from the probe into the full MAC address for the monitor **** //
-    byte *short_mac         = calloc(IFHWADDRLEN, sizeof(byte));
+    byte short_mac[IFHWADDRLEN];
     memcpy(short_mac, z_source_message->probe_mac_address, IFHWADDRLEN);
     memset(new_message->message_header.from_address.device_identifier,NULL_BINARY, SIZE_DEVICE_IDENTIFIER);
-    byte *long_mac          = csl_MacAddressExpand(short_mac);
-    free(short_mac);
+    byte *long_mac          = csl_ArenaMacAddressExpand(csl_ArenaMessage(), short_mac);
     memcpy(new_message->message_header.from_address.device_identifier, long_mac, SIZE_DEVICE_IDENTIFIER);
 
     memset(new_message->message_header.from_address.misc_info,NULL_BINARY, SIZE_HOST_NAME);
@@ -705,13 +1270,12 @@ csl_complete_message *csl_ConvertFromZMessage(csl_complete_message *new_message,
 
     memset(new_message->message_body.message_scan.device_mac_address, NULL_BINARY, SIZE_MAC_ADDRESS);
     memcpy(new_message->message_body.message_scan.device_mac_address, long_mac, SIZE_MAC_ADDRESS);
-    free(long_mac);
 
     memset(new_message->message_body.message_scan.element_name, NULL_BINARY, SIZE_ELEMENT_NAME);
  //   memcpy(new_message->message_body.message_scan.element_name, z_source_message->file_name, SIZE_ELEMENT_NAME);
     strcpy(new_message->message_body.message_scan.element_name, z_source_message->file_name);
 
-    char hash_buffer[SIZE_HASH_NAME];
+    char hash_buffer[SIZE_HASH_NAME + 1];     // MD5CharModule() adds a terminating NUL
     MD5CharModule(new_message->message_body.message_scan.element_name, hash_buffer);
     memset(new_message->message_body.message_scan.element_name_hash, NULL_BINARY, SIZE_HASH_NAME);
     memcpy(new_message->message_body.message_scan.element_name_hash, hash_buffer, SIZE_HASH_NAME);
@@ -806,12 +1370,13 @@ void print_csl_scan_record(csl_scan_record *my_record, char* heading, int rev)
     printf("\nPrinting %s csl_scan_record %d\n", heading, rev);
     printf("\tScan ID:             %u\n",  my_record->scan_id);
     printf("\tProbe ID:            %f\n",  my_record->probe_id);
-    printf("\tProbe UUID:          %s\n",  csl_Byte2String(my_record->probe_uuid, SIZE_ZUUID));
-    printf("\tDevice IP:           %s\n",  csl_Byte2String(my_record->device_ip, SIZE_IP4_ADDRESS));
-    printf("\tDevice MAC Address:  %s\n",  csl_Byte2String(my_record->device_mac_address, SIZE_MAC_ADDRESS));
+    csl_arena *arena = csl_ArenaMessage();
+    printf("\tProbe UUID:          %s\n",  csl_ArenaByte2String(arena, my_record->probe_uuid, SIZE_ZUUID));
+    printf("\tDevice IP:           %s\n",  csl_ArenaByte2String(arena, my_record->device_ip, SIZE_IP4_ADDRESS));
+    printf("\tDevice MAC Address:  %s\n",  csl_ArenaByte2String(arena, my_record->device_mac_address, SIZE_MAC_ADDRESS));
     printf("\tElement Name:        %s\n",  my_record->element_name);
-    printf("\tElement Name Hash:   %s\n",  csl_Hash2String(my_record->element_name_hash, SIZE_HASH_NAME));
-    printf("\tElement Scan Value:  %s\n",  csl_Hash2String(my_record->scan_value, SIZE_HASH_ELEMENT));
+    printf("\tElement Name Hash:   %s\n",  csl_ArenaHash2String(arena, my_record->element_name_hash, SIZE_HASH_NAME));
+    printf("\tElement Scan Value:  %s\n",  csl_ArenaHash2String(arena, my_record->scan_value, SIZE_HASH_ELEMENT));
     printf("\tElement Attribs:     %u\n",  my_record->element_attributes);
     char       buf1[80];
     struct tm *ts;
@@ -833,9 +1398,9 @@ csl_message_body *csl_ScanRecordToMessage(csl_message_body *message_out, csl_sca
     return message_out;
 }
 
-csl_scan_record *csl_MessageToScanRecord(csl_message_body *in_message)
+csl_scan_record *csl_MessageToScanRecord(csl_arena *arena, csl_message_body *in_message)
 {
-    csl_scan_record *out_record = calloc(sizeof(csl_scan_record), sizeof(byte));
+    csl_scan_record *out_record = csl_ArenaAlloc(arena, sizeof(csl_scan_record));
     memcpy(out_record, &in_message->message_scan, sizeof(csl_scan_record));
     return out_record;
 }
@@ -1038,12 +1603,75 @@ char *csl_get_probe_event_name(int probe_event_index)
     return return_string;
 }
 
-int csl_AcknowledgeHandshake(csl_zmessage *current_zmessage, monitor_comms_t *comms)
+/************************************************
+ * unsigned int csl_HandshakeCapabilities()
+ *  @param  const char *directives      - A handshake's file name
+ *
+ *  @brief  The PROBE_CAPABILITY_* bits of the handshake's HANDSHAKE_CAPABILITIES_DIRECTIVE
+ *
+ *  @author Kerry
+ *
+ *  @note   The directive may follow others, separated by spaces
+ *
+ *  @return the bits, 0 if there is no directive
+ ************************************************/
+unsigned int csl_HandshakeCapabilities(const char *directives)
 {
-    int return_flag                     = CS_SUCCESS;
-    byte buffer[CSL_MAX_MESSAGE_LENGTH] = {0x00};
+    unsigned int capabilities = 0;
+    const char *directive = directives;
+    while (directive != NULL && *directive != NULL_BINARY)
+    {
+        if (sscanf(directive, HANDSHAKE_CAPABILITIES_DIRECTIVE, &capabilities) == 1)
+        {
+            return capabilities;
+        }
+        directive = strchr(directive, ' ');
+        if (directive != NULL)
+        {
+            directive++;
+        }
+    }
+    return 0;
+}
 
+/************************************************
+ * int csl_AcknowledgeHandshake()
+ *  @param
+ *          csl_zmessage    *current_zmessage   - The handshake
+ *          monitor_comms_t *comms
+ *          int             device_index        - The registered device, or CS_DEVICE_UNKNOWN
+ *          unsigned int    capabilities        - The PROBE_CAPABILITY_* bits the monitor agrees to
+ *
+ *  @brief  Replies PROBE_REGISTERED to a handshake
+ *
+ *  @author Kerry
+ *
+ *  @note   A registered device is also told which scan endpoint to push to. The reply's file name carries
+ *          HANDSHAKE_SCAN_PORT_DIRECTIVE with the port, spreading the devices across the scan receivers
+ *          by device_index. A probe that ignores the directive keeps using endpoint 0, which is always bound.
+ *          If the monitor agrees to any of the capabilities the probe offered, HANDSHAKE_CAPABILITIES_DIRECTIVE
+ *          follows, after a space, with those it agrees to. A probe only uses a capability the reply names.
+ *
+ *  @return CS_SUCCESS on success, CS_ERROR if the reply could not be sent
+ ************************************************/
+int csl_AcknowledgeHandshake(csl_zmessage *current_zmessage, monitor_comms_t *comms, int device_index,
+                             unsigned int capabilities)
+{
     csl_zmessage response_msg;
+    char scan_port_directive[SIZE_PORT_DIRECTIVE];
+    char *file_name = NULL;
+    if (device_index >= 0)
+    {
+        int length = snprintf(scan_port_directive, SIZE_PORT_DIRECTIVE, HANDSHAKE_SCAN_PORT_DIRECTIVE,
+                              comms->scan_ports[device_index % comms->scan_receiver_ctr]);
+        if (capabilities != 0)
+        {
+            snprintf(scan_port_directive + length, SIZE_PORT_DIRECTIVE - length, " " HANDSHAKE_CAPABILITIES_DIRECTIVE,
+                     capabilities);
+        }
+        file_name = scan_port_directive;
+    }
+
 #ifndef DEPRECATED
     csl_createNewMessage(&response_msg, current_zmessage->license_key,
                          NULL, 0, NULL,
@@ -1051,14 +1679,12 @@ int csl_AcknowledgeHandshake(csl_zmessage *current_zmessage, monitor_comms_t *co
                          PROBE_REGISTERED, current_zmessage->probe_id);
 #endif
     csl_createNewMessage(&response_msg, current_zmessage->license_key,
-                         NULL, 0,                                        // filename and file attributes
+                         file_name, 0,                                   // filename and file attributes
                          current_zmessage->hostname, current_zmessage->probe_uuid,
                          current_zmessage->probe_ip, current_zmessage->probe_mac_address,
                          PROBE_REGISTERED, current_zmessage->probe_id);
-    csl_serializeMessageByte(&response_msg, buffer);
-    zsock_send(comms->responder, "b", &buffer, response_msg.message_total_size);
 
-    return return_flag;
+    return reply_send(comms->responder, &response_msg);
 }
 
 #ifndef DEPRECATED
@@ -1123,234 +1749,3 @@ CS_2d_byte_array   *csl_ScanRecordTo2dByteArray(CS_2d_byte_array *out_array, csl
     return out_array;
 }
 #endif
-
-/************************************************
- * Specialized Functions
- * =====================
- ************************************************/
-
-
-//  4/23/20, GGS, replace CSL_MESSAGE_LENGTH with various message sizes
-//                chg memcpy (several places) with dynamic sizes
-//          CKN emended this code
-
-int csl_serializeMessageByte (csl_zmessage* message, byte* buffer)
-{
-    int buffer_size = message->message_total_size;       //CSL_MESSAGE_LENGTH;
-    size_t index = 0;
-
-    memcpy(buffer+index, &message->message_total_size, sizeof(size_t));
-    index += sizeof(size_t);
-
-    memcpy(buffer+index, &message->file_name_size, sizeof(uint32_t));
-    index += sizeof(uint32_t);
-
-    //"\n" not serialized - add when deserializing
-    memcpy(buffer + index, message->file_name, message->file_name_size);
-    index += message->file_name_size;
-
-    memcpy(buffer + index, message->hash, SIZE_HASH_ELEMENT_Z);
-    index += SIZE_HASH_ELEMENT_Z;
-
-    memcpy(buffer + index, message->probe_ip, SIZE_IP4_ADDRESS);
-    index += SIZE_IP4_ADDRESS;
-
-    memcpy(buffer + index, message->probe_mac_address, IFHWADDRLEN);
-    index += IFHWADDRLEN;
-
-    memcpy(buffer + index, message->probe_uuid, SIZE_ZUUID);
-    index += SIZE_ZUUID;
-
-    memcpy(buffer + index, &message->probe_event, sizeof(uint32_t));
-    index += sizeof(uint32_t);
-
-    memcpy(buffer + index, message->hostname, SIZE_HOST_NAME);
-    index += SIZE_HOST_NAME;
-
-    memcpy (buffer + index, &message->probe_id, sizeof(uint32_t));
-    index += sizeof(uint32_t);
-
-    memcpy(buffer + index, message->license_key, SIZE_LICENSE_KEY);
-    index += SIZE_LICENSE_KEY;
-
-    memcpy(buffer + index, &message->file_attribute, sizeof(message->file_attribute));
-    index += sizeof(message->file_attribute);
-
-    if (index != buffer_size)
-    {
-        message->message_total_size = index;
-        memcpy(buffer+0, &message->message_total_size, sizeof(size_t));
-        printf("WARNING! serialization index size [%lu] does not equal buffer size [%d]!\n",
-               index, buffer_size);
-//        fprintf(stderr,"WARNING! serialization index size does not equal buffer size! Data is being lost!\n");
-    }
-
-    return CS_SUCCESS;
-}
-
-int csl_deserializeMessageByte (csl_zmessage* message, byte* buffer)
-{
-//    int buffer_size = CSL_MESSAGE_LENGTH;
-    size_t index = 0;
-
-    memcpy(&message->message_total_size, buffer+index, sizeof(size_t));
-//    printf("message_total_size [%lu]\n", message->message_total_size);
-    index += sizeof(size_t);
-
-    uint32_t buffer_size = message->message_total_size;
-
-    memcpy(&message->file_name_size, buffer+index, sizeof(uint32_t));
-    index += sizeof(uint32_t);
-//    message->file_name  = calloc(message->file_name_size + 1, sizeof (char));
-    memset( message->file_name, NULL_BINARY, SIZE_ELEMENT_NAME);
-    memcpy( message->file_name, buffer + index, message->file_name_size);
-    message->file_name[message->file_name_size] = END_OF_STRING; //nullterm is not sent in msg, so ensure safely terminated strings
-    index += message->file_name_size;
-
-    memcpy( message->hash, buffer+index, SIZE_HASH_ELEMENT_Z);
-    index += SIZE_HASH_ELEMENT_Z;
-
-    memcpy(message->probe_ip, buffer + index, SIZE_IP4_ADDRESS);
-    index += SIZE_IP4_ADDRESS;
-
-/**** This is future code for use of our MAC address ****
-    memcpy(message->probe_mac_address, buffer + index, SIZE_MAC_ADDRESS);
-    index += SIZE_MAC_ADDRESS;
- ********************************************************/
-    memcpy(message->probe_mac_address, buffer + index, IFHWADDRLEN);
-    index += IFHWADDRLEN;
-
-    memcpy(message->probe_uuid, buffer + index, SIZE_ZUUID);
-    index += SIZE_ZUUID;
-
-    memcpy(&message->probe_event, buffer + index, sizeof(uint32_t));
-    index += sizeof(uint32_t);
-
-    memcpy(message->hostname, buffer + index, SIZE_HOST_NAME);
-    index += SIZE_HOST_NAME;
-
-    memcpy (&message->probe_id, buffer + index, sizeof(uint32_t));
-    index += sizeof(uint32_t);
-
-    memcpy(message->license_key, buffer + index, SIZE_LICENSE_KEY);
-    index += SIZE_LICENSE_KEY;
-
-    memcpy(&message->file_attribute, buffer + index, sizeof(message->file_attribute));
-    index += sizeof(message->file_attribute);
-
-    if (index != buffer_size)
-    {
-        fprintf(stderr, "WARNING! de-serialization index size does not equal buffer size! Data is being lost!\n");
-    }
-
-    return CS_SUCCESS;
-}
-
-#ifndef DEPRECATED
-
-//  4/23/20, GGS, replace CSL_MESSAGE_LENGTH with various message sizes
-//                chg memcpy (several places) with dynamic sizes
-
-int csl_serializeMessageByte (csl_zmessage* message, byte* buffer)
-{
-    int buffer_size = message->message_total_size;       //CSL_MESSAGE_LENGTH;
-    int index = 0;
-
-    memcpy(buffer+index, &message->message_total_size, sizeof(message->message_total_size));
-    index += sizeof(message->message_total_size);
-
-
-    memcpy(buffer+index, &message->file_name_size, sizeof(message->file_name_size));
-    index += sizeof(message->file_name_size);
-
-    //"\n" not serialized - add when deserializing
-    memcpy(buffer + index, message->file_name, message->file_name_size);
-    index += message->file_name_size;
-
-    memcpy(buffer + index, message->hash, sizeof(message->hash));
-    index += sizeof(message->hash);
-
-    memcpy(buffer + index, message->probe_ip, sizeof(message->probe_ip));
-    index += sizeof(message->probe_ip);
-
-    memcpy(buffer + index, message->probe_mac_address, sizeof(message->probe_mac_address));
-    index += sizeof(message->probe_mac_address);
-
-    memcpy(buffer + index, message->probe_uuid, sizeof(message->probe_uuid));
-    index += sizeof(message->probe_uuid);
-
-    memcpy(buffer + index, &message->probe_event, sizeof(uint32_t));
-    index += sizeof(uint32_t);
-
-    memcpy(buffer + index, message->hostname, sizeof(message->hostname));
-    index += sizeof(message->hostname);
-
-    memcpy (buffer + index, &message->probe_id, sizeof(uint32_t));
-    index += sizeof(uint32_t);
-
-
-    memcpy(buffer + index, message->license_key, sizeof(message->license_key));
-    index += sizeof(message->license_key);
-
-
-    if (index != buffer_size) {
-        fprintf(stderr,"ERROR! serialization index size does not equal buffer size! Data is being lost!\n");
-    }
-
-
-    return 0;
-}
-
-int csl_deserializeMessageByte (csl_zmessage* message, byte* buffer)
-{
-//    int buffer_size = CSL_MESSAGE_LENGTH;
-    int index = 0;
-
-    memcpy(&message->message_total_size, buffer+index, sizeof(message->message_total_size));
-    index += sizeof(message->message_total_size);
-
-    uint32_t buffer_size = message->message_total_size;
-
-    memcpy(&message->file_name_size, buffer+index, sizeof(message->file_name_size));
-    index += sizeof(message->file_name_size);
-
-    memcpy( message->file_name, buffer + index, message->file_name_size);
-    message->file_name[message->file_name_size] = '\0'; //nullterm is not sent in msg, so ensure safely terminated strings
-    index += message->file_name_size;
-
-
-    memcpy( message->hash, buffer+index, sizeof(message->hash));
-    index += sizeof(message->hash);
-
-    memcpy(message->probe_ip, buffer + index, sizeof(message->probe_ip));
-    index += sizeof(message->probe_ip);
-
-    memcpy(message->probe_mac_address, buffer + index, sizeof(message->probe_mac_address));
-    index += sizeof(message->probe_mac_address);
-
-    memcpy(message->probe_uuid, buffer + index, sizeof(message->probe_uuid));
-    index += sizeof(message->probe_uuid);
-
-    memcpy(&message->probe_event, buffer + index, sizeof(uint32_t));
-    index += sizeof(uint32_t);
-
-    memcpy(message->hostname, buffer + index, sizeof(message->hostname));
-    index += sizeof(message->hostname);
-
-    memcpy ( &message->probe_id, buffer + index, sizeof(uint32_t));
-    index += sizeof(uint32_t);
-
-    memcpy(message->license_key, buffer + index, sizeof(message->license_key));
-    index += sizeof(message->license_key);
-
-    if (index != buffer_size)
-    {
-        fprintf(stderr, "ERROR! de-serialization index size does not equal buffer size! Data is being lost!\n")
-    }
-
-
-    return 0;
-}
-
-#endif
-
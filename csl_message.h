@@ -47,9 +47,23 @@
 //#define COMM_DEFAULT_PREFIX         "42"
 #define HEARTBEAT_TIMEOUT           5 //Arbitrary timeout for heartbeats (seconds)
 // Refer to ZeroMQ documentation about its use of high water marks to prevent overflowing sockets
-#define RECEIVE_HIGH_WATER_MARK     10000
+// The high water marks are now set from the monitor config (rcvhwm, sndhwm)
 #define LICENSE_KEY_LENGTH          65
 #define DEFAULT_HOST_NAME           "DefaultHostName"
+#define SCAN_RECEIVER_PORT_STRIDE   100    // Scan endpoint k listens on scan_port + k * SCAN_RECEIVER_PORT_STRIDE
+#define SCAN_DECODED_ENDPOINT       "inproc://scan-decoded"
+#define HANDSHAKE_SCAN_PORT_DIRECTIVE "scan_port=%d"
+#define HANDSHAKE_CAPABILITIES_DIRECTIVE "capabilities=%x"  // PROBE_CAPABILITY_* - offered by the probe, agreed by the reply
+#define SIZE_PORT_DIRECTIVE         64
+#define PROBE_CAPABILITY_ORDERED_SCAN 0x1  // The probe sends its scans in element_name_hash order
+#define SCAN_RESUME_DIRECTIVE       "resume_from=%u"   // Rows of a suspended scan the monitor already holds
+#define LANE_STATS_REPORT_SECONDS   60
+#define METRICS_ENDPOINT            "tcp://127.0.0.1:%u"
+#define ALERT_TOPIC_FORMAT          "alert.%llu.%d."   // device_id, alert_type - see csl_alert_event
+#define SIZE_ALERT_TOPIC            48
+#define ALERT_EVENT_VERSION         1
+#define REPLY_POOL_PRELOAD          8      // Reply buffers allocated up front - one per reply ZeroMQ may still hold
+#define REPLY_POOL_MAX_FREE         64     // Spare reply buffers kept after a burst, the rest are freed
 
 /************************************************
  * struct Definitions
@@ -76,6 +90,7 @@ int                 monitor_comms_destroy(monitor_comms_t* self);
 monitor_comms_t*    monitor_comms_new(int broadcaster_port, int responder_port, int scan_port, char* hostname_in);
 void                monitor_comms_set_verbose_auth(monitor_comms_t *self, bool verbosity);
 void                monitor_comms_set_verbose_messaging(monitor_comms_t *self, bool verbosity);
+void                csl_PublishAlert(monitor_comms_t *comms, const csl_alert_event *event, const char *element_name);
 
 //void                *zsys_init(void);
 
@@ -90,11 +105,15 @@ void                csl_createNewMessage (csl_zmessage* message,
                                           uint32_t probe_event,
                                           uint32_t probe_id);
 
-int                 csl_AcknowledgeHandshake(csl_zmessage *current_message, monitor_comms_t *comms);
+int                 csl_AcknowledgeHandshake(csl_zmessage *current_message, monitor_comms_t *comms, int device_index,
+                                             unsigned int capabilities);
+unsigned int        csl_HandshakeCapabilities(const char *directives);
 int                 csl_RequestScan(monitor_comms_t *comms, csl_zmessage *pcurrMessage, device_record *device_entry);
 
 
-int csl_ProcessHeartbeat (monitor_comms_t *comms, csl_zmessage *pcurrMessage, device_record *device_table_row);
+int csl_ProcessHeartbeat (monitor_comms_t *comms, csl_zmessage *pcurrMessage, device_record *device_table_row,
+                          bool scan_granted, unsigned int resume_from);
+unsigned long long  csl_ScanQueueDepth();
 //int                 csl_serializeMessageByte (csl_zmessage* message, byte* buffer);
 
 /****************************************************************************************
@@ -109,7 +128,7 @@ int csl_ProcessHeartbeat (monitor_comms_t *comms, csl_zmessage *pcurrMessage, de
 csl_complete_message    *csl_ConvertFromZMessage(csl_complete_message *new_message, csl_zmessage *z_source_message);
 int                     csl_MessageGetType(csl_complete_message *in_message);
 
-csl_scan_record         *csl_MessageToScanRecord(csl_message_body *in_message);
+csl_scan_record         *csl_MessageToScanRecord(csl_arena *arena, csl_message_body *in_message);
 //csl_scan_record         *generateScanRecord(csl_scan_record *newRecord, int rec_ctr);
 //csl_scan_record         *csl_MessageToScanRecord(csl_scan_record *out_record, csl_message_body *in_array);
 //CS_2d_byte_array        *csl_ScanRecordToMessage(CS_2d_byte_array *out_array, csl_scan_record *in_record);
@@ -117,9 +136,10 @@ csl_message_body        *csl_ScanRecordToMessage(csl_message_body *message_out,
 //csl_scan_record         *csl_MessageToScanRecord(csl_scan_record *out_record, CS_2d_byte_array *in_array);
 void                    print_csl_scan_record(csl_scan_record *my_record, char* heading, int rev);
 
-// **** Specialized Functions **** //
+// **** Specialized Functions (csl_wire.c) **** //
 int csl_serializeMessageByte (csl_zmessage* message, byte* buffer);
 int csl_deserializeMessageByte (csl_zmessage* message, byte* buffer);
+size_t  csl_MessageWireSize(csl_zmessage *message);
 
 
 /************************************************
@@ -0,0 +1,474 @@
+//
+// Created by kerry on 10/19/26.
+//
+
+#include "csl_metrics.h"
+
+/************************************************
+ * Metric Names
+ * ============
+ * One entry per enum value, in the enum's order
+ ************************************************/
+typedef struct
+{
+    char        *name;
+    char        *help;
+    char        *statement;         // the statement label of a DB histogram, NULL for none
+    double      scale;              // multiplies the stored value for rendering
+} csl_metric_name;
+
+static const csl_metric_name G_counter_names[METRIC_COUNTERS] =
+        {
+                {"crytica_received_bytes_total",        "Bytes of probe messages received",             NULL, 1.0},
+                {"crytica_scans_evaluated_total",       "Scans evaluated against the status quo",       NULL, 1.0},
+                {"crytica_scan_records_dropped_total",  "Scan records that arrived outside of a scan",  NULL, 1.0},
+                {"crytica_scans_suspended_total",       "Scans suspended after their device went quiet",NULL, 1.0},
+                {"crytica_alerts_total",                "Alerts written",                               NULL, 1.0},
+                {"crytica_db_errors_total",             "Failed database statements",                   NULL, 1.0},
+                {"crytica_db_reconnects_total",         "Database connections replaced",                NULL, 1.0},
+                {"crytica_spool_rejected_total",        "Spooled writes the database refused",          NULL, 1.0},
+                {"crytica_alerts_summarized_total",     "Scan alerts folded into a summary record",     NULL, 1.0},
+                {"crytica_alerts_published_total",      "Alert events published on the broadcaster",    NULL, 1.0},
+                {"crytica_scans_merged_total",          "Ordered scans evaluated by merge",             NULL, 1.0},
+        };
+
+static const csl_metric_name G_gauge_names[METRIC_GAUGES] =
+        {
+                {"crytica_scan_queue_depth",            "Decoded scan messages waiting",                NULL, 1.0},
+                {"crytica_scan_grants",                 "Devices currently allowed to scan",            NULL, 1.0},
+                {"crytica_memory_bytes",                "Memory used by all of the device tables",      NULL, 1.0},
+                {"crytica_spool_pending",               "Spooled writes not yet in the database",       NULL, 1.0},
+        };
+
+static const csl_metric_name G_device_gauge_names[METRIC_DEVICE_GAUGES] =
+        {
+                {"crytica_device_memory_bytes",         "Memory used by the device's tables",           NULL, 1.0},
+                {"crytica_device_evaluate_seconds",     "Time taken by the device's last scan evaluation", NULL, 1e-6},
+                {"crytica_device_scan_rows",            "Rows in the device's last scan",               NULL, 1.0},
+        };
+
+static const csl_metric_name G_histogram_names[METRIC_HISTOGRAMS] =
+        {
+                {"crytica_scan_evaluate_seconds",       "Time taken to evaluate a scan",                NULL,       1e-6},
+                {"crytica_scan_queue_wait_seconds",     "Time a decoded scan message waited",           NULL,       1e-6},
+                {"crytica_db_statement_seconds",        "Time taken by a database statement",           "select",   1e-6},
+                {"crytica_db_statement_seconds",        "Time taken by a database statement",           "insert",   1e-6},
+                {"crytica_db_statement_seconds",        "Time taken by a database statement",           "update",   1e-6},
+                {"crytica_db_statement_seconds",        "Time taken by a database statement",           "delete",   1e-6},
+                {"crytica_db_statement_seconds",        "Time taken by a database statement",           "other",    1e-6},
+        };
+
+/************************************************
+ * The Metrics
+ * ===========
+ * Only the device gauges are allocated, the rest are static. Every update is a relaxed atomic.
+ ************************************************/
+static unsigned long long   G_message_ctr[METRICS_MESSAGE_TYPES];
+static unsigned long long   G_counters[METRIC_COUNTERS];
+static long long            G_gauges[METRIC_GAUGES];
+static long long            *G_device_gauges[METRIC_DEVICE_GAUGES];
+static unsigned int         G_device_gauge_capacity;
+static csl_histogram        G_histograms[METRIC_HISTOGRAMS];
+
+/************************************************
+ * unsigned int metrics_bucket()
+ *  @param  uint64_t usecs
+ *
+ *  @brief  Returns the histogram bucket of a value
+ *
+ *  @author Kerry
+ *
+ *  @note   Values below METRICS_SUB_BUCKETS get a bucket each. Above that, the bucket is picked by the value's
+ *          highest set bit and the METRICS_SUB_BUCKET_BITS bits just below it.
+ ************************************************/
+static unsigned int metrics_bucket(uint64_t usecs)
+{
+    if (usecs < METRICS_SUB_BUCKETS)
+    {
+        return (unsigned int) usecs;
+    }
+    unsigned int msb    = 63 - (unsigned int) __builtin_clzll(usecs);
+    unsigned int bucket = (msb - METRICS_SUB_BUCKET_BITS + 1) * METRICS_SUB_BUCKETS +
+                          (unsigned int) ((usecs >> (msb - METRICS_SUB_BUCKET_BITS)) & (METRICS_SUB_BUCKETS - 1));
+    return bucket < METRICS_HISTOGRAM_BUCKETS ? bucket : METRICS_HISTOGRAM_BUCKETS - 1;
+}
+
+/************************************************
+ * uint64_t metrics_bucket_top()
+ *  @param  unsigned int bucket
+ *
+ *  @brief  Returns the largest value that falls in a bucket
+ *
+ *  @author Kerry
+ ************************************************/
+static uint64_t metrics_bucket_top(unsigned int bucket)
+{
+    if (bucket < METRICS_SUB_BUCKETS)
+    {
+        return bucket;
+    }
+    unsigned int shift  = bucket / METRICS_SUB_BUCKETS - 1;
+    uint64_t     lower  = (uint64_t) (METRICS_SUB_BUCKETS + bucket % METRICS_SUB_BUCKETS) << shift;
+    return lower + ((uint64_t) 1 << shift) - 1;
+}
+
+/************************************************
+ * const char *metrics_message_name()
+ *  @param  unsigned int message_type
+ *
+ *  @brief  Returns the label of a message type, or NULL if it has none and should be shown by number
+ *
+ *  @author Kerry
+ ************************************************/
+static const char *metrics_message_name(unsigned int message_type)
+{
+    switch (message_type)
+    {
+        case PROBE_HANDSHAKE:       return "handshake";
+        case PROBE_HEARTBEAT:       return "heartbeat";
+        case PROBE_START_SCAN:      return "start_scan";
+        case PROBE_RECURRING_SCAN:  return "scan_record";
+        case PROBE_END_SCAN:        return "end_scan";
+        case METRICS_MESSAGE_TYPES - 1: return "other";
+        default:                    return NULL;
+    }
+}
+
+/************************************************
+ * bool metrics_append()
+ *  @param
+ *          char        *buffer
+ *          size_t      buffer_size
+ *          size_t      *used           - The length written so far, advanced past the new text
+ *          const char  *format, ...
+ *
+ *  @brief  Appends formatted text to the render buffer
+ *
+ *  @author Kerry
+ *
+ *  @return true if the text fit, false if it did not (nothing is appended)
+ ************************************************/
+static bool metrics_append(char *buffer, size_t buffer_size, size_t *used, const char *format, ...)
+{
+    va_list args;
+    va_start(args, format);
+    int length = vsnprintf(buffer + *used, buffer_size - *used, format, args);
+    va_end(args);
+
+    if (length < 0 || (size_t) length >= buffer_size - *used)
+    {
+        buffer[*used] = CS_NULL;
+        return false;
+    }
+    *used += (size_t) length;
+    return true;
+}
+
+/************************************************
+ * int csl_MetricsInit()
+ *  @param  unsigned int max_devices    - The most device_index values the device gauges must hold
+ *
+ *  @brief  Allocates the device gauges. Every other metric is static and starts at zero.
+ *
+ *  @author Kerry
+ *
+ *  @return CS_SUCCESS on success, CS_ERROR if the device gauges could not be allocated
+ ************************************************/
+int     csl_MetricsInit(unsigned int max_devices)
+{
+    csl_MetricsDestroy();
+    for (int i = 0; i < METRIC_DEVICE_GAUGES; i++)
+    {
+        G_device_gauges[i] = calloc(max_devices, sizeof(long long));
+        if (G_device_gauges[i] == NULL)
+        {
+            printf("\t<%s> ERROR: Could not allocate device gauges for [%u] devices\n", __PRETTY_FUNCTION__, max_devices);
+            csl_MetricsDestroy();
+            return CS_ERROR;
+        }
+    }
+    G_device_gauge_capacity = max_devices;
+    return CS_SUCCESS;
+}
+
+/************************************************
+ * void csl_MetricsDestroy()
+ *  @param  - None
+ *
+ *  @brief  Frees the device gauges
+ *
+ *  @author Kerry
+ ************************************************/
+void    csl_MetricsDestroy()
+{
+    G_device_gauge_capacity = 0;
+    for (int i = 0; i < METRIC_DEVICE_GAUGES; i++)
+    {
+        free(G_device_gauges[i]);
+        G_device_gauges[i] = NULL;
+    }
+}
+
+/************************************************
+ * int64_t csl_MetricsNow()
+ *  @param  - None
+ *
+ *  @brief  Returns a monotonic clock in microseconds, for timing what goes into a histogram
+ *
+ *  @author Kerry
+ ************************************************/
+int64_t csl_MetricsNow()
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (int64_t) now.tv_sec * 1000000 + now.tv_nsec / 1000;
+}
+
+/************************************************
+ * void csl_MetricMessage()
+ *  @param  unsigned int message_type
+ *
+ *  @brief  Counts one received message of the given type
+ *
+ *  @author Kerry
+ ************************************************/
+void    csl_MetricMessage(unsigned int message_type)
+{
+    if (message_type >= METRICS_MESSAGE_TYPES)
+    {
+        message_type = METRICS_MESSAGE_TYPES - 1;
+    }
+    __atomic_add_fetch(&G_message_ctr[message_type], 1, __ATOMIC_RELAXED);
+}
+
+/************************************************
+ * void csl_MetricCount()
+ *  @param
+ *          csl_metric_counter  counter
+ *          unsigned long long  amount
+ *
+ *  @brief  Adds amount to a counter
+ *
+ *  @author Kerry
+ ************************************************/
+void    csl_MetricCount(csl_metric_counter counter, unsigned long long amount)
+{
+    __atomic_add_fetch(&G_counters[counter], amount, __ATOMIC_RELAXED);
+}
+
+/************************************************
+ * void csl_MetricGaugeSet()
+ *  @param
+ *          csl_metric_gauge    gauge
+ *          long long           value
+ *
+ *  @brief  Sets a gauge
+ *
+ *  @author Kerry
+ ************************************************/
+void    csl_MetricGaugeSet(csl_metric_gauge gauge, long long value)
+{
+    __atomic_store_n(&G_gauges[gauge], value, __ATOMIC_RELAXED);
+}
+
+/************************************************
+ * void csl_MetricDeviceSet()
+ *  @param
+ *          csl_metric_device_gauge gauge
+ *          short                   device_index
+ *          long long               value
+ *
+ *  @brief  Sets one device's gauge
+ *
+ *  @author Kerry
+ ************************************************/
+void    csl_MetricDeviceSet(csl_metric_device_gauge gauge, short device_index, long long value)
+{
+    if (device_index >= 0 && (unsigned int) device_index < G_device_gauge_capacity)
+    {
+        __atomic_store_n(&G_device_gauges[gauge][device_index], value, __ATOMIC_RELAXED);
+    }
+}
+
+/************************************************
+ * void csl_MetricObserve()
+ *  @param
+ *          csl_metric_histogram    histogram
+ *          int64_t                 usecs
+ *
+ *  @brief  Records one latency in a histogram
+ *
+ *  @author Kerry
+ ************************************************/
+void    csl_MetricObserve(csl_metric_histogram histogram, int64_t usecs)
+{
+    if (usecs < 0)
+    {
+        usecs = 0;
+    }
+    csl_histogram *h = &G_histograms[histogram];
+    __atomic_add_fetch(&h->buckets[metrics_bucket((uint64_t) usecs)], 1, __ATOMIC_RELAXED);
+    __atomic_add_fetch(&h->sum_usecs, (unsigned long long) usecs, __ATOMIC_RELAXED);
+    __atomic_add_fetch(&h->count, 1, __ATOMIC_RELAXED);
+}
+
+/************************************************
+ * csl_metric_histogram csl_MetricDBStatement()
+ *  @param  const char *query
+ *
+ *  @brief  Returns the histogram for a SQL statement, chosen by its first keyword
+ *
+ *  @author Kerry
+ ************************************************/
+csl_metric_histogram csl_MetricDBStatement(const char *query)
+{
+    while (*query == BLANK || *query == '\t' || *query == '\n')
+    {
+        query++;
+    }
+    if (strncasecmp(query, "select", 6) == 0)
+    {
+        return METRIC_DB_SELECT;
+    }
+    if (strncasecmp(query, "insert", 6) == 0)
+    {
+        return METRIC_DB_INSERT;
+    }
+    if (strncasecmp(query, "update", 6) == 0)
+    {
+        return METRIC_DB_UPDATE;
+    }
+    if (strncasecmp(query, "delete", 6) == 0)
+    {
+        return METRIC_DB_DELETE;
+    }
+    return METRIC_DB_OTHER;
+}
+
+/************************************************
+ * size_t csl_MetricsRender()
+ *  @param
+ *          char    *buffer
+ *          size_t  buffer_size
+ *
+ *  @brief  Writes every metric into buffer in the Prometheus text exposition format
+ *
+ *  @author Kerry
+ *
+ *  @note   Output that does not fit is cut at the last complete line.
+ *          A histogram lists its buckets up to the highest one in use, so quiet histograms stay short.
+ *
+ *  @return The length of the text written
+ ************************************************/
+size_t  csl_MetricsRender(char *buffer, size_t buffer_size)
+{
+    size_t  used    = 0;
+    bool    fits    = buffer_size > 0;
+    if (fits)
+    {
+        buffer[0] = CS_NULL;
+    }
+
+    // **** Messages by type **** //
+    fits = fits && metrics_append(buffer, buffer_size, &used,
+                                  "# HELP crytica_messages_total Probe messages received\n"
+                                  "# TYPE crytica_messages_total counter\n");
+    for (unsigned int i = 0; fits && i < METRICS_MESSAGE_TYPES; i++)
+    {
+        unsigned long long value = __atomic_load_n(&G_message_ctr[i], __ATOMIC_RELAXED);
+        if (value == 0)
+        {
+            continue;
+        }
+        const char *name = metrics_message_name(i);
+        fits = name != NULL ?
+               metrics_append(buffer, buffer_size, &used, "crytica_messages_total{type=\"%s\"} %llu\n", name, value) :
+               metrics_append(buffer, buffer_size, &used, "crytica_messages_total{type=\"%u\"} %llu\n", i, value);
+    }
+
+    // **** Counters and gauges **** //
+    for (int i = 0; fits && i < METRIC_COUNTERS; i++)
+    {
+        fits = metrics_append(buffer, buffer_size, &used, "# HELP %s %s\n# TYPE %s counter\n%s %llu\n",
+                              G_counter_names[i].name, G_counter_names[i].help, G_counter_names[i].name,
+                              G_counter_names[i].name, __atomic_load_n(&G_counters[i], __ATOMIC_RELAXED));
+    }
+    for (int i = 0; fits && i < METRIC_GAUGES; i++)
+    {
+        fits = metrics_append(buffer, buffer_size, &used, "# HELP %s %s\n# TYPE %s gauge\n%s %lld\n",
+                              G_gauge_names[i].name, G_gauge_names[i].help, G_gauge_names[i].name,
+                              G_gauge_names[i].name, __atomic_load_n(&G_gauges[i], __ATOMIC_RELAXED));
+    }
+
+    // **** Device gauges - only the devices that have a value **** //
+    for (int i = 0; fits && i < METRIC_DEVICE_GAUGES; i++)
+    {
+        const csl_metric_name *metric = &G_device_gauge_names[i];
+        fits = metrics_append(buffer, buffer_size, &used, "# HELP %s %s\n# TYPE %s gauge\n",
+                              metric->name, metric->help, metric->name);
+        for (unsigned int d = 0; fits && d < G_device_gauge_capacity; d++)
+        {
+            long long value = __atomic_load_n(&G_device_gauges[i][d], __ATOMIC_RELAXED);
+            if (value != 0)
+            {
+                fits = metrics_append(buffer, buffer_size, &used, "%s{device_index=\"%u\"} %.9g\n",
+                                      metric->name, d, (double) value * metric->scale);
+            }
+        }
+    }
+
+    // **** Histograms **** //
+    for (int i = 0; fits && i < METRIC_HISTOGRAMS; i++)
+    {
+        const csl_metric_name   *metric = &G_histogram_names[i];
+        csl_histogram           *h      = &G_histograms[i];
+        char label[SIZE_METRICS_LABEL]          = "";       // e.g. statement="select"
+        char label_set[SIZE_METRICS_LABEL + 2]  = "";       // e.g. {statement="select"}
+        if (metric->statement != NULL)
+        {
+            snprintf(label, SIZE_METRICS_LABEL, "statement=\"%s\"", metric->statement);
+            snprintf(label_set, SIZE_METRICS_LABEL + 2, "{%s}", label);
+        }
+        const char *separator = label[0] == CS_NULL ? "" : ",";
+
+        // Several statements share one name - it is described only before the first of them
+        if (i == 0 || strcmp(metric->name, G_histogram_names[i - 1].name) != 0)
+        {
+            fits = metrics_append(buffer, buffer_size, &used, "# HELP %s %s\n# TYPE %s histogram\n",
+                                  metric->name, metric->help, metric->name);
+        }
+
+        int highest = METRICS_HISTOGRAM_BUCKETS - 1;
+        while (highest >= 0 && __atomic_load_n(&h->buckets[highest], __ATOMIC_RELAXED) == 0)
+        {
+            highest--;
+        }
+        unsigned long long cumulative = 0;
+        for (int b = 0; fits && b <= highest; b++)
+        {
+            cumulative += __atomic_load_n(&h->buckets[b], __ATOMIC_RELAXED);
+            fits = metrics_append(buffer, buffer_size, &used, "%s_bucket{%s%sle=\"%.6f\"} %llu\n",
+                                  metric->name, label, separator,
+                                  (double) metrics_bucket_top((unsigned int) b) * metric->scale, cumulative);
+        }
+
+        // The count is read last, so +Inf is never below a bucket that was updated during the render
+        unsigned long long count = __atomic_load_n(&h->count, __ATOMIC_RELAXED);
+        if (count < cumulative)
+        {
+            count = cumulative;
+        }
+        fits = fits && metrics_append(buffer, buffer_size, &used,
+                                      "%s_bucket{%s%sle=\"+Inf\"} %llu\n%s_sum%s %.6f\n%s_count%s %llu\n",
+                                      metric->name, label, separator, count,
+                                      metric->name, label_set,
+                                      (double) __atomic_load_n(&h->sum_usecs, __ATOMIC_RELAXED) * metric->scale,
+                                      metric->name, label_set, count);
+    }
+
+    if (fits == false)
+    {
+        printf("\t<%s> WARNING: Metrics cut short at [%zu] bytes\n", __PRETTY_FUNCTION__, used);
+    }
+    return used;
+}
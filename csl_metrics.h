@@ -0,0 +1,225 @@
+
+/************************************************
+ * csl_metrics.h
+ * =============
+ *
+ * This is the header file for the CS Metrics Library
+ *
+ * Author:      Kerry
+ * Version:     00.00.00
+ * Comments:    Lock-free counters, gauges and latency histograms, rendered in the Prometheus text format
+ ************************************************/
+
+#ifndef CRYTICAMONITOR_CSL_METRICS_H
+#define CRYTICAMONITOR_CSL_METRICS_H
+
+#include <stdio.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdarg.h>
+#include <stdint.h>
+#include <strings.h>
+#include <time.h>
+
+#include "csl_constants.h"
+
+/************************************************
+ * #defines
+ * ========
+ ************************************************/
+#define METRICS_MESSAGE_TYPES           1024            // Message types at or above this are counted as "other"
+#define METRICS_SUB_BUCKET_BITS         2               // Each power of two is split into 4 buckets (+/- 12.5%)
+#define METRICS_SUB_BUCKETS             (1 << METRICS_SUB_BUCKET_BITS)
+#define METRICS_HISTOGRAM_BUCKETS       160             // Covers up to 2^41 usecs - about 25 days
+#define METRICS_TOPIC                   "metrics"
+#define SIZE_METRICS_TEXT               (512 * 1024)
+#define SIZE_METRICS_LABEL              64
+
+/************************************************
+ * Metrics
+ * =======
+ * Everything here may be updated from any thread without a lock - each value is a single atomic add or store.
+ *
+ *  - Counters only ever go up. Rates (messages per second, alerts per second, ...) are left to the collector.
+ *  - Gauges hold the latest value of something that goes up and down (queue depths, memory).
+ *  - Device gauges are gauges kept per device_index.
+ *  - Histograms record latencies in microseconds. The buckets are HDR style: each power of two is split into
+ *    METRICS_SUB_BUCKETS equal parts, so every bucket is within 25% of its neighbour whatever the scale.
+ ************************************************/
+typedef enum
+{
+    METRIC_BYTES_RECEIVED,
+    METRIC_SCANS_EVALUATED,
+    METRIC_SCAN_RECORDS_DROPPED,
+    METRIC_SCANS_SUSPENDED,
+    METRIC_ALERTS,
+    METRIC_DB_ERRORS,
+    METRIC_DB_RECONNECTS,
+    METRIC_SPOOL_REJECTED,
+    METRIC_ALERTS_SUMMARIZED,
+    METRIC_ALERTS_PUBLISHED,
+    METRIC_SCANS_MERGED,
+    METRIC_COUNTERS
+} csl_metric_counter;
+
+typedef enum
+{
+    METRIC_SCAN_QUEUE_DEPTH,
+    METRIC_SCAN_GRANTS,
+    METRIC_MEMORY_BYTES,
+    METRIC_SPOOL_PENDING,
+    METRIC_GAUGES
+} csl_metric_gauge;
+
+typedef enum
+{
+    METRIC_DEVICE_MEMORY_BYTES,
+    METRIC_DEVICE_EVALUATE_USECS,               // the device's last scan evaluation
+    METRIC_DEVICE_SCAN_ROWS,                    // rows in the device's last scan
+    METRIC_DEVICE_GAUGES
+} csl_metric_device_gauge;
+
+typedef enum
+{
+    METRIC_SCAN_EVALUATE,
+    METRIC_SCAN_QUEUE_WAIT,
+    METRIC_DB_SELECT,
+    METRIC_DB_INSERT,
+    METRIC_DB_UPDATE,
+    METRIC_DB_DELETE,
+    METRIC_DB_OTHER,
+    METRIC_HISTOGRAMS
+} csl_metric_histogram;
+
+typedef struct
+{
+    unsigned long long  buckets[METRICS_HISTOGRAM_BUCKETS];
+    unsigned long long  count;
+    unsigned long long  sum_usecs;
+} csl_histogram;
+
+/************************************************
+ * **********************************************
+ * Function Prototypes
+ * **********************************************
+ ************************************************/
+
+/************************************************
+ * int csl_MetricsInit()
+ *  @param  unsigned int max_devices    - The most device_index values the device gauges must hold
+ *
+ *  @brief  Allocates the device gauges. Every other metric is static and starts at zero.
+ *
+ *  @author Kerry
+ *
+ *  @return CS_SUCCESS on success, CS_ERROR if the device gauges could not be allocated
+ ************************************************/
+int     csl_MetricsInit(unsigned int max_devices);
+
+/************************************************
+ * void csl_MetricsDestroy()
+ *  @param  - None
+ *
+ *  @brief  Frees the device gauges
+ *
+ *  @author Kerry
+ ************************************************/
+void    csl_MetricsDestroy();
+
+/************************************************
+ * int64_t csl_MetricsNow()
+ *  @param  - None
+ *
+ *  @brief  Returns a monotonic clock in microseconds, for timing what goes into a histogram
+ *
+ *  @author Kerry
+ ************************************************/
+int64_t csl_MetricsNow();
+
+/************************************************
+ * void csl_MetricMessage()
+ *  @param  unsigned int message_type
+ *
+ *  @brief  Counts one received message of the given type
+ *
+ *  @author Kerry
+ ************************************************/
+void    csl_MetricMessage(unsigned int message_type);
+
+/************************************************
+ * void csl_MetricCount()
+ *  @param
+ *          csl_metric_counter  counter
+ *          unsigned long long  amount
+ *
+ *  @brief  Adds amount to a counter
+ *
+ *  @author Kerry
+ ************************************************/
+void    csl_MetricCount(csl_metric_counter counter, unsigned long long amount);
+
+/************************************************
+ * void csl_MetricGaugeSet()
+ *  @param
+ *          csl_metric_gauge    gauge
+ *          long long           value
+ *
+ *  @brief  Sets a gauge
+ *
+ *  @author Kerry
+ ************************************************/
+void    csl_MetricGaugeSet(csl_metric_gauge gauge, long long value);
+
+/************************************************
+ * void csl_MetricDeviceSet()
+ *  @param
+ *          csl_metric_device_gauge gauge
+ *          short                   device_index
+ *          long long               value
+ *
+ *  @brief  Sets one device's gauge
+ *
+ *  @author Kerry
+ ************************************************/
+void    csl_MetricDeviceSet(csl_metric_device_gauge gauge, short device_index, long long value);
+
+/************************************************
+ * void csl_MetricObserve()
+ *  @param
+ *          csl_metric_histogram    histogram
+ *          int64_t                 usecs
+ *
+ *  @brief  Records one latency in a histogram
+ *
+ *  @author Kerry
+ ************************************************/
+void    csl_MetricObserve(csl_metric_histogram histogram, int64_t usecs);
+
+/************************************************
+ * csl_metric_histogram csl_MetricDBStatement()
+ *  @param  const char *query
+ *
+ *  @brief  Returns the histogram for a SQL statement, chosen by its first keyword
+ *
+ *  @author Kerry
+ ************************************************/
+csl_metric_histogram csl_MetricDBStatement(const char *query);
+
+/************************************************
+ * size_t csl_MetricsRender()
+ *  @param
+ *          char    *buffer
+ *          size_t  buffer_size
+ *
+ *  @brief  Writes every metric into buffer in the Prometheus text exposition format
+ *
+ *  @author Kerry
+ *
+ *  @note   Output that does not fit is cut at the last complete line
+ *
+ *  @return The length of the text written
+ ************************************************/
+size_t  csl_MetricsRender(char *buffer, size_t buffer_size);
+
+#endif //CRYTICAMONITOR_CSL_METRICS_H
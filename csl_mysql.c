@@ -26,16 +26,27 @@
  *  @author Kerry
  *
  *  @note   The connection_params is pointer to a struct of parameters for connection
+ *          The connect, read and write timeouts are all db_timeout_sec, so a dead server cannot hang the
+ *          monitor. MySQL's own auto-reconnect is left off - the storage backend reconnects itself.
  *
- *  @return Pointer to a MYSQL connection
+ *  @return Pointer to a MYSQL connection, NULL on failure
  ************************************************/
 MYSQL* csl_ConnectToDB(csl_mysql_connection_params* connection_params)
 {
-    MYSQL *db_connection = NULL;        // The NULL here is essential, as mysql_init looks for, and requires, a NULL value
-    db_connection = mysql_init(db_connection);
-    mysql_options(db_connection, MYSQL_READ_DEFAULT_GROUP, CS_SQL_DEFAULT_GROUP);
-    db_connection = mysql_real_connect(
-            db_connection,
+    MYSQL *db_handle = NULL;            // The NULL here is essential, as mysql_init looks for, and requires, a NULL value
+    db_handle = mysql_init(db_handle);
+    if (db_handle == NULL)
+    {
+        fprintf(stderr, "Failed to initialize a database connection\n");
+        return NULL;
+    }
+    unsigned int timeout_sec = csl_Config()->db_timeout_sec;
+    mysql_options(db_handle, MYSQL_READ_DEFAULT_GROUP, CS_SQL_DEFAULT_GROUP);
+    mysql_options(db_handle, MYSQL_OPT_CONNECT_TIMEOUT, &timeout_sec);
+    mysql_options(db_handle, MYSQL_OPT_READ_TIMEOUT, &timeout_sec);
+    mysql_options(db_handle, MYSQL_OPT_WRITE_TIMEOUT, &timeout_sec);
+    MYSQL *db_connection = mysql_real_connect(
+            db_handle,
             connection_params->dbHost,
             connection_params->dbUser,
             connection_params->dbUserPassword,
@@ -52,7 +63,8 @@ MYSQL* csl_ConnectToDB(csl_mysql_connection_params* connection_params)
     if (db_connection == NULL)
     {
         fprintf(stderr, "Failed to connect to database: Error: %s\n",
-                mysql_error(db_connection));
+                mysql_error(db_handle));
+        mysql_close(db_handle);
         // TODO - Elaborate on this error
     }
 
@@ -155,6 +167,41 @@ MYSQL_RES *csl_QueryDB (MYSQL* db_connection, const char* query)
     return result;
 }
 
+/************************************************
+ * MYSQL_RES csl_StreamQueryDB()
+ *  @param
+ *          MYSQL       *db_connection   - Pointer to the DB
+ *          const char  *query           - Text of the query
+ *
+ *  @brief  Send a query to the DB, leaving its rows on the server to be read one at a time
+ *
+ *  @author Kerry
+ *
+ *  @note   Where csl_QueryDB() (mysql_store_result) copies the whole result into client memory before the first
+ *          row is looked at, this uses mysql_use_result, so only the current row is held. The rows must then
+ *          all be read (or the result freed) before the connection can be used for anything else.
+ *
+ *  @return
+ *          On Success - Pointer to the query result, read with mysql_fetch_row()
+ *          On Failure - NULL
+ ************************************************/
+MYSQL_RES *csl_StreamQueryDB (MYSQL* db_connection, const char* query)
+{
+    if (mysql_query(db_connection, query) != ZERO)
+    {
+        printf("\t<%s> **** ERROR: Bad Database Query ****\n", __PRETTY_FUNCTION__ );
+        printf("     Query: %s\n", query);
+        return NULL;
+    }
+    MYSQL_RES *result = mysql_use_result(db_connection);
+    if (result == NULL)
+    {
+        printf("\t<%s> **** ERROR: result == NULL ****\n", __PRETTY_FUNCTION__ );
+        printf("     Query: %s\n", query);
+    }
+    return result;
+}
+
 #ifndef DEPRECATED
 /************************************************
  * CS_3d_byte_array *csl_ReturnQueryRow()
@@ -255,11 +302,335 @@ bool csl_QueryStoredProcedure (MYSQL* db_connection, int stored_proc_id, cs_head
     return true;    // todo - this is STUB ... we need to fix this SOON!
 }
 
+/************************************************
+ * **********************************************
+ * The MySQL Storage Backend
+ * =========================
+ * The monitor's database in production (see csl_storage.h).
+ *
+ * Connections come from a pool of db_pool_size slots. A thread takes a slot on its first statement and keeps
+ * it until the thread exits, so each thread has its own connection and statements on one connection are never
+ * interleaved. When every slot is taken, a new thread waits up to db_timeout_sec for one to be released.
+ *
+ * A connection that has sat idle for MYSQL_PING_IDLE_SEC is pinged before use, and replaced if the ping fails.
+ * A statement that fails because the server has gone away (CR_SERVER_GONE_ERROR) or was lost mid-statement
+ * (CR_SERVER_LOST) is retried once on a new connection. An update is only retried after
+ * CR_SERVER_GONE_ERROR, since after CR_SERVER_LOST it may already have been applied.
+ * **********************************************
+ ************************************************/
+typedef struct
+{
+    MYSQL           *connection;
+    bool            in_use;
+    time_t          last_used;
+} mysql_pool_slot;
+
+static mysql_pool_slot  *G_mysql_pool           = NULL;
+static unsigned int     G_mysql_pool_size       = 0;
+static pthread_mutex_t  G_mysql_pool_lock       = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t   G_mysql_pool_released   = PTHREAD_COND_INITIALIZER;
+static pthread_key_t    G_mysql_pool_key;                               // releases a thread's slot when it exits
+static __thread mysql_pool_slot *G_mysql_thread_slot;
+
+/************************************************
+ * int mysql_pool_connect()
+ *  @param  mysql_pool_slot *slot
+ *
+ *  @brief  (Re)connects a slot to the monitor's schema
+ *
+ *  @author Kerry
+ *
+ *  @return CS_SUCCESS on success, CS_ERROR_DB_CONNECTION on failure (the slot is left unconnected)
+ ************************************************/
+static int mysql_pool_connect(mysql_pool_slot *slot)
+{
+    if (slot->connection != NULL)
+    {
+        csl_DisconnectFromDB(slot->connection);
+        slot->connection = NULL;
+    }
+
+    csl_mysql_connection_params connect_db_params;
+    connect_db_params.dbHost            = CS_SQL_LOCAL_DB;
+    connect_db_params.dbServer          = CS_SQL_LOCAL_DB;
+    connect_db_params.dbPort            = CS_SQL_DB_PORT;
+    connect_db_params.dbName            = CS_SQL_MONITOR_SCHEMA;
+    connect_db_params.dbUser            = DB_USER;
+    connect_db_params.dbUserPassword    = DB_USER_PWD;
+
+    slot->connection    = csl_ConnectToDB(&connect_db_params);
+    slot->last_used     = time(NULL);
+    return slot->connection == NULL ? CS_ERROR_DB_CONNECTION : CS_SUCCESS;
+}
+
+/************************************************
+ * void mysql_pool_thread_exit()
+ *  @param  void *thread_slot   - The exiting thread's slot
+ *
+ *  @brief  Returns an exiting thread's slot to the pool, its connection still open for the next thread
+ *
+ *  @author Kerry
+ ************************************************/
+static void mysql_pool_thread_exit(void *thread_slot)
+{
+    mysql_pool_slot *slot = thread_slot;
+    pthread_mutex_lock(&G_mysql_pool_lock);
+    slot->in_use = false;
+    pthread_cond_signal(&G_mysql_pool_released);
+    pthread_mutex_unlock(&G_mysql_pool_lock);
+    mysql_thread_end();
+    return;
+}
+
+/************************************************
+ * mysql_pool_slot *mysql_pool_thread_slot()
+ *  @param  - None
+ *
+ *  @brief  The calling thread's slot, taking one from the pool on its first call and health checking it
+ *
+ *  @author Kerry
+ *
+ *  @return The slot, connected, or NULL if no slot or no connection could be had
+ ************************************************/
+static mysql_pool_slot *mysql_pool_thread_slot()
+{
+    mysql_pool_slot *slot = G_mysql_thread_slot;
+    if (slot == NULL)
+    {
+        struct timespec deadline;
+        clock_gettime(CLOCK_REALTIME, &deadline);
+        deadline.tv_sec += csl_Config()->db_timeout_sec;
+
+        pthread_mutex_lock(&G_mysql_pool_lock);
+        while (slot == NULL && G_mysql_pool != NULL)
+        {
+            for (unsigned int slot_ctr = 0; slot_ctr < G_mysql_pool_size; slot_ctr++)
+            {
+                if (G_mysql_pool[slot_ctr].in_use == false)
+                {
+                    slot            = &G_mysql_pool[slot_ctr];
+                    slot->in_use    = true;
+                    break;
+                }
+            }
+            if (slot == NULL && pthread_cond_timedwait(&G_mysql_pool_released, &G_mysql_pool_lock, &deadline) != 0)
+            {
+                break;
+            }
+        }
+        pthread_mutex_unlock(&G_mysql_pool_lock);
+        if (slot == NULL)
+        {
+            printf("\t<%s> ERROR: All [%u] database connections are in use\n", __PRETTY_FUNCTION__, G_mysql_pool_size);
+            return NULL;
+        }
+        mysql_thread_init();
+        pthread_setspecific(G_mysql_pool_key, slot);
+        G_mysql_thread_slot = slot;
+    }
+
+    // **** Health check - an idle connection may have been closed by the server's wait_timeout **** //
+    time_t now = time(NULL);
+    if (slot->connection == NULL)
+    {
+        if (mysql_pool_connect(slot) != CS_SUCCESS)
+        {
+            return NULL;
+        }
+    }
+    else if (now - slot->last_used >= MYSQL_PING_IDLE_SEC && mysql_ping(slot->connection) != ZERO)
+    {
+        printf("\t<%s> Reconnecting to the database\n", __PRETTY_FUNCTION__);
+        csl_MetricCount(METRIC_DB_RECONNECTS, 1);
+        if (mysql_pool_connect(slot) != CS_SUCCESS)
+        {
+            return NULL;
+        }
+    }
+    slot->last_used = now;
+    return slot;
+}
+
+/************************************************
+ * bool mysql_pool_retry()
+ *  @param
+ *          mysql_pool_slot *slot
+ *          bool            lost_is_retried - Whether a statement lost mid-way may be run again
+ *
+ *  @brief  After a failed statement, reconnects the slot if the connection was the cause
+ *
+ *  @author Kerry
+ *
+ *  @return true if the statement should be retried on the new connection
+ ************************************************/
+static bool mysql_pool_retry(mysql_pool_slot *slot, bool lost_is_retried)
+{
+    unsigned int error_number = mysql_errno(slot->connection);
+    if (error_number != CR_SERVER_GONE_ERROR && (error_number != CR_SERVER_LOST || lost_is_retried == false))
+    {
+        return false;
+    }
+    printf("\t<%s> Lost the database connection [%u] - reconnecting\n", __PRETTY_FUNCTION__, error_number);
+    csl_MetricCount(METRIC_DB_RECONNECTS, 1);
+    return mysql_pool_connect(slot) == CS_SUCCESS;
+}
+
+static void mysql_backend_close()
+{
+    pthread_mutex_lock(&G_mysql_pool_lock);
+    for (unsigned int slot_ctr = 0; slot_ctr < G_mysql_pool_size; slot_ctr++)
+    {
+        if (G_mysql_pool[slot_ctr].connection != NULL)
+        {
+            csl_DisconnectFromDB(G_mysql_pool[slot_ctr].connection);
+        }
+    }
+    if (G_mysql_pool != NULL)
+    {
+        pthread_key_delete(G_mysql_pool_key);
+    }
+    free(G_mysql_pool);
+    G_mysql_pool        = NULL;
+    G_mysql_pool_size   = 0;
+    pthread_mutex_unlock(&G_mysql_pool_lock);
+    G_mysql_thread_slot = NULL;
+}
+
+static int mysql_backend_open()
+{
+    G_mysql_pool = calloc(csl_Config()->db_pool_size, sizeof(mysql_pool_slot));
+    if (G_mysql_pool == NULL)
+    {
+        return CS_ERROR_DB_CONNECTION;
+    }
+    G_mysql_pool_size = csl_Config()->db_pool_size;
+    pthread_key_create(&G_mysql_pool_key, mysql_pool_thread_exit);
+
+    // **** Connect the opening thread now, so that a bad database is reported at start-up **** //
+    if (mysql_pool_thread_slot() == NULL)
+    {
+        mysql_backend_close();
+        return CS_ERROR_DB_CONNECTION;
+    }
+    return CS_SUCCESS;
+}
+
+static int mysql_backend_update(const char *statement)
+{
+    mysql_pool_slot *slot = mysql_pool_thread_slot();
+    if (slot == NULL)
+    {
+        return CS_ERROR_DB_CONNECTION;
+    }
+    int return_value = csl_UpdateDB(slot->connection, statement);
+    if (return_value != CS_SUCCESS && mysql_pool_retry(slot, false) == true)
+    {
+        return_value = csl_UpdateDB(slot->connection, statement);
+    }
+    // **** A client error (CR_*) means the statement never reached the server - it may be tried again later, **** //
+    // **** except after CR_SERVER_LOST, when the server may already have run it and a replay would repeat it **** //
+    if (return_value != CS_SUCCESS)
+    {
+        unsigned int error_number = slot->connection == NULL ? CR_SERVER_GONE_ERROR : mysql_errno(slot->connection);
+        if (error_number == CR_SERVER_LOST)
+        {
+            printf("\t<%s> WARNING: Lost the database mid-update - it may or may not have been applied [%s]\n",
+                   __PRETTY_FUNCTION__, statement);
+            return_value = CS_ERROR_DB_UPDATE;
+        }
+        else if (error_number >= CR_MIN_ERROR)
+        {
+            return_value = CS_ERROR_DB_CONNECTION;
+        }
+    }
+    return return_value;
+}
+
+static long long mysql_backend_query(const char *statement, csl_storage_row_function row_function, void *context)
+{
+    mysql_pool_slot *slot = mysql_pool_thread_slot();
+    if (slot == NULL)
+    {
+        return CS_ERROR_DB_CONNECTION;
+    }
+    // A dropped connection is only retried before the first row - after that the caller has seen rows //
+    MYSQL_RES *result = csl_StreamQueryDB(slot->connection, statement);
+    if (result == NULL && mysql_pool_retry(slot, true) == true)
+    {
+        result = csl_StreamQueryDB(slot->connection, statement);
+    }
+    if (result == NULL)
+    {
+        return CS_ERROR_DB_QUERY;
+    }
+
+    unsigned int    column_ctr      = mysql_num_fields(result);
+    long long       return_value    = 0;
+    MYSQL_ROW       row;
+    while ((row = mysql_fetch_row(result)) != NULL)
+    {
+        return_value++;
+        int row_flag = row_function == NULL ? CS_SUCCESS : row_function(context, column_ctr, row);
+        if (row_flag == CS_END_OF_RUN)
+        {
+            return_value--;     // the row was not taken
+            break;
+        }
+        if (row_flag != CS_SUCCESS)
+        {
+            return_value = row_flag;
+            break;
+        }
+    }
+    if (row == NULL && mysql_errno(slot->connection) != ZERO)
+    {
+        printf("\t<%s> **** ERROR: Query failed after [%lld] rows - %s ****\n", __PRETTY_FUNCTION__,
+               return_value, mysql_error(slot->connection));
+        printf("     Query: %s\n", statement);
+        return_value = CS_ERROR_DB_QUERY;
+    }
+    mysql_free_result(result);      // Also reads and discards any rows left when the read was stopped early
+    return return_value;
+}
+
+static int mysql_backend_truncate(const char *schema, const char *table)
+{
+    char statement[SIZE_CS_SQL_COMMAND];
+    snprintf(statement, SIZE_CS_SQL_COMMAND, "Truncate Table %s.%s", schema, table);
+    return mysql_backend_update(statement);
+}
+
+static const csl_storage_backend G_mysql_backend =
+{
+    "MySQL",
+    mysql_backend_open,
+    mysql_backend_close,
+    mysql_backend_update,
+    mysql_backend_query,
+    mysql_backend_truncate
+};
+
+/************************************************
+ * const csl_storage_backend *csl_MySQLBackend()
+ *  @param  - None
+ *
+ *  @brief  The MySQL storage backend, for csl_StorageOpen()
+ *
+ *  @author Kerry
+ *
+ *  @return Pointer to the backend
+ ************************************************/
+const csl_storage_backend *csl_MySQLBackend()
+{
+    return &G_mysql_backend;
+}
+
+#ifndef DEPRECATED
 /************************************************
  * **********************************************
  * Monitor Specific MySQL Functions
  * =======================
- *
+ * Replaced by the csl_StorageRead*() functions, which work on any storage backend
  * **********************************************
  ************************************************/
 
@@ -369,6 +740,7 @@ int csl_alert_sync_and_prune(MYSQL* db_connection, char *view_name, unsigned lon
 
     return return_flag;
 }
+#endif
 
 #ifndef DEPRECATED
 /************************************************
@@ -13,6 +13,7 @@
 #include "csl_constants.h"
 #include "CryticaMonitor.h"
 #include "csl_message.h"
+#include "csl_storage.h"
 
 //#include "mysql/mysql.h"
 //#include "csl_monitorSQ.h"
@@ -26,6 +27,7 @@
 //#define DB_SERVER               "75.140.40.244"
 #define DB_USER                   "crytica"
 #define DB_USER_PWD               "crytica123!"
+#define MYSQL_PING_IDLE_SEC       30        // a pooled connection idle this long is pinged before it is used
 //#define DB_NAME                 "cs_monitor"
 
 #define ACT_AUDIT_LOG           0
@@ -271,6 +273,26 @@ void csl_mysql_free_result(MYSQL_RES *result);
  ************************************************/
 MYSQL_RES *csl_QueryDB (MYSQL* db_connection, const char* query);
 
+/************************************************
+ * MYSQL_RES csl_StreamQueryDB()
+ *  @param
+ *          MYSQL       *db_connection   - Pointer to the DB
+ *          const char  *query           - Text of the query
+ *
+ *  @brief  Send a query to the DB, leaving its rows on the server to be read one at a time
+ *
+ *  @author Kerry
+ *
+ *  @note   Where csl_QueryDB() (mysql_store_result) copies the whole result into client memory before the first
+ *          row is looked at, this uses mysql_use_result, so only the current row is held. The rows must then
+ *          all be read (or the result freed) before the connection can be used for anything else.
+ *
+ *  @return
+ *          On Success - Pointer to the query result, read with mysql_fetch_row()
+ *          On Failure - NULL
+ ************************************************/
+MYSQL_RES *csl_StreamQueryDB (MYSQL* db_connection, const char* query);
+
 /************************************************
  * bool csl_QueryStoredProcedure () - Query the database using stored procedures
  *  @param
@@ -325,11 +347,24 @@ CS_3d_byte_array *csl_ReturnQueryRow(MYSQL *db_connection, MYSQL_RES *result);
  ************************************************/
 int csl_UpdateDB (MYSQL* db_connection, const char* query);
 
+/************************************************
+ * const csl_storage_backend *csl_MySQLBackend()
+ *  @param  - None
+ *
+ *  @brief  The MySQL storage backend, for csl_StorageOpen()
+ *
+ *  @author Kerry
+ *
+ *  @return Pointer to the backend
+ ************************************************/
+const csl_storage_backend *csl_MySQLBackend();
+
+#ifndef DEPRECATED
 /************************************************
  * **********************************************
  * Monitor Specific MySQL Functions
  * =======================
- *
+ * Replaced by the csl_StorageRead*() functions, which work on any storage backend
  * **********************************************
  ************************************************/
 
@@ -342,6 +377,7 @@ cs_standard_record *csl_ReturnStandardRow(MYSQL *db_connection, MYSQL_RES *resul
 char *csl_ReturnElementName(MYSQL *db_connection, MYSQL_RES *result);
 
 int csl_alert_sync_and_prune(MYSQL* db_connection, char *view_name, unsigned long long device_id);
+#endif
 
 /************************************************
  * **********************************************
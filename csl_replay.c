@@ -0,0 +1,359 @@
+//
+// Created by kerry on 10/19/26.
+//
+
+/************************************************
+ * csl_replay
+ * ==========
+ * Sends the probe frames in a capture file (see csl_capture.h) back at a running monitor, the way the probes
+ * sent them: control frames as requests on the responder, each waiting for its reply, and scan frames pushed to
+ * the scan endpoint they were captured on. Both are encrypted with CurveZMQ like a real probe.
+ *
+ *      csl_replay -f capture_file -b port_base [-H host] [-k monitor.pub] [-x speed | -m rate] [-n loops]
+ *
+ *          -f  The capture file
+ *          -b  The monitor's port base - the last octet of its internal IP address * 1000
+ *          -H  The monitor's host, 127.0.0.1 by default
+ *          -k  The monitor's public key file, MONITOR_PUB_KEY_FILE_NAME by default
+ *          -x  Replay at this multiple of the recorded speed (1 by default, 0 for as fast as possible)
+ *          -m  Replay at this many frames per second instead, whatever the recorded timing
+ *          -n  Replay the capture this many times
+ *
+ * When it is done it prints the frames and bytes sent per lane, the throughput, and the latency of the
+ * control requests (from sending the request to receiving the monitor's reply).
+ *
+ * The monitor must already know the captured devices, so replay against a monitor using the database the
+ * capture was made with (or a copy of it).
+ ************************************************/
+
+#include <getopt.h>
+#include "csl_message.h"
+#include "csl_capture.h"
+#include "csl_client.h"
+
+#define REPLAY_DEFAULT_HOST         "127.0.0.1"
+#define REPLAY_REPLY_TIMEOUT_MSEC   5000
+#define REPLAY_LINGER_MSEC          10000       // How long queued scan frames may take to go out at the end
+#define REPLAY_LATENCY_INITIAL      4096
+
+/************************************************
+ * The Replay
+ * ==========
+ * One REQ socket for the control lane, and one PUSH socket per scan endpoint, each connected the first time
+ * a frame for it is replayed.
+ ************************************************/
+typedef struct
+{
+    char                host[HOST_NAME_MAX + 1];
+    int                 port_base;
+    const char          *server_key;
+    zcert_t             *client_cert;
+    zsock_t             *requester;
+    zsock_t             *pushers[CONFIG_MAX_SCAN_RECEIVERS];
+    unsigned long long  frame_ctr[CAPTURE_LANE_SCAN + 1];
+    unsigned long long  byte_ctr[CAPTURE_LANE_SCAN + 1];
+    unsigned long long  reply_timeout_ctr;
+    int64_t             *latencies;             // usecs, one per control request answered
+    size_t              latency_ctr;
+    size_t              latency_size;
+} replay_state;
+
+/************************************************
+ * zsock_t *replay_socket()
+ *  @param
+ *          replay_state    *replay
+ *          int             type        - ZMQ_REQ or ZMQ_PUSH
+ *          int             port
+ *
+ *  @brief  Connects a client socket with the tool's timeouts (csl_client.h)
+ *
+ *  @author Kerry
+ *
+ *  @return The socket, or NULL
+ ************************************************/
+static zsock_t *replay_socket(replay_state *replay, int type, int port)
+{
+    return csl_ClientSocket(type, replay->host, port, replay->client_cert, replay->server_key,
+                            REPLAY_REPLY_TIMEOUT_MSEC, REPLAY_LINGER_MSEC);
+}
+
+/************************************************
+ * int replay_control()
+ *  @param
+ *          replay_state    *replay
+ *          byte            *data
+ *          uint32_t        size
+ *
+ *  @brief  Sends one control frame and waits for the monitor's reply, recording how long it took
+ *
+ *  @author Kerry
+ *
+ *  @return CS_SUCCESS on success, CS_ERROR if the monitor could not be reached
+ ************************************************/
+static int replay_control(replay_state *replay, byte *data, uint32_t size)
+{
+    if (replay->requester == NULL)
+    {
+        replay->requester = replay_socket(replay, ZMQ_REQ, replay->port_base + RESPONDER_PORT);
+        if (replay->requester == NULL)
+        {
+            return CS_ERROR;
+        }
+    }
+
+    int64_t sent_usecs = zclock_usecs();
+    if (zmq_send(zsock_resolve(replay->requester), data, size, 0) == -1)
+    {
+        return CS_ERROR;
+    }
+    zmq_msg_t reply;
+    zmq_msg_init(&reply);
+    if (zmq_msg_recv(&reply, zsock_resolve(replay->requester), 0) == -1)
+    {
+        // A REQ socket that missed its reply can not send again, so start over with a new one
+        zmq_msg_close(&reply);
+        zsock_destroy(&replay->requester);
+        replay->reply_timeout_ctr++;
+        return CS_SUCCESS;
+    }
+    zmq_msg_close(&reply);
+
+    if (replay->latency_ctr == replay->latency_size)
+    {
+        size_t  new_size        = replay->latency_size == 0 ? REPLAY_LATENCY_INITIAL : replay->latency_size * 2;
+        int64_t *new_latencies  = realloc(replay->latencies, new_size * sizeof(int64_t));
+        if (new_latencies == NULL)
+        {
+            return CS_SUCCESS;      // Keep replaying - only this latency is lost
+        }
+        replay->latencies       = new_latencies;
+        replay->latency_size    = new_size;
+    }
+    replay->latencies[replay->latency_ctr++] = zclock_usecs() - sent_usecs;
+    return CS_SUCCESS;
+}
+
+/************************************************
+ * int replay_scan()
+ *  @param
+ *          replay_state    *replay
+ *          uint8_t         receiver    - The scan endpoint the frame was captured on
+ *          byte            *data
+ *          uint32_t        size
+ *
+ *  @brief  Pushes one scan frame to the scan endpoint it was captured on
+ *
+ *  @author Kerry
+ *
+ *  @return CS_SUCCESS on success, CS_ERROR if the monitor could not be reached
+ ************************************************/
+static int replay_scan(replay_state *replay, uint8_t receiver, byte *data, uint32_t size)
+{
+    if (receiver >= CONFIG_MAX_SCAN_RECEIVERS)
+    {
+        return CS_ERROR;
+    }
+    if (replay->pushers[receiver] == NULL)
+    {
+        int port = replay->port_base + SCAN_PORT + receiver * SCAN_RECEIVER_PORT_STRIDE;
+        replay->pushers[receiver] = replay_socket(replay, ZMQ_PUSH, port);
+        if (replay->pushers[receiver] == NULL)
+        {
+            return CS_ERROR;
+        }
+    }
+    return zmq_send(zsock_resolve(replay->pushers[receiver]), data, size, 0) == -1 ? CS_ERROR : CS_SUCCESS;
+}
+
+/************************************************
+ * int replay_latency_compare()
+ *  @param
+ *          const void *left
+ *          const void *right
+ *
+ *  @brief  qsort() comparison for the control latencies
+ *
+ *  @author Kerry
+ ************************************************/
+static int replay_latency_compare(const void *left, const void *right)
+{
+    int64_t left_usecs  = *(const int64_t *) left;
+    int64_t right_usecs = *(const int64_t *) right;
+    return (left_usecs > right_usecs) - (left_usecs < right_usecs);
+}
+
+/************************************************
+ * void replay_report()
+ *  @param
+ *          replay_state    *replay
+ *          int64_t         elapsed_usecs
+ *
+ *  @brief  Prints what was sent, the throughput and the control latencies
+ *
+ *  @author Kerry
+ ************************************************/
+static void replay_report(replay_state *replay, int64_t elapsed_usecs)
+{
+    double elapsed_secs = elapsed_usecs > 0 ? (double) elapsed_usecs / 1000000.0 : 1.0;
+    char *lane_names[CAPTURE_LANE_SCAN + 1] = {"control", "scan"};
+
+    printf("\n\tReplayed in %.3f seconds\n", elapsed_secs);
+    for (int lane = CAPTURE_LANE_CONTROL; lane <= CAPTURE_LANE_SCAN; lane++)
+    {
+        printf("\t\t%-8s %12llu frames %14llu bytes %12.1f frames/sec %10.3f MB/sec\n",
+               lane_names[lane], replay->frame_ctr[lane], replay->byte_ctr[lane],
+               (double) replay->frame_ctr[lane] / elapsed_secs,
+               (double) replay->byte_ctr[lane] / elapsed_secs / (1024.0 * 1024.0));
+    }
+
+    if (replay->latency_ctr > 0)
+    {
+        qsort(replay->latencies, replay->latency_ctr, sizeof(int64_t), replay_latency_compare);
+        size_t last = replay->latency_ctr - 1;
+        printf("\t\tcontrol latency usecs: min %lld  p50 %lld  p90 %lld  p99 %lld  max %lld\n",
+               (long long) replay->latencies[0],
+               (long long) replay->latencies[last * 50 / 100],
+               (long long) replay->latencies[last * 90 / 100],
+               (long long) replay->latencies[last * 99 / 100],
+               (long long) replay->latencies[last]);
+    }
+    if (replay->reply_timeout_ctr > 0)
+    {
+        printf("\t\t[%llu] control requests got no reply within %d msec\n",
+               replay->reply_timeout_ctr, REPLAY_REPLY_TIMEOUT_MSEC);
+    }
+}
+
+/************************************************
+ * void replay_usage()
+ *  @param  const char *program_name
+ *
+ *  @brief  Prints the command line
+ *
+ *  @author Kerry
+ ************************************************/
+static void replay_usage(const char *program_name)
+{
+    printf("Usage: %s -f capture_file -b port_base [-H host] [-k monitor.pub] [-x speed | -m rate] [-n loops]\n",
+           program_name);
+}
+
+int main(int argc, char *argv[])
+{
+    replay_state    replay;
+    const char      *capture_file_name  = NULL;
+    const char      *key_file_name      = MONITOR_PUB_KEY_FILE_NAME;
+    double          speed               = 1.0;
+    double          rate                = 0.0;
+    long            loops               = 1;
+
+    memset(&replay, 0, sizeof(replay_state));
+    snprintf(replay.host, sizeof(replay.host), "%s", REPLAY_DEFAULT_HOST);
+
+    int option;
+    while ((option = getopt(argc, argv, "f:b:H:k:x:m:n:")) != -1)
+    {
+        switch (option)
+        {
+            case 'f':   capture_file_name   = optarg;                                       break;
+            case 'b':   replay.port_base    = atoi(optarg);                                 break;
+            case 'H':   snprintf(replay.host, sizeof(replay.host), "%s", optarg);           break;
+            case 'k':   key_file_name       = optarg;                                       break;
+            case 'x':   speed               = atof(optarg);                                 break;
+            case 'm':   rate                = atof(optarg);                                 break;
+            case 'n':   loops               = atol(optarg);                                 break;
+            default:
+                replay_usage(argv[0]);
+                return CS_ERROR;
+        }
+    }
+    if (capture_file_name == NULL || replay.port_base <= 0 || speed < 0.0 || rate < 0.0 || loops < 1)
+    {
+        replay_usage(argv[0]);
+        return CS_ERROR;
+    }
+
+    zsys_init();
+    zcert_t *server_cert = zcert_load(key_file_name);
+    if (server_cert == NULL)
+    {
+        printf("\t<%s> ERROR: Could not load the monitor's public key from [%s]\n", __PRETTY_FUNCTION__, key_file_name);
+        return CS_ERROR;
+    }
+    replay.server_key   = zcert_public_txt(server_cert);
+    replay.client_cert  = zcert_new();
+
+    byte *buffer = malloc(CAPTURE_MAX_FRAME);
+    if (buffer == NULL)
+    {
+        return CS_ERROR;
+    }
+
+    int     return_value    = CS_SUCCESS;
+    int64_t start_usecs     = zclock_usecs();
+    unsigned long long replayed_ctr = 0;
+    for (long loop = 0; loop < loops && return_value == CS_SUCCESS && ! zsys_interrupted; loop++)
+    {
+        FILE *capture_file = csl_CaptureReadOpen(capture_file_name);
+        if (capture_file == NULL)
+        {
+            return_value = CS_ERROR;
+            break;
+        }
+
+        int64_t             loop_start_usecs = zclock_usecs();
+        csl_capture_frame   frame;
+        int                 read_status;
+        while ((read_status = csl_CaptureReadFrame(capture_file, &frame, buffer)) == CS_SUCCESS && ! zsys_interrupted)
+        {
+            // Wait until the frame is due - at the fixed rate, or at its recorded time scaled by the speed
+            int64_t due_usecs = start_usecs;
+            if (rate > 0.0)
+            {
+                due_usecs += (int64_t) ((double) replayed_ctr * 1000000.0 / rate);
+            }
+            else if (speed > 0.0)
+            {
+                due_usecs = loop_start_usecs + (int64_t) ((double) frame.usecs / speed);
+            }
+            int64_t wait_usecs = due_usecs - zclock_usecs();
+            if (wait_usecs > 0)
+            {
+                usleep((useconds_t) wait_usecs);
+            }
+
+            return_value = frame.lane == CAPTURE_LANE_CONTROL ?
+                           replay_control(&replay, buffer, frame.size) :
+                           replay_scan(&replay, frame.receiver, buffer, frame.size);
+            if (return_value != CS_SUCCESS)
+            {
+                printf("\t<%s> ERROR: Could not send to the monitor\n", __PRETTY_FUNCTION__);
+                break;
+            }
+            replay.frame_ctr[frame.lane]++;
+            replay.byte_ctr[frame.lane] += frame.size;
+            replayed_ctr++;
+        }
+        if (read_status == CS_ERROR)
+        {
+            printf("\t<%s> ERROR: [%s] is corrupt after [%llu] frames\n",
+                   __PRETTY_FUNCTION__, capture_file_name, replayed_ctr);
+            return_value = CS_ERROR;
+        }
+        fclose(capture_file);
+    }
+
+    // Destroying the pushers waits (up to REPLAY_LINGER_MSEC) for the queued scan frames to go out
+    zsock_destroy(&replay.requester);
+    for (int i = 0; i < CONFIG_MAX_SCAN_RECEIVERS; i++)
+    {
+        zsock_destroy(&replay.pushers[i]);
+    }
+    replay_report(&replay, zclock_usecs() - start_usecs);
+
+    free(replay.latencies);
+    free(buffer);
+    zcert_destroy(&replay.client_cert);
+    zcert_destroy(&server_cert);
+    return return_value;
+}
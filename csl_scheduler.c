@@ -0,0 +1,265 @@
+//
+// Created by kerry on 10/19/26.
+//
+
+#include "csl_scheduler.h"
+
+/************************************************
+ * The Scan Schedule
+ * =================
+ * G_schedule is indexed by device_index. The scan start rate limit is a token bucket holding at most
+ * one minute's worth of scan starts.
+ ************************************************/
+static csl_schedule_entry   *G_schedule;
+static unsigned int         G_schedule_capacity;
+static double               G_start_tokens;
+static time_t               G_start_tokens_refilled;
+static pthread_mutex_t      G_schedule_lock = PTHREAD_MUTEX_INITIALIZER;
+
+/************************************************
+ * time_t schedule_jitter()
+ *  @param  time_t range    - in seconds
+ *
+ *  @brief  Returns a random number of seconds in [0, range)
+ *
+ *  @author Kerry
+ ************************************************/
+static time_t schedule_jitter(time_t range)
+{
+    if (range <= 0)
+    {
+        return 0;
+    }
+    return (time_t) (random() % range);
+}
+
+/************************************************
+ * time_t schedule_next_due()
+ *  @param  time_t now
+ *
+ *  @brief  Returns when the next scan is due: scan_interval_sec from now, give or take scan_jitter_pct percent
+ *
+ *  @author Kerry
+ ************************************************/
+static time_t schedule_next_due(time_t now)
+{
+    const csl_monitor_config *config = csl_Config();
+    time_t interval = (time_t) config->scan_interval_sec;
+    time_t spread   = interval * (time_t) config->scan_jitter_pct / 100;
+    return now + interval - spread + schedule_jitter(2 * spread + 1);
+}
+
+/************************************************
+ * bool schedule_start_token_take()
+ *  @param  time_t now
+ *
+ *  @brief  Takes one scan start from the rate limit's token bucket
+ *
+ *  @author Kerry
+ *
+ *  @return true if a start was available (or there is no limit), false otherwise
+ ************************************************/
+static bool schedule_start_token_take(time_t now)
+{
+    unsigned int per_minute = csl_Config()->scan_starts_per_minute;
+    if (per_minute == 0)
+    {
+        return true;
+    }
+
+    G_start_tokens += (double) (now - G_start_tokens_refilled) * per_minute / 60.0;
+    if (G_start_tokens > per_minute)
+    {
+        G_start_tokens = per_minute;
+    }
+    G_start_tokens_refilled = now;
+
+    if (G_start_tokens < 1.0)
+    {
+        return false;
+    }
+    G_start_tokens -= 1.0;
+    return true;
+}
+
+/************************************************
+ * int csl_SchedulerInit()
+ *  @param  unsigned int max_devices    - The most device_index values the schedule must hold
+ *
+ *  @brief  Allocates an empty schedule
+ *
+ *  @author Kerry
+ *
+ *  @return CS_SUCCESS on success, CS_ERROR if the schedule could not be allocated
+ ************************************************/
+int     csl_SchedulerInit(unsigned int max_devices)
+{
+    pthread_mutex_lock(&G_schedule_lock);
+    free(G_schedule);
+    G_schedule              = calloc(max_devices, sizeof(csl_schedule_entry));
+    G_schedule_capacity     = G_schedule == NULL ? 0 : max_devices;
+    G_start_tokens          = 1.0;
+    G_start_tokens_refilled = time(NULL);
+    srandom((unsigned int) (G_start_tokens_refilled ^ getpid()));
+    pthread_mutex_unlock(&G_schedule_lock);
+
+    if (G_schedule == NULL)
+    {
+        printf("\t<%s> ERROR: Could not allocate the scan schedule for [%u] devices\n", __PRETTY_FUNCTION__, max_devices);
+        return CS_ERROR;
+    }
+    return CS_SUCCESS;
+}
+
+/************************************************
+ * void csl_SchedulerDestroy()
+ *  @param  - None
+ *
+ *  @brief  Frees the schedule
+ *
+ *  @author Kerry
+ ************************************************/
+void    csl_SchedulerDestroy()
+{
+    pthread_mutex_lock(&G_schedule_lock);
+    free(G_schedule);
+    G_schedule          = NULL;
+    G_schedule_capacity = 0;
+    pthread_mutex_unlock(&G_schedule_lock);
+}
+
+/************************************************
+ * void csl_SchedulerDeviceAdd()
+ *  @param  short device_index
+ *
+ *  @brief  Starts scheduling a device. Its first scan is due at a random point within scan_startup_spread_sec
+ *
+ *  @author Kerry
+ ************************************************/
+void    csl_SchedulerDeviceAdd(short device_index)
+{
+    pthread_mutex_lock(&G_schedule_lock);
+    if (device_index >= 0 && (unsigned int) device_index < G_schedule_capacity)
+    {
+        time_t now                  = time(NULL);
+        csl_schedule_entry *entry   = &G_schedule[device_index];
+        entry->in_use               = true;
+        entry->scanning             = false;
+        entry->last_scan            = 0;
+        entry->last_heard           = 0;
+        entry->next_due             = now + schedule_jitter((time_t) csl_Config()->scan_startup_spread_sec + 1);
+    }
+    pthread_mutex_unlock(&G_schedule_lock);
+}
+
+/************************************************
+ * void csl_SchedulerDeviceRemove()
+ *  @param  short device_index
+ *
+ *  @brief  Stops scheduling a device
+ *
+ *  @author Kerry
+ ************************************************/
+void    csl_SchedulerDeviceRemove(short device_index)
+{
+    pthread_mutex_lock(&G_schedule_lock);
+    if (device_index >= 0 && (unsigned int) device_index < G_schedule_capacity)
+    {
+        memset(&G_schedule[device_index], 0, sizeof(csl_schedule_entry));
+    }
+    pthread_mutex_unlock(&G_schedule_lock);
+}
+
+/************************************************
+ * bool csl_SchedulerScanStart()
+ *  @param
+ *          short           device_index    - The device that has just heartbeat
+ *          unsigned int    free_slots      - How many more scans the monitor can follow right now
+ *
+ *  @brief  Decides whether a device should start a scan now
+ *
+ *  @author Kerry
+ *
+ *  @note   This is called on every heartbeat, which is also how the scheduler knows a device is alive.
+ *          The device starts only if it is due, it is among the free_slots live due devices with the
+ *          oldest last scans, and the fleet's scan start rate allows it.
+ *
+ *  @return true if the device should scan (it is then marked as scanning), false if it should wait
+ ************************************************/
+bool    csl_SchedulerScanStart(short device_index, unsigned int free_slots)
+{
+    bool return_flag = false;
+
+    pthread_mutex_lock(&G_schedule_lock);
+    if (device_index < 0 || (unsigned int) device_index >= G_schedule_capacity || !G_schedule[device_index].in_use)
+    {
+        pthread_mutex_unlock(&G_schedule_lock);
+        return false;
+    }
+
+    time_t now                  = time(NULL);
+    csl_schedule_entry *entry   = &G_schedule[device_index];
+    entry->last_heard           = now;
+
+    if (free_slots > 0 && entry->scanning == false && entry->next_due <= now)
+    {
+        // Count the live, due devices that have waited longer than this one
+        unsigned int ahead = 0;
+        for (unsigned int i = 0; i < G_schedule_capacity && ahead < free_slots; i++)
+        {
+            csl_schedule_entry *other = &G_schedule[i];
+            if (i == (unsigned int) device_index || !other->in_use || other->scanning ||
+                other->next_due > now || now - other->last_heard > SCHEDULER_ALIVE_SECONDS)
+            {
+                continue;
+            }
+            if (other->last_scan < entry->last_scan ||
+                (other->last_scan == entry->last_scan && i < (unsigned int) device_index))
+            {
+                ahead++;
+            }
+        }
+
+        if (ahead < free_slots && schedule_start_token_take(now))
+        {
+            entry->scanning = true;
+            return_flag     = true;
+        }
+    }
+    pthread_mutex_unlock(&G_schedule_lock);
+    return return_flag;
+}
+
+/************************************************
+ * void csl_SchedulerScanDone()
+ *  @param
+ *          short   device_index
+ *          bool    scanned         - true if the scan was received and evaluated
+ *
+ *  @brief  Ends a device's scan and sets when the next one is due
+ *
+ *  @author Kerry
+ *
+ *  @note   A failed or abandoned scan does not update last_scan, so the device keeps its priority,
+ *          and it is retried within scan_startup_spread_sec rather than a whole interval later
+ ************************************************/
+void    csl_SchedulerScanDone(short device_index, bool scanned)
+{
+    pthread_mutex_lock(&G_schedule_lock);
+    if (device_index >= 0 && (unsigned int) device_index < G_schedule_capacity && G_schedule[device_index].in_use)
+    {
+        time_t now                  = time(NULL);
+        csl_schedule_entry *entry   = &G_schedule[device_index];
+        entry->scanning             = false;
+        if (scanned == true)
+        {
+            entry->last_scan        = now;
+            entry->next_due         = schedule_next_due(now);
+        }
+        else
+        {
+            entry->next_due         = now + schedule_jitter((time_t) csl_Config()->scan_startup_spread_sec + 1);
+        }
+    }
+    pthread_mutex_unlock(&G_schedule_lock);
+}
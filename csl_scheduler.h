@@ -0,0 +1,135 @@
+
+/************************************************
+ * csl_scheduler.h
+ * ===============
+ *
+ * This is the header file for the CS Scan Scheduler Library
+ *
+ * Author:      Kerry
+ * Version:     00.00.00
+ * Comments:    Decides when each device scans, so the fleet's scan load on the monitor and its DB stays smooth
+ ************************************************/
+
+#ifndef CRYTICAMONITOR_CSL_SCHEDULER_H
+#define CRYTICAMONITOR_CSL_SCHEDULER_H
+
+#include <stdio.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <pthread.h>
+
+#include "csl_constants.h"
+#include "csl_config.h"
+
+/************************************************
+ * #defines
+ * ========
+ ************************************************/
+#define SCHEDULER_ALIVE_SECONDS     15      // A device not heard from for this long is not competing for a scan
+
+/************************************************
+ * Scan Schedule
+ * =============
+ * One entry per device_index. A device is "due" once next_due has passed. Among the live devices that are due,
+ * the one with the oldest last_scan goes first.
+ *
+ *  - After a scan the next one is set scan_interval_sec away, moved by up to scan_jitter_pct percent
+ *    either way so that devices scanned together drift apart.
+ *  - A newly added device (including every device at start-up) is first due at a random point within
+ *    scan_startup_spread_sec, so a monitor restart does not make the whole fleet rescan at once.
+ *  - Scan starts are rate limited to scan_starts_per_minute across the fleet (0 for no limit).
+ ************************************************/
+typedef struct
+{
+    bool        in_use;
+    bool        scanning;
+    time_t      next_due;
+    time_t      last_scan;
+    time_t      last_heard;
+} csl_schedule_entry;
+
+/************************************************
+ * **********************************************
+ * Function Prototypes
+ * **********************************************
+ ************************************************/
+
+/************************************************
+ * int csl_SchedulerInit()
+ *  @param  unsigned int max_devices    - The most device_index values the schedule must hold
+ *
+ *  @brief  Allocates an empty schedule
+ *
+ *  @author Kerry
+ *
+ *  @return CS_SUCCESS on success, CS_ERROR if the schedule could not be allocated
+ ************************************************/
+int     csl_SchedulerInit(unsigned int max_devices);
+
+/************************************************
+ * void csl_SchedulerDestroy()
+ *  @param  - None
+ *
+ *  @brief  Frees the schedule
+ *
+ *  @author Kerry
+ ************************************************/
+void    csl_SchedulerDestroy();
+
+/************************************************
+ * void csl_SchedulerDeviceAdd()
+ *  @param  short device_index
+ *
+ *  @brief  Starts scheduling a device. Its first scan is due at a random point within scan_startup_spread_sec
+ *
+ *  @author Kerry
+ ************************************************/
+void    csl_SchedulerDeviceAdd(short device_index);
+
+/************************************************
+ * void csl_SchedulerDeviceRemove()
+ *  @param  short device_index
+ *
+ *  @brief  Stops scheduling a device
+ *
+ *  @author Kerry
+ ************************************************/
+void    csl_SchedulerDeviceRemove(short device_index);
+
+/************************************************
+ * bool csl_SchedulerScanStart()
+ *  @param
+ *          short           device_index    - The device that has just heartbeat
+ *          unsigned int    free_slots      - How many more scans the monitor can follow right now
+ *
+ *  @brief  Decides whether a device should start a scan now
+ *
+ *  @author Kerry
+ *
+ *  @note   This is called on every heartbeat, which is also how the scheduler knows a device is alive.
+ *          The device starts only if it is due, it is among the free_slots live due devices with the
+ *          oldest last scans, and the fleet's scan start rate allows it.
+ *
+ *  @return true if the device should scan (it is then marked as scanning), false if it should wait
+ ************************************************/
+bool    csl_SchedulerScanStart(short device_index, unsigned int free_slots);
+
+/************************************************
+ * void csl_SchedulerScanDone()
+ *  @param
+ *          short   device_index
+ *          bool    scanned         - true if the scan was received and evaluated
+ *
+ *  @brief  Ends a device's scan and sets when the next one is due
+ *
+ *  @author Kerry
+ *
+ *  @note   A failed or abandoned scan does not update last_scan, so the device keeps its priority,
+ *          and it is retried within scan_startup_spread_sec rather than a whole interval later
+ ************************************************/
+void    csl_SchedulerScanDone(short device_index, bool scanned);
+
+#endif //CRYTICAMONITOR_CSL_SCHEDULER_H
@@ -0,0 +1,705 @@
+//
+// Created by kerry on 10/19/26.
+//
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/uio.h>
+
+#include "csl_spool.h"
+#include "csl_config.h"
+#include "csl_metrics.h"
+
+#define SIZE_SPOOL_FILE_NAME    256
+
+/************************************************
+ * The Spool File
+ * ==============
+ * G_spool_file is -1 unless the spool is open. The scan threads append under the lock, and the drain thread
+ * takes the records between G_spool_drain_offset and G_spool_write_end, running them without the lock.
+ *
+ * A writer waits for its record to be synced before it returns (group commit): the first writer to find no sync
+ * running syncs every record appended so far, and the writers that append meanwhile wait on G_spool_synced for
+ * the next. G_spool_synced_sequence is the last record a sync has covered, G_spool_durable_sequence the last one
+ * a sync succeeded for - they part only once a sync fails, after which nothing more is spooled.
+ ************************************************/
+static int                  G_spool_file            = -1;
+static int                  G_spool_ledger          = -1;
+static off_t                G_spool_write_end;          // the end of the last whole record appended
+static off_t                G_spool_drain_offset;       // the first record not yet run
+static uint64_t             G_spool_sequence;           // the next record's
+static uint64_t             G_spool_ledger_sequence;    // the last record run (the drain thread's own copy)
+static uint64_t             G_spool_run_sequence;       // the last record run, for csl_SpoolWait()
+static uint64_t             G_spool_synced_sequence;    // the last record a sync covered
+static uint64_t             G_spool_durable_sequence;   // the last record a sync succeeded for
+static bool                 G_spool_syncing;
+static bool                 G_spool_sync_failed;
+static unsigned long long   G_spool_pending;
+static bool                 G_spool_stopping;
+static pthread_t            G_spool_drain_thread;
+static pthread_mutex_t      G_spool_lock            = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t       G_spool_wake            = PTHREAD_COND_INITIALIZER;
+static pthread_cond_t       G_spool_synced          = PTHREAD_COND_INITIALIZER;
+static pthread_cond_t       G_spool_ran             = PTHREAD_COND_INITIALIZER;
+
+/************************************************
+ * uint32_t spool_checksum()
+ *  @param
+ *          const char  *data
+ *          size_t      size
+ *
+ *  @brief  FNV-1a - enough to tell a torn record from a whole one
+ *
+ *  @author Kerry
+ ************************************************/
+static uint32_t spool_checksum(const char *data, size_t size)
+{
+    uint32_t checksum = 2166136261u;
+    for (size_t byte_ctr = 0; byte_ctr < size; byte_ctr++)
+    {
+        checksum ^= (unsigned char) data[byte_ctr];
+        checksum *= 16777619u;
+    }
+    return checksum;
+}
+
+/************************************************
+ * int spool_read_record()
+ *  @param
+ *          int                 spool_file
+ *          off_t               offset
+ *          csl_spool_record    *record
+ *          char                *payload    - At least SPOOL_MAX_RECORD bytes
+ *
+ *  @brief  Reads and checks the record at offset
+ *
+ *  @author Kerry
+ *
+ *  @return CS_SUCCESS with the record in record and payload, CS_END_OF_RUN at the end of the file (or at a
+ *          partial record), CS_ERROR if the record is corrupt
+ ************************************************/
+static int spool_read_record(int spool_file, off_t offset, csl_spool_record *record, char *payload)
+{
+    if (pread(spool_file, record, sizeof(csl_spool_record), offset) != (ssize_t) sizeof(csl_spool_record))
+    {
+        return CS_END_OF_RUN;
+    }
+    if (record->magic != SPOOL_RECORD_MAGIC || record->size == 0 || record->size > SPOOL_MAX_RECORD ||
+        (record->type != SPOOL_UPDATE && record->type != SPOOL_TRUNCATE))
+    {
+        return CS_ERROR;
+    }
+    if (pread(spool_file, payload, record->size, offset + (off_t) sizeof(csl_spool_record)) != (ssize_t) record->size)
+    {
+        return CS_END_OF_RUN;
+    }
+    if (spool_checksum(payload, record->size) != record->checksum || payload[record->size - 1] != NULL_BINARY)
+    {
+        return CS_ERROR;
+    }
+    return CS_SUCCESS;
+}
+
+/************************************************
+ * int spool_append()
+ *  @param
+ *          uint32_t    type        - SPOOL_UPDATE or SPOOL_TRUNCATE
+ *          const char  *payload
+ *          size_t      size
+ *
+ *  @brief  Appends a record, waking the drain thread if the spool was empty, and waits for it to be synced
+ *
+ *  @author Kerry
+ *
+ *  @note   One sync covers every record appended while the last one ran (see The Spool File)
+ *
+ *  @return CS_SUCCESS once spooled and synced, CS_ERROR if not spooled (the spool is closed, or the disk is full),
+ *          CS_FATAL_ERROR if spooled but the sync failed - the record will still be run, but may not survive a crash
+ ************************************************/
+static int spool_append(uint32_t type, const char *payload, size_t size)
+{
+    if (size > SPOOL_MAX_RECORD)
+    {
+        printf("\t<%s> ERROR: [%zu] bytes is too large to spool\n", __PRETTY_FUNCTION__, size);
+        return CS_ERROR;
+    }
+
+    pthread_mutex_lock(&G_spool_lock);
+    if (G_spool_file < 0 || G_spool_sync_failed == true)
+    {
+        pthread_mutex_unlock(&G_spool_lock);
+        return CS_ERROR;
+    }
+
+    csl_spool_record record = {SPOOL_RECORD_MAGIC, (uint32_t) size, G_spool_sequence, type,
+                               spool_checksum(payload, size)};
+    struct iovec parts[2] = {{&record, sizeof(csl_spool_record)}, {(void *) payload, size}};
+    ssize_t written = writev(G_spool_file, parts, 2);
+    if (written != (ssize_t) (sizeof(csl_spool_record) + size))
+    {
+        // Drop whatever part of the record did get written, so that the next one follows a whole record //
+        if (written > 0 && ftruncate(G_spool_file, G_spool_write_end) != 0)
+        {
+            printf("\t<%s> ERROR: Could not drop a partial record\n", __PRETTY_FUNCTION__);
+        }
+        pthread_mutex_unlock(&G_spool_lock);
+        printf("\t<%s> ERROR: Could not write the spool - writing directly\n", __PRETTY_FUNCTION__);
+        return CS_ERROR;
+    }
+
+    if (G_spool_write_end == G_spool_drain_offset)
+    {
+        pthread_cond_signal(&G_spool_wake);
+    }
+    uint64_t sequence = G_spool_sequence++;
+    G_spool_write_end += written;
+    G_spool_pending++;
+    csl_MetricGaugeSet(METRIC_SPOOL_PENDING, (long long) G_spool_pending);
+
+    // **** Wait for a sync that covers this record - running it if no other writer is **** //
+    while (G_spool_synced_sequence < sequence)
+    {
+        if (G_spool_syncing == true)
+        {
+            pthread_cond_wait(&G_spool_synced, &G_spool_lock);
+            continue;
+        }
+        G_spool_syncing         = true;
+        uint64_t sync_sequence  = G_spool_sequence - 1;
+        int      spool_file     = G_spool_file;
+        pthread_mutex_unlock(&G_spool_lock);
+
+        int sync_flag = fdatasync(spool_file);
+
+        pthread_mutex_lock(&G_spool_lock);
+        if (sync_flag != 0)
+        {
+            printf("\t<%s> ERROR: Could not sync the spool - no more writes will be spooled\n", __PRETTY_FUNCTION__);
+            G_spool_sync_failed = true;
+        }
+        else if (G_spool_sync_failed == false)
+        {
+            G_spool_durable_sequence = sync_sequence;
+        }
+        G_spool_synced_sequence = sync_sequence;
+        G_spool_syncing         = false;
+        pthread_cond_broadcast(&G_spool_synced);
+    }
+    int return_flag = sequence <= G_spool_durable_sequence ? CS_SUCCESS : CS_FATAL_ERROR;
+    pthread_mutex_unlock(&G_spool_lock);
+    return return_flag;
+}
+
+/************************************************
+ * void spool_wait_msec()
+ *  @param  unsigned int msec
+ *
+ *  @brief  Waits, with the lock held, until msec have passed or the spool is being closed
+ *
+ *  @author Kerry
+ ************************************************/
+static void spool_wait_msec(unsigned int msec)
+{
+    struct timespec deadline;
+    clock_gettime(CLOCK_REALTIME, &deadline);
+    deadline.tv_sec     += msec / 1000;
+    deadline.tv_nsec    += (long) (msec % 1000) * 1000000;
+    if (deadline.tv_nsec >= 1000000000)
+    {
+        deadline.tv_sec++;
+        deadline.tv_nsec -= 1000000000;
+    }
+    while (G_spool_stopping == false && pthread_cond_timedwait(&G_spool_wake, &G_spool_lock, &deadline) == 0)
+    {
+        // woken by an append - keep gathering //
+    }
+}
+
+/************************************************
+ * int spool_run_records()
+ *  @param
+ *          off_t   drain_end
+ *          char    *payload    - At least SPOOL_MAX_RECORD bytes
+ *
+ *  @brief  Runs the records from G_spool_drain_offset up to drain_end against the storage, in order
+ *
+ *  @author Kerry
+ *
+ *  @note   Called without the lock. Each record run is entered in the ledger, which is synced at the end.
+ *
+ *  @return CS_SUCCESS if all were run, CS_ERROR_DB_CONNECTION if the database could not be reached for one
+ *          (it, and those after it, are left for the next drain)
+ ************************************************/
+static int spool_run_records(off_t drain_end, char *payload)
+{
+    int                 return_value    = CS_SUCCESS;
+    bool                ledger_written  = false;
+    csl_spool_record    record;
+
+    pthread_mutex_lock(&G_spool_lock);
+    off_t offset = G_spool_drain_offset;
+    pthread_mutex_unlock(&G_spool_lock);
+
+    while (offset < drain_end)
+    {
+        if (spool_read_record(G_spool_file, offset, &record, payload) != CS_SUCCESS)
+        {
+            // The spool was written by this process, so this is a damaged disk - there is no next record to find //
+            printf("\t<%s> ERROR: Corrupt spool record at [%lld] - dropping the rest of the spool\n",
+                   __PRETTY_FUNCTION__, (long long) offset);
+            pthread_mutex_lock(&G_spool_lock);
+            G_spool_drain_offset    = G_spool_write_end;
+            G_spool_pending         = 0;
+            G_spool_run_sequence    = G_spool_sequence - 1;
+            pthread_cond_broadcast(&G_spool_ran);
+            pthread_mutex_unlock(&G_spool_lock);
+            break;
+        }
+
+        if (record.sequence > G_spool_ledger_sequence)
+        {
+            int record_flag = record.type == SPOOL_UPDATE ?
+                              csl_StorageUpdate(payload) :
+                              csl_StorageTruncate(payload, payload + strlen(payload) + 1);
+            if (record_flag == CS_ERROR_DB_CONNECTION)
+            {
+                return_value = CS_ERROR_DB_CONNECTION;
+                break;
+            }
+            if (record_flag != CS_SUCCESS)
+            {
+                // The database refused it, and would again - the storage has already reported it //
+                csl_MetricCount(METRIC_SPOOL_REJECTED, 1);
+            }
+            G_spool_ledger_sequence = record.sequence;
+            if (pwrite(G_spool_ledger, &G_spool_ledger_sequence, sizeof(uint64_t), 0) != (ssize_t) sizeof(uint64_t))
+            {
+                printf("\t<%s> WARNING: Could not write the spool ledger - a restart may run [%llu] again\n",
+                       __PRETTY_FUNCTION__, (unsigned long long) record.sequence);
+            }
+            ledger_written = true;
+        }
+
+        offset += (off_t) (sizeof(csl_spool_record) + record.size);
+        pthread_mutex_lock(&G_spool_lock);
+        G_spool_drain_offset = offset;
+        G_spool_pending--;
+        G_spool_run_sequence = record.sequence > G_spool_run_sequence ? record.sequence : G_spool_run_sequence;
+        pthread_cond_broadcast(&G_spool_ran);
+        csl_MetricGaugeSet(METRIC_SPOOL_PENDING, (long long) G_spool_pending);
+        pthread_mutex_unlock(&G_spool_lock);
+    }
+
+    if (ledger_written == true)
+    {
+        fdatasync(G_spool_ledger);
+    }
+    return return_value;
+}
+
+/************************************************
+ * void *spool_drain()
+ *  @param  void *unused
+ *
+ *  @brief  The drain thread - runs the spool against the storage until the spool is closed
+ *
+ *  @author Kerry
+ *
+ *  @note   On the MySQL backend this thread has its own pooled connection (see csl_mysql.c)
+ ************************************************/
+static void *spool_drain(void *unused)
+{
+    (void) unused;
+    char        *payload        = malloc(SPOOL_MAX_RECORD);
+    int64_t     retry_usecs     = 0;        // when the database is next tried, after it could not be reached
+    unsigned int retry_msec     = 0;
+
+    pthread_mutex_lock(&G_spool_lock);
+    while (payload != NULL)
+    {
+        while (G_spool_drain_offset == G_spool_write_end && G_spool_stopping == false)
+        {
+            pthread_cond_wait(&G_spool_wake, &G_spool_lock);
+        }
+        if (G_spool_drain_offset == G_spool_write_end)
+        {
+            break;      // closing, and nothing left
+        }
+
+        // **** Let the writes gather, so that one drain runs them all **** //
+        if (G_spool_stopping == false)
+        {
+            spool_wait_msec(csl_Config()->spool_fsync_msec);
+        }
+        off_t   drain_end   = G_spool_write_end;
+        bool    stopping    = G_spool_stopping;
+        pthread_mutex_unlock(&G_spool_lock);
+
+        int drain_flag = CS_END_OF_RUN;     // not tried - still waiting out the database
+        if (stopping == true || csl_MetricsNow() >= retry_usecs)
+        {
+            drain_flag = spool_run_records(drain_end, payload);
+        }
+
+        pthread_mutex_lock(&G_spool_lock);
+        if (drain_flag == CS_ERROR_DB_CONNECTION)
+        {
+            if (stopping == true)
+            {
+                break;
+            }
+            retry_msec  = retry_msec == 0 ? SPOOL_RETRY_MIN_MSEC : retry_msec * 2;
+            retry_msec  = retry_msec > SPOOL_RETRY_MAX_MSEC ? SPOOL_RETRY_MAX_MSEC : retry_msec;
+            retry_usecs = csl_MetricsNow() + (int64_t) retry_msec * 1000;
+            printf("\t<%s> Database unavailable - [%llu] spooled writes wait [%u] msec\n",
+                   __PRETTY_FUNCTION__, G_spool_pending, retry_msec);
+        }
+        else if (drain_flag == CS_SUCCESS && retry_msec != 0)
+        {
+            printf("\t<%s> Database available again\n", __PRETTY_FUNCTION__);
+            retry_msec = 0;
+        }
+
+        // **** Caught up - start the file again, so the spool only holds what the database is behind by **** //
+        if (G_spool_drain_offset == G_spool_write_end && ftruncate(G_spool_file, 0) == 0)
+        {
+            G_spool_drain_offset    = 0;
+            G_spool_write_end       = 0;
+        }
+    }
+    pthread_mutex_unlock(&G_spool_lock);
+    free(payload);
+    return NULL;
+}
+
+/************************************************
+ * int csl_SpoolOpen()
+ *  @param  const char *file_name
+ *
+ *  @brief  Opens (or creates) the spool, and starts the drain thread on whatever it still holds
+ *
+ *  @author Kerry
+ *
+ *  @note   The storage must already be open. Until the spool is open, the spooled writes go straight to storage.
+ *
+ *  @return CS_SUCCESS on success, CS_ERROR if the spool could not be opened
+ ************************************************/
+int     csl_SpoolOpen(const char *file_name)
+{
+    char ledger_name[SIZE_SPOOL_FILE_NAME];
+    snprintf(ledger_name, SIZE_SPOOL_FILE_NAME, "%s%s", file_name, SPOOL_LEDGER_SUFFIX);
+
+    int     spool_file  = open(file_name, O_RDWR | O_CREAT | O_APPEND | O_CLOEXEC, 0600);
+    int     ledger_file = open(ledger_name, O_RDWR | O_CREAT | O_CLOEXEC, 0600);
+    char    *payload    = malloc(SPOOL_MAX_RECORD);
+    if (spool_file < 0 || ledger_file < 0 || payload == NULL)
+    {
+        printf("\t<%s> ERROR: Could not open spool [%s]\n", __PRETTY_FUNCTION__, file_name);
+        if (spool_file >= 0)
+        {
+            close(spool_file);
+        }
+        if (ledger_file >= 0)
+        {
+            close(ledger_file);
+        }
+        free(payload);
+        return CS_ERROR;
+    }
+
+    uint64_t ledger_sequence = 0;
+    if (pread(ledger_file, &ledger_sequence, sizeof(uint64_t), 0) != (ssize_t) sizeof(uint64_t))
+    {
+        ledger_sequence = 0;
+    }
+
+    // **** Find the last whole record, and the first one the database does not have yet **** //
+    csl_spool_record    record;
+    off_t               offset          = 0;
+    off_t               drain_offset    = -1;
+    uint64_t            last_sequence   = ledger_sequence;
+    unsigned long long  pending         = 0;
+    while (spool_read_record(spool_file, offset, &record, payload) == CS_SUCCESS)
+    {
+        if (record.sequence > ledger_sequence)
+        {
+            drain_offset = drain_offset < 0 ? offset : drain_offset;
+            pending++;
+        }
+        last_sequence   = record.sequence > last_sequence ? record.sequence : last_sequence;
+        offset          += (off_t) (sizeof(csl_spool_record) + record.size);
+    }
+    free(payload);
+
+    off_t file_end = lseek(spool_file, 0, SEEK_END);
+    if (file_end > offset)
+    {
+        printf("\t<%s> Dropping [%lld] bytes of partial record from the spool\n",
+               __PRETTY_FUNCTION__, (long long) (file_end - offset));
+        if (ftruncate(spool_file, offset) != 0)
+        {
+            printf("\t<%s> ERROR: Could not truncate spool [%s]\n", __PRETTY_FUNCTION__, file_name);
+            close(spool_file);
+            close(ledger_file);
+            return CS_ERROR;
+        }
+    }
+
+    pthread_mutex_lock(&G_spool_lock);
+    G_spool_file             = spool_file;
+    G_spool_ledger           = ledger_file;
+    G_spool_write_end        = offset;
+    G_spool_drain_offset     = drain_offset < 0 ? offset : drain_offset;
+    G_spool_sequence         = last_sequence + 1;
+    G_spool_synced_sequence  = last_sequence;
+    G_spool_durable_sequence = last_sequence;
+    G_spool_sync_failed      = false;
+    G_spool_ledger_sequence  = ledger_sequence;
+    G_spool_run_sequence     = drain_offset < 0 ? last_sequence : ledger_sequence;
+    G_spool_pending          = pending;
+    G_spool_stopping         = false;
+    csl_MetricGaugeSet(METRIC_SPOOL_PENDING, (long long) G_spool_pending);
+    pthread_mutex_unlock(&G_spool_lock);
+
+    if (pthread_create(&G_spool_drain_thread, NULL, spool_drain, NULL) != 0)
+    {
+        printf("\t<%s> ERROR: Could not start the spool drain thread\n", __PRETTY_FUNCTION__);
+        pthread_mutex_lock(&G_spool_lock);
+        G_spool_file    = -1;
+        G_spool_ledger  = -1;
+        G_spool_pending = 0;
+        pthread_mutex_unlock(&G_spool_lock);
+        close(spool_file);
+        close(ledger_file);
+        return CS_ERROR;
+    }
+
+    printf("\t<%s> Spooling database writes to [%s] - [%llu] left from the last run\n",
+           __PRETTY_FUNCTION__, file_name, pending);
+    return CS_SUCCESS;
+}
+
+/************************************************
+ * void csl_SpoolClose()
+ *  @param  - None
+ *
+ *  @brief  Drains what the database will take, stops the drain thread and closes the spool
+ *
+ *  @author Kerry
+ *
+ *  @note   Writes the database could not be reached for stay in the spool for the next start
+ ************************************************/
+void    csl_SpoolClose()
+{
+    pthread_mutex_lock(&G_spool_lock);
+    if (G_spool_file < 0)
+    {
+        pthread_mutex_unlock(&G_spool_lock);
+        return;
+    }
+    G_spool_stopping = true;
+    pthread_cond_broadcast(&G_spool_wake);
+    pthread_mutex_unlock(&G_spool_lock);
+
+    pthread_join(G_spool_drain_thread, NULL);
+
+    pthread_mutex_lock(&G_spool_lock);
+    if (G_spool_pending > 0)
+    {
+        printf("\t<%s> [%llu] spooled writes kept for the next start\n", __PRETTY_FUNCTION__, G_spool_pending);
+    }
+    // **** Let a writer's sync finish, then cover the writers still waiting with a last one **** //
+    while (G_spool_syncing == true)
+    {
+        pthread_cond_wait(&G_spool_synced, &G_spool_lock);
+    }
+    if (fdatasync(G_spool_file) == 0 && G_spool_sync_failed == false)
+    {
+        G_spool_durable_sequence = G_spool_sequence - 1;
+    }
+    G_spool_synced_sequence = G_spool_sequence - 1;
+    pthread_cond_broadcast(&G_spool_synced);
+    pthread_cond_broadcast(&G_spool_ran);
+    close(G_spool_file);
+    close(G_spool_ledger);
+    G_spool_file    = -1;
+    G_spool_ledger  = -1;
+    G_spool_pending = 0;
+    csl_MetricGaugeSet(METRIC_SPOOL_PENDING, 0);
+    pthread_mutex_unlock(&G_spool_lock);
+}
+
+/************************************************
+ * int csl_SpoolUpdate()
+ *  @param  const char *statement
+ *
+ *  @brief  Appends an update to the spool
+ *
+ *  @author Kerry
+ *
+ *  @return CS_SUCCESS once spooled and synced, CS_FATAL_ERROR if the sync failed (see spool_append), or with no
+ *          spool open, csl_StorageUpdate()'s result
+ ************************************************/
+int     csl_SpoolUpdate(const char *statement)
+{
+    int spool_flag = spool_append(SPOOL_UPDATE, statement, strlen(statement) + 1);
+    if (spool_flag != CS_ERROR)
+    {
+        return spool_flag;
+    }
+    return csl_StorageUpdate(statement);
+}
+
+/************************************************
+ * int csl_SpoolTruncate()
+ *  @param
+ *          const char  *schema
+ *          const char  *table
+ *
+ *  @brief  Appends a truncate to the spool
+ *
+ *  @author Kerry
+ *
+ *  @return CS_SUCCESS once spooled and synced, CS_FATAL_ERROR if the sync failed (see spool_append), or with no
+ *          spool open, csl_StorageTruncate()'s result
+ ************************************************/
+int     csl_SpoolTruncate(const char *schema, const char *table)
+{
+    char    payload[SIZE_CS_SQL_COMMAND];
+    size_t  schema_size = strlen(schema) + 1;
+    size_t  table_size  = strlen(table) + 1;
+    if (schema_size + table_size <= SIZE_CS_SQL_COMMAND)
+    {
+        memcpy(payload, schema, schema_size);
+        memcpy(payload + schema_size, table, table_size);
+        int spool_flag = spool_append(SPOOL_TRUNCATE, payload, schema_size + table_size);
+        if (spool_flag != CS_ERROR)
+        {
+            return spool_flag;
+        }
+    }
+    return csl_StorageTruncate(schema, table);
+}
+
+/************************************************
+ * int csl_SpoolAlertSyncAndPrune()
+ *  @param
+ *          const char          *view_name
+ *          unsigned long long  device_id
+ *
+ *  @brief  csl_StorageAlertSyncAndPrune(), spooled
+ *
+ *  @author Kerry
+ *
+ *  @return CS_SUCCESS once spooled and synced (or, with no spool open, csl_StorageAlertSyncAndPrune()'s result)
+ ************************************************/
+int     csl_SpoolAlertSyncAndPrune(const char *view_name, unsigned long long device_id)
+{
+    pthread_mutex_lock(&G_spool_lock);
+    bool spooling = G_spool_file >= 0;
+    pthread_mutex_unlock(&G_spool_lock);
+    if (spooling == false)
+    {
+        return csl_StorageAlertSyncAndPrune(view_name, device_id);
+    }
+
+    char statement[SIZE_CS_SQL_COMMAND];
+    snprintf(statement, SIZE_CS_SQL_COMMAND, "Update %s.%s Set db_sync = db_sync | %d where device_id = %llu",
+             CS_SQL_MONITOR_SCHEMA, CS_SQL_DEVICE_VIEW, CS_SYNC_ALERT, device_id);
+    int return_flag = csl_SpoolUpdate(statement);
+    if (return_flag != CS_SUCCESS)
+    {
+        return return_flag;
+    }
+    snprintf(statement, SIZE_CS_SQL_COMMAND, CS_SQL_ALERT_PRUNE_STATEMENT, CS_SQL_MONITOR_SCHEMA, view_name);
+    return csl_SpoolUpdate(statement);
+}
+
+/************************************************
+ * unsigned long long csl_SpoolPending()
+ *  @param  - None
+ *
+ *  @brief  The writes spooled but not yet run
+ *
+ *  @author Kerry
+ *
+ *  @return The count, 0 with no spool open
+ ************************************************/
+unsigned long long csl_SpoolPending()
+{
+    pthread_mutex_lock(&G_spool_lock);
+    unsigned long long pending = G_spool_pending;
+    pthread_mutex_unlock(&G_spool_lock);
+    return pending;
+}
+
+/************************************************
+ * unsigned long long csl_SpoolSequence()
+ *  @param  - None
+ *
+ *  @brief  The sequence number of the last write spooled
+ *
+ *  @author Kerry
+ *
+ *  @return The sequence number, 0 with no spool open
+ ************************************************/
+unsigned long long csl_SpoolSequence()
+{
+    pthread_mutex_lock(&G_spool_lock);
+    unsigned long long sequence = G_spool_file < 0 ? 0 : G_spool_sequence - 1;
+    pthread_mutex_unlock(&G_spool_lock);
+    return sequence;
+}
+
+/************************************************
+ * bool csl_SpoolRun()
+ *  @param  unsigned long long sequence
+ *
+ *  @brief  Whether the drain has run every write up to sequence
+ *
+ *  @author Kerry
+ *
+ *  @return true once it has (or with no spool open), false if some are still spooled
+ ************************************************/
+bool    csl_SpoolRun(unsigned long long sequence)
+{
+    pthread_mutex_lock(&G_spool_lock);
+    bool run = G_spool_file < 0 || sequence <= G_spool_run_sequence;
+    pthread_mutex_unlock(&G_spool_lock);
+    return run;
+}
+
+/************************************************
+ * int csl_SpoolWait()
+ *  @param  unsigned long long sequence
+ *
+ *  @brief  Waits for the drain to run every write up to sequence
+ *
+ *  @author Kerry
+ *
+ *  @note   Waits at most db_timeout_sec - the drain may be waiting out the database
+ *
+ *  @return CS_SUCCESS once they are run (or with no spool open), CS_ERROR_DB_CONNECTION if they were not in time
+ ************************************************/
+int     csl_SpoolWait(unsigned long long sequence)
+{
+    struct timespec deadline;
+    clock_gettime(CLOCK_REALTIME, &deadline);
+    deadline.tv_sec += csl_Config()->db_timeout_sec;
+
+    int return_flag = CS_SUCCESS;
+    pthread_mutex_lock(&G_spool_lock);
+    while (G_spool_file >= 0 && sequence > G_spool_run_sequence)
+    {
+        if (pthread_cond_timedwait(&G_spool_ran, &G_spool_lock, &deadline) != 0)
+        {
+            return_flag = CS_ERROR_DB_CONNECTION;
+            break;
+        }
+    }
+    pthread_mutex_unlock(&G_spool_lock);
+    return return_flag;
+}
@@ -0,0 +1,193 @@
+
+/************************************************
+ * csl_spool.h
+ * ===========
+ *
+ * This is the header file for the CS Spool Library
+ *
+ * Author:      Kerry
+ * Version:     00.00.00
+ * Comments:    A local write-ahead log for the alert and Crytica Standard writes, drained into the database
+ ************************************************/
+
+#ifndef CRYTICAMONITOR_CSL_SPOOL_H
+#define CRYTICAMONITOR_CSL_SPOOL_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <pthread.h>
+
+#include "csl_constants.h"
+#include "csl_storage.h"
+
+/************************************************
+ * #defines
+ * ========
+ ************************************************/
+#define FILE_SPOOL                  "/usr/crytica/cs_monitor.spool"
+#define SPOOL_LEDGER_SUFFIX         ".ledger"
+#define SPOOL_RECORD_MAGIC          0x4C4F4F50      // "POOL"
+#define SPOOL_MAX_RECORD            (64 * 1024)     // Far more than any statement (SIZE_CS_SQL_COMMAND)
+#define SPOOL_RETRY_MIN_MSEC        100             // The first wait before a write the database missed is retried
+#define SPOOL_RETRY_MAX_MSEC        10000           // ... doubling up to this
+
+#define SPOOL_UPDATE                1               // The payload is a statement for csl_StorageUpdate()
+#define SPOOL_TRUNCATE              2               // The payload is "schema\0table\0" for csl_StorageTruncate()
+
+/************************************************
+ * The Spool
+ * =========
+ * The scan threads do not wait on the database to record an alert or a Crytica Standard. Each write is appended
+ * to the spool file instead, and a drain thread replays the file into the database, in the order written:
+ *
+ *      csl_spool_record    - the record's sequence number, type and size, and a checksum of its payload
+ *      the payload         - the statement, NUL-terminated
+ *
+ * A write returns once its record is synced to disk, so a write reported spooled survives a crash. The writes
+ * share their syncs - one fdatasync() covers every record appended while the last one ran. The drain thread lets
+ * the writes gather for spool_fsync_msec (see csl_config.h), then runs them. A write the database could not be
+ * reached for is retried, with a growing wait, until it can; a write the database refuses, or one the connection
+ * was lost in the middle of, is reported and dropped. The file is emptied each time the drain catches up.
+ *
+ * The sequence number of the last write run is kept in the ledger file (the spool file's name with
+ * SPOOL_LEDGER_SUFFIX), and at start-up the writes up to it are skipped, so that a restart does not replay what
+ * the database already has. The ledger is synced once per drain, so a crash may replay the writes of the last
+ * drain - they are run at least once. A partial last record (the crash came mid-write) is dropped.
+ ************************************************/
+typedef struct
+{
+    uint32_t    magic;          // SPOOL_RECORD_MAGIC
+    uint32_t    size;           // of the payload
+    uint64_t    sequence;
+    uint32_t    type;           // SPOOL_UPDATE or SPOOL_TRUNCATE
+    uint32_t    checksum;       // FNV-1a of the payload
+} csl_spool_record;
+
+/************************************************
+ * **********************************************
+ * Function Prototypes
+ * **********************************************
+ ************************************************/
+
+/************************************************
+ * int csl_SpoolOpen()
+ *  @param  const char *file_name
+ *
+ *  @brief  Opens (or creates) the spool, and starts the drain thread on whatever it still holds
+ *
+ *  @author Kerry
+ *
+ *  @note   The storage must already be open. Until the spool is open, the spooled writes go straight to storage.
+ *
+ *  @return CS_SUCCESS on success, CS_ERROR if the spool could not be opened
+ ************************************************/
+int     csl_SpoolOpen(const char *file_name);
+
+/************************************************
+ * void csl_SpoolClose()
+ *  @param  - None
+ *
+ *  @brief  Drains what the database will take, stops the drain thread and closes the spool
+ *
+ *  @author Kerry
+ *
+ *  @note   Writes the database could not be reached for stay in the spool for the next start
+ ************************************************/
+void    csl_SpoolClose();
+
+/************************************************
+ * int csl_SpoolUpdate()
+ *  @param  const char *statement
+ *
+ *  @brief  Appends an update to the spool
+ *
+ *  @author Kerry
+ *
+ *  @return CS_SUCCESS once spooled and synced, CS_FATAL_ERROR if spooled but the sync failed, or with no spool
+ *          open, csl_StorageUpdate()'s result
+ ************************************************/
+int     csl_SpoolUpdate(const char *statement);
+
+/************************************************
+ * int csl_SpoolTruncate()
+ *  @param
+ *          const char  *schema
+ *          const char  *table
+ *
+ *  @brief  Appends a truncate to the spool
+ *
+ *  @author Kerry
+ *
+ *  @return CS_SUCCESS once spooled and synced, CS_FATAL_ERROR if spooled but the sync failed, or with no spool
+ *          open, csl_StorageTruncate()'s result
+ ************************************************/
+int     csl_SpoolTruncate(const char *schema, const char *table);
+
+/************************************************
+ * int csl_SpoolAlertSyncAndPrune()
+ *  @param
+ *          const char          *view_name
+ *          unsigned long long  device_id
+ *
+ *  @brief  csl_StorageAlertSyncAndPrune(), spooled
+ *
+ *  @author Kerry
+ *
+ *  @return CS_SUCCESS once spooled and synced (or, with no spool open, csl_StorageAlertSyncAndPrune()'s result)
+ ************************************************/
+int     csl_SpoolAlertSyncAndPrune(const char *view_name, unsigned long long device_id);
+
+/************************************************
+ * unsigned long long csl_SpoolPending()
+ *  @param  - None
+ *
+ *  @brief  The writes spooled but not yet run
+ *
+ *  @author Kerry
+ *
+ *  @return The count, 0 with no spool open
+ ************************************************/
+unsigned long long csl_SpoolPending();
+
+/************************************************
+ * unsigned long long csl_SpoolSequence()
+ *  @param  - None
+ *
+ *  @brief  The sequence number of the last write spooled
+ *
+ *  @author Kerry
+ *
+ *  @note   Taken straight after a write, it names that write for csl_SpoolRun() and csl_SpoolWait() - a read
+ *          that depends on the write waits for it alone, not for the whole spool
+ *
+ *  @return The sequence number, 0 with no spool open
+ ************************************************/
+unsigned long long csl_SpoolSequence();
+
+/************************************************
+ * bool csl_SpoolRun()
+ *  @param  unsigned long long sequence
+ *
+ *  @brief  Whether the drain has run every write up to sequence
+ *
+ *  @author Kerry
+ *
+ *  @return true once it has (or with no spool open), false if some are still spooled
+ ************************************************/
+bool    csl_SpoolRun(unsigned long long sequence);
+
+/************************************************
+ * int csl_SpoolWait()
+ *  @param  unsigned long long sequence
+ *
+ *  @brief  Waits for the drain to run every write up to sequence
+ *
+ *  @author Kerry
+ *
+ *  @note   Waits at most db_timeout_sec - the drain may be waiting out the database
+ *
+ *  @return CS_SUCCESS once they are run (or with no spool open), CS_ERROR_DB_CONNECTION if they were not in time
+ ************************************************/
+int     csl_SpoolWait(unsigned long long sequence);
+
+#endif //CRYTICAMONITOR_CSL_SPOOL_H
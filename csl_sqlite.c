@@ -0,0 +1,252 @@
+//
+// Created by kerry on 10/19/26.
+//
+
+#include "csl_sqlite.h"
+
+#ifdef CSL_SQLITE
+#include <time.h>
+#include <sqlite3.h>
+
+static sqlite3 *G_sqlite_connection = NULL;
+
+/************************************************
+ * The cs_monitor Schema
+ * =====================
+ * Created on first open, and left alone after that
+ ************************************************/
+#define SQLITE_SCHEMA_PREFIX    "Create table if not exists " CS_SQL_MONITOR_SCHEMA "."
+#define SQLITE_VIEW_PREFIX      "Create view if not exists " CS_SQL_MONITOR_SCHEMA "."
+
+static const char *G_sqlite_schema[] =
+{
+    SQLITE_SCHEMA_PREFIX CS_SQL_MONITOR_VIEW
+        " (monitor_id integer primary key, monitor_name text, monitor_identifier text,"
+        " monitor_sync integer not null default 0)",
+
+    SQLITE_SCHEMA_PREFIX CS_SQL_DEVICE_VIEW
+        " (device_id integer primary key, device_identifier text, db_sync integer not null default 0)",
+
+    SQLITE_SCHEMA_PREFIX CS_SQL_MONITOR_DEVICE_VIEW
+        " (monitor_id integer not null, device_id integer not null, device_identifier text,"
+        " crytica_standard_date text, primary key (monitor_id, device_id))",
+
+    SQLITE_SCHEMA_PREFIX CS_SQL_ALERT_LOG_VIEW
+        " (alert_id integer primary key, monitor_id integer, device_identifier text, device_id integer,"
+        " probe_id real, alert_type integer, element_type text, element_name text, alert_data text,"
+        " alert_process_date text, alert_sync integer not null default 0)",
+
+    SQLITE_SCHEMA_PREFIX CS_SQL_STANDARD_TABLE
+        " (standard_id integer primary key, standard_type integer, standard_date text, monitor_id integer,"
+        " device_id integer, element_type integer, element_identifier text, element_name text, scan_value text)",
+
+    "Create index if not exists " CS_SQL_MONITOR_SCHEMA ".crytica_standard_element on " CS_SQL_STANDARD_TABLE
+        " (monitor_id, device_id, element_identifier)",
+
+    SQLITE_SCHEMA_PREFIX CS_SQL_ELEMENT_ADDED_NAMES_TABLE
+        " (monitor_id integer, device_id integer, element_identifier text, element_name text)",
+
+    SQLITE_VIEW_PREFIX CS_SQL_STANDARD_VIEW
+        " as select * from " CS_SQL_STANDARD_TABLE,
+
+    // cStandardWriteToDB() deletes through the view //
+    "Create trigger if not exists " CS_SQL_MONITOR_SCHEMA "." CS_SQL_STANDARD_VIEW "_delete"
+        " instead of delete on " CS_SQL_STANDARD_VIEW
+        " begin delete from " CS_SQL_STANDARD_TABLE " where standard_id = old.standard_id; end",
+
+    SQLITE_VIEW_PREFIX CS_SQL_ELEMENT_NAMES_VIEW
+        " as select monitor_id, device_id, element_identifier, element_name from " CS_SQL_STANDARD_TABLE
+        " union all"
+        " select monitor_id, device_id, element_identifier, element_name from " CS_SQL_ELEMENT_ADDED_NAMES_TABLE,
+
+    NULL
+};
+
+/************************************************
+ * void sqlite_from_unixtime()
+ *  @param
+ *          sqlite3_context *context
+ *          int             argc
+ *          sqlite3_value   **argv
+ *
+ *  @brief  MySQL's FROM_UNIXTIME(), as a SQLite function: epoch seconds to a local 'YYYY-MM-DD HH:MM:SS'
+ *
+ *  @author Kerry
+ ************************************************/
+static void sqlite_from_unixtime(sqlite3_context *context, int argc, sqlite3_value **argv)
+{
+    if (argc != 1 || sqlite3_value_type(argv[0]) == SQLITE_NULL)
+    {
+        sqlite3_result_null(context);
+        return;
+    }
+    time_t      epoch = (time_t) sqlite3_value_int64(argv[0]);
+    struct tm   local_time;
+    char        date[SIZE_SQLITE_DATE];
+    localtime_r(&epoch, &local_time);
+    strftime(date, SIZE_SQLITE_DATE, "%Y-%m-%d %H:%M:%S", &local_time);
+    sqlite3_result_text(context, date, -1, SQLITE_TRANSIENT);
+    return;
+}
+
+static int sqlite_backend_update(const char *statement)
+{
+    char *error_message = NULL;
+    if (sqlite3_exec(G_sqlite_connection, statement, NULL, NULL, &error_message) != SQLITE_OK)
+    {
+        printf("\t<%s> **** Warning: Failed DB Update [%s] - %s ****\n", __PRETTY_FUNCTION__, statement,
+               error_message == NULL ? "" : error_message);
+        sqlite3_free(error_message);
+
+        // A locked or full database is a passing condition, not a bad statement //
+        int error_code = sqlite3_errcode(G_sqlite_connection);
+        if (error_code == SQLITE_BUSY || error_code == SQLITE_LOCKED || error_code == SQLITE_FULL ||
+            error_code == SQLITE_IOERR)
+        {
+            return CS_ERROR_DB_CONNECTION;
+        }
+        return CS_ERROR_DB_QUERY;
+    }
+    return CS_SUCCESS;
+}
+
+static void sqlite_backend_close()
+{
+    sqlite3_close(G_sqlite_connection);
+    G_sqlite_connection = NULL;
+}
+
+static int sqlite_backend_open()
+{
+    // The main database is a scratch one - the monitor's file is attached under the schema name //
+    if (sqlite3_open_v2(":memory:", &G_sqlite_connection,
+                        SQLITE_OPEN_READWRITE | SQLITE_OPEN_CREATE | SQLITE_OPEN_FULLMUTEX, NULL) != SQLITE_OK)
+    {
+        printf("\t<%s> Failed to open SQLite: %s\n", __PRETTY_FUNCTION__, sqlite3_errmsg(G_sqlite_connection));
+        sqlite_backend_close();
+        return CS_ERROR_DB_CONNECTION;
+    }
+    sqlite3_busy_timeout(G_sqlite_connection, SQLITE_BUSY_TIMEOUT_MSEC);
+    sqlite3_create_function(G_sqlite_connection, "FROM_UNIXTIME", 1, SQLITE_UTF8 | SQLITE_DETERMINISTIC, NULL,
+                            sqlite_from_unixtime, NULL, NULL);
+
+    char statement[SIZE_CS_SQL_COMMAND];
+    snprintf(statement, SIZE_CS_SQL_COMMAND, "Attach database '%s' as %s", FILE_STORAGE_SQLITE, CS_SQL_MONITOR_SCHEMA);
+    if (sqlite_backend_update(statement) != CS_SUCCESS)
+    {
+        sqlite_backend_close();
+        return CS_ERROR_DB_CONNECTION;
+    }
+
+    // WAL lets db_sync read while the monitor writes; NORMAL only syncs at checkpoints, which is safe in WAL //
+    snprintf(statement, SIZE_CS_SQL_COMMAND, "Pragma %s.journal_mode = WAL", CS_SQL_MONITOR_SCHEMA);
+    int return_value = sqlite_backend_update(statement);
+    snprintf(statement, SIZE_CS_SQL_COMMAND, "Pragma %s.synchronous = NORMAL", CS_SQL_MONITOR_SCHEMA);
+    if (return_value == CS_SUCCESS)
+    {
+        return_value = sqlite_backend_update(statement);
+    }
+    for (int schema_ctr = 0; return_value == CS_SUCCESS && G_sqlite_schema[schema_ctr] != NULL; schema_ctr++)
+    {
+        return_value = sqlite_backend_update(G_sqlite_schema[schema_ctr]);
+    }
+    if (return_value != CS_SUCCESS)
+    {
+        sqlite_backend_close();
+        return CS_CORRUPTED_DB;
+    }
+    return CS_SUCCESS;
+}
+
+static long long sqlite_backend_query(const char *statement, csl_storage_row_function row_function, void *context)
+{
+    sqlite3_stmt *prepared = NULL;
+    if (sqlite3_prepare_v2(G_sqlite_connection, statement, -1, &prepared, NULL) != SQLITE_OK)
+    {
+        printf("\t<%s> **** ERROR: Bad Database Query - %s ****\n", __PRETTY_FUNCTION__,
+               sqlite3_errmsg(G_sqlite_connection));
+        printf("     Query: %s\n", statement);
+        return CS_ERROR_DB_QUERY;
+    }
+
+    unsigned int column_ctr = (unsigned int) sqlite3_column_count(prepared);
+    if (column_ctr > STORAGE_MAX_COLUMNS)
+    {
+        printf("\t<%s> **** ERROR: [%u] columns is more than [%d] ****\n", __PRETTY_FUNCTION__,
+               column_ctr, STORAGE_MAX_COLUMNS);
+        sqlite3_finalize(prepared);
+        return CS_ERROR_DB_QUERY;
+    }
+
+    char        *fields[STORAGE_MAX_COLUMNS];
+    long long   return_value = 0;
+    int         step_value;
+    while ((step_value = sqlite3_step(prepared)) == SQLITE_ROW)
+    {
+        return_value++;
+        if (row_function == NULL)
+        {
+            continue;
+        }
+        for (unsigned int field_ctr = 0; field_ctr < column_ctr; field_ctr++)
+        {
+            fields[field_ctr] = (char *) sqlite3_column_text(prepared, (int) field_ctr);
+        }
+        int row_flag = row_function(context, column_ctr, fields);
+        if (row_flag == CS_END_OF_RUN)
+        {
+            return_value--;     // the row was not taken
+            step_value = SQLITE_DONE;
+            break;
+        }
+        if (row_flag != CS_SUCCESS)
+        {
+            sqlite3_finalize(prepared);
+            return row_flag;
+        }
+    }
+    if (step_value != SQLITE_DONE)
+    {
+        printf("\t<%s> **** ERROR: Query failed after [%lld] rows - %s ****\n", __PRETTY_FUNCTION__,
+               return_value, sqlite3_errmsg(G_sqlite_connection));
+        printf("     Query: %s\n", statement);
+        return_value = CS_ERROR_DB_QUERY;
+    }
+    sqlite3_finalize(prepared);
+    return return_value;
+}
+
+static int sqlite_backend_truncate(const char *schema, const char *table)
+{
+    // SQLite has no TRUNCATE, but optimizes an unqualified delete into one //
+    char statement[SIZE_CS_SQL_COMMAND];
+    snprintf(statement, SIZE_CS_SQL_COMMAND, "Delete from %s.%s", schema, table);
+    return sqlite_backend_update(statement);
+}
+
+static const csl_storage_backend G_sqlite_backend =
+{
+    "SQLite",
+    sqlite_backend_open,
+    sqlite_backend_close,
+    sqlite_backend_update,
+    sqlite_backend_query,
+    sqlite_backend_truncate
+};
+
+/************************************************
+ * const csl_storage_backend *csl_SQLiteBackend()
+ *  @param  - None
+ *
+ *  @brief  The SQLite storage backend, for csl_StorageOpen()
+ *
+ *  @author Kerry
+ *
+ *  @return Pointer to the backend
+ ************************************************/
+const csl_storage_backend *csl_SQLiteBackend()
+{
+    return &G_sqlite_backend;
+}
+
+#endif //CSL_SQLITE
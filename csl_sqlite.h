@@ -0,0 +1,51 @@
+
+/************************************************
+ * csl_sqlite.h
+ * ============
+ *
+ * This is the header file for the CS SQLite Library
+ *
+ * Author:      Kerry
+ * Version:     00.00.00
+ * Comments:    The embedded storage backend, built with -DCSL_SQLITE=ON
+ ************************************************/
+
+#ifndef CRYTICAMONITOR_CSL_SQLITE_H
+#define CRYTICAMONITOR_CSL_SQLITE_H
+
+#include "csl_storage.h"
+
+/************************************************
+ * #defines
+ * ========
+ ************************************************/
+#define SQLITE_BUSY_TIMEOUT_MSEC    5000        // db_sync, or an admin's sqlite3 shell, may hold the write lock
+#define SIZE_SQLITE_DATE            20          // "YYYY-MM-DD HH:MM:SS"
+
+/************************************************
+ * The SQLite Storage Backend
+ * ==========================
+ * Keeps the cs_monitor schema in FILE_STORAGE_SQLITE, in WAL mode, so that db_sync can read it while the
+ * monitor writes. The file is attached as CS_SQL_MONITOR_SCHEMA, so the monitor's schema qualified statements
+ * run unchanged.
+ *
+ * MySQL's views become tables of the same name (v_crytica_standard and v_element_names stay views), holding
+ * just the columns the monitor reads and writes. FROM_UNIXTIME() is provided as a SQL function, and a
+ * truncate is a delete.
+ ************************************************/
+
+#ifdef CSL_SQLITE
+/************************************************
+ * const csl_storage_backend *csl_SQLiteBackend()
+ *  @param  - None
+ *
+ *  @brief  The SQLite storage backend, for csl_StorageOpen()
+ *
+ *  @author Kerry
+ *
+ *  @return Pointer to the backend
+ ************************************************/
+const csl_storage_backend *csl_SQLiteBackend();
+#endif //CSL_SQLITE
+
+#endif //CRYTICAMONITOR_CSL_SQLITE_H
@@ -0,0 +1,438 @@
+//
+// Created by kerry on 10/19/26.
+//
+
+#include "csl_storage.h"
+#include "csl_mysql.h"
+#include "csl_sqlite.h"
+
+/************************************************
+ * The Storage Backend
+ * ===================
+ * Chosen once by csl_StorageOpen() during start-up, NULL until then
+ ************************************************/
+static const csl_storage_backend *G_storage;
+
+/************************************************
+ * Row Tables
+ * ==========
+ * The readers collect their rows in a table that doubles as it fills
+ ************************************************/
+typedef struct
+{
+    void        *rows;
+    size_t      row_size;
+    long long   row_ctr;
+    long long   capacity;
+} storage_row_table;
+
+/************************************************
+ * void *storage_row_next()
+ *  @param  storage_row_table *table
+ *
+ *  @brief  Adds a zeroed row to the table
+ *
+ *  @author Kerry
+ *
+ *  @return The new row, or NULL if the table could not grow
+ ************************************************/
+static void *storage_row_next(storage_row_table *table)
+{
+    if (table->row_ctr == table->capacity)
+    {
+        long long new_capacity  = table->capacity == 0 ? STORAGE_INITIAL_ROWS : table->capacity * 2;
+        void      *new_rows     = realloc(table->rows, (size_t) new_capacity * table->row_size);
+        if (new_rows == NULL)
+        {
+            printf("\t<%s> ERROR: Could not grow a query result to [%lld] rows\n", __PRETTY_FUNCTION__, new_capacity);
+            return NULL;
+        }
+        table->rows     = new_rows;
+        table->capacity = new_capacity;
+    }
+    void *row = (byte *) table->rows + (size_t) table->row_ctr * table->row_size;
+    memset(row, NULL_BINARY, table->row_size);
+    table->row_ctr++;
+    return row;
+}
+
+/************************************************
+ * const char *storage_field()
+ *  @param  const char *field
+ *
+ *  @brief  Reads a SQL NULL as an empty string
+ *
+ *  @author Kerry
+ ************************************************/
+static const char *storage_field(const char *field)
+{
+    return field == NULL ? "" : field;
+}
+
+/************************************************
+ * Row Functions
+ * =============
+ * One per reader, each decoding a row into the reader's record
+ ************************************************/
+static int storage_monitor_row(void *context, unsigned int column_ctr, char **fields)
+{
+    if (column_ctr < 4)
+    {
+        return CS_ERROR_DB_QUERY;
+    }
+    csl_monitor_record *monitor = storage_row_next(context);
+    if (monitor == NULL)
+    {
+        return CS_ERROR;
+    }
+    monitor->monitor_id     = strtoull(storage_field(fields[0]), NULL, BASE_TEN);
+    snprintf(monitor->monitor_name, SIZE_HOST_NAME, "%s", storage_field(fields[1]));
+    snprintf((char *) monitor->monitor_identifier, SIZE_DEVICE_IDENTIFIER, "%s", storage_field(fields[2]));
+    monitor->monitor_sync   = (unsigned short) strtol(storage_field(fields[3]), NULL, BASE_TEN);
+    return CS_SUCCESS;
+}
+
+static int storage_monitor_device_row(void *context, unsigned int column_ctr, char **fields)
+{
+    if (column_ctr < 2)
+    {
+        return CS_ERROR_DB_QUERY;
+    }
+    csl_monitor_device_record *device = storage_row_next(context);
+    if (device == NULL)
+    {
+        return CS_ERROR;
+    }
+    return csl_StorageMonitorDeviceDecode(column_ctr, fields, device);
+}
+
+static int storage_standard_row(void *context, unsigned int column_ctr, char **fields)
+{
+    cs_standard_record **standard = context;
+    if (column_ctr < 2 || *standard != NULL)
+    {
+        // A second row - the caller only wants a unique element
+        return CS_ERROR_DB_QUERY;
+    }
+    *standard = calloc(1, sizeof(cs_standard_record));
+    if (*standard == NULL || ((*standard)->cs_element_name = strdup(storage_field(fields[1]))) == NULL)
+    {
+        return CS_ERROR;
+    }
+    (*standard)->cs_element_type = (unsigned short) strtol(storage_field(fields[0]), NULL, BASE_TEN);
+    return CS_SUCCESS;
+}
+
+static int storage_element_name_row(void *context, unsigned int column_ctr, char **fields)
+{
+    char **element_name = context;
+    if (column_ctr < 1 || *element_name != NULL)
+    {
+        return CS_ERROR_DB_QUERY;
+    }
+    *element_name = calloc(SIZE_ELEMENT_NAME + 1, sizeof(char));
+    if (*element_name == NULL)
+    {
+        return CS_ERROR;
+    }
+    snprintf(*element_name, SIZE_ELEMENT_NAME + 1, "%s", storage_field(fields[0]));
+    return CS_SUCCESS;
+}
+
+/************************************************
+ * int csl_StorageOpen()
+ *  @param  unsigned int backend    - STORAGE_MYSQL or STORAGE_SQLITE
+ *
+ *  @brief  Connects the monitor to its database
+ *
+ *  @author Kerry
+ *
+ *  @return CS_SUCCESS on success, CS_ERROR_DB_CONNECTION (or the backend's error) on failure
+ ************************************************/
+int     csl_StorageOpen(unsigned int backend)
+{
+    switch (backend)
+    {
+        case STORAGE_MYSQL:
+            G_storage = csl_MySQLBackend();
+            break;
+
+#ifdef CSL_SQLITE
+        case STORAGE_SQLITE:
+            G_storage = csl_SQLiteBackend();
+            break;
+#endif
+
+        default:
+            printf("\t<%s> ERROR: Storage backend [%u] is not built into this monitor\n", __PRETTY_FUNCTION__, backend);
+            return CS_ERROR_DB_CONNECTION;
+    }
+
+    int return_value = G_storage->open();
+    if (return_value != CS_SUCCESS)
+    {
+        printf("\t<%s> ERROR: Could not open the %s database\n", __PRETTY_FUNCTION__, G_storage->name);
+        G_storage = NULL;
+        return return_value;
+    }
+    printf("\t<%s> Using the %s database\n", __PRETTY_FUNCTION__, G_storage->name);
+    return CS_SUCCESS;
+}
+
+/************************************************
+ * void csl_StorageClose()
+ *  @param  - None
+ *
+ *  @brief  Disconnects the monitor from its database
+ *
+ *  @author Kerry
+ ************************************************/
+void    csl_StorageClose()
+{
+    if (G_storage != NULL)
+    {
+        G_storage->close();
+        G_storage = NULL;
+    }
+}
+
+/************************************************
+ * int csl_StorageUpdate()
+ *  @param  const char *statement   - An insert, update or delete
+ *
+ *  @brief  Runs a statement that returns no rows
+ *
+ *  @author Kerry
+ *
+ *  @return CS_SUCCESS on success, CS_ERROR_DB_QUERY on failure
+ ************************************************/
+int     csl_StorageUpdate(const char *statement)
+{
+    if (G_storage == NULL)
+    {
+        return CS_ERROR_DB_CONNECTION;
+    }
+
+    int64_t start_usecs = csl_MetricsNow();
+    CSL_TRACE_BEGIN(update_span);
+    int return_value = G_storage->update(statement);
+    if (return_value != CS_SUCCESS)
+    {
+        csl_MetricCount(METRIC_DB_ERRORS, 1);
+    }
+    CSL_TRACE_END(update_span, "db update", -1);
+    csl_MetricObserve(csl_MetricDBStatement(statement), csl_MetricsNow() - start_usecs);
+    return return_value;
+}
+
+/************************************************
+ * long long csl_StorageQuery()
+ *  @param
+ *          const char                  *statement
+ *          csl_storage_row_function    row_function    - NULL to only count the rows
+ *          void                        *context        - Passed to row_function
+ *
+ *  @brief  Runs a query, handing each row to row_function
+ *
+ *  @author Kerry
+ *
+ *  @note   The backend reports the failure itself. The time measured includes row_function's.
+ *
+ *  @return The rows read on success (not counting a row row_function stopped at with CS_END_OF_RUN),
+ *          CS_ERROR_DB_QUERY (or row_function's error code) on failure
+ ************************************************/
+long long csl_StorageQuery(const char *statement, csl_storage_row_function row_function, void *context)
+{
+    if (G_storage == NULL)
+    {
+        return CS_ERROR_DB_CONNECTION;
+    }
+
+    int64_t start_usecs = csl_MetricsNow();
+    CSL_TRACE_BEGIN(query_span);
+    long long return_value = G_storage->query(statement, row_function, context);
+    if (return_value < 0)
+    {
+        csl_MetricCount(METRIC_DB_ERRORS, 1);
+    }
+    CSL_TRACE_END(query_span, "db query", -1);
+    csl_MetricObserve(csl_MetricDBStatement(statement), csl_MetricsNow() - start_usecs);
+    return return_value;
+}
+
+/************************************************
+ * int csl_StorageTruncate()
+ *  @param
+ *          const char  *schema
+ *          const char  *table
+ *
+ *  @brief  Empties a table
+ *
+ *  @author Kerry
+ *
+ *  @return CS_SUCCESS on success, CS_ERROR_DB_QUERY on failure
+ ************************************************/
+int     csl_StorageTruncate(const char *schema, const char *table)
+{
+    if (G_storage == NULL)
+    {
+        return CS_ERROR_DB_CONNECTION;
+    }
+    int return_value = G_storage->truncate(schema, table);
+    if (return_value != CS_SUCCESS)
+    {
+        csl_MetricCount(METRIC_DB_ERRORS, 1);
+    }
+    return return_value;
+}
+
+/************************************************
+ * long long csl_StorageReadMonitors()
+ *  @param
+ *          const char          *statement      - Selecting monitor_id, monitor_name, monitor_identifier, monitor_sync
+ *          csl_monitor_record  **monitor_rows  - Receives the rows, which the caller frees
+ *
+ *  @brief  Reads rows of the monitor view
+ *
+ *  @author Kerry
+ *
+ *  @return The rows read on success (*monitor_rows is NULL when there are none), an error code on failure
+ ************************************************/
+long long csl_StorageReadMonitors(const char *statement, csl_monitor_record **monitor_rows)
+{
+    storage_row_table table = {NULL, sizeof(csl_monitor_record), 0, 0};
+    long long return_value  = csl_StorageQuery(statement, storage_monitor_row, &table);
+    if (return_value < 0)
+    {
+        free(table.rows);
+        table.rows = NULL;
+    }
+    *monitor_rows = table.rows;
+    return return_value;
+}
+
+/************************************************
+ * long long csl_StorageReadMonitorDevices()
+ *  @param
+ *          const char                  *statement      - Selecting device_id, device_identifier
+ *          csl_monitor_device_record   **device_rows   - Receives the rows, which the caller frees
+ *
+ *  @brief  Reads rows of the monitor device view
+ *
+ *  @author Kerry
+ *
+ *  @return The rows read on success (*device_rows is NULL when there are none), an error code on failure
+ ************************************************/
+long long csl_StorageReadMonitorDevices(const char *statement, csl_monitor_device_record **device_rows)
+{
+    storage_row_table table = {NULL, sizeof(csl_monitor_device_record), 0, 0};
+    long long return_value  = csl_StorageQuery(statement, storage_monitor_device_row, &table);
+    if (return_value < 0)
+    {
+        free(table.rows);
+        table.rows = NULL;
+    }
+    *device_rows = table.rows;
+    return return_value;
+}
+
+/************************************************
+ * int csl_StorageMonitorDeviceDecode()
+ *  @param
+ *          unsigned int                column_ctr
+ *          char                        **fields    - device_id, device_identifier
+ *          csl_monitor_device_record   *device     - Receives the decoded row
+ *
+ *  @brief  Decodes a row of the monitor device view, for row functions that consume the rows as they stream
+ *
+ *  @author Kerry
+ *
+ *  @return CS_SUCCESS on success, CS_ERROR_DB_QUERY if the row is short of columns
+ ************************************************/
+int     csl_StorageMonitorDeviceDecode(unsigned int column_ctr, char **fields, csl_monitor_device_record *device)
+{
+    if (column_ctr < 2)
+    {
+        return CS_ERROR_DB_QUERY;
+    }
+    device->device_id = strtoull(storage_field(fields[0]), NULL, BASE_TEN);
+    memset(device->device_identifier, NULL_BINARY, SIZE_DEVICE_IDENTIFIER);
+    snprintf((char *) device->device_identifier, SIZE_DEVICE_IDENTIFIER, "%s", storage_field(fields[1]));
+    return CS_SUCCESS;
+}
+
+/************************************************
+ * cs_standard_record *csl_StorageReadStandard()
+ *  @param  const char *statement   - Selecting element_type, element_name
+ *
+ *  @brief  Reads one element of a Crytica Standard
+ *
+ *  @author Kerry
+ *
+ *  @return The record, which the caller frees (with its cs_element_name), or NULL unless exactly one row was found
+ ************************************************/
+cs_standard_record *csl_StorageReadStandard(const char *statement)
+{
+    cs_standard_record *standard = NULL;
+    long long return_value = csl_StorageQuery(statement, storage_standard_row, &standard);
+    if (return_value != 1 && standard != NULL)
+    {
+        printf("\t<%s> Bad return rows [%lld] from Standard DB Query\n", __PRETTY_FUNCTION__, return_value);
+        free(standard->cs_element_name);
+        free(standard);
+        standard = NULL;
+    }
+    return standard;
+}
+
+/************************************************
+ * char *csl_StorageReadElementName()
+ *  @param  const char *statement   - Selecting element_name
+ *
+ *  @brief  Reads the full name of one element
+ *
+ *  @author Kerry
+ *
+ *  @return The name, which the caller frees, or NULL unless exactly one row was found
+ ************************************************/
+char   *csl_StorageReadElementName(const char *statement)
+{
+    char *element_name = NULL;
+    long long return_value = csl_StorageQuery(statement, storage_element_name_row, &element_name);
+    if (return_value != 1 && element_name != NULL)
+    {
+        printf("\t<%s> Bad return rows [%lld] from Element Name DB Query\n", __PRETTY_FUNCTION__, return_value);
+        free(element_name);
+        element_name = NULL;
+    }
+    return element_name;
+}
+
+/************************************************
+ * int csl_StorageAlertSyncAndPrune()
+ *  @param
+ *          const char          *view_name
+ *          unsigned long long  device_id
+ *
+ *  @brief  Flags the device as having alerts to sync, and prunes the alerts db_sync has already synced
+ *
+ *  @author Kerry
+ *
+ *  @return CS_SUCCESS on success, an error code on failure
+ ************************************************/
+int     csl_StorageAlertSyncAndPrune(const char *view_name, unsigned long long device_id)
+{
+    // Set db_sync alert value in the device table //
+    char query[SIZE_CS_SQL_COMMAND];
+    snprintf(query, SIZE_CS_SQL_COMMAND, "Update %s.%s Set db_sync = db_sync | %d where device_id = %llu",
+             CS_SQL_MONITOR_SCHEMA, CS_SQL_DEVICE_VIEW, CS_SYNC_ALERT, device_id);
+    int return_flag = csl_StorageUpdate(query);
+    if (return_flag != CS_SUCCESS)
+    {
+        return return_flag;
+    }
+
+    // Prune the alert log of all previously sync'd records //
+    snprintf(query, SIZE_CS_SQL_COMMAND, CS_SQL_ALERT_PRUNE_STATEMENT, CS_SQL_MONITOR_SCHEMA, view_name);
+    return csl_StorageUpdate(query);
+}
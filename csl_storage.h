@@ -0,0 +1,230 @@
+
+/************************************************
+ * csl_storage.h
+ * =============
+ *
+ * This is the header file for the CS Storage Library
+ *
+ * Author:      Kerry
+ * Version:     00.00.00
+ * Comments:    One interface to the monitor's database, whichever engine is behind it
+ ************************************************/
+
+#ifndef CRYTICAMONITOR_CSL_STORAGE_H
+#define CRYTICAMONITOR_CSL_STORAGE_H
+
+#include <stdio.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "csl_constants.h"
+#include "CryticaMonitor.h"
+
+/************************************************
+ * #defines
+ * ========
+ ************************************************/
+#define STORAGE_MYSQL               0           // storage_backend in the monitor config
+#define STORAGE_SQLITE              1
+#ifndef FILE_STORAGE_SQLITE                     // The tests (tests/) each build with their own
+#define FILE_STORAGE_SQLITE         "/usr/crytica/cs_monitor.db"
+#endif
+#define STORAGE_MAX_COLUMNS         32
+#define STORAGE_INITIAL_ROWS        16
+
+/************************************************
+ * Storage Backends
+ * ================
+ * Everything the monitor keeps in its database goes through one backend, chosen by storage_backend in the
+ * monitor config:
+ *
+ *      STORAGE_MYSQL   - The local MySQL server that db_sync keeps in step with the backend (csl_mysql.c)
+ *      STORAGE_SQLITE  - An embedded SQLite file, FILE_STORAGE_SQLITE, for small sites and test rigs
+ *                        (csl_sqlite.c, only built with CSL_SQLITE)
+ *
+ * The monitor's statements are plain SQL against the CS_SQL_MONITOR_SCHEMA views, written so that every backend
+ * accepts them. What does differ - FROM_UNIXTIME() and TRUNCATE - is the backend's business.
+ *
+ * A query hands its rows, one at a time, to a csl_storage_row_function. The fields are NUL-terminated text
+ * (NULL for a SQL NULL) and are only valid during the call. The function returns CS_SUCCESS for the next row,
+ * CS_END_OF_RUN to stop reading, or an error code to abandon the query.
+ * Rows are streamed from the server as they are handed over, so a large read runs in constant memory - and the
+ * row function must not run statements of its own, as its thread's connection is busy until the query ends.
+ *
+ * An update or truncate returns CS_ERROR_DB_CONNECTION when the database could not be reached, so that it may be
+ * tried again later (see csl_spool.h), and another error code when the database refused the statement itself, or
+ * when the connection was lost mid-statement and the statement may already have been applied.
+ ************************************************/
+typedef int (*csl_storage_row_function)(void *context, unsigned int column_ctr, char **fields);
+
+typedef struct
+{
+    const char  *name;
+    int         (*open)();
+    void        (*close)();
+    int         (*update)(const char *statement);
+    long long   (*query)(const char *statement, csl_storage_row_function row_function, void *context);
+    int         (*truncate)(const char *schema, const char *table);
+} csl_storage_backend;
+
+/************************************************
+ * **********************************************
+ * Function Prototypes
+ * **********************************************
+ ************************************************/
+
+/************************************************
+ * int csl_StorageOpen()
+ *  @param  unsigned int backend    - STORAGE_MYSQL or STORAGE_SQLITE
+ *
+ *  @brief  Connects the monitor to its database
+ *
+ *  @author Kerry
+ *
+ *  @return CS_SUCCESS on success, CS_ERROR_DB_CONNECTION (or the backend's error) on failure
+ ************************************************/
+int         csl_StorageOpen(unsigned int backend);
+
+/************************************************
+ * void csl_StorageClose()
+ *  @param  - None
+ *
+ *  @brief  Disconnects the monitor from its database
+ *
+ *  @author Kerry
+ ************************************************/
+void        csl_StorageClose();
+
+/************************************************
+ * int csl_StorageUpdate()
+ *  @param  const char *statement   - An insert, update or delete
+ *
+ *  @brief  Runs a statement that returns no rows
+ *
+ *  @author Kerry
+ *
+ *  @return CS_SUCCESS on success, CS_ERROR_DB_QUERY on failure
+ ************************************************/
+int         csl_StorageUpdate(const char *statement);
+
+/************************************************
+ * long long csl_StorageQuery()
+ *  @param
+ *          const char                  *statement
+ *          csl_storage_row_function    row_function    - NULL to only count the rows
+ *          void                        *context        - Passed to row_function
+ *
+ *  @brief  Runs a query, handing each row to row_function
+ *
+ *  @author Kerry
+ *
+ *  @return The rows read on success (not counting a row row_function stopped at with CS_END_OF_RUN),
+ *          CS_ERROR_DB_QUERY (or row_function's error code) on failure
+ ************************************************/
+long long   csl_StorageQuery(const char *statement, csl_storage_row_function row_function, void *context);
+
+/************************************************
+ * int csl_StorageTruncate()
+ *  @param
+ *          const char  *schema
+ *          const char  *table
+ *
+ *  @brief  Empties a table
+ *
+ *  @author Kerry
+ *
+ *  @return CS_SUCCESS on success, CS_ERROR_DB_QUERY on failure
+ ************************************************/
+int         csl_StorageTruncate(const char *schema, const char *table);
+
+/************************************************
+ * **********************************************
+ * Monitor Specific Storage Functions
+ * ==================================
+ * Each runs a query whose columns are in the order given, and decodes the rows into the monitor's records
+ * **********************************************
+ ************************************************/
+
+/************************************************
+ * long long csl_StorageReadMonitors()
+ *  @param
+ *          const char          *statement      - Selecting monitor_id, monitor_name, monitor_identifier, monitor_sync
+ *          csl_monitor_record  **monitor_rows  - Receives the rows, which the caller frees
+ *
+ *  @brief  Reads rows of the monitor view
+ *
+ *  @author Kerry
+ *
+ *  @return The rows read on success (*monitor_rows is NULL when there are none), an error code on failure
+ ************************************************/
+long long   csl_StorageReadMonitors(const char *statement, csl_monitor_record **monitor_rows);
+
+/************************************************
+ * long long csl_StorageReadMonitorDevices()
+ *  @param
+ *          const char                  *statement      - Selecting device_id, device_identifier
+ *          csl_monitor_device_record   **device_rows   - Receives the rows, which the caller frees
+ *
+ *  @brief  Reads rows of the monitor device view
+ *
+ *  @author Kerry
+ *
+ *  @return The rows read on success (*device_rows is NULL when there are none), an error code on failure
+ ************************************************/
+long long   csl_StorageReadMonitorDevices(const char *statement, csl_monitor_device_record **device_rows);
+
+/************************************************
+ * int csl_StorageMonitorDeviceDecode()
+ *  @param
+ *          unsigned int                column_ctr
+ *          char                        **fields    - device_id, device_identifier
+ *          csl_monitor_device_record   *device     - Receives the decoded row
+ *
+ *  @brief  Decodes a row of the monitor device view, for row functions that consume the rows as they stream
+ *
+ *  @author Kerry
+ *
+ *  @return CS_SUCCESS on success, CS_ERROR_DB_QUERY if the row is short of columns
+ ************************************************/
+int         csl_StorageMonitorDeviceDecode(unsigned int column_ctr, char **fields, csl_monitor_device_record *device);
+
+/************************************************
+ * cs_standard_record *csl_StorageReadStandard()
+ *  @param  const char *statement   - Selecting element_type, element_name
+ *
+ *  @brief  Reads one element of a Crytica Standard
+ *
+ *  @author Kerry
+ *
+ *  @return The record, which the caller frees (with its cs_element_name), or NULL unless exactly one row was found
+ ************************************************/
+cs_standard_record *csl_StorageReadStandard(const char *statement);
+
+/************************************************
+ * char *csl_StorageReadElementName()
+ *  @param  const char *statement   - Selecting element_name
+ *
+ *  @brief  Reads the full name of one element
+ *
+ *  @author Kerry
+ *
+ *  @return The name, which the caller frees, or NULL unless exactly one row was found
+ ************************************************/
+char       *csl_StorageReadElementName(const char *statement);
+
+/************************************************
+ * int csl_StorageAlertSyncAndPrune()
+ *  @param
+ *          const char          *view_name
+ *          unsigned long long  device_id
+ *
+ *  @brief  Flags the device as having alerts to sync, and prunes the alerts db_sync has already synced
+ *
+ *  @author Kerry
+ *
+ *  @return CS_SUCCESS on success, an error code on failure
+ ************************************************/
+int         csl_StorageAlertSyncAndPrune(const char *view_name, unsigned long long device_id);
+
+#endif //CRYTICAMONITOR_CSL_STORAGE_H
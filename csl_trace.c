@@ -0,0 +1,248 @@
+//
+// Created by kerry on 10/19/26.
+//
+
+#include "csl_trace.h"
+
+#ifdef CSL_TRACE
+
+/************************************************
+ * The Trace Rings
+ * ===============
+ * Each thread's ring is allocated on its first span and registered in G_trace_rings, so a dump can find it.
+ * Only the owning thread writes a ring. A dump reads the rings while they are being written, so a span being
+ * overwritten at that moment may come out mangled - acceptable for a diagnostic build.
+ * The rings are kept until the process exits.
+ ************************************************/
+static __thread csl_trace_ring  *G_trace_ring;
+static csl_trace_ring           *G_trace_rings[TRACE_MAX_THREADS];
+static unsigned int             G_trace_ring_ctr;
+static pthread_mutex_t          G_trace_lock = PTHREAD_MUTEX_INITIALIZER;
+static uint64_t                 G_trace_ticks_at_init;
+static int64_t                  G_trace_usecs_at_init;
+static volatile sig_atomic_t    G_trace_dump_requested;
+
+/************************************************
+ * int64_t trace_usecs()
+ *  @param  - None
+ *
+ *  @brief  Returns the monotonic clock in microseconds
+ *
+ *  @author Kerry
+ ************************************************/
+static int64_t trace_usecs()
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (int64_t) now.tv_sec * 1000000 + now.tv_nsec / 1000;
+}
+
+/************************************************
+ * void trace_signal_handler()
+ *  @param  int signal_number
+ *
+ *  @brief  Asks the message thread for a dump - the dump itself is not safe to do in a signal handler
+ *
+ *  @author Kerry
+ ************************************************/
+static void trace_signal_handler(int signal_number)
+{
+    (void) signal_number;
+    G_trace_dump_requested = 1;
+}
+
+/************************************************
+ * csl_trace_ring *trace_ring()
+ *  @param  - None
+ *
+ *  @brief  Returns the calling thread's ring, allocating and registering it the first time
+ *
+ *  @author Kerry
+ *
+ *  @return The ring, or NULL if it could not be allocated or TRACE_MAX_THREADS rings already exist
+ ************************************************/
+static csl_trace_ring *trace_ring()
+{
+    if (G_trace_ring != NULL)
+    {
+        return G_trace_ring;
+    }
+
+    csl_trace_ring *ring = calloc(1, sizeof(csl_trace_ring));
+    if (ring == NULL)
+    {
+        return NULL;
+    }
+    pthread_mutex_lock(&G_trace_lock);
+    if (G_trace_ring_ctr < TRACE_MAX_THREADS)
+    {
+        snprintf(ring->thread_name, SIZE_TRACE_THREAD_NAME, "thread %u", G_trace_ring_ctr);
+        G_trace_rings[G_trace_ring_ctr++] = ring;
+        G_trace_ring = ring;
+    }
+    pthread_mutex_unlock(&G_trace_lock);
+
+    if (G_trace_ring == NULL)
+    {
+        free(ring);
+    }
+    return G_trace_ring;
+}
+
+/************************************************
+ * void csl_TraceInit()
+ *  @param  - None
+ *
+ *  @brief  Notes the clocks the span times are converted against and installs the SIGUSR2 handler
+ *
+ *  @author Kerry
+ ************************************************/
+void    csl_TraceInit()
+{
+    G_trace_ticks_at_init = csl_TraceNow();
+    G_trace_usecs_at_init = trace_usecs();
+
+    struct sigaction action;
+    memset(&action, 0, sizeof(action));
+    action.sa_handler = trace_signal_handler;
+    sigemptyset(&action.sa_mask);
+    action.sa_flags   = SA_RESTART;
+    sigaction(SIGUSR2, &action, NULL);
+
+    printf("\t<%s> Tracing is on - send SIGUSR2 to pid [%d] to write a trace\n", __PRETTY_FUNCTION__, getpid());
+}
+
+/************************************************
+ * void csl_TraceRecord()
+ *  @param
+ *          const char  *name           - A string literal naming the stage
+ *          uint64_t    start
+ *          uint64_t    end
+ *          int         device_index    - -1 when the span is not about one device
+ *
+ *  @brief  Records one span in the calling thread's ring
+ *
+ *  @author Kerry
+ ************************************************/
+void    csl_TraceRecord(const char *name, uint64_t start, uint64_t end, int device_index)
+{
+    csl_trace_ring *ring = trace_ring();
+    if (ring == NULL)
+    {
+        return;
+    }
+    csl_trace_span *span = &ring->spans[ring->head & (TRACE_RING_SPANS - 1)];
+    span->name          = name;
+    span->start         = start;
+    span->end           = end;
+    span->device_index  = device_index;
+    __atomic_store_n(&ring->head, ring->head + 1, __ATOMIC_RELEASE);
+}
+
+/************************************************
+ * void csl_TraceThreadName()
+ *  @param  const char *name
+ *
+ *  @brief  Names the calling thread in the trace
+ *
+ *  @author Kerry
+ ************************************************/
+void    csl_TraceThreadName(const char *name)
+{
+    csl_trace_ring *ring = trace_ring();
+    if (ring != NULL)
+    {
+        snprintf(ring->thread_name, SIZE_TRACE_THREAD_NAME, "%s", name);
+    }
+}
+
+/************************************************
+ * int csl_TraceDump()
+ *  @param  - None
+ *
+ *  @brief  Writes every thread's spans to a new trace file
+ *
+ *  @author Kerry
+ *
+ *  @note   The span times are converted to microseconds with the tick rate measured between csl_TraceInit()
+ *          and now. Each thread is a "tid" of its own, named with a thread_name metadata event.
+ *
+ *  @return CS_SUCCESS on success, CS_ERROR if the file could not be written
+ ************************************************/
+int     csl_TraceDump()
+{
+    int64_t elapsed_usecs = trace_usecs() - G_trace_usecs_at_init;
+    if (elapsed_usecs < 1000)
+    {
+        usleep(1000);
+        elapsed_usecs = trace_usecs() - G_trace_usecs_at_init;
+    }
+    double ticks_per_usec = (double) (csl_TraceNow() - G_trace_ticks_at_init) / (double) elapsed_usecs;
+
+    char file_name[SIZE_TRACE_FILE_NAME];
+    snprintf(file_name, SIZE_TRACE_FILE_NAME, TRACE_FILE_FORMAT, getpid(), (long long) time(NULL));
+    FILE *trace_file = fopen(file_name, "w");
+    if (trace_file == NULL)
+    {
+        printf("\t<%s> ERROR: Could not open trace file [%s]\n", __PRETTY_FUNCTION__, file_name);
+        return CS_ERROR;
+    }
+
+    int pid = getpid();
+    unsigned long long span_ctr = 0;
+    fprintf(trace_file, "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[\n");
+
+    pthread_mutex_lock(&G_trace_lock);
+    for (unsigned int t = 0; t < G_trace_ring_ctr; t++)
+    {
+        csl_trace_ring *ring = G_trace_rings[t];
+        fprintf(trace_file, "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":%d,\"tid\":%u,\"args\":{\"name\":\"%s\"}}",
+                t == 0 ? "" : ",\n", pid, t, ring->thread_name);
+
+        uint64_t head  = __atomic_load_n(&ring->head, __ATOMIC_ACQUIRE);
+        uint64_t first = head > TRACE_RING_SPANS ? head - TRACE_RING_SPANS : 0;
+        for (uint64_t i = first; i < head; i++)
+        {
+            csl_trace_span *span = &ring->spans[i & (TRACE_RING_SPANS - 1)];
+            if (span->name == NULL || span->end < span->start || span->start < G_trace_ticks_at_init)
+            {
+                continue;
+            }
+            fprintf(trace_file, ",\n{\"name\":\"%s\",\"ph\":\"X\",\"pid\":%d,\"tid\":%u,\"ts\":%.3f,\"dur\":%.3f",
+                    span->name, pid, t,
+                    (double) (span->start - G_trace_ticks_at_init) / ticks_per_usec,
+                    (double) (span->end - span->start) / ticks_per_usec);
+            if (span->device_index >= 0)
+            {
+                fprintf(trace_file, ",\"args\":{\"device_index\":%d}", span->device_index);
+            }
+            fprintf(trace_file, "}");
+            span_ctr++;
+        }
+    }
+    pthread_mutex_unlock(&G_trace_lock);
+
+    fprintf(trace_file, "\n]}\n");
+    int return_value = fclose(trace_file) == 0 ? CS_SUCCESS : CS_ERROR;
+    printf("\t<%s> Wrote [%llu] spans to [%s]\n", __PRETTY_FUNCTION__, span_ctr, file_name);
+    return return_value;
+}
+
+/************************************************
+ * void csl_TraceDumpIfRequested()
+ *  @param  - None
+ *
+ *  @brief  Calls csl_TraceDump() if SIGUSR2 has arrived since the last dump
+ *
+ *  @author Kerry
+ ************************************************/
+void    csl_TraceDumpIfRequested()
+{
+    if (G_trace_dump_requested)
+    {
+        G_trace_dump_requested = 0;
+        csl_TraceDump();
+    }
+}
+
+#endif //CSL_TRACE
@@ -0,0 +1,173 @@
+
+/************************************************
+ * csl_trace.h
+ * ===========
+ *
+ * This is the header file for the CS Trace Library
+ *
+ * Author:      Kerry
+ * Version:     00.00.00
+ * Comments:    Hot-path trace spans, built only when CSL_TRACE is defined (cmake -DCSL_TRACE=ON)
+ ************************************************/
+
+#ifndef CRYTICAMONITOR_CSL_TRACE_H
+#define CRYTICAMONITOR_CSL_TRACE_H
+
+/************************************************
+ * Trace Spans
+ * ===========
+ * A span times one stage of the hot path (receive, deserialize, convert, evaluate, a DB statement, ...):
+ *
+ *      CSL_TRACE_BEGIN(span);
+ *      ... the stage ...
+ *      CSL_TRACE_END(span, "stage name", device_index);
+ *
+ * Without CSL_TRACE the macros are empty, so a normal build carries no trace code at all.
+ *
+ * With CSL_TRACE each thread records its spans, time-stamped with the CPU's time stamp counter, in a ring of its
+ * own holding the last TRACE_RING_SPANS spans. Nothing is locked on the hot path. Sending the monitor SIGUSR2
+ * (or shutting it down) writes every ring to TRACE_FILE_FORMAT in the Chrome trace event format, which
+ * chrome://tracing and ui.perfetto.dev both open.
+ ************************************************/
+#ifdef CSL_TRACE
+
+#include <stdio.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <time.h>
+#include <signal.h>
+#include <unistd.h>
+#include <pthread.h>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+#include "csl_constants.h"
+
+/************************************************
+ * #defines
+ * ========
+ ************************************************/
+#define TRACE_RING_SPANS        32768           // per thread, a power of two
+#define TRACE_MAX_THREADS       64
+#define TRACE_FILE_FORMAT       "crytica_trace_%d_%lld.json"    // pid, time
+#define SIZE_TRACE_FILE_NAME    64
+#define SIZE_TRACE_THREAD_NAME  32
+
+#define CSL_TRACE_BEGIN(span)                   uint64_t span = csl_TraceNow()
+#define CSL_TRACE_END(span, name, device_index) csl_TraceRecord((name), span, csl_TraceNow(), (device_index))
+#define CSL_TRACE_THREAD(name)                  csl_TraceThreadName(name)
+#define CSL_TRACE_POLL()                        csl_TraceDumpIfRequested()
+#define CSL_TRACE_INIT()                        csl_TraceInit()
+#define CSL_TRACE_DUMP()                        csl_TraceDump()
+
+typedef struct
+{
+    const char  *name;              // a string literal - only the pointer is kept
+    uint64_t    start;
+    uint64_t    end;
+    int         device_index;       // -1 when the span is not about one device
+} csl_trace_span;
+
+typedef struct
+{
+    csl_trace_span  spans[TRACE_RING_SPANS];
+    uint64_t        head;           // spans ever recorded - the newest is at (head - 1) % TRACE_RING_SPANS
+    char            thread_name[SIZE_TRACE_THREAD_NAME];
+} csl_trace_ring;
+
+/************************************************
+ * uint64_t csl_TraceNow()
+ *  @param  - None
+ *
+ *  @brief  Returns the time stamp counter (nanoseconds of the monotonic clock where there is none)
+ *
+ *  @author Kerry
+ ************************************************/
+static inline uint64_t csl_TraceNow()
+{
+#if defined(__x86_64__) || defined(__i386__)
+    return __rdtsc();
+#else
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t) now.tv_sec * 1000000000ULL + (uint64_t) now.tv_nsec;
+#endif
+}
+
+/************************************************
+ * **********************************************
+ * Function Prototypes
+ * **********************************************
+ ************************************************/
+
+/************************************************
+ * void csl_TraceInit()
+ *  @param  - None
+ *
+ *  @brief  Notes the clocks the span times are converted against and installs the SIGUSR2 handler
+ *
+ *  @author Kerry
+ ************************************************/
+void    csl_TraceInit();
+
+/************************************************
+ * void csl_TraceRecord()
+ *  @param
+ *          const char  *name           - A string literal naming the stage
+ *          uint64_t    start
+ *          uint64_t    end
+ *          int         device_index    - -1 when the span is not about one device
+ *
+ *  @brief  Records one span in the calling thread's ring
+ *
+ *  @author Kerry
+ ************************************************/
+void    csl_TraceRecord(const char *name, uint64_t start, uint64_t end, int device_index);
+
+/************************************************
+ * void csl_TraceThreadName()
+ *  @param  const char *name
+ *
+ *  @brief  Names the calling thread in the trace
+ *
+ *  @author Kerry
+ ************************************************/
+void    csl_TraceThreadName(const char *name);
+
+/************************************************
+ * int csl_TraceDump()
+ *  @param  - None
+ *
+ *  @brief  Writes every thread's spans to a new trace file
+ *
+ *  @author Kerry
+ *
+ *  @return CS_SUCCESS on success, CS_ERROR if the file could not be written
+ ************************************************/
+int     csl_TraceDump();
+
+/************************************************
+ * void csl_TraceDumpIfRequested()
+ *  @param  - None
+ *
+ *  @brief  Calls csl_TraceDump() if SIGUSR2 has arrived since the last dump
+ *
+ *  @author Kerry
+ ************************************************/
+void    csl_TraceDumpIfRequested();
+
+#else
+
+#define CSL_TRACE_BEGIN(span)
+#define CSL_TRACE_END(span, name, device_index)
+#define CSL_TRACE_THREAD(name)
+#define CSL_TRACE_POLL()
+#define CSL_TRACE_INIT()
+#define CSL_TRACE_DUMP()
+
+#endif //CSL_TRACE
+
+#endif //CRYTICAMONITOR_CSL_TRACE_H
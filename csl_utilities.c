@@ -106,10 +106,46 @@ char *csl_Byte2String(byte* in_byte, short size)
 char *csl_Time2String(time_t in_time)
 {
     char *out_string = calloc(SIZE_OF_TIME, sizeof(char));
-    struct tm *ts;
-    ts = localtime(&in_time);
-//    strftime(out_string, sizeof(out_string), "%a %Y-%m-%d %H:%M:%S %Z", ts);
-    strftime(out_string, SIZE_OF_TIME, "%Y-%m-%d %H:%M:%S", ts); // YYYY-MM-DD HH:MM:SS
+    return csl_TimeFormat(out_string, in_time);
+}
+
+/************************************************
+ * The Time Format Cache
+ * =====================
+ * Each thread keeps the last minute it formatted. A time within that minute only needs its
+ * seconds rewritten, so localtime_r() and strftime() run at most once a minute per thread.
+ ************************************************/
+static __thread time_t  G_time_cache_minute = -1;
+static __thread char    G_time_cache_string[SIZE_OF_TIME];
+
+/************************************************
+ * char *csl_TimeFormat()
+ *  @param
+ *          char    *out_string - At least SIZE_OF_TIME bytes
+ *          time_t  in_time
+ *
+ *  @brief  Formats in_time as local "YYYY-MM-DD HH:MM:SS" into out_string
+ *
+ *  @author Kerry
+ *
+ *  @return out_string
+ ************************************************/
+char *csl_TimeFormat(char *out_string, time_t in_time)
+{
+    time_t seconds = in_time - G_time_cache_minute;
+    if (G_time_cache_minute < 0 || seconds < 0 || seconds >= SECONDS_PER_MINUTE)
+    {
+        struct tm ts;
+        localtime_r(&in_time, &ts);
+        strftime(G_time_cache_string, SIZE_OF_TIME, "%Y-%m-%d %H:%M:%S", &ts); // YYYY-MM-DD HH:MM:SS
+        G_time_cache_minute = in_time - ts.tm_sec;
+        seconds             = ts.tm_sec;
+    }
+
+    // The seconds are always the last two characters
+    G_time_cache_string[TIME_STRING_SECONDS]     = (char) ('0' + seconds / 10);
+    G_time_cache_string[TIME_STRING_SECONDS + 1] = (char) ('0' + seconds % 10);
+    memcpy(out_string, G_time_cache_string, TIME_STRING_SECONDS + 3);
     return out_string;
 }
 
@@ -141,8 +177,8 @@ int csl_get_last_octet(char *ip_address_internal)
 
 double csl_AssignProbeID(unsigned long long monitor_id, unsigned short device_index)
 {
-    double return_probe_id  = (double)(monitor_id * MAX_DEVICES) + device_index + 1;
-    return_probe_id         = return_probe_id / MAX_DEVICES;
+    double return_probe_id  = (double)(monitor_id * PROBE_ID_DEVICE_BASE) + device_index + 1;
+    return_probe_id         = return_probe_id / PROBE_ID_DEVICE_BASE;
     return return_probe_id;
 }
 
@@ -196,6 +232,276 @@ byte *csl_String2Hash(byte *string_in, short hash_length)
     return hash_out;
 }
 
+/************************************************
+ * Arena-backed Conversion Functions
+ * =================================
+ * These match the conversions above, except that the result is carved out of an arena
+ * rather than calloc'd, so the caller never frees it.
+ ************************************************/
+
+char *csl_ArenaByte2String(csl_arena *arena, byte* in_byte, short size)
+{
+    char *return_string = csl_ArenaAlloc(arena, size + 1);
+    memcpy(return_string, in_byte, size);
+    return return_string;
+}
+
+char *csl_ArenaHash2String(csl_arena *arena, byte *hash_in, short hash_length)
+{
+    return csl_ArenaByte2String(arena, hash_in, hash_length);
+}
+
+byte *csl_ArenaMacAddressExpand(csl_arena *arena, byte *short_address)
+{
+    byte *long_address = csl_ArenaAlloc(arena, SIZE_MAC_ADDRESS + 1);
+    snprintf((char *) long_address, SIZE_MAC_ADDRESS + 1, "%02x:%02x:%02x:%02x:%02x:%02x",
+             short_address[0],
+             short_address[1],
+             short_address[2],
+             short_address[3],
+             short_address[4],
+             short_address[5]);
+    return long_address;
+}
+
+
+/************************************************
+ * Contiguous Byte Table Functions
+ * ===============================
+ * See csl_utilities.h. Every array grows by doubling, so n fields cost O(n) copying in all, and a reset table
+ * keeps its arrays for the next use.
+ ************************************************/
+
+void csl_ByteTableInit(CS_byte_table *table)
+{
+    memset(table, NULL_BINARY, sizeof(CS_byte_table));
+}
+
+void csl_ByteTableReset(CS_byte_table *table)
+{
+    table->row_ctr      = 0;
+    table->field_ctr    = 0;
+    table->byte_ctr     = 0;
+}
+
+void csl_ByteTableFree(CS_byte_table *table)
+{
+    free(table->row_starts);
+    free(table->fields);
+    free(table->bytes);
+    csl_ByteTableInit(table);
+}
+
+/**** Makes room for needed more elements in a doubling array ****/
+static bool byte_table_reserve(void **array, unsigned int *capacity, unsigned int used, unsigned int needed,
+                               size_t element_size, unsigned int initial_capacity)
+{
+    if (needed <= *capacity - used)
+    {
+        return true;
+    }
+    if (needed > UINT_MAX - used)
+    {
+        return false;
+    }
+    unsigned long long new_capacity = *capacity == 0 ? initial_capacity : *capacity;
+    while (new_capacity < (unsigned long long) used + needed)
+    {
+        new_capacity *= 2;
+    }
+    if (new_capacity > UINT_MAX)
+    {
+        new_capacity = UINT_MAX;
+    }
+    void *new_array = realloc(*array, (size_t) new_capacity * element_size);
+    if (new_array == NULL)
+    {
+        return false;
+    }
+    *array      = new_array;
+    *capacity   = (unsigned int) new_capacity;
+    return true;
+}
+
+bool csl_ByteTableAddRow(CS_byte_table *table)
+{
+    if (byte_table_reserve((void **) &table->row_starts, &table->row_capacity, table->row_ctr, 1,
+                           sizeof(unsigned int), BYTE_TABLE_INITIAL_ROWS) == false)
+    {
+        return false;
+    }
+    table->row_starts[table->row_ctr++] = table->field_ctr;
+    return true;
+}
+
+bool csl_ByteTableAddField(CS_byte_table *table, const void *field, unsigned int length)
+{
+    if (table->row_ctr == 0 && csl_ByteTableAddRow(table) == false)
+    {
+        return false;
+    }
+    if (byte_table_reserve((void **) &table->fields, &table->field_capacity, table->field_ctr, 1,
+                           sizeof(CS_byte_field), BYTE_TABLE_INITIAL_FIELDS) == false
+        || byte_table_reserve((void **) &table->bytes, &table->byte_capacity, table->byte_ctr, length,
+                              sizeof(byte), BYTE_TABLE_INITIAL_BYTES) == false)
+    {
+        return false;
+    }
+    table->fields[table->field_ctr].offset = table->byte_ctr;
+    table->fields[table->field_ctr].length = length;
+    table->field_ctr++;
+    if (length != 0)
+    {
+        memcpy(table->bytes + table->byte_ctr, field, length);
+        table->byte_ctr += length;
+    }
+    return true;
+}
+
+bool csl_ByteTableAddString(CS_byte_table *table, const char *string)
+{
+    size_t length = strlen(string);
+    if (length > UINT_MAX)
+    {
+        return false;
+    }
+    return csl_ByteTableAddField(table, string, (unsigned int) length);
+}
+
+unsigned int csl_ByteTableRowFields(const CS_byte_table *table, unsigned int row)
+{
+    if (row >= table->row_ctr)
+    {
+        return 0;
+    }
+    unsigned int row_end = row + 1 < table->row_ctr ? table->row_starts[row + 1] : table->field_ctr;
+    return row_end - table->row_starts[row];
+}
+
+const byte *csl_ByteTableField(const CS_byte_table *table, unsigned int row, unsigned int column,
+                               unsigned int *length)
+{
+    if (column >= csl_ByteTableRowFields(table, row))
+    {
+        return NULL;
+    }
+    const CS_byte_field *field = &table->fields[table->row_starts[row] + column];
+    if (length != NULL)
+    {
+        *length = field->length;
+    }
+    return table->bytes + field->offset;
+}
+
+bool csl_ByteTableFieldCopy(const CS_byte_table *table, unsigned int row, unsigned int column,
+                            void *out_field, unsigned int length)
+{
+    unsigned int    field_length;
+    const byte      *field = csl_ByteTableField(table, row, column, &field_length);
+    if (field == NULL || field_length != length)
+    {
+        return false;
+    }
+    memcpy(out_field, field, length);
+    return true;
+}
+
+char *csl_ArenaByteTableString(csl_arena *arena, const CS_byte_table *table, unsigned int row, unsigned int column)
+{
+    unsigned int    length;
+    const byte      *field = csl_ByteTableField(table, row, column, &length);
+    if (field == NULL)
+    {
+        return NULL;
+    }
+    char *return_string = csl_ArenaAlloc(arena, (size_t) length + 1);
+    memcpy(return_string, field, length);
+    return_string[length] = END_OF_STRING;
+    return return_string;
+}
+
+size_t csl_ByteTableSerializedSize(const CS_byte_table *table)
+{
+    return sizeof(CS_byte_table_header)
+           + (size_t) table->row_ctr * sizeof(unsigned int)
+           + (size_t) table->field_ctr * sizeof(CS_byte_field)
+           + table->byte_ctr;
+}
+
+/**** Returns the bytes written, 0 if out_buffer is too small ****/
+size_t csl_ByteTableSerialize(const CS_byte_table *table, byte *out_buffer, size_t buffer_length)
+{
+    size_t serialized_size = csl_ByteTableSerializedSize(table);
+    if (buffer_length < serialized_size)
+    {
+        return 0;
+    }
+    CS_byte_table_header header = {table->row_ctr, table->field_ctr, table->byte_ctr};
+    byte *out_position = out_buffer;
+    memcpy(out_position, &header, sizeof(header));
+    out_position += sizeof(header);
+    memcpy(out_position, table->row_starts, (size_t) table->row_ctr * sizeof(unsigned int));
+    out_position += (size_t) table->row_ctr * sizeof(unsigned int);
+    memcpy(out_position, table->fields, (size_t) table->field_ctr * sizeof(CS_byte_field));
+    out_position += (size_t) table->field_ctr * sizeof(CS_byte_field);
+    memcpy(out_position, table->bytes, table->byte_ctr);
+    return serialized_size;
+}
+
+/**** Replaces the table's contents - the buffer is checked before anything in it is trusted ****/
+bool csl_ByteTableDeserialize(CS_byte_table *table, const byte *in_buffer, size_t buffer_length)
+{
+    CS_byte_table_header header;
+    if (buffer_length < sizeof(header))
+    {
+        return false;
+    }
+    memcpy(&header, in_buffer, sizeof(header));
+    size_t row_bytes    = (size_t) header.row_ctr * sizeof(unsigned int);
+    size_t field_bytes  = (size_t) header.field_ctr * sizeof(CS_byte_field);
+    if (buffer_length != sizeof(header) + row_bytes + field_bytes + header.byte_ctr)
+    {
+        return false;
+    }
+
+    csl_ByteTableReset(table);
+    if (byte_table_reserve((void **) &table->row_starts, &table->row_capacity, 0, header.row_ctr,
+                           sizeof(unsigned int), BYTE_TABLE_INITIAL_ROWS) == false
+        || byte_table_reserve((void **) &table->fields, &table->field_capacity, 0, header.field_ctr,
+                              sizeof(CS_byte_field), BYTE_TABLE_INITIAL_FIELDS) == false
+        || byte_table_reserve((void **) &table->bytes, &table->byte_capacity, 0, header.byte_ctr,
+                              sizeof(byte), BYTE_TABLE_INITIAL_BYTES) == false)
+    {
+        return false;
+    }
+    const byte *in_position = in_buffer + sizeof(header);
+    memcpy(table->row_starts, in_position, row_bytes);
+    in_position += row_bytes;
+    memcpy(table->fields, in_position, field_bytes);
+    in_position += field_bytes;
+    memcpy(table->bytes, in_position, header.byte_ctr);
+
+    // **** Every row must start in order within the fields, and every field must lie within the bytes **** //
+    for (unsigned int row = 0; row < header.row_ctr; row++)
+    {
+        if (table->row_starts[row] > header.field_ctr || (row > 0 && table->row_starts[row] < table->row_starts[row - 1]))
+        {
+            return false;
+        }
+    }
+    for (unsigned int field = 0; field < header.field_ctr; field++)
+    {
+        if (table->fields[field].offset > header.byte_ctr
+            || table->fields[field].length > header.byte_ctr - table->fields[field].offset)
+        {
+            return false;
+        }
+    }
+    table->row_ctr      = header.row_ctr;
+    table->field_ctr    = header.field_ctr;
+    table->byte_ctr     = header.byte_ctr;
+    return true;
+}
 
 /************************************************
  * Specific Data Type Conversion Functions
@@ -24,6 +24,7 @@
 
 #include <limits.h>
 #include "csl_constants.h"
+#include "csl_arena.h"
 //#include "CryticaMonitor.h"
 //#include "csl_message.h"
 
@@ -32,6 +33,9 @@
  * ========
  * See csl_constants.h
  ************************************************/
+#define BYTE_TABLE_INITIAL_ROWS     16
+#define BYTE_TABLE_INITIAL_FIELDS   64
+#define BYTE_TABLE_INITIAL_BYTES    1024
 
 /************************************************
  * Typedefs and other structure definitions
@@ -68,6 +72,33 @@ typedef struct
 
 } CS_3d_byte_array;
 
+/**** Contiguous Byte Table *********************/
+typedef struct
+{
+    unsigned int        offset;             // into the table's bytes[]
+    unsigned int        length;
+} CS_byte_field;
+
+typedef struct
+{
+    unsigned int        row_ctr;
+    unsigned int        field_ctr;
+    unsigned int        byte_ctr;
+    unsigned int        row_capacity;
+    unsigned int        field_capacity;
+    unsigned int        byte_capacity;
+    unsigned int        *row_starts;        // index into fields[] of each row's first field
+    CS_byte_field       *fields;
+    byte                *bytes;
+} CS_byte_table;
+
+typedef struct
+{
+    unsigned int        row_ctr;
+    unsigned int        field_ctr;
+    unsigned int        byte_ctr;
+} CS_byte_table_header;
+
 /************************************************
  * Basic Utilities (Project Agnostic)
  * ===============
@@ -85,11 +116,55 @@ bool                csl_IsEven(int my_number);
 byte                *csl_MacAddressExpand(byte *short_address);
 
 char                *csl_Time2String(time_t in_time);
+char                *csl_TimeFormat(char *out_string, time_t in_time);
 
 int                 csl_get_last_octet(char *ip_address_internal);
 
 char                *csl_Byte2String(byte* in_byte, short size);
 
+/************************************************
+ * Arena-backed Conversions
+ * ========================
+ * The same conversions as above, but the result lives in the given arena and is never freed by the caller.
+ * These are the ones to use on the message and scan paths.
+ ************************************************/
+char                *csl_ArenaByte2String(csl_arena *arena, byte* in_byte, short size);
+char                *csl_ArenaHash2String(csl_arena *arena, byte *hash_in, short hash_length);
+byte                *csl_ArenaMacAddressExpand(csl_arena *arena, byte *short_address);
+
+/************************************************
+ * Contiguous Byte Tables
+ * ======================
+ * A table of rows of variable length byte fields - what the CS Byte Arrays below were for - kept in three flat
+ * arrays that double as they fill: the bytes of every field back to back, an (offset, length) per field, and
+ * the first field of each row. Adding a field is one memcpy, and usually no allocation.
+ *
+ * A serialised table is a CS_byte_table_header and the three arrays back to back, in host byte order (it is
+ * for the monitor's own use, not the wire), so it is written and read with one memcpy per array.
+ *
+ * The fixed width conversions (csl_Int2ByteArray() and friends) are csl_ByteTableAddField(table, &value,
+ * sizeof(value)) and csl_ByteTableFieldCopy(table, row, column, &value, sizeof(value)).
+ ************************************************/
+void                csl_ByteTableInit(CS_byte_table *table);
+void                csl_ByteTableReset(CS_byte_table *table);
+void                csl_ByteTableFree(CS_byte_table *table);
+
+bool                csl_ByteTableAddRow(CS_byte_table *table);
+bool                csl_ByteTableAddField(CS_byte_table *table, const void *field, unsigned int length);
+bool                csl_ByteTableAddString(CS_byte_table *table, const char *string);
+
+unsigned int        csl_ByteTableRowFields(const CS_byte_table *table, unsigned int row);
+const byte          *csl_ByteTableField(const CS_byte_table *table, unsigned int row, unsigned int column,
+                                        unsigned int *length);
+bool                csl_ByteTableFieldCopy(const CS_byte_table *table, unsigned int row, unsigned int column,
+                                           void *out_field, unsigned int length);
+char                *csl_ArenaByteTableString(csl_arena *arena, const CS_byte_table *table,
+                                              unsigned int row, unsigned int column);
+
+size_t              csl_ByteTableSerializedSize(const CS_byte_table *table);
+size_t              csl_ByteTableSerialize(const CS_byte_table *table, byte *out_buffer, size_t buffer_length);
+bool                csl_ByteTableDeserialize(CS_byte_table *table, const byte *in_buffer, size_t buffer_length);
+
 
 #ifndef DEPRECATED
 int                 csl_ByteArrayCompare(const byte *array_one, unsigned int array_one_size,
@@ -113,6 +188,8 @@ bool                csl_ZeroByteArray(byte *inArray, unsigned short size);
 /************************************************
  * Crytica Byte Array Utilities
  * ============================
+ * Replaced by the Contiguous Byte Tables above, which do not allocate per field or copy per row
+ *
  *
  * These are utility functions that manage the CS Byte Arrays used mostly in Crytica Messaging
  * CS Byte Arrays are all variable length, consisting of:
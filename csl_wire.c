@@ -0,0 +1,259 @@
+//
+// Created by kerry on 10/19/26.
+//
+
+/************************************************
+ * The Wire Format
+ * ===============
+ * csl_serializeMessageByte() and csl_deserializeMessageByte() are the probe protocol's wire format. They live
+ * apart from the rest of csl_message.c, which needs the monitor, so that tools speaking the protocol (csl_loadgen)
+ * can link them on their own.
+ ************************************************/
+
+#include "csl_message.h"
+
+/************************************************
+ * Specialized Functions
+ * =====================
+ ************************************************/
+
+
+//  4/23/20, GGS, replace CSL_MESSAGE_LENGTH with various message sizes
+//                chg memcpy (several places) with dynamic sizes
+//          CKN emended this code
+
+int csl_serializeMessageByte (csl_zmessage* message, byte* buffer)
+{
+    int buffer_size = message->message_total_size;       //CSL_MESSAGE_LENGTH;
+    size_t index = 0;
+
+    memcpy(buffer+index, &message->message_total_size, sizeof(size_t));
+    index += sizeof(size_t);
+
+    memcpy(buffer+index, &message->file_name_size, sizeof(uint32_t));
+    index += sizeof(uint32_t);
+
+    //"\n" not serialized - add when deserializing
+    memcpy(buffer + index, message->file_name, message->file_name_size);
+    index += message->file_name_size;
+
+    memcpy(buffer + index, message->hash, SIZE_HASH_ELEMENT_Z);
+    index += SIZE_HASH_ELEMENT_Z;
+
+    memcpy(buffer + index, message->probe_ip, SIZE_IP4_ADDRESS);
+    index += SIZE_IP4_ADDRESS;
+
+    memcpy(buffer + index, message->probe_mac_address, IFHWADDRLEN);
+    index += IFHWADDRLEN;
+
+    memcpy(buffer + index, message->probe_uuid, SIZE_ZUUID);
+    index += SIZE_ZUUID;
+
+    memcpy(buffer + index, &message->probe_event, sizeof(uint32_t));
+    index += sizeof(uint32_t);
+
+    memcpy(buffer + index, message->hostname, SIZE_HOST_NAME);
+    index += SIZE_HOST_NAME;
+
+    memcpy (buffer + index, &message->probe_id, sizeof(uint32_t));
+    index += sizeof(uint32_t);
+
+    memcpy(buffer + index, message->license_key, SIZE_LICENSE_KEY);
+    index += SIZE_LICENSE_KEY;
+
+    memcpy(buffer + index, &message->file_attribute, sizeof(message->file_attribute));
+    index += sizeof(message->file_attribute);
+
+    if (index != buffer_size)
+    {
+        message->message_total_size = index;
+        memcpy(buffer+0, &message->message_total_size, sizeof(size_t));
+        printf("WARNING! serialization index size [%lu] does not equal buffer size [%d]!\n",
+               index, buffer_size);
+//        fprintf(stderr,"WARNING! serialization index size does not equal buffer size! Data is being lost!\n");
+    }
+
+    return CS_SUCCESS;
+}
+
+int csl_deserializeMessageByte (csl_zmessage* message, byte* buffer)
+{
+//    int buffer_size = CSL_MESSAGE_LENGTH;
+    size_t index = 0;
+
+    memcpy(&message->message_total_size, buffer+index, sizeof(size_t));
+//    printf("message_total_size [%lu]\n", message->message_total_size);
+    index += sizeof(size_t);
+
+    uint32_t buffer_size = message->message_total_size;
+
+    memcpy(&message->file_name_size, buffer+index, sizeof(uint32_t));
+    index += sizeof(uint32_t);
+//    message->file_name  = calloc(message->file_name_size + 1, sizeof (char));
+    memset( message->file_name, NULL_BINARY, SIZE_ELEMENT_NAME);
+    memcpy( message->file_name, buffer + index, message->file_name_size);
+    message->file_name[message->file_name_size] = END_OF_STRING; //nullterm is not sent in msg, so ensure safely terminated strings
+    index += message->file_name_size;
+
+    memcpy( message->hash, buffer+index, SIZE_HASH_ELEMENT_Z);
+    index += SIZE_HASH_ELEMENT_Z;
+
+    memcpy(message->probe_ip, buffer + index, SIZE_IP4_ADDRESS);
+    index += SIZE_IP4_ADDRESS;
+
+/**** This is future code for use of our MAC address ****
+    memcpy(message->probe_mac_address, buffer + index, SIZE_MAC_ADDRESS);
+    index += SIZE_MAC_ADDRESS;
+ ********************************************************/
+    memcpy(message->probe_mac_address, buffer + index, IFHWADDRLEN);
+    index += IFHWADDRLEN;
+
+    memcpy(message->probe_uuid, buffer + index, SIZE_ZUUID);
+    index += SIZE_ZUUID;
+
+    memcpy(&message->probe_event, buffer + index, sizeof(uint32_t));
+    index += sizeof(uint32_t);
+
+    memcpy(message->hostname, buffer + index, SIZE_HOST_NAME);
+    index += SIZE_HOST_NAME;
+
+    memcpy (&message->probe_id, buffer + index, sizeof(uint32_t));
+    index += sizeof(uint32_t);
+
+    memcpy(message->license_key, buffer + index, SIZE_LICENSE_KEY);
+    index += SIZE_LICENSE_KEY;
+
+    memcpy(&message->file_attribute, buffer + index, sizeof(message->file_attribute));
+    index += sizeof(message->file_attribute);
+
+    if (index != buffer_size)
+    {
+        fprintf(stderr, "WARNING! de-serialization index size does not equal buffer size! Data is being lost!\n");
+    }
+
+    return CS_SUCCESS;
+}
+
+/************************************************
+ * size_t csl_MessageWireSize()
+ *  @param  csl_zmessage *message
+ *
+ *  @brief  Returns the size csl_serializeMessageByte() will write for the message, for its message_total_size
+ *
+ *  @author Kerry
+ ************************************************/
+size_t  csl_MessageWireSize(csl_zmessage *message)
+{
+    return sizeof(size_t) + sizeof(uint32_t) + message->file_name_size + SIZE_HASH_ELEMENT_Z + SIZE_IP4_ADDRESS +
+           IFHWADDRLEN + SIZE_ZUUID + sizeof(uint32_t) + SIZE_HOST_NAME + sizeof(uint32_t) + SIZE_LICENSE_KEY +
+           sizeof(message->file_attribute);
+}
+
+#ifndef DEPRECATED
+
+//  4/23/20, GGS, replace CSL_MESSAGE_LENGTH with various message sizes
+//                chg memcpy (several places) with dynamic sizes
+
+int csl_serializeMessageByte (csl_zmessage* message, byte* buffer)
+{
+    int buffer_size = message->message_total_size;       //CSL_MESSAGE_LENGTH;
+    int index = 0;
+
+    memcpy(buffer+index, &message->message_total_size, sizeof(message->message_total_size));
+    index += sizeof(message->message_total_size);
+
+
+    memcpy(buffer+index, &message->file_name_size, sizeof(message->file_name_size));
+    index += sizeof(message->file_name_size);
+
+    //"\n" not serialized - add when deserializing
+    memcpy(buffer + index, message->file_name, message->file_name_size);
+    index += message->file_name_size;
+
+    memcpy(buffer + index, message->hash, sizeof(message->hash));
+    index += sizeof(message->hash);
+
+    memcpy(buffer + index, message->probe_ip, sizeof(message->probe_ip));
+    index += sizeof(message->probe_ip);
+
+    memcpy(buffer + index, message->probe_mac_address, sizeof(message->probe_mac_address));
+    index += sizeof(message->probe_mac_address);
+
+    memcpy(buffer + index, message->probe_uuid, sizeof(message->probe_uuid));
+    index += sizeof(message->probe_uuid);
+
+    memcpy(buffer + index, &message->probe_event, sizeof(uint32_t));
+    index += sizeof(uint32_t);
+
+    memcpy(buffer + index, message->hostname, sizeof(message->hostname));
+    index += sizeof(message->hostname);
+
+    memcpy (buffer + index, &message->probe_id, sizeof(uint32_t));
+    index += sizeof(uint32_t);
+
+
+    memcpy(buffer + index, message->license_key, sizeof(message->license_key));
+    index += sizeof(message->license_key);
+
+
+    if (index != buffer_size) {
+        fprintf(stderr,"ERROR! serialization index size does not equal buffer size! Data is being lost!\n");
+    }
+
+
+    return 0;
+}
+
+int csl_deserializeMessageByte (csl_zmessage* message, byte* buffer)
+{
+//    int buffer_size = CSL_MESSAGE_LENGTH;
+    int index = 0;
+
+    memcpy(&message->message_total_size, buffer+index, sizeof(message->message_total_size));
+    index += sizeof(message->message_total_size);
+
+    uint32_t buffer_size = message->message_total_size;
+
+    memcpy(&message->file_name_size, buffer+index, sizeof(message->file_name_size));
+    index += sizeof(message->file_name_size);
+
+    memcpy( message->file_name, buffer + index, message->file_name_size);
+    message->file_name[message->file_name_size] = '\0'; //nullterm is not sent in msg, so ensure safely terminated strings
+    index += message->file_name_size;
+
+
+    memcpy( message->hash, buffer+index, sizeof(message->hash));
+    index += sizeof(message->hash);
+
+    memcpy(message->probe_ip, buffer + index, sizeof(message->probe_ip));
+    index += sizeof(message->probe_ip);
+
+    memcpy(message->probe_mac_address, buffer + index, sizeof(message->probe_mac_address));
+    index += sizeof(message->probe_mac_address);
+
+    memcpy(message->probe_uuid, buffer + index, sizeof(message->probe_uuid));
+    index += sizeof(message->probe_uuid);
+
+    memcpy(&message->probe_event, buffer + index, sizeof(uint32_t));
+    index += sizeof(uint32_t);
+
+    memcpy(message->hostname, buffer + index, sizeof(message->hostname));
+    index += sizeof(message->hostname);
+
+    memcpy ( &message->probe_id, buffer + index, sizeof(uint32_t));
+    index += sizeof(uint32_t);
+
+    memcpy(message->license_key, buffer + index, sizeof(message->license_key));
+    index += sizeof(message->license_key);
+
+    if (index != buffer_size)
+    {
+        fprintf(stderr, "ERROR! de-serialization index size does not equal buffer size! Data is being lost!\n")
+    }
+
+
+    return 0;
+}
+
+#endif
+
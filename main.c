@@ -13,7 +13,8 @@
 /**** CS headers ****/
 #include "CryticaMonitor.h"
 #include "csl_message.h"
-#include "csl_mysql.h"
+#include "csl_storage.h"
+#include "csl_spool.h"
 
 
 /**** STUB HEADERS ****/
@@ -32,23 +33,35 @@
 static monitor_info_table G_monitor_table;
 
 /************************************************
- * Status Quo Table
- * ================
- * The G_status_quo_table is where the most recent scan for each device is stored.
- *      There is one column (status_quo_column), an array of rows, per device
- *      Each column contains:
- *
- *      There is one row (status_quo_record) in each column for the data of a scanned element
- *
+ * Device Shards
+ * =============
+ * Each device being monitored owns one device_shard, holding its device record, its status quo column (the most
+ * recent scan of each element) and the scan table of its current scan. A shard is allocated when the device is
+ * registered and is guarded by its own shard_lock, so that work for different devices can proceed in parallel.
+ *
+ * The shard pointer array is allocated once, at the configured max_devices, by monitorTablesInitialize() and is
+ * never moved. A shard is only freed by deviceShardsRelease(), under the registry write lock, so a shard is only
+ * used with the registry read lock held - deviceShardLock() keeps it until deviceShardUnlock().
+ * Each device's tables grow as its scans grow, up to the configured max_elements, and their memory is accounted
+ * in the shard's memory_bytes.
+ *
+ * G_device_registry_lock guards the shard pointer array itself and G_monitor_table.device_ctr:
+ *      - read lock     for device lookups, and held with every shard lock
+ *      - write lock    for registering devices and for config updates
+ * Lock order is always registry first, then shard. Never take a second shard lock while holding one.
  ************************************************/
-static status_quo_record G_status_quo_table[MAX_DEVICES][MAX_ELEMENTS];
+static device_shard             **G_device_shards;
+static unsigned int             G_device_shard_capacity;
+static pthread_rwlock_t         G_device_registry_lock = PTHREAD_RWLOCK_INITIALIZER;
 
 /************************************************
- * Device Table
- * ============
- * The G_device_table has one record for each device being monitored
- * **********************************************/
-static device_record G_device_table[MAX_DEVICES];
+ * Scan Grants
+ * ===========
+ * A device scans only when its heartbeat reply tells it to, and it is told to only while it holds a
+ * scan grant. G_scan_grant_ctr counts the grants out. It is only touched from the message thread,
+ * under the shard lock of the device concerned.
+ ************************************************/
+static unsigned int             G_scan_grant_ctr;
 
 /************************************************
  * Device Bad Actor Table
@@ -72,35 +85,18 @@ static csl_zmessage            G_current_zmessage;
 static monitor_comms_t         *G_zmq_comms_t;
 static csl_complete_message    G_current_cs_message;
 
-/************************************************
- * Scan Table
- * ==========
- * Stores all the records of the "current" scan.
- * This table consists of:
- *      unsigned short      scan_element_ctr                - The number or scan table rows
- *      short               device_index                    - The device from which the scan was taken
- *      csl_scan_record     scan_elements[MAX_ELEMENTS]     - An array (rows) for scans, one per element
- ************************************************/
-static scan_structure          G_scan_table;
-
-/************************************************
- * MySQL Globals
- * =============
- * We need to maintain the context of the current MySQL database here in the main module - perhaps in the future
- * that will change
- ************************************************/
-MYSQL                          *G_db_connection;
-
 /************************************************
  * Global Variables for Status, Error, & Indices
  * =============================================
  *
  ************************************************/
 static int                     G_error_status;
-static short                   G_current_scan_device_index;
 
 static pid_t                   G_pid_db_sync;
 
+// The scan thread's status quo diff block (see statusQuoTableSearch())
+static __thread status_quo_diff G_status_quo_diff;
+
 /************************************************
  * Interrupt Stop to "gracefully" exit
  * Not sure we need it ... // todo - research this
@@ -122,6 +118,7 @@ void sig_handler(int signum)
  *
  * **********************************************
  ************************************************/
+#ifndef CSL_NO_MAIN
 int main()
 {
 
@@ -169,7 +166,6 @@ int main()
     // Initialize the status variables //
     bool good_run               = true;
     G_error_status              = CS_SUCCESS;
-    short next_scan_index       = -1;
     short message_device_index  = -1;
 
     // Initialize the config update query fields //
@@ -227,7 +223,7 @@ int main()
 
         // Provide the zmessage with the probe id
         // todo - we need to give the probe the appropriate piece of the probe_id
-        G_current_zmessage.probe_id   = G_device_table[message_device_index].probe_id;
+        G_current_zmessage.probe_id   = G_device_shards[message_device_index]->device.probe_id;
         
         // **** Primary Loop Switch - Switch statement is based upon the message type ****
         switch (message_type)
@@ -236,7 +232,7 @@ int main()
                 break;
 
             case PROBE_HANDSHAKE:
-                if (messageHandshakeProccess(&G_current_zmessage, G_zmq_comms_t) != CS_SUCCESS)
+                if (messageHandshakeProccess(&G_current_zmessage, G_zmq_comms_t, message_device_index) != CS_SUCCESS)
                 {
                     printf("\t<%s> WARNING: Failed Handshake for device_index [%d]\n",
                            __PRETTY_FUNCTION__, message_device_index);
@@ -265,19 +261,12 @@ int main()
                            __PRETTY_FUNCTION__, message_device_index);
                     break;
                 }
-//                G_current_scan_device_index    = deviceFindByDeviceIdentifier(
-//                        G_current_cs_message.message_header.from_address.device_identifier);
-                G_current_scan_device_index = message_device_index;
-//                printf("\t<%s> Scan of [%d] records received from device [%d]\n",
-//                       __PRETTY_FUNCTION__, G_scan_table.scan_element_ctr, G_current_scan_device_index);
-                good_run = scanEvaluate(G_current_scan_device_index);
+//                printf("\t<%s> Scan received from device [%d]\n", __PRETTY_FUNCTION__, message_device_index);
+                good_run = scanEvaluate(message_device_index);
+                scanGrantRelease(message_device_index, good_run);
                 if (good_run)
                 {
-                    G_device_table[G_current_scan_device_index].currently_scanning = false;
-
- //                   next_scan_index = scan_get_next_index((short) (G_current_scan_device_index + 1));
- //                   messageHeartBeatProcess(next_scan_index);
-                    messageHeartBeatProcess(G_current_scan_device_index);
+                    messageHeartBeatProcess(message_device_index);
                 }
                 break;
 
@@ -309,6 +298,7 @@ int main()
 
     return EXIT_SUCCESS;
 }
+#endif //CSL_NO_MAIN
 /************************************************
  *	End of Main Module
  ************************************************/
@@ -347,34 +337,48 @@ int alertDeviceWriteRecord(device_alert_record *alert_record)
     int         return_value    = CS_SUCCESS;
     char        mysql_insert[SIZE_CS_SQL_COMMAND];
     char        alert_data[SIZE_ALERT_DEVICE_DATA];
-    char        *time_string    = csl_Time2String(alert_record->alert_date);
+
+    // Prep the alert "query" //
+    sprintf(alert_data,"Sent From: [%s] [%s] - Sent To: [%s] [%s]",
+            alert_record->device_from_ip_address, alert_record->device_from_info,
+            alert_record->device_to_ip_address, alert_record->device_to_info);
+
+    // Subscribers hear of it first - the device is unknown, so the event carries the alert_data as its name //
+    csl_alert_event alert_event;
+    memset(&alert_event, NULL_BINARY, sizeof(csl_alert_event));
+    alert_event.version             = ALERT_EVENT_VERSION;
+    alert_event.alert_type          = alert_record->alert_type;
+    alert_event.alert_count         = 1;
+    alert_event.monitor_id          = alert_record->monitor_id;
+    alert_event.device_id           = UNKNOWN_DEVICE_ID;
+    alert_event.alert_date          = alert_record->alert_date;
+    alert_event.first_alert_date    = alert_record->alert_date;
+    csl_PublishAlert(G_zmq_comms_t, &alert_event, alert_data);
 
     // First prune the alert log of all the already sync'd records //
-    return_value = csl_alert_sync_and_prune(G_db_connection, CS_SQL_ALERT_LOG_VIEW, UNKNOWN_DEVICE_ID);
+    return_value = csl_SpoolAlertSyncAndPrune(CS_SQL_ALERT_LOG_VIEW, UNKNOWN_DEVICE_ID);
     if (return_value != CS_SUCCESS)
     {
         return return_value;
     }
 
-    // Prep the alert "query" //
-    sprintf(alert_data,"Sent From: [%s] [%s] - Sent To: [%s] [%s]",
-            alert_record->device_from_ip_address, alert_record->device_from_info,
-            alert_record->device_to_ip_address, alert_record->device_to_info);
-
     //   sprintf(mysql_insert, "Insert into cs_monitor.v_alert_log "
     sprintf(mysql_insert, "Insert into %s.%s "
                           "(monitor_id, device_identifier, probe_id, alert_type, alert_data, alert_process_date, alert_sync) "
-                          "values (%llu, '%s', %f, %d, '%s', '%s', 0)",
+                          "values (%llu, '%s', %f, %d, '%s', " CS_SQL_FROM_EPOCH ", 0)",
             CS_SQL_MONITOR_SCHEMA, CS_SQL_ALERT_LOG_VIEW,
             alert_record->monitor_id,
             alert_record->device_identifier,
-            csl_AssignProbeID(alert_record->monitor_id, MAX_DEVICES-2),
+            csl_AssignProbeID(alert_record->monitor_id, PROBE_ID_DEVICE_BASE-2),
             alert_record->alert_type,
             alert_data,
-            time_string);
-    return_value = csl_UpdateDB(G_db_connection, mysql_insert);
+            (long long) alert_record->alert_date);
+    return_value = csl_SpoolUpdate(mysql_insert);
+    if (return_value == CS_SUCCESS)
+    {
+        csl_MetricCount(METRIC_ALERTS, 1);
+    }
 
-    free (time_string);
     return return_value;
 }
 
@@ -468,6 +472,7 @@ bool alertOnElementAddition(unsigned short device_index, csl_scan_record scan_el
     return alertOnElementModification(device_index, scan_element, ALERT_ADD_ELEMENT);
 #ifdef FUTURE_CODE // When we might want to have a different type of message for add versus modify
     bool return_flag = true;
+    device_shard *shard = G_device_shards[device_index];
 
     // Build the alert record and write it to the database
     scan_alert_record alert_record;
@@ -479,11 +484,11 @@ bool alertOnElementAddition(unsigned short device_index, csl_scan_record scan_el
     strcpy(alert_record.element_name, scan_element.element_name);
     memcpy(alert_record.scan_value, scan_element.scan_value, SIZE_HASH_ELEMENT);
     alert_record.scan_date         = scan_element.scan_date;
-    alert_record.device_id         = G_device_table[device_index].device_id;
+    alert_record.device_id         = shard->device.device_id;
     memset(alert_record.device_identifier, NULL_BINARY, SIZE_DEVICE_IDENTIFIER+1);
-    memcpy(alert_record.device_identifier, G_device_table[device_index].device_identifier, SIZE_DEVICE_IDENTIFIER);
+    memcpy(alert_record.device_identifier, shard->device.device_identifier, SIZE_DEVICE_IDENTIFIER);
     alert_record.scan_id           = scan_element.scan_id;
-    alert_record.probe_id          = G_device_table->probe_id;
+    alert_record.probe_id          = shard->device.probe_id;
     if (alertScanWriteRecord(&alert_record) != CS_SUCCESS)
     {
         return_flag = false;
@@ -498,8 +503,8 @@ bool alertOnElementAddition(unsigned short device_index, csl_scan_record scan_el
 /************************************************
  * bool alertOnElementDeletion
  *  @param
+ *          unsigned short      device_index
  *          status_quo_record   deleted_record
- *          unsigned long long  device_id
  *          time_t              scan_date
  *
  *  @brief
@@ -510,13 +515,16 @@ bool alertOnElementAddition(unsigned short device_index, csl_scan_record scan_el
  *
  *  @return true on success, false on failure
  ************************************************/
-bool alertOnElementDeletion (status_quo_record deleted_record, unsigned long long device_id, time_t scan_date)
+bool alertOnElementDeletion (unsigned short device_index, status_quo_record deleted_record, time_t scan_date)
 {
     bool return_flag = true;
+    device_shard *shard = G_device_shards[device_index];
+    unsigned long long device_id = shard->device.device_id;
     // get the element name from the CryticaStandard DB record
     char *element_name = elementNameRetrieve(G_monitor_table.monitor_id,
                                                               device_id,
-                                                              deleted_record.element_identifier);
+                                                              deleted_record.element_identifier,
+                                                              shard->spool_sequence);
     if (strcmp(element_name, ELEMENT_NAME_NOT_FOUND) == 0)
     {
         printf("\t<%s> Could not read element name for:\n", __PRETTY_FUNCTION__);
@@ -534,11 +542,13 @@ bool alertOnElementDeletion (status_quo_record deleted_record, unsigned long lon
         strcpy(alert_record.element_name, element_name);
         memcpy(alert_record.scan_value, deleted_record.scan_value, SIZE_HASH_ELEMENT);
         alert_record.scan_date         = scan_date;
-        alert_record.device_id         = G_device_table[G_current_scan_device_index].device_id;
-        alert_record.probe_id          = csl_AssignProbeID(G_monitor_table.monitor_id, G_current_scan_device_index);
+        alert_record.device_id         = device_id;
+        alert_record.probe_id          = csl_AssignProbeID(G_monitor_table.monitor_id, device_index);
         memset(alert_record.device_identifier, NULL_BINARY, SIZE_DEVICE_IDENTIFIER+1);
-        memcpy(alert_record.device_identifier, G_device_table[G_current_scan_device_index].device_identifier, SIZE_DEVICE_IDENTIFIER);
-        if (alertScanWriteRecord(&alert_record) != CS_SUCCESS)
+        memcpy(alert_record.device_identifier, shard->device.device_identifier, SIZE_DEVICE_IDENTIFIER);
+        alert_record.alert_count       = 1;
+        alert_record.first_alert_date  = alert_record.alert_date;
+        if (alertScanSubmit(device_index, &alert_record) != CS_SUCCESS)
         {
             return_flag = false;
             // todo - Throw Error Message
@@ -566,6 +576,7 @@ bool alertOnElementDeletion (status_quo_record deleted_record, unsigned long lon
 bool alertOnElementModification(unsigned short device_index, csl_scan_record scan_element, short alert_type)
 {
     bool return_flag = true;
+    device_shard *shard = G_device_shards[device_index];
 
     // Build the alert record and write it to the database
     scan_alert_record alert_record;
@@ -577,12 +588,14 @@ bool alertOnElementModification(unsigned short device_index, csl_scan_record sca
     memcpy(alert_record.scan_value, scan_element.scan_value, SIZE_HASH_ELEMENT);
     alert_record.scan_date         = scan_element.scan_date;
     alert_record.alert_date        = time(NULL);
-    alert_record.device_id         = G_device_table[device_index].device_id;
+    alert_record.device_id         = shard->device.device_id;
     memset(alert_record.device_identifier, NULL_BINARY, SIZE_DEVICE_IDENTIFIER+1);
-    memcpy(alert_record.device_identifier, G_device_table[device_index].device_identifier, SIZE_DEVICE_IDENTIFIER);
+    memcpy(alert_record.device_identifier, shard->device.device_identifier, SIZE_DEVICE_IDENTIFIER);
     alert_record.scan_id           = scan_element.scan_id;
-    alert_record.probe_id          = csl_AssignProbeID(G_monitor_table.monitor_id, G_current_scan_device_index);
-    if (alertScanWriteRecord(&alert_record) != CS_SUCCESS)
+    alert_record.probe_id          = csl_AssignProbeID(G_monitor_table.monitor_id, device_index);
+    alert_record.alert_count       = 1;
+    alert_record.first_alert_date  = alert_record.alert_date;
+    if (alertScanSubmit(device_index, &alert_record) != CS_SUCCESS)
     {
         return_flag = false;
         // todo - Throw Error Message
@@ -609,21 +622,46 @@ int alertScanWriteRecord (scan_alert_record *alert_record)
     int  return_value   = CS_SUCCESS;
     char mysql_insert[SIZE_CS_SQL_COMMAND];
     memset(mysql_insert, NULL_BINARY, SIZE_CS_SQL_COMMAND);
-    char *time_string   = csl_Time2String(alert_record->alert_date);
+
+    // Subscribers hear of it first, without waiting on the database //
+    csl_alert_event alert_event;
+    alert_event.version             = ALERT_EVENT_VERSION;
+    alert_event.element_type        = (uint8_t) alert_record->element_type;
+    alert_event.alert_type          = alert_record->alert_type;
+    alert_event.alert_count         = alert_record->alert_count;
+    alert_event.monitor_id          = alert_record->monitor_id;
+    alert_event.device_id           = alert_record->device_id;
+    alert_event.alert_date          = alert_record->alert_date;
+    alert_event.first_alert_date    = alert_record->alert_count > 1 ? alert_record->first_alert_date :
+                                                                     alert_record->alert_date;
+    memcpy(alert_event.scan_value, alert_record->scan_value, SIZE_HASH_ELEMENT);
+    alert_event.reserved            = 0;
+    csl_PublishAlert(G_zmq_comms_t, &alert_event, alert_record->element_name);
 
     // First prune the alert log of all the already sync'd records //
-    return_value = csl_alert_sync_and_prune(G_db_connection, CS_SQL_ALERT_LOG_VIEW,
-                                        G_device_table[G_current_scan_device_index].device_id);
+    return_value = csl_SpoolAlertSyncAndPrune(CS_SQL_ALERT_LOG_VIEW, alert_record->device_id);
     if (return_value != CS_SUCCESS)
     {
         return return_value;
     }
 
+    // **** A summary record carries its count in alert_data ****
+    char alert_data[SIZE_ALERT_DEVICE_DATA] = "NULL";
+    if (alert_record->alert_count > 1)
+    {
+        char first_date[SIZE_OF_TIME];
+        char last_date[SIZE_OF_TIME];
+        snprintf(alert_data, SIZE_ALERT_DEVICE_DATA, "'Summary: [%u] alerts held back from [%s] to [%s]'",
+                 alert_record->alert_count,
+                 csl_TimeFormat(first_date, alert_record->first_alert_date),
+                 csl_TimeFormat(last_date, alert_record->scan_date));
+    }
+
     sprintf(mysql_insert, "Insert into %s.%s "
             "(monitor_id, device_identifier, device_id, probe_id, alert_type, element_type, "
-            "element_name, alert_process_date, alert_sync)"
+            "element_name, alert_data, alert_process_date, alert_sync)"
             " values "
-            "(%llu, '%s', %llu, %f, %d, '%s', '%s', '%s', 0)",
+            "(%llu, '%s', %llu, %f, %d, '%s', '%s', %s, " CS_SQL_FROM_EPOCH ", 0)",
             CS_SQL_MONITOR_SCHEMA, CS_SQL_ALERT_LOG_VIEW,
             alert_record->monitor_id,
             alert_record->device_identifier,
@@ -632,21 +670,263 @@ int alertScanWriteRecord (scan_alert_record *alert_record)
             alert_record->alert_type,
             element_types[alert_record->element_type],
             alert_record->element_name,
-            time_string);
+            alert_data,
+            (long long) alert_record->alert_date);
 
     printf("\t<%s> Alert Scan Write:\n\t\t%s\n", __PRETTY_FUNCTION__, mysql_insert);
 
-    return_value = csl_UpdateDB(G_db_connection, mysql_insert);
+    return_value = csl_SpoolUpdate(mysql_insert);
     if (return_value != CS_SUCCESS)
     {
         printf("\t<%s> **** ERROR: Failed to Insert in %s.%s with command:\n\t%s\n",
                __PRETTY_FUNCTION__, CS_SQL_MONITOR_SCHEMA, CS_SQL_ALERT_LOG_VIEW, mysql_insert);
     }
+    else
+    {
+        csl_MetricCount(METRIC_ALERTS, 1);
+    }
 
-    free (time_string);
     return return_value;
 }
 
+/************************************************
+ * int alertScanSubmit()
+ *  @param
+ *          unsigned short      device_index
+ *          scan_alert_record   *alert_record
+ *
+ *  @brief  Writes a scan alert, or holds it for the window's summary (see Alert Aggregation in CryticaMonitor.h)
+ *
+ *  @author Kerry
+ *
+ *  @note   The caller holds the device's shard_lock
+ *
+ *  @return CS_SUCCESS  - on a successful write, or when the alert is held
+ *          error-code  - on failure
+ ************************************************/
+int alertScanSubmit(unsigned short device_index, scan_alert_record *alert_record)
+{
+    unsigned int window_sec = csl_Config()->alert_window_sec;
+    if (window_sec == 0)
+    {
+        return alertScanWriteRecord(alert_record);
+    }
+
+    // **** Close the last window, if it is over, and open a new one ****
+    alert_aggregator *aggregator = &G_device_shards[device_index]->alerts;
+    alertAggregateFlush(device_index, false);
+    if (aggregator->window_start == 0)
+    {
+        aggregator->window_start = alert_record->alert_date;
+    }
+
+    alert_bucket *bucket = alertBucketFind(aggregator, alert_record);
+    if (bucket == NULL)
+    {
+        return alertScanWriteRecord(alert_record);
+    }
+
+    // **** The first of its kind this window goes out now, unless the device is over its rate ****
+    unsigned int device_rate = csl_Config()->alert_device_rate;
+    if (bucket->leading_written == false && (device_rate == 0 || aggregator->written_ctr < device_rate))
+    {
+        bucket->leading_written = true;
+        aggregator->written_ctr++;
+        return alertScanWriteRecord(alert_record);
+    }
+
+    // **** Otherwise it is held for the summary ****
+    if (bucket->held_ctr == 0)
+    {
+        bucket->first_date      = alert_record->alert_date;
+        bucket->element_name    = strdup(alert_record->element_name);
+    }
+    else if (bucket->element_name != NULL && strcmp(bucket->element_name, alert_record->element_name) != 0)
+    {
+        free(bucket->element_name);
+        bucket->element_name = NULL;
+    }
+    bucket->held_ctr++;
+    bucket->last_date = alert_record->alert_date;
+    csl_MetricCount(METRIC_ALERTS_SUMMARIZED, 1);
+    return CS_SUCCESS;
+}
+
+/************************************************
+ * alert_bucket *alertBucketFind()
+ *  @param
+ *          alert_aggregator    *aggregator
+ *          scan_alert_record   *alert_record
+ *
+ *  @brief  Finds, or adds, the bucket for the alert's directory and type
+ *
+ *  @author Kerry
+ *
+ *  @note   Once a device has ALERT_MAX_BUCKETS - ALERT_SCAN_TYPES buckets, alerts from any other directory share
+ *          an ALERT_OTHER_DIRECTORY bucket for their type, so a device never has more than ALERT_MAX_BUCKETS
+ *
+ *  @return The bucket, or NULL if there was no memory for it
+ ************************************************/
+alert_bucket *alertBucketFind(alert_aggregator *aggregator, scan_alert_record *alert_record)
+{
+    // **** The directory is the element's name up to its last '/' ****
+    char    *last_slash         = strrchr(alert_record->element_name, '/');
+    size_t  directory_length    = last_slash == NULL ? 0 : (size_t) (last_slash - alert_record->element_name);
+    if (last_slash == alert_record->element_name)
+    {
+        directory_length = 1;       // "/"
+    }
+
+    const char *directory = alert_record->element_name;
+    for (int pass_ctr = 0; pass_ctr < 2; pass_ctr++)
+    {
+        for (unsigned int bucket_ctr = 0; bucket_ctr < aggregator->bucket_ctr; bucket_ctr++)
+        {
+            alert_bucket *bucket = &aggregator->buckets[bucket_ctr];
+            if (bucket->alert_type == alert_record->alert_type &&
+                strncmp(bucket->directory, directory, directory_length) == 0 &&
+                bucket->directory[directory_length] == NULL_BINARY)
+            {
+                return bucket;
+            }
+        }
+        // The last ALERT_SCAN_TYPES buckets are kept for ALERT_OTHER_DIRECTORY, one per alert type
+        if (aggregator->bucket_ctr < ALERT_MAX_BUCKETS - ALERT_SCAN_TYPES ||
+            strcmp(directory, ALERT_OTHER_DIRECTORY) == 0)
+        {
+            break;
+        }
+        directory           = ALERT_OTHER_DIRECTORY;
+        directory_length    = strlen(ALERT_OTHER_DIRECTORY);
+    }
+
+    if (aggregator->bucket_ctr == aggregator->bucket_capacity)
+    {
+        unsigned int new_capacity = aggregator->bucket_capacity == 0 ? 16 : aggregator->bucket_capacity * 2;
+        alert_bucket *new_buckets = realloc(aggregator->buckets, new_capacity * sizeof(alert_bucket));
+        if (new_buckets == NULL)
+        {
+            return NULL;
+        }
+        aggregator->buckets         = new_buckets;
+        aggregator->bucket_capacity = new_capacity;
+    }
+    char *bucket_directory = strndup(directory, directory_length);
+    if (bucket_directory == NULL)
+    {
+        return NULL;
+    }
+
+    alert_bucket *bucket = &aggregator->buckets[aggregator->bucket_ctr++];
+    memset(bucket, NULL_BINARY, sizeof(alert_bucket));
+    bucket->alert_type      = alert_record->alert_type;
+    bucket->element_type    = alert_record->element_type;
+    bucket->directory       = bucket_directory;
+    return bucket;
+}
+
+/************************************************
+ * void alertAggregateFlush()
+ *  @param
+ *          unsigned short  device_index
+ *          bool            force           - Close the window even if it is not over
+ *
+ *  @brief  Closes a device's alert window once it is over, writing a summary record for each bucket holding alerts
+ *
+ *  @author Kerry
+ *
+ *  @note   The caller holds the device's shard_lock (or the registry's write lock)
+ ************************************************/
+void alertAggregateFlush(unsigned short device_index, bool force)
+{
+    device_shard        *shard      = G_device_shards[device_index];
+    alert_aggregator    *aggregator = &shard->alerts;
+    time_t              now         = time(NULL);
+    if (aggregator->window_start == 0 ||
+        (force == false && now - aggregator->window_start < (time_t) csl_Config()->alert_window_sec))
+    {
+        return;
+    }
+
+    for (unsigned int bucket_ctr = 0; bucket_ctr < aggregator->bucket_ctr; bucket_ctr++)
+    {
+        alert_bucket *bucket = &aggregator->buckets[bucket_ctr];
+        if (bucket->held_ctr > 0)
+        {
+            scan_alert_record summary_record;
+            memset(&summary_record, NULL_BINARY, sizeof(scan_alert_record));
+            summary_record.monitor_id       = G_monitor_table.monitor_id;
+            summary_record.alert_type       = bucket->alert_type;
+            summary_record.alert_date       = now;
+            summary_record.element_type     = bucket->element_type;
+            snprintf(summary_record.element_name, SIZE_ELEMENT_NAME, "%s",
+                     bucket->element_name != NULL ? bucket->element_name : bucket->directory);
+            summary_record.scan_date        = bucket->last_date;
+            summary_record.device_id        = shard->device.device_id;
+            memcpy(summary_record.device_identifier, shard->device.device_identifier, SIZE_DEVICE_IDENTIFIER);
+            summary_record.probe_id         = csl_AssignProbeID(G_monitor_table.monitor_id, device_index);
+            summary_record.alert_count      = bucket->held_ctr;
+            summary_record.first_alert_date = bucket->first_date;
+            if (alertScanWriteRecord(&summary_record) != CS_SUCCESS)
+            {
+                // todo - Throw Error Message
+            }
+        }
+        free(bucket->directory);
+        free(bucket->element_name);
+    }
+    aggregator->bucket_ctr      = 0;
+    aggregator->written_ctr     = 0;
+    aggregator->window_start    = 0;
+}
+
+/************************************************
+ * void alertAggregateFlushAll()
+ *  @param  - None
+ *
+ *  @brief  Closes every device's alert window, writing the summaries still held
+ *
+ *  @author Kerry
+ *
+ *  @note   Called at shut down, while the database can still take them, and by monitorConfigUpdate() before
+ *          it releases the shards
+ ************************************************/
+void alertAggregateFlushAll()
+{
+    pthread_rwlock_rdlock(&G_device_registry_lock);
+    unsigned int device_ctr = G_monitor_table.device_ctr;
+    pthread_rwlock_unlock(&G_device_registry_lock);
+
+    for (unsigned int device_index = 0; device_index < device_ctr; device_index++)
+    {
+        device_shard *shard = deviceShardLock((short) device_index);
+        if (shard != NULL)
+        {
+            alertAggregateFlush((unsigned short) device_index, true);
+            deviceShardUnlock(shard);
+        }
+    }
+}
+
+/************************************************
+ * void alertAggregateRelease()
+ *  @param  alert_aggregator *aggregator
+ *
+ *  @brief  Frees an aggregator's buckets, without writing what they hold
+ *
+ *  @author Kerry
+ ************************************************/
+void alertAggregateRelease(alert_aggregator *aggregator)
+{
+    for (unsigned int bucket_ctr = 0; bucket_ctr < aggregator->bucket_ctr; bucket_ctr++)
+    {
+        free(aggregator->buckets[bucket_ctr].directory);
+        free(aggregator->buckets[bucket_ctr].element_name);
+    }
+    free(aggregator->buckets);
+    memset(aggregator, NULL_BINARY, sizeof(alert_aggregator));
+}
+
 
 /************************************************
  *      Config File Processing Functions
@@ -730,7 +1010,10 @@ bool configFileCreate(monitor_comm_params *comms)
  *
  *          This function queries the cs_monitor database to find any devices that require a new Crytica Standard.
  *          For those that do, it sets:
- *              G_device_table->cs_standard_flag = true   // the device needs a new Crytica Standard
+ *              shard->device.cs_standard_flag = true   // the device needs a new Crytica Standard
+ *
+ *          A device whose last Crytica Standard is still in the spool (see csl_spool.h) is passed over - its
+ *          date update has not reached the database yet, so it would be found again.
  *
  *  @return Success - number of devices found
  *          Failure - ERROR Code
@@ -748,9 +1031,9 @@ int    cStandardNeeded()
             CS_SQL_MONITOR_SCHEMA, CS_SQL_MONITOR_DEVICE_VIEW,
             G_monitor_table.monitor_id, DEFAULT_DATE);
 
-    MYSQL_RES *result    = NULL;
-    result = csl_QueryDB (G_db_connection, mysql_query);
-    if (result == NULL)                       // query returned an error flag
+    csl_monitor_device_record *monitor_device_row = NULL;
+    long long row_count = csl_StorageReadMonitorDevices(mysql_query, &monitor_device_row);
+    if (row_count < 0)                       // query returned an error flag
     {
         // todo - issue error message on bad query result
         printf("\t<%s> **** ERROR: Failed DB Query:\n", __PRETTY_FUNCTION__ );
@@ -759,31 +1042,37 @@ int    cStandardNeeded()
     }
     else
     {
-        unsigned int row_count    = mysql_num_rows(result);
         if (row_count != 0)  // i.e., There ARE devices needing a new Crytica Standard
         {
-            csl_monitor_device_record *monitor_device_row = csl_ReturnMonitorDeviceRows(G_db_connection, result);
-
             short device_index;
             // **** cycle through the found rows - should be one row per device needing new standard (for this monitor)
-            for (unsigned int i = 0; i < row_count; i++)
+            for (long long i = 0; i < row_count; i++)
             {
                 device_index = deviceFindByDeviceID(monitor_device_row[i].device_id);
                 if (device_index == CS_DEVICE_NOT_FOUND)
                 {
                     // todo issue a fatal error and exit
-                    printf("\t<%s> Could not find device_id [%llu] in G_device_table\n",
+                    printf("\t<%s> Could not find device_id [%llu] in the device shards\n",
                     __PRETTY_FUNCTION__, monitor_device_row[i].device_id);
+                    continue;
                 }
-                // If we have found the device, set the flag in the G_device_table
-                G_device_table[device_index].cs_standard_flag = true;
-                return_count++;
+                // If we have found the device, set the flag in its shard - unless its last standard is still spooled
+                device_shard *shard = deviceShardLock(device_index);
+                if (shard == NULL)
+                {
+                    continue;
+                }
+                if (csl_SpoolRun(shard->spool_sequence) == true)
+                {
+                    shard->device.cs_standard_flag = true;
+                    return_count++;
+                }
+                deviceShardUnlock(shard);
             }
             free(monitor_device_row);
         }
     }
 
-    csl_mysql_free_result(result);
     return return_count;
 }
 
@@ -793,11 +1082,13 @@ int    cStandardNeeded()
  *          unsigned long long   monitor_id
  *          unsigned long long   device_id
  *          unsigned short       element_identifier
+ *          unsigned long long   spool_sequence     - The device's last spooled standard write (see device_shard)
  *
  *  @brief  Queries the cs_monitor.v_cs_standard View to find the current record of a CS-Standard for
  *          a specific element on a specific device.
  *
- *  @note   At the moment, all we are retrieving are the element_name and element_type
+ *  @note   At the moment, all we are retrieving are the element_name and element_type.
+ *          The device's own spooled writes are waited for first, so that its latest standard is read
  *
  *  @author Kerry
  *
@@ -807,25 +1098,27 @@ int    cStandardNeeded()
 cs_standard_record *cStandardReadRecord(
         unsigned long long  monitor_id,
         unsigned long long  device_id,
-        byte                *element_identifier)
+        byte                *element_identifier,
+        unsigned long long  spool_sequence)
 {
-    MYSQL_RES *result    = NULL;
     char mysql_query[SIZE_CS_SQL_COMMAND];
-    char *identifier_string = csl_Hash2String(element_identifier, SIZE_HASH_NAME);
+    if (csl_SpoolWait(spool_sequence) != CS_SUCCESS)
+    {
+        printf("\t<%s> WARNING: The writes of device_id [%llu] are still spooled - reading what the database has\n",
+               __PRETTY_FUNCTION__, device_id);
+    }
+    char *identifier_string = csl_ArenaHash2String(csl_ArenaScan(), element_identifier, SIZE_HASH_NAME);
 
     sprintf(mysql_query,
             "Select element_type, element_name from %s.%s where "
             "Device_ID = %llu and Monitor_ID = %llu and element_identifier = '%s'",
             CS_SQL_MONITOR_SCHEMA, CS_SQL_STANDARD_VIEW,
             device_id, monitor_id, identifier_string);
-    result = csl_QueryDB (G_db_connection, mysql_query);
-    cs_standard_record *standard_record = csl_ReturnStandardRow(G_db_connection, result);
+    cs_standard_record *standard_record = csl_StorageReadStandard(mysql_query);
     if (standard_record == NULL)
     {
         printf("\t<%s> **** ERROR: Could execute query [%s]\n", __PRETTY_FUNCTION__, mysql_query);
     }
-    free(identifier_string);
-    csl_mysql_free_result(result);
     return standard_record;
 }
 
@@ -856,6 +1149,8 @@ cs_standard_record *cStandardReadRecord(
 bool    cStandardWriteToDB(unsigned short device_index)
 {
     bool return_flag    = true;
+    device_shard    *shard      = G_device_shards[device_index];
+    scan_structure  *scan_table = shard->scan_table;
 
     // **** First Clean out the previous CS Standard table **** //
     // todo - Check to see whether or not the CS Standard Table has already been sync'd with the backend ledger
@@ -865,8 +1160,8 @@ bool    cStandardWriteToDB(unsigned short device_index)
     sprintf(sql_command, "Delete from %s.%s "
                          "where standard_id > 0 and monitor_id = %llu and device_id = %llu",
                          CS_SQL_MONITOR_SCHEMA, CS_SQL_STANDARD_VIEW,
-                         G_monitor_table.monitor_id, G_device_table[device_index].device_id);
-    int return_value = csl_UpdateDB (G_db_connection, sql_command);
+                         G_monitor_table.monitor_id, shard->device.device_id);
+    int return_value = csl_SpoolUpdate(sql_command);
     if (return_value != CS_SUCCESS)
     {
         printf("\t<%s> **** ERROR ****\n", __PRETTY_FUNCTION__);
@@ -880,8 +1175,8 @@ bool    cStandardWriteToDB(unsigned short device_index)
     sprintf(sql_command, "Delete from %s.%s "
                          "where monitor_id = %llu and device_id = %llu",
             CS_SQL_MONITOR_SCHEMA, CS_SQL_ELEMENT_ADDED_NAMES_VIEW,
-            G_monitor_table.monitor_id, G_device_table[device_index].device_id);
-    return_value = csl_UpdateDB (G_db_connection, sql_command);
+            G_monitor_table.monitor_id, shard->device.device_id);
+    return_value = csl_SpoolUpdate(sql_command);
     if (return_value != CS_SUCCESS)
     {
         printf("\t<%s> **** ERROR ****\n", __PRETTY_FUNCTION__);
@@ -895,37 +1190,33 @@ bool    cStandardWriteToDB(unsigned short device_index)
 
     // initialize the static fields, those common to this entire Crytica Standard
     new_record.cs_monitor_id     = G_monitor_table.monitor_id;
-    new_record.cs_device_id      = G_device_table[device_index].device_id;
+    new_record.cs_device_id      = shard->device.device_id;
     new_record.cs_date           = time(NULL);       //i.e., time(Null) is "now"
     new_record.cs_standard_type  = CS_CODE_SELF_DEFINED;
 
     // **** Cycle through the device table for this device ****
-    for (int i = 0; i < G_scan_table.scan_element_ctr; i++)
+    for (unsigned int i = 0; i < scan_table->scan_element_ctr; i++)
     {
-        new_record.cs_element_type         = G_scan_table.scan_elements[i].element_type;
-        memcpy(new_record.cs_element_identifier, G_scan_table.scan_elements[i].element_name_hash, SIZE_HASH_NAME);
-        new_record.cs_element_name         = calloc(strlen(G_scan_table.scan_elements[i].element_name) + 1,sizeof(char));
-        strcpy(new_record.cs_element_name, G_scan_table.scan_elements[i].element_name);
-        memcpy(new_record.cs_scan_value, G_scan_table.scan_elements[i].scan_value, SIZE_HASH_ELEMENT);
+        new_record.cs_element_type         = scan_table->scan_elements[i].element_type;
+        memcpy(new_record.cs_element_identifier, scan_table->scan_elements[i].element_name_hash, SIZE_HASH_NAME);
+        new_record.cs_element_name         = scan_table->scan_elements[i].element_name;
+        memcpy(new_record.cs_scan_value, scan_table->scan_elements[i].scan_value, SIZE_HASH_ELEMENT);
 
         if (cStandardWriteRecord(&new_record) != CS_SUCCESS)
         {
             // todo - issue error failed to write new Standard
             return_flag = false;
         }
-        free (new_record.cs_element_name);
     }
 
     // **** Reset the monitor_device crytica_standard_date to "now" ****
-    char *current_time   = csl_Time2String(time(NULL));
     memset (sql_command, NULL_BINARY, SIZE_CS_SQL_COMMAND);
-    sprintf(sql_command, "Update %s.%s set crytica_standard_date = '%s' "
+    sprintf(sql_command, "Update %s.%s set crytica_standard_date = " CS_SQL_FROM_EPOCH " "
                          "where monitor_id = %llu and device_id = %llu",
             CS_SQL_MONITOR_SCHEMA, CS_SQL_MONITOR_DEVICE_VIEW,
-            current_time,
-            G_monitor_table.monitor_id, G_device_table[device_index].device_id);
-    free (current_time);
-    if (csl_UpdateDB(G_db_connection, sql_command) != CS_SUCCESS)
+            (long long) time(NULL),
+            G_monitor_table.monitor_id, shard->device.device_id);
+    if (csl_SpoolUpdate(sql_command) != CS_SUCCESS)
     {
         // todo - issue error message failed to update monitor-device date
         return_flag = false;
@@ -937,12 +1228,13 @@ bool    cStandardWriteToDB(unsigned short device_index)
                          "where device_id = %llu",
             CS_SQL_MONITOR_SCHEMA, CS_SQL_DEVICE_VIEW,
             CS_SYNC_STANDARD,
-            G_device_table[device_index].device_id);
-    if (csl_UpdateDB(G_db_connection, sql_command) != CS_SUCCESS)
+            shard->device.device_id);
+    if (csl_SpoolUpdate(sql_command) != CS_SUCCESS)
     {
         // todo - issue error message failed to update monitor-device date
         return_flag = false;
     }
+    shard->spool_sequence = csl_SpoolSequence();
 
     return return_flag;
 }
@@ -967,20 +1259,20 @@ bool    cStandardWriteToDB(unsigned short device_index)
 int cStandardWriteRecord(cs_standard_record *new_record)
 {
     char mysql_insert[SIZE_CS_SQL_COMMAND];
-    char *time_string               = csl_Time2String(new_record->cs_date);
-    char *element_identifier_string = csl_Hash2String(new_record->cs_element_identifier, SIZE_HASH_NAME);
-    char *scan_value_string         = csl_Hash2String(new_record->cs_scan_value, SIZE_HASH_ELEMENT);
+    csl_arena *arena                = csl_ArenaScan();
+    char *element_identifier_string = csl_ArenaHash2String(arena, new_record->cs_element_identifier, SIZE_HASH_NAME);
+    char *scan_value_string         = csl_ArenaHash2String(arena, new_record->cs_scan_value, SIZE_HASH_ELEMENT);
 
     // **** Prepare the "Query" ****
     sprintf(mysql_insert, "Insert into %s.%s "
                           "(standard_type, standard_date, monitor_id, device_id,"
                           " element_type, element_identifier, element_name, scan_value)"
                           " values "
-                          "(%d, '%s', %llu, %llu,"
+                          "(%d, " CS_SQL_FROM_EPOCH ", %llu, %llu,"
                           " %d, '%s', '%s', '%s')",
             CS_SQL_MONITOR_SCHEMA, CS_SQL_STANDARD_TABLE,
             new_record->cs_standard_type,
-            time_string,
+            (long long) new_record->cs_date,
             new_record->cs_monitor_id,
             new_record->cs_device_id,
 
@@ -991,7 +1283,7 @@ int cStandardWriteRecord(cs_standard_record *new_record)
             scan_value_string);
 
     // **** Submit the Query ****
-    int return_value = csl_UpdateDB (G_db_connection, mysql_insert);
+    int return_value = csl_SpoolUpdate(mysql_insert);
 
     // **** Check the results ****
     if (return_value != CS_SUCCESS)
@@ -1002,9 +1294,6 @@ int cStandardWriteRecord(cs_standard_record *new_record)
         // todo issue error message
     }
 
-    free(time_string);
-    free(element_identifier_string);
-    free(scan_value_string);
 
     return return_value;
 }
@@ -1037,21 +1326,19 @@ int cStandardWriteRecord(cs_standard_record *new_record)
 long long deviceAssignedToMonitor(byte *device_identifier, byte *device_mac_address)
 {
     long long device_id = (long long) CS_DEVICE_NOT_FOUND;
-    MYSQL_RES *result = NULL;
     char mysql_query[SIZE_CS_SQL_COMMAND];
-    char *identifier_string = csl_Byte2String(device_identifier, SIZE_DEVICE_IDENTIFIER);
+    char *identifier_string = csl_ArenaByte2String(csl_ArenaMessage(), device_identifier, SIZE_DEVICE_IDENTIFIER);
 
     sprintf(mysql_query,
             "Select Device_ID, device_identifier from %s.%s "
             "where Device_Identifier = '%s' and Monitor_ID = %llu",
             CS_SQL_MONITOR_SCHEMA, CS_SQL_MONITOR_DEVICE_VIEW,
             identifier_string, G_monitor_table.monitor_id);
-    free(identifier_string);
 
-    result = csl_QueryDB(G_db_connection, mysql_query);
-    if (result != NULL)
+    csl_monitor_device_record *monitor_device_row = NULL;
+    long long return_row_ctr = csl_StorageReadMonitorDevices(mysql_query, &monitor_device_row);
+    if (return_row_ctr >= 0)
     {
-        int return_row_ctr = mysql_num_rows(result);
         switch (return_row_ctr)
         {
             case 0:
@@ -1063,7 +1350,6 @@ long long deviceAssignedToMonitor(byte *device_identifier, byte *device_mac_addr
             case 1:
                 printf("\t<%s>Looking up device_id\n",
                        __PRETTY_FUNCTION__);    // SHOULD NOT BE HERE: BUG IN COMPILER!!!!
-                csl_monitor_device_record *monitor_device_row = csl_ReturnMonitorDeviceRows(G_db_connection, result);
                 if (monitor_device_row != NULL)
                 {
                     device_id = (long long) monitor_device_row[0].device_id;
@@ -1073,7 +1359,6 @@ long long deviceAssignedToMonitor(byte *device_identifier, byte *device_mac_addr
                            __PRETTY_FUNCTION__, device_identifier, G_monitor_table.monitor_id);
                     device_id = (long long) CS_DEVICE_NOT_FOUND;
                 }
-                free(monitor_device_row);
                 break;
 
             default:
@@ -1085,7 +1370,7 @@ long long deviceAssignedToMonitor(byte *device_identifier, byte *device_mac_addr
         } // End of Switch
     }
 
-    csl_mysql_free_result(result);
+    free(monitor_device_row);
     return device_id;
 }
 
@@ -1172,162 +1457,426 @@ bool deviceBadActorTableInitialize()
 }
 
 /************************************************
- * short deviceFindByDeviceID()
+ * device_shard *deviceShardLock()
  *  @param
- *          unsigned long long device_id
+ *          short device_index
  *
- *  @brief  Function to find a device in the G_device_table
+ *  @brief  Returns the shard of a registered device with its shard_lock held
  *
  *  @author Kerry
  *
- *  @note   The monitor maintains a G_device_table in which each entry
- *          contains information about a device the monitor is monitoring.
- *          This function returns the row number corresponding to a
- *          specific device, identified by the device's unique device_id
+ *  @note   Every deviceShardLock() must be paired with a deviceShardUnlock() of the same device_index. The registry
+ *          read lock is held until then, so deviceShardsRelease() cannot free the shard under its holder - never
+ *          take the registry write lock while holding a shard
  *
- * @return the row number (the device_index) of the found device or an error code: CS_DEVICE_NOT_FOUND
+ *  @return Success - a pointer to the locked shard
+ *          Failure - NULL if the device_index is not registered
  ************************************************/
-short deviceFindByDeviceID(unsigned long long device_id)
+device_shard *deviceShardLock(short device_index)
 {
-    short device_index = CS_DEVICE_NOT_FOUND;
-    for (short i = 0; i < G_monitor_table.device_ctr; i++)
+    device_shard *shard = NULL;
+
+    // Registry first, then shard - the read lock is kept until deviceShardUnlock()
+    pthread_rwlock_rdlock(&G_device_registry_lock);
+    if (device_index >= 0 && device_index < G_monitor_table.device_ctr)
     {
-        if (device_id == G_device_table[i].device_id)
-        {
-            device_index  = i;
-            return device_index;
-        }
+        shard = G_device_shards[device_index];
     }
-    //todo Throw Error Message Here
-    printf("\t<%s> **** ERROR: Could Not Find device_id[%llu] in the device_table\n",
-           __PRETTY_FUNCTION__, device_id);
 
-    return CS_DEVICE_NOT_FOUND;
+    if (shard == NULL)
+    {
+        pthread_rwlock_unlock(&G_device_registry_lock);
+        printf("\t<%s> ERROR: No shard for device_index [%d]\n", __PRETTY_FUNCTION__, device_index);
+        return NULL;
+    }
+    pthread_mutex_lock(&shard->shard_lock);
+    return shard;
 }
 
+/************************************************
+ * void deviceShardUnlock()
+ *  @param
+ *          device_shard *shard
+ *
+ *  @brief  Releases a shard obtained from deviceShardLock(), and the registry read lock taken with it
+ *
+ *  @author Kerry
+ ************************************************/
+void deviceShardUnlock(device_shard *shard)
+{
+    if (shard != NULL)
+    {
+        pthread_mutex_unlock(&shard->shard_lock);
+        pthread_rwlock_unlock(&G_device_registry_lock);
+    }
+}
 
 /************************************************
- * short deviceFindByDeviceIdentifier()
+ * device_shard *deviceShardNew()
  *  @param
- *          char *device_identifier
+ *          short device_index
  *
- *  @brief  Function to find a device in the G_device_table
+ *  @brief  Allocates and initializes the shard for the device at device_index
  *
  *  @author Kerry
  *
- *  @note   The monitor maintains a G_device_table in which each entry
- *          contains information about a device the monitor is monitoring.
- *          This function returns the row number corresponding to a
- *          specific device, identified by the device's unique device identifier
+ *  @note   The caller must hold G_device_registry_lock for writing.
+ *          The status quo column is allocated here, the scan table is allocated when the device's first scan arrives.
  *
- * @return the row number (the device_index) of the found device or an error code: CS_DEVICE_NOT_FOUND
+ *  @return Success - a pointer to the new shard
+ *          Failure - NULL
  ************************************************/
-short deviceFindByDeviceIdentifier(byte device_identifier[])
+device_shard *deviceShardNew(short device_index)
 {
-    short device_index = CS_DEVICE_NOT_FOUND;
-    // Check for bad actor first //
-    char device_identifier_string[SIZE_DEVICE_IDENTIFIER+1];
-    memset(device_identifier_string, NULL_BINARY, SIZE_DEVICE_IDENTIFIER+1);
-    memcpy(device_identifier_string, device_identifier, SIZE_DEVICE_IDENTIFIER);
-    if (deviceBadActorFind(device_identifier_string) != CS_DEVICE_NOT_FOUND)
+    // **** The shard pointer array is sized for max_devices up front, and never grows **** //
+    if (device_index < 0 || (unsigned int) device_index >= G_device_shard_capacity)
     {
-        return CS_DEVICE_BAD_ACTOR;
+        printf("\t<%s> ERROR: device_index [%d] is past the [%u] devices configured\n",
+               __PRETTY_FUNCTION__, device_index, G_device_shard_capacity);
+        return NULL;
     }
 
-    for (short i = 0; i < G_monitor_table.device_ctr; i++)
+    device_shard *shard = calloc(1, sizeof(device_shard));
+    if (shard == NULL)
     {
- //       int cmp_result = memcmp(tmp_compare, G_device_table[i].device_identifier, SIZE_DEVICE_IDENTIFIER);
-        if (memcmp(device_identifier, G_device_table[i].device_identifier, SIZE_DEVICE_IDENTIFIER) == 0)
-        {
-            device_index  = i;
-            return device_index;
-        }
+        printf("\t<%s> ERROR: Could not allocate shard for device_index [%d]\n", __PRETTY_FUNCTION__, device_index);
+        return NULL;
     }
-    //todo Throw Error Message Here
-    char display_field[SIZE_DEVICE_IDENTIFIER + 1];
-    memset(display_field, NULL_BINARY, SIZE_DEVICE_IDENTIFIER+1);
-    memcpy(display_field, device_identifier, SIZE_DEVICE_IDENTIFIER);
-    printf("\t<%s> **** WARNING: Could Not Find device_identifier[%s] in the device_table\n"
-           "\t\tWill Check the DB for newly assigned device\n",
-           __PRETTY_FUNCTION__, display_field);
+    if (deviceShardGrowTable(shard, (void **) &shard->status_quo, &shard->status_quo_capacity,
+                             sizeof(status_quo_record), csl_Config()->initial_elements) == false)
+    {
+        printf("\t<%s> ERROR: Could not allocate status quo for device_index [%d]\n", __PRETTY_FUNCTION__, device_index);
+        free(shard);
+        return NULL;
+    }
+    pthread_mutex_init(&shard->shard_lock, NULL);
 
-    return CS_DEVICE_NOT_FOUND;
+    memcpy(shard->device.device_mac_address, DEFAULT_MAC_ADDRESS, strlen(DEFAULT_MAC_ADDRESS));
+    memcpy(shard->device.device_identifier, DEFAULT_MAC_ADDRESS, strlen(DEFAULT_MAC_ADDRESS));
+    shard->device.device_index          = device_index;
+    shard->device.status_element_ctr    = 0;
+    shard->device.cs_standard_flag      = true;
+    shard->device.last_heartbeat        = 0L;
+    shard->device.probe_id              = csl_AssignProbeID(DEFAULT_MONITOR_ID, 1);
+
+    G_device_shards[device_index]       = shard;
+    csl_SchedulerDeviceAdd(device_index);
+    return shard;
 }
 
 /************************************************
- * short deviceFindByProbeID()
+ * bool deviceMemoryCharge()
  *  @param
- *          double probe_id
+ *          device_shard    *shard
+ *          long long       delta_bytes     - positive when memory is allocated, negative when it is freed
  *
- *  @brief  Function to find a device in the device_table
+ *  @brief  Accounts for memory allocated to (or freed from) a device's tables
  *
  *  @author Kerry
  *
- *  @note   The monitor maintains a device_table in which each entry
- *          contains information about a device the monitor is monitoring.
- *          This function returns the row number corresponding to a
- *          specific device, identified by the device's unique probe_id
- *
- *          The probe_id = monitor_id + ((device_index + 1) / MAX_DEVICES)
+ *  @note   An allocation that would take the monitor past the configured max_memory_mb is refused and
+ *          nothing is charged. Frees are always accepted.
  *
- * @return the row number (the device_index) of the found device or an error code: CS_DEVICE_NOT_FOUND
+ *  @return true if the memory was charged, false if it would exceed the budget
  ************************************************/
-short deviceFindByProbeID(double probe_id)
+bool deviceMemoryCharge(device_shard *shard, long long delta_bytes)
 {
-    short device_index = CS_DEVICE_NOT_FOUND;
-    for (short i = 0; i < G_monitor_table.device_ctr; i++)
+    size_t budget = (size_t) csl_Config()->max_memory_mb * 1024 * 1024;
+    size_t total  = __atomic_add_fetch(&G_monitor_table.memory_bytes, (size_t) delta_bytes, __ATOMIC_RELAXED);
+    if (delta_bytes > 0 && budget != 0 && total > budget)
     {
-        if (probe_id == G_device_table[i].probe_id)
-        {
-            device_index  = i;
-            return device_index;
-        }
+        __atomic_sub_fetch(&G_monitor_table.memory_bytes, (size_t) delta_bytes, __ATOMIC_RELAXED);
+        printf("\t<%s> ERROR: Device [%d] needs [%lld] more bytes, monitor memory budget of [%u] MB is used up\n",
+               __PRETTY_FUNCTION__, shard->device.device_index, delta_bytes, csl_Config()->max_memory_mb);
+        return false;
     }
-    //todo Throw Error Message Here
-    printf("\t<%s> **** ERROR: Could Not Find probe_id[%10.4f] in the device_table\n",
-           __PRETTY_FUNCTION__, probe_id);
-    return CS_DEVICE_NOT_FOUND;
+    shard->memory_bytes += delta_bytes;
+    csl_MetricGaugeSet(METRIC_MEMORY_BYTES, (long long) total);
+    csl_MetricDeviceSet(METRIC_DEVICE_MEMORY_BYTES, shard->device.device_index, (long long) shard->memory_bytes);
+    return true;
 }
 
 /************************************************
- * short    deviceRegisterNew()
- *  @param  byte                *device_identifier  - The identifier of the new device being added to the device table
- *  @param  unsigned long long  device_id           - The device_id of the new device being added to the device table
- *  @param  char                *device_mac_address - The MAC address of the new device being added
+ * bool deviceShardGrowTable()
+ *  @param
+ *          device_shard    *shard
+ *          void            **table         - The table to grow (status quo rows or scan rows)
+ *          unsigned int    *capacity       - The number of rows currently allocated in the table
+ *          size_t          row_size
+ *          unsigned int    needed_rows     - The number of rows the table must hold
  *
- *  @brief  To add a new device to the monitor's internal G_device_table. It is assumed at this point that the device
- *          identifier and id were checked with the config database, just to be sure. The new device is added to the
- *          table and the device counter is incremented.
+ *  @brief  Grows one of a device's tables so that it holds at least needed_rows rows
  *
  *  @author Kerry
  *
- *  @return the largest index value, i.e., how many devices (minus one) are in the table
+ *  @note   The capacity doubles, so a device reaches its steady-state size in a handful of scans.
+ *          The caller must hold the shard's lock (or own the shard exclusively).
+ *          New rows are zeroed.
+ *
+ *  @return true on success, false if the table would exceed max_elements or the memory budget
  ************************************************/
-short     deviceRegisterNew(byte *device_identifier, unsigned long long device_id, byte *device_mac_address)
+bool deviceShardGrowTable(device_shard *shard, void **table, unsigned int *capacity, size_t row_size,
+                          unsigned int needed_rows)
 {
-    short return_value                                      = G_monitor_table.device_ctr;
-    G_device_table[G_monitor_table.device_ctr].device_id    = device_id;
+    unsigned int max_rows = csl_Config()->max_elements;
+    if (needed_rows <= *capacity)
+    {
+        return true;
+    }
+    if (needed_rows > max_rows)
+    {
+        printf("\t<%s> ERROR: Device [%d] needs [%u] rows, max_elements is [%u]\n",
+               __PRETTY_FUNCTION__, shard->device.device_index, needed_rows, max_rows);
+        return false;
+    }
 
-    // **** NOTE: For the time-being, we are using the mac address also as the device identifier **** //
-    memset(G_device_table[G_monitor_table.device_ctr].device_identifier, NULL_BINARY, SIZE_DEVICE_IDENTIFIER);
-    memcpy(G_device_table[G_monitor_table.device_ctr].device_identifier, device_mac_address, SIZE_DEVICE_IDENTIFIER);
-    memset(G_device_table[G_monitor_table.device_ctr].device_mac_address, NULL_BINARY, SIZE_MAC_ADDRESS);
-    memcpy(G_device_table[G_monitor_table.device_ctr].device_mac_address, device_mac_address, SIZE_MAC_ADDRESS);
-    G_device_table[G_monitor_table.device_ctr].device_index         = G_monitor_table.device_ctr;
-    G_device_table[G_monitor_table.device_ctr].status_element_ctr   = 0;
-    G_device_table[G_monitor_table.device_ctr].probe_id             =
-            csl_AssignProbeID(G_monitor_table.monitor_id, G_monitor_table.device_ctr);
-    G_device_table[G_monitor_table.device_ctr].cs_standard_flag     = true;
-    G_monitor_table.device_ctr++;
-    if (G_monitor_table.device_ctr >= MAX_DEVICES)
+    unsigned long long new_capacity = *capacity == 0 ? csl_Config()->initial_elements : *capacity;
+    while (new_capacity < needed_rows)
     {
-        printf("\t<%s> ERROR: Device Table Overflow! Device Counter = [%d]\n",
-               __PRETTY_FUNCTION__, G_monitor_table.device_ctr);
+        new_capacity *= 2;
+    }
+    if (new_capacity > max_rows)
+    {
+        new_capacity = max_rows;
     }
-    printf("\t<%s> DEBUG: Just added device [%d], with MAC [%s]\n",
-           __PRETTY_FUNCTION__, return_value, device_mac_address);
-    return return_value;
-}
+
+    long long added_bytes = (long long) ((new_capacity - *capacity) * row_size);
+    if (deviceMemoryCharge(shard, added_bytes) == false)
+    {
+        return false;
+    }
+    void *new_table = realloc(*table, new_capacity * row_size);
+    if (new_table == NULL)
+    {
+        deviceMemoryCharge(shard, -added_bytes);
+        printf("\t<%s> ERROR: Could not grow table for device [%d] to [%llu] rows\n",
+               __PRETTY_FUNCTION__, shard->device.device_index, new_capacity);
+        return false;
+    }
+    memset((byte *) new_table + (size_t) *capacity * row_size, NULL_BINARY, (size_t) added_bytes);
+    *table      = new_table;
+    *capacity   = (unsigned int) new_capacity;
+    return true;
+}
+
+/************************************************
+ * void deviceShardsRelease()
+ *  @param  - None
+ *
+ *  @brief  Frees every device shard and resets the device counter
+ *
+ *  @author Kerry
+ *
+ *  @note   The caller must hold G_device_registry_lock for writing. The (empty) pointer array is kept for reuse.
+ *          Alert summaries still held are dropped - write them first, with alertAggregateFlushAll()
+ ************************************************/
+void deviceShardsRelease()
+{
+    for (unsigned int i = 0; i < G_device_shard_capacity; i++)
+    {
+        device_shard *shard = G_device_shards[i];
+        if (shard == NULL)
+        {
+            continue;
+        }
+        deviceMemoryCharge(shard, -(long long) shard->memory_bytes);
+        alertAggregateRelease(&shard->alerts);
+        pthread_mutex_destroy(&shard->shard_lock);
+        free(shard->status_quo);
+        if (shard->scan_table != NULL)
+        {
+            free(shard->scan_table->scan_elements);
+            free(shard->scan_table);
+        }
+        free(shard);
+        G_device_shards[i] = NULL;
+        csl_SchedulerDeviceRemove((short) i);
+    }
+    G_monitor_table.device_ctr = 0;
+    G_scan_grant_ctr           = 0;     // The grants went with the shards
+}
+
+/************************************************
+ * short deviceFindByDeviceID()
+ *  @param
+ *          unsigned long long device_id
+ *
+ *  @brief  Function to find a device in the device shards
+ *
+ *  @author Kerry
+ *
+ *  @note   The monitor maintains a device shard for each device; each shard
+ *          contains information about a device the monitor is monitoring.
+ *          This function returns the row number corresponding to a
+ *          specific device, identified by the device's unique device_id
+ *
+ * @return the row number (the device_index) of the found device or an error code: CS_DEVICE_NOT_FOUND
+ ************************************************/
+short deviceFindByDeviceID(unsigned long long device_id)
+{
+    short device_index = CS_DEVICE_NOT_FOUND;
+    pthread_rwlock_rdlock(&G_device_registry_lock);
+    for (short i = 0; i < G_monitor_table.device_ctr; i++)
+    {
+        if (device_id == G_device_shards[i]->device.device_id)
+        {
+            device_index  = i;
+            break;
+        }
+    }
+    pthread_rwlock_unlock(&G_device_registry_lock);
+    if (device_index >= 0)
+    {
+        return device_index;
+    }
+    //todo Throw Error Message Here
+    printf("\t<%s> **** ERROR: Could Not Find device_id[%llu] in the device_table\n",
+           __PRETTY_FUNCTION__, device_id);
+
+    return CS_DEVICE_NOT_FOUND;
+}
+
+
+/************************************************
+ * short deviceFindByDeviceIdentifier()
+ *  @param
+ *          char *device_identifier
+ *
+ *  @brief  Function to find a device in the device shards
+ *
+ *  @author Kerry
+ *
+ *  @note   The monitor maintains a device shard for each device; each shard
+ *          contains information about a device the monitor is monitoring.
+ *          This function returns the row number corresponding to a
+ *          specific device, identified by the device's unique device identifier
+ *
+ * @return the row number (the device_index) of the found device or an error code: CS_DEVICE_NOT_FOUND
+ ************************************************/
+short deviceFindByDeviceIdentifier(byte device_identifier[])
+{
+    short device_index = CS_DEVICE_NOT_FOUND;
+    // Check for bad actor first //
+    char device_identifier_string[SIZE_DEVICE_IDENTIFIER+1];
+    memset(device_identifier_string, NULL_BINARY, SIZE_DEVICE_IDENTIFIER+1);
+    memcpy(device_identifier_string, device_identifier, SIZE_DEVICE_IDENTIFIER);
+    if (deviceBadActorFind(device_identifier_string) != CS_DEVICE_NOT_FOUND)
+    {
+        return CS_DEVICE_BAD_ACTOR;
+    }
+
+    pthread_rwlock_rdlock(&G_device_registry_lock);
+    for (short i = 0; i < G_monitor_table.device_ctr; i++)
+    {
+ //       int cmp_result = memcmp(tmp_compare, G_device_shards[i]->device.device_identifier, SIZE_DEVICE_IDENTIFIER);
+        if (memcmp(device_identifier, G_device_shards[i]->device.device_identifier, SIZE_DEVICE_IDENTIFIER) == 0)
+        {
+            device_index  = i;
+            break;
+        }
+    }
+    pthread_rwlock_unlock(&G_device_registry_lock);
+    if (device_index >= 0)
+    {
+        return device_index;
+    }
+    //todo Throw Error Message Here
+    char display_field[SIZE_DEVICE_IDENTIFIER + 1];
+    memset(display_field, NULL_BINARY, SIZE_DEVICE_IDENTIFIER+1);
+    memcpy(display_field, device_identifier, SIZE_DEVICE_IDENTIFIER);
+    printf("\t<%s> **** WARNING: Could Not Find device_identifier[%s] in the device_table\n"
+           "\t\tWill Check the DB for newly assigned device\n",
+           __PRETTY_FUNCTION__, display_field);
+
+    return CS_DEVICE_NOT_FOUND;
+}
+
+/************************************************
+ * short deviceFindByProbeID()
+ *  @param
+ *          double probe_id
+ *
+ *  @brief  Function to find a device in the device_table
+ *
+ *  @author Kerry
+ *
+ *  @note   The monitor maintains a device_table in which each entry
+ *          contains information about a device the monitor is monitoring.
+ *          This function returns the row number corresponding to a
+ *          specific device, identified by the device's unique probe_id
+ *
+ *          The probe_id = monitor_id + ((device_index + 1) / PROBE_ID_DEVICE_BASE)
+ *
+ * @return the row number (the device_index) of the found device or an error code: CS_DEVICE_NOT_FOUND
+ ************************************************/
+short deviceFindByProbeID(double probe_id)
+{
+    short device_index = CS_DEVICE_NOT_FOUND;
+    pthread_rwlock_rdlock(&G_device_registry_lock);
+    for (short i = 0; i < G_monitor_table.device_ctr; i++)
+    {
+        if (probe_id == G_device_shards[i]->device.probe_id)
+        {
+            device_index  = i;
+            break;
+        }
+    }
+    pthread_rwlock_unlock(&G_device_registry_lock);
+    if (device_index >= 0)
+    {
+        return device_index;
+    }
+    //todo Throw Error Message Here
+    printf("\t<%s> **** ERROR: Could Not Find probe_id[%10.4f] in the device_table\n",
+           __PRETTY_FUNCTION__, probe_id);
+    return CS_DEVICE_NOT_FOUND;
+}
+
+/************************************************
+ * short    deviceRegisterNew()
+ *  @param  byte                *device_identifier  - The identifier of the new device being added to the device table
+ *  @param  unsigned long long  device_id           - The device_id of the new device being added to the device table
+ *  @param  char                *device_mac_address - The MAC address of the new device being added
+ *
+ *  @brief  To add a new device to the monitor's device shards. It is assumed at this point that the device
+ *          identifier and id were checked with the config database, just to be sure. The new device is added to the
+ *          table and the device counter is incremented.
+ *
+ *  @author Kerry
+ *
+ *  @return the largest index value, i.e., how many devices (minus one) are in the table
+ ************************************************/
+short     deviceRegisterNew(byte *device_identifier, unsigned long long device_id, byte *device_mac_address)
+{
+    pthread_rwlock_wrlock(&G_device_registry_lock);
+    short return_value  = G_monitor_table.device_ctr;
+    if (return_value >= G_monitor_table.max_devices)
+    {
+        pthread_rwlock_unlock(&G_device_registry_lock);
+        printf("\t<%s> ERROR: Device Table Overflow! Device Counter = [%d]\n",
+               __PRETTY_FUNCTION__, return_value);
+        return CS_TABLE_OVERFLOW;
+    }
+
+    device_shard *shard = deviceShardNew(return_value);
+    if (shard == NULL)
+    {
+        pthread_rwlock_unlock(&G_device_registry_lock);
+        return CS_ERROR;
+    }
+    shard->device.device_id    = device_id;
+
+    // **** NOTE: For the time-being, we are using the mac address also as the device identifier **** //
+    memcpy(shard->device.device_identifier, device_mac_address, SIZE_DEVICE_IDENTIFIER);
+    memcpy(shard->device.device_mac_address, device_mac_address, SIZE_MAC_ADDRESS);
+    shard->device.probe_id     = csl_AssignProbeID(G_monitor_table.monitor_id, return_value);
+    G_monitor_table.device_ctr++;
+    pthread_rwlock_unlock(&G_device_registry_lock);
+
+    printf("\t<%s> DEBUG: Just added device [%d], with MAC [%s]\n",
+           __PRETTY_FUNCTION__, return_value, device_mac_address);
+    return return_value;
+}
 
 /************************************************
  * char *elementNameRetrieve(()
@@ -1335,11 +1884,13 @@ short     deviceRegisterNew(byte *device_identifier, unsigned long long device_i
  *          unsigned long long   monitor_id
  *          unsigned long long   device_id
  *          unsigned short       element_identifier
+ *          unsigned long long   spool_sequence     - The device's last spooled name write (see device_shard)
  *
  *  @brief  Queries the cs_monitor.v_element_names View to find the full element name fo
  *          a specific element on a specific device.
  *
- *  @note   This is not necessary for releases prior to 0.5.0, since we are storing the element name in those
+ *  @note   This is not necessary for releases prior to 0.5.0, since we are storing the element name in those.
+ *          The device's own spooled writes are waited for first, so that a name just added is found
  *
  *  @author Kerry
  *
@@ -1348,11 +1899,16 @@ short     deviceRegisterNew(byte *device_identifier, unsigned long long device_i
 char *elementNameRetrieve(
         unsigned long long  monitor_id,
         unsigned long long  device_id,
-        byte                *element_identifier)
+        byte                *element_identifier,
+        unsigned long long  spool_sequence)
 {
-    MYSQL_RES *result    = NULL;
     char mysql_query[SIZE_CS_SQL_COMMAND];
-    char *identifier_string = csl_Hash2String(element_identifier, SIZE_HASH_NAME);
+    if (csl_SpoolWait(spool_sequence) != CS_SUCCESS)
+    {
+        printf("\t<%s> WARNING: The writes of device_id [%llu] are still spooled - reading what the database has\n",
+               __PRETTY_FUNCTION__, device_id);
+    }
+    char *identifier_string = csl_ArenaHash2String(csl_ArenaScan(), element_identifier, SIZE_HASH_NAME);
 
     sprintf(mysql_query,
                 "Select distinct (element_name) "
@@ -1360,16 +1916,14 @@ char *elementNameRetrieve(
                 "Device_ID = %llu and Monitor_ID = %llu and element_identifier = '%s'",
                 CS_SQL_MONITOR_SCHEMA, CS_SQL_ELEMENT_NAMES_VIEW,
                 device_id, monitor_id, identifier_string);
-    result = csl_QueryDB (G_db_connection, mysql_query);
-    char *element_name = csl_ReturnElementName(G_db_connection, result);
+    char *element_name = csl_StorageReadElementName(mysql_query);
     if (element_name == NULL)
     {
         printf("\t<%s> **** ERROR: Could not execute query [%s]\n", __PRETTY_FUNCTION__, mysql_query);
+        element_name = calloc(strlen(ELEMENT_NAME_NOT_FOUND) + 1, sizeof(char));
         strcpy(element_name, ELEMENT_NAME_NOT_FOUND);
     }
 
-    csl_mysql_free_result(result);
-    free(identifier_string);
     return element_name;
 }
 /************************************************
@@ -1384,9 +1938,9 @@ char *elementNameRetrieve(
  *  @brief
  *      Checks to see if a message has originated from:
  *          A device the monitor has already registered
- *              - the global variable G_current_scan_device_index is set, and CS_SUCCESS is returned
+ *              - its device_index is returned
  *          An authorized device the monitor has not yet registered
- *              - the new device is registered, G_current_scan_device_index is set and CS_SUCCESS is returned
+ *              - the new device is registered and its new device_index is returned
  *          An unauthorized device
  *              - an alert is issued (CS_ALERT_DEVICE_UNKNOWN) and CS_DEVICE_UNKNOWN is returned
  *
@@ -1410,7 +1964,7 @@ int     messageCheckOrigin()
 
     // Find the appropriate device index for the Status Quo Table Lookup
     return_value = deviceFindByDeviceIdentifier(device_identifier);
-    if (return_value < 0)        // i.e., the device was not found in the G_device_table
+    if (return_value < 0)        // i.e., the device was not found in the device shards
     {
         if (return_value == CS_DEVICE_BAD_ACTOR)
         {
@@ -1423,6 +1977,10 @@ int     messageCheckOrigin()
         {
             // Authorized Device - Register it
             return_value                  = deviceRegisterNew(device_identifier, device_id, device_mac_address);
+            if (return_value < 0)
+            {
+                return CS_DEVICE_UNKNOWN;
+            }
             G_current_zmessage.probe_id   = return_value;
 //            G_current_zmessage.probe_id   = csl_AssignProbeID(G_monitor_table.monitor_id, return_value);
 //            G_current_zmessage.probe_id   = G_monitor_table.monitor_id + device_id; // todo - this is also in deviceRegisterNew?
@@ -1439,8 +1997,6 @@ int     messageCheckOrigin()
             return_value = CS_DEVICE_UNKNOWN;
         }
     }
-//    G_current_scan_device_index    = return_value; // We should not need this here.
-
     return return_value;
 }
 
@@ -1448,19 +2004,34 @@ int     messageCheckOrigin()
  * int messageHandshakeProccess()
  *  @param csl_zmessage     *current_message    - The incoming message
  *  @param monitor_comms_t  *comms              - The CZMQ parameter file
+ *  @param short            device_index        - The device that sent the handshake
  *
  *  @brief  Calls the csl_AcknowledgeHandshake function after a handshake message is received
  *
  *  @author Kerry
  *
+ *  @note   The device keeps the capabilities the probe offered that the monitor agrees to (ordered_scans in the
+ *          monitor config allows PROBE_CAPABILITY_ORDERED_SCAN), and the reply names them
+ *
  *  @return the result of the csl_AcknowledgeHandshake function
  ************************************************/
-int     messageHandshakeProccess(csl_zmessage *curr_zmessage, monitor_comms_t *comms)
+int     messageHandshakeProccess(csl_zmessage *curr_zmessage, monitor_comms_t *comms, short device_index)
 {
     int return_flag = CS_SUCCESS;
 
+    // Agree to the capabilities the probe offers that this monitor allows
+    unsigned int allowed        = csl_Config()->ordered_scans != 0 ? PROBE_CAPABILITY_ORDERED_SCAN : 0;
+    unsigned int capabilities   = csl_HandshakeCapabilities(curr_zmessage->file_name) & allowed;
+
+    device_shard *shard = deviceShardLock(device_index);
+    if (shard != NULL)
+    {
+        shard->device.probe_capabilities = capabilities;
+        deviceShardUnlock(shard);
+    }
+
     // Acknowledge Handshake
-    return_flag = csl_AcknowledgeHandshake(curr_zmessage, comms);
+    return_flag = csl_AcknowledgeHandshake(curr_zmessage, comms, device_index, capabilities);
     return return_flag;
 }
 
@@ -1477,7 +2048,20 @@ int     messageHandshakeProccess(csl_zmessage *curr_zmessage, monitor_comms_t *c
 bool    messageHeartBeatProcess(short device_index)
 {
     int success_flag    = CS_SUCCESS;
-    success_flag        = csl_ProcessHeartbeat (G_zmq_comms_t, &G_current_zmessage, &G_device_table[device_index]);
+    device_shard *shard = deviceShardLock(device_index);
+    if (shard == NULL)
+    {
+        return false;
+    }
+    // A heart beat keeps the device's scan session alive
+    if (shard->session.state == SCAN_SESSION_ACTIVE)
+    {
+        shard->session.last_activity = zclock_mono();
+    }
+    bool scan_granted   = scanGrantTake(shard);
+    success_flag        = csl_ProcessHeartbeat (G_zmq_comms_t, &G_current_zmessage, &shard->device, scan_granted,
+                                                scan_granted ? scanSessionResumePoint(shard) : 0);
+    deviceShardUnlock(shard);
 
     if (success_flag != CS_SUCCESS)
     {
@@ -1553,7 +2137,6 @@ int     monitorConfigDBQuery (bool db_sync_just_launched)
 {
 
     int         return_flag = CS_SUCCESS;
-    MYSQL_RES   *result     = NULL;
     char mysql_query[SIZE_CS_SQL_COMMAND];
 
     // **** Set up the Query to read the Config View in the localhost DB **** //
@@ -1574,10 +2157,10 @@ int     monitorConfigDBQuery (bool db_sync_just_launched)
     do
     {
         // **** Query the DB and evaluate the "result" **** //
-        result = csl_QueryDB (G_db_connection, mysql_query);
-        if (result != NULL)
+        csl_monitor_record *monitor_row = NULL;
+        long long returned_rows = csl_StorageReadMonitors(mysql_query, &monitor_row);
+        if (returned_rows >= 0)
         {
-            unsigned int returned_rows = mysql_num_rows(result);
             switch (returned_rows)
             {
                 case 0:
@@ -1604,7 +2187,6 @@ int     monitorConfigDBQuery (bool db_sync_just_launched)
                 case 1:
                     // **** We found the Monitor's Row in the DB - We need to retrieve the info **** //
                     repeat_flag = false;
-                    csl_monitor_record *monitor_row = csl_ReturnMonitorRows(G_db_connection, result);
                     G_monitor_table.monitor_id = monitor_row[0].monitor_id;
                     G_monitor_table.monitor_sync = (short) monitor_row[0].monitor_sync;
 
@@ -1615,7 +2197,7 @@ int     monitorConfigDBQuery (bool db_sync_just_launched)
                         // **** Perform Initiation (or re-initiation) of the Monitor's tables **** //
                         return_flag = monitorConfigUpdate();
                         if (return_flag != CS_SUCCESS)
-                            continue;
+                            break;
 
                         // **** Update the DB to let it know that we have read the config info **** //
                         printf("\t<%s> Obtained Config Data from Monitor_Sync\n\n", __PRETTY_FUNCTION__);
@@ -1625,7 +2207,7 @@ int     monitorConfigDBQuery (bool db_sync_just_launched)
                         memset(query, NULL_BINARY, SIZE_CS_SQL_COMMAND);
                         sprintf(query, "Update %s.%s Set Monitor_Sync = 0 where monitor_id = %llu",
                                 CS_SQL_MONITOR_SCHEMA, CS_SQL_MONITOR_VIEW, G_monitor_table.monitor_id);
-                        int query_flag = csl_UpdateDB(G_db_connection, query);
+                        int query_flag = csl_StorageUpdate(query);
                         if (query_flag != CS_SUCCESS)
                         {
                             return_flag = CS_ERROR_DB_UPDATE;
@@ -1633,29 +2215,73 @@ int     monitorConfigDBQuery (bool db_sync_just_launched)
                                    __PRETTY_FUNCTION__, G_monitor_table.comm_params.monitor_mac_address);
                         }
                     }
-                    free(monitor_row);
                     break;
 
                 default:
                     // There should only be one row in the Monitor View in the DB ... Corrupted DB
-                    printf("\t<%s> Error: too many rows [%d] in the database for monitor_identifier [%s]\n",
+                    printf("\t<%s> Error: too many rows [%lld] in the database for monitor_identifier [%s]\n",
                            __PRETTY_FUNCTION__, returned_rows, G_monitor_table.comm_params.monitor_mac_address);
                     return_flag = CS_CORRUPTED_DB;
                     repeat_flag = false;
                     break;
             }
         }
+        free(monitor_row);
     } while (repeat_flag == true);
 
-    csl_mysql_free_result(result);
     return return_flag;
 }
 
+/************************************************
+ * int monitorDeviceRowLoad()
+ *  @param
+ *          void            *context        - The monitor_device_list being read
+ *          unsigned int    column_ctr
+ *          char            **fields        - device_id, device_identifier
+ *
+ *  @brief  A storage row function (see csl_storage.h) that adds a row of the monitor device view to a
+ *          monitor_device_list
+ *
+ *  @author Kerry
+ *
+ *  @note   Called by monitorConfigUpdate() without the registry lock - no device shard is touched
+ *
+ *  @return CS_SUCCESS for the next row (a row past max_devices is counted as dropped), an error code on failure
+ ************************************************/
+int monitorDeviceRowLoad(void *context, unsigned int column_ctr, char **fields)
+{
+    monitor_device_list *device_list = (monitor_device_list *) context;
+    if (device_list->row_ctr >= device_list->max_rows)
+    {
+        device_list->dropped_ctr++;     // read on, so that monitorConfigUpdate() can say how many
+        return CS_SUCCESS;
+    }
+
+    if (csl_StorageMonitorDeviceDecode(column_ctr, fields, &device_list->rows[device_list->row_ctr]) != CS_SUCCESS)
+    {
+        return CS_ERROR_DB_QUERY;
+    }
+    device_list->row_ctr++;
+    return CS_SUCCESS;
+}
+
+/************************************************
+ * int monitorConfigUpdate()
+ *  @param  - None
+ *
+ *  @brief  Reloads the monitor's devices from the database, replacing every device shard
+ *
+ *  @author Kerry
+ *
+ *  @note   The devices are read into a monitor_device_list first, and the registry write lock is only held to
+ *          swap them in - no database work is done under it
+ *
+ *  @return CS_SUCCESS, or an error code
+ ************************************************/
 int monitorConfigUpdate()
 {
     int         return_flag = CS_SUCCESS;
     char        mysql_query[SIZE_CS_SQL_COMMAND];
-    MYSQL_RES   *result     = NULL;
 
     /********************************************
      * Initialize the Monitor's important tables
@@ -1664,48 +2290,14 @@ int monitorConfigUpdate()
      *      The Device "bad actor" Table    - Keeps track of the unauthorized devices attempting to connect
      ********************************************/
 
-    // **** Initialize G_status_quo_table to all 0s - indicating no current devices and scans ****
-    for (int i = 0; i < MAX_DEVICES; i++)
-    {
-        for (int j = 0; j < MAX_ELEMENTS; j++)
-        {
-            memset(G_status_quo_table[i][j].element_identifier, NULL_BINARY, SIZE_ELEMENT_IDENTIFIER);
-            G_status_quo_table[i][j].element_attributes   = 0;
-//            memset(G_status_quo_table[i][j].element_name, NULL_BINARY, SIZE_ELEMENT_NAME);
-//            strcpy(G_status_quo_table[i][j].element_name,DEFAULT_ELEMENT_NAME);
-            memset(G_status_quo_table[i][j].scan_value, NULL_BINARY, SIZE_HASH_ELEMENT);
-            G_status_quo_table[i][j].alert_code           = 0;
-        }
-    }
-
-//    printf("\t<%s>  we are true up to here ... and then?\n",__PRETTY_FUNCTION__);
-    // **** Initialize G_device_table to all 0s - indicating no active devices ****
-    for (short i = 0; i < MAX_DEVICES; i++)
-    {
-        G_device_table[i].device_id             = 0L;
-        memset(G_device_table[i].device_mac_address, NULL_BINARY, SIZE_MAC_ADDRESS);
-        memcpy(G_device_table[i].device_mac_address, DEFAULT_MAC_ADDRESS, strlen(DEFAULT_MAC_ADDRESS));
-        memset(G_device_table[i].device_identifier, NULL_BINARY, SIZE_DEVICE_IDENTIFIER);   // 0 out the byte array
-        memcpy(G_device_table[i].device_identifier, DEFAULT_MAC_ADDRESS, strlen(DEFAULT_MAC_ADDRESS));
-        G_device_table[i].status_element_ctr    = 0;
-        G_device_table[i].cs_standard_flag      = true;
-        G_device_table[i].last_heartbeat        = 0L;
-        G_device_table[i].probe_id              = csl_AssignProbeID(DEFAULT_MONITOR_ID, 1);
-        G_device_table[i].device_index          = i;
-    }
-//    printf("\t<%s> we are true up to here ... and then?\n",__PRETTY_FUNCTION__);
-
-    deviceBadActorTableInitialize();
-
     // **** Initialize the crytica_standard date field in the database ****
-    result      = NULL;
     sprintf(mysql_query,
             "Update %s.%s "
             "set crytica_standard_date = '%s' "
             "where Monitor_id = %llu",
             CS_SQL_MONITOR_SCHEMA, CS_SQL_MONITOR_DEVICE_VIEW,
             DEFAULT_DATE, G_monitor_table.monitor_id);
-    if (csl_UpdateDB(G_db_connection, mysql_query) != CS_SUCCESS)
+    if (csl_SpoolUpdate(mysql_query) != CS_SUCCESS)
     {
         printf("\t<%s>, Failed to initialize the Crytica Standard Date in the %s.%s\n",
                __PRETTY_FUNCTION__ , CS_SQL_MONITOR_SCHEMA, CS_SQL_MONITOR_DEVICE_VIEW);
@@ -1713,50 +2305,80 @@ int monitorConfigUpdate()
     }
 
     // **** Obtain Monitor's Assigned Devices Data from the Database ****
-    result      = NULL;
     sprintf(mysql_query,
             "Select Distinct Device_ID, Device_Identifier from %s.%s "
             "where Monitor_id = %llu order by Device_ID asc",
             CS_SQL_MONITOR_SCHEMA, CS_SQL_MONITOR_DEVICE_VIEW,
             G_monitor_table.monitor_id);
-    result = csl_QueryDB (G_db_connection, mysql_query);
-    if (result != NULL)
+    // **** The rows are read into a list of at most max_devices, without the registry lock ****
+    monitor_device_list device_list;
+    device_list.row_ctr     = 0;
+    device_list.dropped_ctr = 0;
+    device_list.max_rows    = (unsigned int) G_monitor_table.max_devices;
+    device_list.rows        = calloc(device_list.max_rows, sizeof(csl_monitor_device_record));
+    if (device_list.rows == NULL)
+    {
+        return CS_FATAL_ERROR;
+    }
+    // **** On failure the devices already loaded are kept - a partial list must never replace them ****
+    long long row_count = csl_StorageQuery(mysql_query, monitorDeviceRowLoad, &device_list);
+    if (row_count < 0)
+    {
+        printf("\t<%s> ERROR: Failed [%lld] to read the devices from %s.%s - keeping the devices loaded\n",
+               __PRETTY_FUNCTION__, row_count, CS_SQL_MONITOR_SCHEMA, CS_SQL_MONITOR_DEVICE_VIEW);
+        free(device_list.rows);
+        return (int) row_count;
+    }
+    if (device_list.dropped_ctr > 0)
+    {
+        printf("\t<%s> WARNING: [%u] devices past max_devices [%u] are assigned to this monitor - they are not monitored\n",
+               __PRETTY_FUNCTION__, device_list.dropped_ctr, device_list.max_rows);
+    }
+
+    // **** Write out the alert summaries still held, while the shards (and the database) are free to take them ****
+    alertAggregateFlushAll();
+
+    // **** Swap the list in - release every device shard and set up one per row ****
+    // The registry write lock is held only for the swap, so no lookup sees a half-built table
+    unsigned int loaded_ctr = 0;
+    pthread_rwlock_wrlock(&G_device_registry_lock);
+    deviceShardsRelease();
+    deviceBadActorTableInitialize();
+    for (unsigned int row_ctr = 0; row_ctr < device_list.row_ctr; row_ctr++)
     {
-        int return_rows = mysql_num_rows(result);
-        csl_monitor_device_record *monitor_device_row = csl_ReturnMonitorDeviceRows(G_db_connection, result);
-        for (unsigned int i = 0; i < return_rows; i++)
+        short device_index = (short) row_ctr;
+        device_shard *shard = deviceShardNew(device_index);
+        if (shard == NULL)
         {
-            G_device_table[i].device_id   = monitor_device_row[i].device_id;
-            G_device_table[i].probe_id    = csl_AssignProbeID(G_monitor_table.monitor_id, i);
-            memset(G_device_table[i].device_identifier, NULL_BINARY, SIZE_DEVICE_IDENTIFIER);
-            memcpy(G_device_table[i].device_identifier, monitor_device_row[i].device_identifier, SIZE_DEVICE_IDENTIFIER);
-            printf("\t<%s> Supported device_id [%llu] has device_identifier [%s] & probe_id [%0.4f]\n",
-                   __PRETTY_FUNCTION__ , G_device_table[i].device_id,
-                   G_device_table[i].device_identifier, G_device_table[i].probe_id);
-//            printf("Device [%d] device_id [%llu] device_identifier [%s] is %s\n", i , G_device_table[i].device_id,
-//                   G_device_table[i].cs_standard_flag ? "true" : "false", G_device_table[i].device_identifier);
-            G_monitor_table.device_ctr++;
+            return_flag = CS_ERROR;
+            break;
         }
-        free(monitor_device_row);
+        shard->device.device_id   = device_list.rows[row_ctr].device_id;
+        shard->device.probe_id    = csl_AssignProbeID(G_monitor_table.monitor_id, device_index);
+        memset(shard->device.device_identifier, NULL_BINARY, SIZE_DEVICE_IDENTIFIER);
+        memcpy(shard->device.device_identifier, device_list.rows[row_ctr].device_identifier, SIZE_DEVICE_IDENTIFIER);
+        G_monitor_table.device_ctr++;
+        loaded_ctr++;
+    }
+    pthread_rwlock_unlock(&G_device_registry_lock);
+
+    for (unsigned int row_ctr = 0; row_ctr < loaded_ctr; row_ctr++)
+    {
+        printf("\t<%s> Supported device_id [%llu] has device_identifier [%s] & probe_id [%0.4f]\n",
+               __PRETTY_FUNCTION__ , device_list.rows[row_ctr].device_id, device_list.rows[row_ctr].device_identifier,
+               csl_AssignProbeID(G_monitor_table.monitor_id, (short) row_ctr));
     }
+    free(device_list.rows);
 
     // **** Initialize the Crytica Standard Table and Element Added Names Table ****
-    result      = NULL;
-    sprintf(mysql_query,
-            "Truncate Table %s.%s",
-            CS_SQL_MONITOR_SCHEMA, CS_SQL_STANDARD_TABLE);
-    if (csl_UpdateDB (G_db_connection, mysql_query) != CS_SUCCESS)
+    if (csl_SpoolTruncate(CS_SQL_MONITOR_SCHEMA, CS_SQL_STANDARD_TABLE) != CS_SUCCESS)
     {
         printf("\t<%s> **** WARNING: Failed to truncate %s.%s\n",
                __PRETTY_FUNCTION__ , CS_SQL_MONITOR_SCHEMA, CS_SQL_STANDARD_TABLE);
         return_flag = CS_ERROR_DB_UPDATE;
     }
 
-    result      = NULL;
-    sprintf(mysql_query,
-            "Truncate Table %s.%s",
-            CS_SQL_MONITOR_SCHEMA, CS_SQL_ELEMENT_ADDED_NAMES_TABLE);
-    if (csl_UpdateDB (G_db_connection, mysql_query) != CS_SUCCESS)
+    if (csl_SpoolTruncate(CS_SQL_MONITOR_SCHEMA, CS_SQL_ELEMENT_ADDED_NAMES_TABLE) != CS_SUCCESS)
     {
         printf("\t<%s> **** WARNING: Failed to truncate %s.%s\n",
                __PRETTY_FUNCTION__, CS_SQL_MONITOR_SCHEMA, CS_SQL_ELEMENT_ADDED_NAMES_TABLE);
@@ -1794,15 +2416,37 @@ int monitorInitialize()
     int   return_flag = CS_SUCCESS;
 
     /********************************************
-     * Set up the monitor identity and communication fields
-     * These are stored in the G_monitor_table in the comms structure
+     * Read the monitor's runtime config - capacity limits et cetera
      ********************************************/
+    if (csl_ConfigLoad(FILE_MONITOR_CONFIG) != CS_SUCCESS)
+    {
+        printf("\t<%s> **** ERROR: Invalid monitor config file [%s]\n", __PRETTY_FUNCTION__, FILE_MONITOR_CONFIG);
+        return CS_FATAL_ERROR;
+    }
+    printf("\t<%s> Monitor config:\n", __PRETTY_FUNCTION__);
+    csl_ConfigPrint();
+    if (monitorTablesInitialize() != CS_SUCCESS)
+    {
+        return CS_FATAL_ERROR;
+    }
+    CSL_TRACE_INIT();
+    CSL_TRACE_THREAD("message");
 
-    // Initialize the G_monitor_table with default values
-    G_monitor_table.monitor_id   = DEFAULT_MONITOR_ID;
-    G_monitor_table.device_ctr   = 0;
-    G_monitor_table.max_devices  = MAX_DEVICES;      // todo: Future releases this needs to be more flexible, based on "device class
+    // The capture must be open before the scan decode workers start in monitor_comms_new()
+    if (csl_Config()->capture_frames != 0)
+    {
+        char capture_file_name[SIZE_CAPTURE_FILE_NAME];
+        snprintf(capture_file_name, SIZE_CAPTURE_FILE_NAME, CAPTURE_FILE_FORMAT, getpid(), (long long) time(NULL));
+        if (csl_CaptureOpen(capture_file_name) != CS_SUCCESS)
+        {
+            return CS_FATAL_ERROR;
+        }
+    }
 
+    /********************************************
+     * Set up the monitor communication fields
+     * These are stored in the G_monitor_table in the comms structure
+     ********************************************/
     if (comm_params_initialize (&G_monitor_table.comm_params, BROADCASTER_PORT, DATA_PIPELINE_PORT, SCAN_PORT) != CS_SUCCESS)
     {
         printf("\t<%s> Failed to initialize the comm_params\n", __PRETTY_FUNCTION__);
@@ -1905,9 +2549,23 @@ int monitorInitialize()
     int scan_port       = last_octet + SCAN_PORT;
     G_zmq_comms_t = monitor_comms_new(broadcast_port, responder_port, scan_port, my_host_name);
 
-    // **** Populate the G_monitor_table's Communication Parameters **** //
-    strcpy(G_monitor_table.comm_params.monitor_external_ip_address, ip_address_external);
- //   memset(G_monitor_table.comm_params.monitor_external_ip_address, NULL_BINARY, SIZE_IP4_ADDRESS);
+    // **** Alerts are published on the broadcaster as they are found (see csl_alert_event) ****
+    if (csl_Config()->alert_publish != 0)
+    {
+        if (monitor_comms_bind_command_publisher(G_zmq_comms_t) == -1)
+        {
+            printf("\t<%s> WARNING: Could not bind the broadcaster [%s] - alerts will not be published\n",
+                   __PRETTY_FUNCTION__, G_zmq_comms_t->broadcasting_address);
+        }
+        else
+        {
+            printf("\t<%s> Publishing alerts on [%s]\n", __PRETTY_FUNCTION__, G_zmq_comms_t->broadcasting_address);
+        }
+    }
+
+    // **** Populate the G_monitor_table's Communication Parameters **** //
+    strcpy(G_monitor_table.comm_params.monitor_external_ip_address, ip_address_external);
+ //   memset(G_monitor_table.comm_params.monitor_external_ip_address, NULL_BINARY, SIZE_IP4_ADDRESS);
     strcpy(G_monitor_table.comm_params.monitor_internal_ip_address, ip_address_internal);
     strcpy(G_monitor_table.comm_params.monitor_hostname, my_host_name);
     strcpy(G_monitor_table.comm_params.monitor_mac_address, mac_address);
@@ -1925,36 +2583,26 @@ int monitorInitialize()
 //    FILE* testLogFile = fopen ("Exceptions.txt" , "w");   // TO BE REMOVED - vestigial code
 
     /********************************************
-     * Connect to the MySQL Database
+     * Connect to the Database (MySQL, or SQLite for small sites - see csl_storage.h)
      ********************************************/
-    // **** Setup the MySQL parameters and declarations ****
-    csl_mysql_connection_params connect_db_params;
-    connect_db_params.dbPort           = CS_SQL_DB_PORT;
-    connect_db_params.dbHost           = CS_SQL_LOCAL_DB;
-    connect_db_params.dbServer         = NULL;
-    connect_db_params.dbName           = CS_SQL_MONITOR_SCHEMA;
-    connect_db_params.dbUser           = DB_USER;
-    connect_db_params.dbUserPassword   = DB_USER_PWD;
-
-    // **** Connect to the DB Server ****
-    G_db_connection = csl_ConnectToDB(&connect_db_params);
-    if ( !G_db_connection )
+    int storage_flag = csl_StorageOpen(csl_Config()->storage_backend);
+    if (storage_flag != CS_SUCCESS)
     {
         // todo - issue error message
-        printf("\t<%s>**** ERROR: Monitor Failed to Connect to its MySQL Database ****\n",__PRETTY_FUNCTION__ );
-        return CS_ERROR_DB_CONNECTION;
+        printf("\t<%s>**** ERROR: Monitor Failed to Connect to its Database ****\n",__PRETTY_FUNCTION__ );
+        return storage_flag;
     }
 
-    // **** Connect to the Monitor Schema ****
-    char database_query[SIZE_CS_SQL_COMMAND];
-    sprintf(database_query,"USE %s", CS_SQL_MONITOR_SCHEMA);
-
-    if (csl_UpdateDB(G_db_connection, database_query) != CS_SUCCESS)
+    // **** Alerts and Crytica Standards are written through the spool, so a slow database does not stall a scan ****
+    if (csl_Config()->spool_writes != 0 && csl_SpoolOpen(FILE_SPOOL) != CS_SUCCESS)
     {
-        // todo - issue error message
-        return CS_CORRUPTED_DB;
+        printf("\t<%s> WARNING: No spool - alerts and Crytica Standards are written directly\n", __PRETTY_FUNCTION__);
     }
 
+    // **** The status quo searches compare with the fastest diff kernel this CPU has ****
+    csl_DiffSelect(NULL);
+    printf("\t<%s> Status quo diff kernel: [%s]\n", __PRETTY_FUNCTION__, csl_DiffKernelName());
+
 
     /********************************************
      * Launch the DB_SYNC program
@@ -1996,6 +2644,44 @@ int monitorInitialize()
     return return_flag;
 }
 
+/************************************************
+ * int monitorTablesInitialize()
+ *  @param  None
+ *
+ *  @brief  Sets up the monitor's in-memory tables - the G_monitor_table, the scheduler and the metrics - from
+ *          the runtime config, without touching the network or the database
+ *
+ *  @author Kerry
+ *
+ *  @note   Split out of monitorInitialize() so that csl_bench can drive the scan and status quo functions
+ *
+ *  @return CS_SUCCESS or CS_FATAL_ERROR
+ ************************************************/
+int monitorTablesInitialize()
+{
+    // Initialize the G_monitor_table with default values
+    G_monitor_table.monitor_id   = DEFAULT_MONITOR_ID;
+    G_monitor_table.device_ctr   = 0;
+    G_monitor_table.max_devices  = (short) csl_Config()->max_devices;
+
+    // The shard pointer array is never reallocated - see the Device Shards note
+    G_device_shards = calloc(csl_Config()->max_devices, sizeof(device_shard *));
+    if (G_device_shards == NULL)
+    {
+        printf("\t<%s> ERROR: Could not allocate the device shards for [%u] devices\n",
+               __PRETTY_FUNCTION__, csl_Config()->max_devices);
+        return CS_FATAL_ERROR;
+    }
+    G_device_shard_capacity = csl_Config()->max_devices;
+
+    if (csl_SchedulerInit(csl_Config()->max_devices) != CS_SUCCESS ||
+        csl_MetricsInit(csl_Config()->max_devices) != CS_SUCCESS)
+    {
+        return CS_FATAL_ERROR;
+    }
+    return CS_SUCCESS;
+}
+
 /************************************************
  * bool monitorShutdown()
  *  @param  None
@@ -2014,10 +2700,14 @@ bool    monitorShutDown()
 {
     bool return_flag = true;
 
-    // **** Kill the DB_SYNC process **** //
+    // **** Kill the DB_SYNC process - if there is none, "kill -9 0" would kill our own process group **** //
     char command[SIZE_LINUX_COMMAND];
     sprintf(command, "kill -9 %d", G_pid_db_sync);
-    if (system(command) != 0)
+    if (G_pid_db_sync < 1)
+    {
+        printf("\n\t<%s> No db_sync process to kill\n\n", __PRETTY_FUNCTION__);
+    }
+    else if (system(command) != 0)
     {
         printf("\n\t<%s> Failed to kill db_sync process [%d]\n\n", __PRETTY_FUNCTION__, G_pid_db_sync);
     }
@@ -2026,15 +2716,29 @@ bool    monitorShutDown()
         printf("\n\t<%s> Successfully killed db_sync process [%d]\n\n", __PRETTY_FUNCTION__, G_pid_db_sync);
     }
 
-    // **** Disconnect from the database ****
-    csl_DisconnectFromDB(G_db_connection);    // Note: This is a void function, so indicator of success or failure
+    // **** Write the alert summaries still held, drain the spool, then disconnect from the database ****
+    alertAggregateFlushAll();
+    csl_SpoolClose();
+    csl_StorageClose();     // Note: This is a void function, so indicator of success or failure
 
     // **** Take Down the Communication Ports ****
-    if (monitor_comms_destroy(G_zmq_comms_t) != CS_SUCCESS)
+    if (G_zmq_comms_t != NULL && monitor_comms_destroy(G_zmq_comms_t) != CS_SUCCESS)
     {
         return_flag = false;
     }
 
+    // **** Release the device shards ****
+    pthread_rwlock_wrlock(&G_device_registry_lock);
+    deviceShardsRelease();
+    free(G_device_shards);
+    G_device_shards         = NULL;
+    G_device_shard_capacity = 0;
+    pthread_rwlock_unlock(&G_device_registry_lock);
+    csl_SchedulerDestroy();
+    csl_MetricsDestroy();
+    csl_CaptureClose();         // After monitor_comms_destroy(), so no decode worker is still capturing
+    CSL_TRACE_DUMP();
+
     printf("\n=> Say: 'Good Night Gracie'\n");
     printf("\n\t ============================");
     printf("\n\t **** Good Night Gracie! ****");
@@ -2048,26 +2752,6 @@ bool    monitorShutDown()
  *      ==============
  ************************************************/
 
-short scan_get_next_index(short next_scan_index)
-{
-    for (short i = next_scan_index; MAX_DEVICES; i++)
-    {
-        if (G_device_table[i].last_heartbeat != 0L)
-        {
-            return i;
-        }
-    }
-
-    for (short i = 0; i <= next_scan_index; i++)
-    {
-        if (G_device_table[i].last_heartbeat != 0L)
-            return i;
-    }
-
-    return (short) CS_ERROR;
-}
-
-
 /************************************************
  * bool scanEvaluate()
  *  @param  short device_index
@@ -2081,36 +2765,179 @@ short scan_get_next_index(short next_scan_index)
  *
  *  @author Kerry
  *
+ *  @note   A scan from a device that agreed to PROBE_CAPABILITY_ORDERED_SCAN, and that did arrive in order, is
+ *          evaluated by statusQuoTableMerge() instead
+ *
  *  @return true on success, false on failure
  ************************************************/
 bool scanEvaluate(short device_index)
 {
     bool return_flag = true;
+    int64_t start_usecs = csl_MetricsNow();
+    CSL_TRACE_BEGIN(evaluate_span);
+
+    // The device's shard stays locked for the whole evaluation - other devices are unaffected
+    device_shard *shard = deviceShardLock(device_index);
+    if (shard == NULL)
+    {
+        return false;
+    }
+    if (shard->scan_table == NULL)
+    {
+        printf("\t<%s> ERROR: No scan table for device_index [%d]\n", __PRETTY_FUNCTION__, device_index);
+        deviceShardUnlock(shard);
+        return false;
+    }
+    unsigned int scan_rows = shard->scan_table->scan_element_ctr;
 
     // Determine if this device needs a new Crytica Standard
-    if (G_device_table[device_index].cs_standard_flag == true)
+    if (shard->device.cs_standard_flag == true)
     {
         // Generate a new Crytica Standard
+        CSL_TRACE_BEGIN(build_span);
         return_flag = statusQuoTableBuild(device_index);
+        CSL_TRACE_END(build_span, "status quo build", device_index);
         if (return_flag == true)
         {
+            CSL_TRACE_BEGIN(write_span);
             return_flag = cStandardWriteToDB(device_index);
-            G_device_table[device_index].cs_standard_flag = false;
+            CSL_TRACE_END(write_span, "standard write", device_index);
+            shard->device.cs_standard_flag = false;
         }
+        scanTableReset(shard->scan_table, -1);
     }
     else
     {
-        // Read Through the scan results table to look for "alerts"
-        if (statusQuoTableSearch(device_index) < 0)
+        // Read Through the scan results table to look for "alerts" - in one merge, if the probe sent it in order
+        CSL_TRACE_BEGIN(search_span);
+        int alert_ctr;
+        if ((shard->device.probe_capabilities & PROBE_CAPABILITY_ORDERED_SCAN) != 0 && shard->scan_table->ordered)
+        {
+            alert_ctr = statusQuoTableMerge(device_index);
+            csl_MetricCount(METRIC_SCANS_MERGED, 1);
+        }
+        else
+        {
+            alert_ctr = statusQuoTableSearch(device_index);
+        }
+        if (alert_ctr < 0)
         {
             // todo - Throw Error Message Here
             return_flag = false;
         }
+        CSL_TRACE_END(search_span, "status quo search", device_index);
     }
 
+    // Everything the evaluation formatted for the database is done with
+    csl_ArenaReset(csl_ArenaScan());
+    deviceShardUnlock(shard);
+    CSL_TRACE_END(evaluate_span, "evaluate", device_index);
+
+    int64_t evaluate_usecs = csl_MetricsNow() - start_usecs;
+    csl_MetricObserve(METRIC_SCAN_EVALUATE, evaluate_usecs);
+    csl_MetricDeviceSet(METRIC_DEVICE_EVALUATE_USECS, device_index, evaluate_usecs);
+    csl_MetricDeviceSet(METRIC_DEVICE_SCAN_ROWS, device_index, scan_rows);
+    csl_MetricCount(METRIC_SCANS_EVALUATED, 1);
     return return_flag;
 }
 
+/************************************************
+ * bool scanGrantTake()
+ *  @param  device_shard *shard  - The device asking, whose shard lock the caller holds
+ *
+ *  @brief  Decides whether a heartbeating device may be told to start a scan.
+ *          A grant is given only if:
+ *              the device does not already hold one
+ *              fewer than max_concurrent_scans grants are out
+ *              the decoded-scan queue is no deeper than scan_queue_high
+ *              the scan scheduler says the device is next (see csl_scheduler.h)
+ *
+ *  @author Kerry
+ *
+ *  @note   A grant not returned within scan_grant_timeout_sec (the probe died mid-scan, or the scan was
+ *          dropped) is reclaimed here, on the device's next heartbeat
+ *
+ *  @return true if the device may scan, false if it should wait
+ ************************************************/
+bool scanGrantTake(device_shard *shard)
+{
+    const csl_monitor_config *config = csl_Config();
+    int64_t now = zclock_mono();
+
+    if (shard->device.currently_scanning == true)
+    {
+        if (now - shard->device.scan_granted_at < (int64_t) config->scan_grant_timeout_sec * 1000)
+        {
+            return false;
+        }
+        printf("\t<%s> WARNING: Scan grant of device_index [%d] expired - reclaimed\n",
+               __PRETTY_FUNCTION__, shard->device.device_index);
+        scanGrantReturn(shard, false);
+    }
+
+    unsigned int free_slots = 0;
+    if (G_scan_grant_ctr < config->max_concurrent_scans && csl_ScanQueueDepth() <= config->scan_queue_high)
+    {
+        free_slots = config->max_concurrent_scans - G_scan_grant_ctr;
+    }
+    // Called even with no free slots - every heartbeat tells the scheduler the device is alive
+    if (csl_SchedulerScanStart(shard->device.device_index, free_slots) == false)
+    {
+        return false;
+    }
+
+    shard->device.currently_scanning    = true;
+    shard->device.scan_granted_at       = now;
+    G_scan_grant_ctr++;
+    csl_MetricGaugeSet(METRIC_SCAN_GRANTS, G_scan_grant_ctr);
+    return true;
+}
+
+/************************************************
+ * void scanGrantReturn()
+ *  @param
+ *          device_shard    *shard      - The device whose shard lock the caller holds
+ *          bool            scanned     - true if the device's scan was received and evaluated
+ *
+ *  @brief  Gives back the device's scan grant, if it holds one, and tells the scheduler how the scan went
+ *
+ *  @author Kerry
+ ************************************************/
+void scanGrantReturn(device_shard *shard, bool scanned)
+{
+    if (shard->device.currently_scanning == true)
+    {
+        shard->device.currently_scanning = false;
+        G_scan_grant_ctr--;
+        csl_MetricGaugeSet(METRIC_SCAN_GRANTS, G_scan_grant_ctr);
+        if (scanned == true)
+        {
+            shard->device.last_scan = time(NULL);
+        }
+        csl_SchedulerScanDone(shard->device.device_index, scanned);
+    }
+}
+
+/************************************************
+ * void scanGrantRelease()
+ *  @param
+ *          short   device_index
+ *          bool    scanned         - true if the device's scan was received and evaluated
+ *
+ *  @brief  Gives back the device's scan grant under its shard lock, once its scan has been evaluated
+ *
+ *  @author Kerry
+ ************************************************/
+void scanGrantRelease(short device_index, bool scanned)
+{
+    device_shard *shard = deviceShardLock(device_index);
+    if (shard != NULL)
+    {
+        scanGrantReturn(shard, scanned);
+        deviceShardUnlock(shard);
+    }
+}
+
 #ifndef DEPRECATED
 /************************************************
  * bool scanRequest()
@@ -2122,7 +2949,7 @@ bool scanEvaluate(short device_index)
  *
  *  @author Kerry
  *
- *  @note   Although it is true that this function could use the global variable "G_current_scan_device_index", if we
+ *  @note   Although it is true that this function could use the device of the current scan, if we
  *          ever move to a more asynchronous environment, being explicit about from which device we are
  *          requesting the scan cannnot hurt us.
  *
@@ -2130,7 +2957,7 @@ bool scanEvaluate(short device_index)
  ************************************************/
 bool    scanRequest(short device_index)
 {
-    int return_value = csl_RequestScan (G_zmq_comms_t,  &G_current_zmessage, &G_device_table[device_index]);
+    int return_value = csl_RequestScan (G_zmq_comms_t,  &G_current_zmessage, &G_device_shards[device_index]->device);
     if (return_value != CS_SUCCESS)
     {
         printf("**** ERROR [%d] in function scanRequest()\n", return_value);
@@ -2143,124 +2970,304 @@ bool    scanRequest(short device_index)
 
 /************************************************
  * int scanTableAddRow()
- *  @param  csl_scan_record *new_scan
+ *  @param
+ *          csl_scan_record *new_scan
+ *          short           device_index
  *
- *  @brief  Adds a row to the scan table
+ *  @brief  Adds a row to the scan table of the device's active scan session, growing the table when it is full
  *
  *  @author Kerry
  *
- * @return CS_SUCCESS
+ *  @note   Rows arriving for a suspended (or no) session are dropped - the device resumes or restarts its scan
+ *          with a new PROBE_START_SCAN
+ *
+ * @return CS_SUCCESS, CS_ERROR if the device has no active scan session,
+ *         or CS_TABLE_OVERFLOW once the scan exceeds max_elements or the memory budget
  ************************************************/
 int scanTableAddRow(csl_scan_record *new_scan, short device_index)
 {
-    if (device_index != G_scan_table.device_index)
+    device_shard *shard = deviceShardLock(device_index);
+    if (shard == NULL)
     {
-        printf("\t<%s> ERROR: Attempting to store scan from device [%d] during scan of device [%d\n",
-               __PRETTY_FUNCTION__, device_index, G_scan_table.device_index);
+        return CS_DEVICE_NOT_FOUND;
     }
-    G_scan_table.scan_elements[G_scan_table.scan_element_ctr].scan_id             = new_scan->scan_id;
-    G_scan_table.scan_elements[G_scan_table.scan_element_ctr].probe_id            = new_scan->probe_id;
-    G_scan_table.scan_elements[G_scan_table.scan_element_ctr].scan_date           = new_scan->scan_date;
-    G_scan_table.scan_elements[G_scan_table.scan_element_ctr].element_type        = new_scan->element_type;
-    G_scan_table.scan_elements[G_scan_table.scan_element_ctr].element_attributes  = new_scan->element_attributes;
+    scan_structure *scan_table = shard->scan_table;
+    if (scan_table == NULL || device_index != scan_table->device_index ||
+        shard->session.state != SCAN_SESSION_ACTIVE)
+    {
+        printf("\t<%s> ERROR: Attempting to store scan from device [%d] outside of a scan\n",
+               __PRETTY_FUNCTION__, device_index);
+        csl_MetricCount(METRIC_SCAN_RECORDS_DROPPED, 1);
+        deviceShardUnlock(shard);
+        return CS_ERROR;
+    }
+    shard->session.last_activity = zclock_mono();
+    if (deviceShardGrowTable(shard, (void **) &scan_table->scan_elements, &scan_table->scan_element_capacity,
+                             sizeof(csl_scan_record), scan_table->scan_element_ctr + 1) == false)
+    {
+        printf("\t<%s> ***** ERROR: Scan Table Overflow [%u] ****\n", __PRETTY_FUNCTION__, scan_table->scan_element_ctr);
+        deviceShardUnlock(shard);
+        return CS_TABLE_OVERFLOW;
+    }
+    // A row not strictly after the one before it means the scan is not in order (see statusQuoTableMerge)
+    if (scan_table->scan_element_ctr > 0 &&
+        memcmp(scan_table->scan_elements[scan_table->scan_element_ctr - 1].element_name_hash,
+               new_scan->element_name_hash, SIZE_HASH_NAME) >= 0)
+    {
+        scan_table->ordered = false;
+    }
+    scan_table->scan_elements[scan_table->scan_element_ctr].scan_id             = new_scan->scan_id;
+    scan_table->scan_elements[scan_table->scan_element_ctr].probe_id            = new_scan->probe_id;
+    scan_table->scan_elements[scan_table->scan_element_ctr].scan_date           = new_scan->scan_date;
+    scan_table->scan_elements[scan_table->scan_element_ctr].element_type        = new_scan->element_type;
+    scan_table->scan_elements[scan_table->scan_element_ctr].element_attributes  = new_scan->element_attributes;
 
-    memset(G_scan_table.scan_elements[G_scan_table.scan_element_ctr].scan_value, NULL_BINARY, SIZE_HASH_ELEMENT);
-    memcpy(G_scan_table.scan_elements[G_scan_table.scan_element_ctr].scan_value, new_scan->scan_value, SIZE_HASH_ELEMENT);
+    memset(scan_table->scan_elements[scan_table->scan_element_ctr].scan_value, NULL_BINARY, SIZE_HASH_ELEMENT);
+    memcpy(scan_table->scan_elements[scan_table->scan_element_ctr].scan_value, new_scan->scan_value, SIZE_HASH_ELEMENT);
 
-    memset(G_scan_table.scan_elements[G_scan_table.scan_element_ctr].element_name_hash, NULL_BINARY, SIZE_HASH_NAME+1);
-    memcpy(G_scan_table.scan_elements[G_scan_table.scan_element_ctr].element_name_hash, new_scan->element_name_hash,
+    memset(scan_table->scan_elements[scan_table->scan_element_ctr].element_name_hash, NULL_BINARY, SIZE_HASH_NAME+1);
+    memcpy(scan_table->scan_elements[scan_table->scan_element_ctr].element_name_hash, new_scan->element_name_hash,
            SIZE_HASH_NAME);
 
-    memset(G_scan_table.scan_elements[G_scan_table.scan_element_ctr].probe_uuid, NULL_BINARY, SIZE_ZUUID);
-    memcpy(G_scan_table.scan_elements[G_scan_table.scan_element_ctr].probe_uuid, new_scan->probe_uuid, SIZE_ZUUID);
+    memset(scan_table->scan_elements[scan_table->scan_element_ctr].probe_uuid, NULL_BINARY, SIZE_ZUUID);
+    memcpy(scan_table->scan_elements[scan_table->scan_element_ctr].probe_uuid, new_scan->probe_uuid, SIZE_ZUUID);
 
-    memset(G_scan_table.scan_elements[G_scan_table.scan_element_ctr].device_ip, NULL_BINARY, SIZE_IP4_ADDRESS);
-    memcpy(G_scan_table.scan_elements[G_scan_table.scan_element_ctr].device_ip, new_scan->device_ip, SIZE_IP4_ADDRESS);
+    memset(scan_table->scan_elements[scan_table->scan_element_ctr].device_ip, NULL_BINARY, SIZE_IP4_ADDRESS);
+    memcpy(scan_table->scan_elements[scan_table->scan_element_ctr].device_ip, new_scan->device_ip, SIZE_IP4_ADDRESS);
 
-    memset(G_scan_table.scan_elements[G_scan_table.scan_element_ctr].device_mac_address, NULL_BINARY, SIZE_MAC_ADDRESS);
-    memcpy(G_scan_table.scan_elements[G_scan_table.scan_element_ctr].device_mac_address, new_scan->device_mac_address,
+    memset(scan_table->scan_elements[scan_table->scan_element_ctr].device_mac_address, NULL_BINARY, SIZE_MAC_ADDRESS);
+    memcpy(scan_table->scan_elements[scan_table->scan_element_ctr].device_mac_address, new_scan->device_mac_address,
            SIZE_MAC_ADDRESS);
 
-    memset(G_scan_table.scan_elements[G_scan_table.scan_element_ctr].element_name, NULL_BINARY, SIZE_ELEMENT_NAME);
-    strcpy(G_scan_table.scan_elements[G_scan_table.scan_element_ctr].element_name, new_scan->element_name);
+    memset(scan_table->scan_elements[scan_table->scan_element_ctr].element_name, NULL_BINARY, SIZE_ELEMENT_NAME);
+    strcpy(scan_table->scan_elements[scan_table->scan_element_ctr].element_name, new_scan->element_name);
 
-    G_scan_table.scan_element_ctr++;
-    if (G_scan_table.scan_element_ctr >= MAX_ELEMENTS)
-    {
-        printf("\t<%s> ***** ERROR: Scan Table Overflow [%d] ****\n", __PRETTY_FUNCTION__, G_scan_table.scan_element_ctr);
-        return CS_TABLE_OVERFLOW;
-    }
+    scan_table->scan_element_ctr++;
 
+    deviceShardUnlock(shard);
     return CS_SUCCESS;
 }
 
 #ifndef DEPRECATED
 int scanTableAddRow(csl_scan_record *new_scan)
 {
-    G_scan_table.scan_element_ctr++;
-    if (G_scan_table.scan_element_ctr >= MAX_ELEMENTS)
+    scan_table->scan_element_ctr++;
+    if (scan_table->scan_element_ctr >= MAX_ELEMENTS)
     {
-        printf("***** ERROR: Scan Table Overflow [%d] ****\n", G_scan_table.scan_element_ctr);
+        printf("***** ERROR: Scan Table Overflow [%d] ****\n", scan_table->scan_element_ctr);
         return CS_TABLE_OVERFLOW;
     }
 
-    G_scan_table.scan_elements[G_scan_table.scan_element_ctr].scan_id             = new_scan->scan_id;
-    G_scan_table.scan_elements[G_scan_table.scan_element_ctr].probe_id            = new_scan->probe_id;
-    G_scan_table.scan_elements[G_scan_table.scan_element_ctr].scan_date           = new_scan->scan_date;
-    G_scan_table.scan_elements[G_scan_table.scan_element_ctr].element_attributes  = new_scan->element_attributes;
+    scan_table->scan_elements[scan_table->scan_element_ctr].scan_id             = new_scan->scan_id;
+    scan_table->scan_elements[scan_table->scan_element_ctr].probe_id            = new_scan->probe_id;
+    scan_table->scan_elements[scan_table->scan_element_ctr].scan_date           = new_scan->scan_date;
+    scan_table->scan_elements[scan_table->scan_element_ctr].element_attributes  = new_scan->element_attributes;
 
-    G_scan_table.scan_elements[G_scan_table.scan_element_ctr].scan_value            = calloc(SIZE_HASH_ELEMENT, sizeof(byte));
-    memcpy(G_scan_table.scan_elements[G_scan_table.scan_element_ctr].scan_value, new_scan->scan_value, SIZE_HASH_ELEMENT);
+    scan_table->scan_elements[scan_table->scan_element_ctr].scan_value            = calloc(SIZE_HASH_ELEMENT, sizeof(byte));
+    memcpy(scan_table->scan_elements[scan_table->scan_element_ctr].scan_value, new_scan->scan_value, SIZE_HASH_ELEMENT);
 
-    G_scan_table.scan_elements[G_scan_table.scan_element_ctr].element_name_hash    = calloc(SIZE_HASH_NAME, sizeof(byte));
-    memcpy(G_scan_table.scan_elements[G_scan_table.scan_element_ctr].element_name_hash, new_scan->element_name_hash,
+    scan_table->scan_elements[scan_table->scan_element_ctr].element_name_hash    = calloc(SIZE_HASH_NAME, sizeof(byte));
+    memcpy(scan_table->scan_elements[scan_table->scan_element_ctr].element_name_hash, new_scan->element_name_hash,
            SIZE_HASH_NAME);
 
-    G_scan_table.scan_elements[G_scan_table.scan_element_ctr].probe_uuid            = calloc(SIZE_ZUUID, sizeof(byte));
-    memcpy(G_scan_table.scan_elements[G_scan_table.scan_element_ctr].probe_uuid, new_scan->probe_uuid, SIZE_ZUUID);
+    scan_table->scan_elements[scan_table->scan_element_ctr].probe_uuid            = calloc(SIZE_ZUUID, sizeof(byte));
+    memcpy(scan_table->scan_elements[scan_table->scan_element_ctr].probe_uuid, new_scan->probe_uuid, SIZE_ZUUID);
 
-    G_scan_table.scan_elements[G_scan_table.scan_element_ctr].device_ip             = calloc(SIZE_IP4_ADDRESS, sizeof(byte));
-    memcpy(G_scan_table.scan_elements[G_scan_table.scan_element_ctr].device_ip, new_scan->device_ip, SIZE_IP4_ADDRESS);
+    scan_table->scan_elements[scan_table->scan_element_ctr].device_ip             = calloc(SIZE_IP4_ADDRESS, sizeof(byte));
+    memcpy(scan_table->scan_elements[scan_table->scan_element_ctr].device_ip, new_scan->device_ip, SIZE_IP4_ADDRESS);
 
-    G_scan_table.scan_elements[G_scan_table.scan_element_ctr].device_mac_address   = calloc(SIZE_MAC_ADDRESS, sizeof(byte));
-    memcpy(G_scan_table.scan_elements[G_scan_table.scan_element_ctr].device_mac_address, new_scan->device_mac_address,
+    scan_table->scan_elements[scan_table->scan_element_ctr].device_mac_address   = calloc(SIZE_MAC_ADDRESS, sizeof(byte));
+    memcpy(scan_table->scan_elements[scan_table->scan_element_ctr].device_mac_address, new_scan->device_mac_address,
            SIZE_MAC_ADDRESS);
 
-    G_scan_table.scan_elements[G_scan_table.scan_element_ctr].element_name          = calloc(strlen(new_scan->element_name) + 1,
+    scan_table->scan_elements[scan_table->scan_element_ctr].element_name          = calloc(strlen(new_scan->element_name) + 1,
                                                                                          sizeof(char));
-    strcpy(G_scan_table.scan_elements[G_scan_table.scan_element_ctr].element_name, new_scan->element_name);
+    strcpy(scan_table->scan_elements[scan_table->scan_element_ctr].element_name, new_scan->element_name);
 
-    print_csl_scan_record(new_scan, "Debug", G_scan_table.scan_element_ctr);
+    print_csl_scan_record(new_scan, "Debug", scan_table->scan_element_ctr);
 
     return CS_SUCCESS;
 }
 #endif
 /************************************************
- * int scanTableInitialize()
+ * int scanSessionStart()
+ *  @param
+ *          short           device_index
+ *          unsigned int    resume_from     - The rows the probe says were already sent, 0 for a fresh scan
+ *
+ *  @brief  Opens the device's scan session when its PROBE_START_SCAN arrives
+ *
+ *  @author Kerry
+ *
+ *  @note   A suspended session holding exactly resume_from rows is resumed. Anything else starts a fresh scan:
+ *          the scan table is allocated the first time the device scans and is then reused.
+ *
+ * @return the scan rows already held (0 for a fresh scan) on success, an error code on failure
+ ************************************************/
+int scanSessionStart(short device_index, unsigned int resume_from)
+{
+    device_shard *shard = deviceShardLock(device_index);
+    if (shard == NULL)
+    {
+        return CS_DEVICE_NOT_FOUND;
+    }
+    shard->session.last_activity = zclock_mono();
+
+    if (shard->session.state == SCAN_SESSION_SUSPENDED && resume_from > 0 &&
+        shard->scan_table != NULL && resume_from == shard->scan_table->scan_element_ctr)
+    {
+        shard->session.state = SCAN_SESSION_ACTIVE;
+        deviceShardUnlock(shard);
+        return (int) resume_from;
+    }
+    if (resume_from > 0)
+    {
+        printf("\t<%s> WARNING: Device [%d] asked to resume after [%u] rows - restarting its scan instead\n",
+               __PRETTY_FUNCTION__, device_index, resume_from);
+    }
+
+    if (shard->scan_table == NULL)
+    {
+        shard->scan_table = calloc(1, sizeof(scan_structure));
+        if (shard->scan_table == NULL ||
+            deviceShardGrowTable(shard, (void **) &shard->scan_table->scan_elements,
+                                 &shard->scan_table->scan_element_capacity, sizeof(csl_scan_record),
+                                 csl_Config()->initial_elements) == false)
+        {
+            free(shard->scan_table);
+            shard->scan_table = NULL;
+            printf("\t<%s> ERROR: Could not allocate scan table for device [%d]\n", __PRETTY_FUNCTION__, device_index);
+            shard->session.state = SCAN_SESSION_IDLE;
+            deviceShardUnlock(shard);
+            return CS_ERROR;
+        }
+    }
+    int return_value        = scanTableReset(shard->scan_table, device_index);
+    shard->session.state    = SCAN_SESSION_ACTIVE;
+    deviceShardUnlock(shard);
+    return return_value;
+}
+
+/************************************************
+ * bool scanSessionEnd()
+ *  @param  short device_index
+ *
+ *  @brief  Closes the device's scan session when its PROBE_END_SCAN arrives
+ *
+ *  @author Kerry
+ *
+ * @return true if the session was active and its scan table is ready to evaluate, false otherwise
+ ************************************************/
+bool scanSessionEnd(short device_index)
+{
+    device_shard *shard = deviceShardLock(device_index);
+    if (shard == NULL)
+    {
+        return false;
+    }
+    bool return_flag        = shard->session.state == SCAN_SESSION_ACTIVE;
+    shard->session.state    = SCAN_SESSION_IDLE;
+    deviceShardUnlock(shard);
+    return return_flag;
+}
+
+/************************************************
+ * void scanSessionsExpire()
  *  @param  - None
  *
- *  @brief  Initializes all of the values in the G_scan_table
+ *  @brief  Suspends the scan sessions that have stalled, and discards the suspended sessions that were not
+ *          resumed in time (see Scan Session)
  *
  *  @author Kerry
  *
- *  @note   This is called each time a new scan is received from a probe. It is possible that
- *          we can get away with setting:
- *              G_scan_table.scan_element_ctr = 0;
- *          or perhaps setting
- *              G_scan_table.scan_elements[i].scan_id = 0L;
- *          but we shall see
+ *  @note   This is called on every pass of the message loop, but only looks at the sessions once every
+ *          SCAN_SESSION_CHECK_MSEC
+ ************************************************/
+void scanSessionsExpire()
+{
+    static int64_t last_check = 0;
+    int64_t now = zclock_mono();
+    if (now - last_check < SCAN_SESSION_CHECK_MSEC)
+    {
+        return;
+    }
+    last_check = now;
+
+    const csl_monitor_config *config = csl_Config();
+    int64_t timeout_msec    = (int64_t) config->scan_session_timeout_sec * 1000;
+    int64_t window_msec     = (int64_t) config->scan_resume_window_sec * 1000;
+
+    // Registry first, then each shard in turn
+    pthread_rwlock_rdlock(&G_device_registry_lock);
+    for (short i = 0; i < G_monitor_table.device_ctr; i++)
+    {
+        device_shard *shard = G_device_shards[i];
+        pthread_mutex_lock(&shard->shard_lock);
+        if (shard->session.state == SCAN_SESSION_ACTIVE && now - shard->session.last_activity >= timeout_msec)
+        {
+            printf("\t<%s> WARNING: Scan of device_index [%d] stalled after [%u] rows - suspended\n",
+                   __PRETTY_FUNCTION__, i, shard->scan_table == NULL ? 0 : shard->scan_table->scan_element_ctr);
+            shard->session.state        = SCAN_SESSION_SUSPENDED;
+            shard->session.suspended_at = now;
+            scanGrantReturn(shard, false);
+            csl_MetricCount(METRIC_SCANS_SUSPENDED, 1);
+        }
+        else if (shard->session.state == SCAN_SESSION_SUSPENDED && now - shard->session.suspended_at >= window_msec)
+        {
+            printf("\t<%s> WARNING: Suspended scan of device_index [%d] was not resumed - discarded\n",
+                   __PRETTY_FUNCTION__, i);
+            shard->session.state = SCAN_SESSION_IDLE;
+            if (shard->scan_table != NULL)
+            {
+                scanTableReset(shard->scan_table, -1);
+            }
+        }
+        pthread_mutex_unlock(&shard->shard_lock);
+    }
+    pthread_rwlock_unlock(&G_device_registry_lock);
+}
+
+/************************************************
+ * unsigned int scanSessionResumePoint()
+ *  @param  device_shard *shard  - The device, whose shard lock the caller holds
  *
- * @return scan_element_ctr
+ *  @brief  Returns the scan rows a suspended session holds, so its device can resume after them
+ *
+ *  @author Kerry
+ *
+ * @return the rows held, or 0 if the device has no suspended session
  ************************************************/
-int scanTableInitialize(short device_index)
+unsigned int scanSessionResumePoint(device_shard *shard)
 {
-    G_scan_table.scan_element_ctr = 0;
-    G_scan_table.device_index     = device_index;
-    for (unsigned short i = 0; i < MAX_ELEMENTS; i++)
+    if (shard->session.state != SCAN_SESSION_SUSPENDED || shard->scan_table == NULL)
     {
-        memset(&G_scan_table.scan_elements[i], NULL_BINARY, sizeof(csl_scan_record));
+        return 0;
     }
-    return G_scan_table.scan_element_ctr;
+    return shard->scan_table->scan_element_ctr;
+}
+
+/************************************************
+ * int scanTableReset()
+ *  @param
+ *          scan_structure  *scan_table
+ *          short           device_index
+ *
+ *  @brief  Initializes all of the values in a scan table and marks it as belonging to device_index
+ *
+ *  @author Kerry
+ *
+ *  @note   The caller must hold the owning shard's lock. A device_index of -1 marks the table as idle.
+ *
+ * @return scan_element_ctr
+ ************************************************/
+int scanTableReset(scan_structure *scan_table, short device_index)
+{
+    // Only the rows used by the previous scan need clearing, the rest have never been written
+    memset(scan_table->scan_elements, NULL_BINARY, scan_table->scan_element_ctr * sizeof(csl_scan_record));
+    scan_table->scan_element_ctr = 0;
+    scan_table->device_index     = device_index;
+    scan_table->ordered          = true;
+    return scan_table->scan_element_ctr;
 }
 
 
@@ -2273,7 +3280,7 @@ int scanTableInitialize(short device_index)
  * bool statusQuoTableAddRow ()
  *  @param
  *          unsigned short device_index
- *          unsigned short sq_table_row
+ *          unsigned int   sq_table_row
  *          csl_scan_record scanRecord
  *
  *  @brief  This function adds a row to the column in the Status Quo Table associated with a specific device.
@@ -2284,23 +3291,25 @@ int scanTableInitialize(short device_index)
  *
  * @return  true on success, false on failure
  ************************************************/
-bool statusQuoTableAddRow (unsigned short device_index, unsigned short sq_table_row, csl_scan_record scanRecord)
+bool statusQuoTableAddRow (unsigned short device_index, unsigned int sq_table_row, csl_scan_record scanRecord)
 {
     bool return_flag = true;
+    device_shard *shard = G_device_shards[device_index];
 
-    if (G_device_table[device_index].status_element_ctr >= MAX_ELEMENTS)
+    if (deviceShardGrowTable(shard, (void **) &shard->status_quo, &shard->status_quo_capacity,
+                             sizeof(status_quo_record), sq_table_row + 1) == false)
     {
         // todo - Throw an error flag here
         printf("\t<%s> ERROR: Status Quo Table Overflow for Device [%d]\n", __PRETTY_FUNCTION__, device_index);
         return_flag = false;
         return return_flag;
     }
-    G_device_table[device_index].status_element_ctr++;
-    memcpy(G_status_quo_table[device_index][sq_table_row].element_identifier,scanRecord.element_name_hash, SIZE_HASH_NAME);
-    G_status_quo_table[device_index][sq_table_row].element_type         = scanRecord.element_type;
-    G_status_quo_table[device_index][sq_table_row].element_attributes   = scanRecord.element_attributes;
-    memcpy(G_status_quo_table[device_index][sq_table_row].scan_value, scanRecord.scan_value, SIZE_HASH_ELEMENT);
-    G_status_quo_table[device_index][sq_table_row].alert_code           = 0;
+    shard->device.status_element_ctr++;
+    memcpy(shard->status_quo[sq_table_row].element_identifier,scanRecord.element_name_hash, SIZE_HASH_NAME);
+    shard->status_quo[sq_table_row].element_type         = scanRecord.element_type;
+    shard->status_quo[sq_table_row].element_attributes   = scanRecord.element_attributes;
+    memcpy(shard->status_quo[sq_table_row].scan_value, scanRecord.scan_value, SIZE_HASH_ELEMENT);
+    shard->status_quo[sq_table_row].alert_code           = 0;
 
 //    print_csl_scan_record(&scanRecord, "Debug", sq_table_row);
     return return_flag;
@@ -2322,17 +3331,21 @@ bool statusQuoTableAddRow (unsigned short device_index, unsigned short sq_table_
 bool statusQuoTableBuild(unsigned short device_index)
 {
     bool return_flag = true;
+    device_shard    *shard      = G_device_shards[device_index];
+    scan_structure  *scan_table = shard->scan_table;
 
-    G_device_table[device_index].status_element_ctr = 0;
-    for (unsigned short row_index = 0; row_index < G_scan_table.scan_element_ctr; row_index++)
+    shard->device.status_element_ctr = 0;
+    for (unsigned int row_index = 0; row_index < scan_table->scan_element_ctr; row_index++)
     {
-        if (statusQuoTableAddRow(device_index, row_index, G_scan_table.scan_elements[row_index]) != true)
+        if (statusQuoTableAddRow(device_index, row_index, scan_table->scan_elements[row_index]) != true)
         {
             // todo - Throw an error flag here
             return_flag = false;
             break;
         }
     }
+    // A column built from an ordered scan is already in the order statusQuoTableMerge() keeps
+    shard->status_quo_ordered = return_flag && scan_table->ordered;
 
     return return_flag;
 }
@@ -2342,7 +3355,7 @@ bool statusQuoTableBuild(unsigned short device_index)
  * bool statusQuoTableRemoveRow()
  *  @param
  *          unsigned short device_index
- *          unsigned short row_number
+ *          unsigned int   row_number
  *
  *  @brief  Removes the specified row from the column in the Status Quo Table associated with a specific device.
  *          It then "closes up the gap" by moving all of the lower rows up.
@@ -2351,25 +3364,26 @@ bool statusQuoTableBuild(unsigned short device_index)
  *
  *  @return true on success, false on failure
  ************************************************/
-bool statusQuoTableRemoveRow(unsigned short device_index, unsigned short row_number)
+bool statusQuoTableRemoveRow(unsigned short device_index, unsigned int row_number)
 {
     bool return_flag = true;
+    device_shard *shard = G_device_shards[device_index];
 
-    unsigned short next_row;
-    unsigned short end_of_table = G_device_table[device_index].status_element_ctr;
-    while (end_of_table > row_number)
+    unsigned int next_row;
+    unsigned int end_of_table = shard->device.status_element_ctr;
+    while (end_of_table > row_number + 1)
     {
         next_row = row_number + 1;
-        memcpy(&G_status_quo_table[device_index][row_number], &G_status_quo_table[device_index][next_row], sizeof(status_quo_record));
+        memcpy(&shard->status_quo[row_number], &shard->status_quo[next_row], sizeof(status_quo_record));
         row_number++;
     }
-    G_device_table[device_index].status_element_ctr--;
+    shard->device.status_element_ctr--;
 
     return return_flag;
 }
 
 /************************************************
- * short statusQuoTableSearch
+ * int statusQuoTableSearch
  *  @param
  *          short           device_index    - The device column to search
  *          scan_structure  the_scan        - The scan data from the latest scan
@@ -2394,7 +3408,8 @@ bool statusQuoTableRemoveRow(unsigned short device_index, unsigned short row_num
  *
  *      Pass #1
  *      -------
- *      Modified Elements are determined by a direct comparison with the associated values in the Status Quo Table
+ *      Modified Elements are determined by a direct comparison with the associated values in the Status Quo Table,
+ *      made DIFF_BLOCK_ROWS matched elements at a time by csl_DiffBlock() (see statusQuoTableDiffFlush())
  *      Additions are determined by there not being an associated value in the Status Quo Table
  *      For additions and modifications, each discrepancy is flagged and the alert_code field in the
  *      Status Quo Table is updated appropriately. The alert_code field is a single byte (unsigned char) field
@@ -2417,76 +3432,46 @@ bool statusQuoTableRemoveRow(unsigned short device_index, unsigned short row_num
  *      For every entry touched on Pass #2, when it is examined, its COMPARED bit is set back to 0x0.
  *
  * @return  on success, the number of alerts found
- *          On failure, an error code (not yet implemented)
+ *          On failure, CS_ERROR (a count is never negative)
  ************************************************/
-short   statusQuoTableSearch(short device_index)
+int     statusQuoTableSearch(short device_index)
 {
-    short alert_ctr = 0;
-    if (device_index != G_scan_table.device_index)
+    int alert_ctr = 0;
+    device_shard    *shard      = G_device_shards[device_index];
+    scan_structure  *scan_table = shard->scan_table;
+    if (device_index != scan_table->device_index)
     {
         printf("\t<%s> ERROR: Searching SQ Table for device [%d] with scan from device [%d]\n",
-               __PRETTY_FUNCTION__, device_index, G_scan_table.device_index);
+               __PRETTY_FUNCTION__, device_index, scan_table->device_index);
         return CS_ERROR;
     }
 
     /********************************************
      * For each element in the scan, we search the sq table for a match ****
+     * The matches are compared a block at a time, in statusQuoTableDiffFlush()
      ********************************************/
+    status_quo_diff *diff = &G_status_quo_diff;
+    diff->block.row_ctr         = 0;
+    diff->compare_contents      = 0;
+    diff->compare_attributes    = 0;
 
     // **** scan table loop ****
-    for (unsigned short scan_index = 0; scan_index < G_scan_table.scan_element_ctr; scan_index++)
+    for (unsigned int scan_index = 0; scan_index < scan_table->scan_element_ctr; scan_index++)
     {
         bool found_flag = false;
 
         // **** status quo table loop ****
-        for (unsigned short sq_index = 0; sq_index < G_device_table[device_index].status_element_ctr; sq_index++)
+        for (unsigned int sq_index = 0; sq_index < shard->device.status_element_ctr; sq_index++)
         {
             // Check for the Row matching the element_name_hash
-            if (memcmp(G_scan_table.scan_elements[scan_index].element_name_hash,
-                G_status_quo_table[device_index][sq_index].element_identifier, SIZE_HASH_NAME) == 0)
+            if (memcmp(scan_table->scan_elements[scan_index].element_name_hash,
+                shard->status_quo[sq_index].element_identifier, SIZE_HASH_NAME) == 0)
             {
-                // Found a match. Need to compare the specific values and note that we found this element
+                // Found a match. Note that we found this element, and queue its values for comparison
                 found_flag = true;
-                G_status_quo_table[device_index][sq_index].alert_code =
-                        G_status_quo_table[device_index][sq_index].alert_code | MASK_COMPARED;
-
-                // Check for Contents Modifications
-                if (memcmp(G_scan_table.scan_elements[scan_index].scan_value,
-                           G_status_quo_table[device_index][sq_index].scan_value, SIZE_HASH_ELEMENT) != 0)
-                {
-                    // **** Hash Modification Discovered ****
-
-                    // Increment the alert_ctr and update the row to note that this change has been noted
-                    alert_ctr++;
-                    G_status_quo_table[device_index][sq_index].alert_code =
-                            G_status_quo_table[device_index][sq_index].alert_code | MASK_MOD_CONTENTS;
-
-                    // write to the alert log that element's contents have been modified
-                    alertOnElementModification(device_index, G_scan_table.scan_elements[scan_index], ALERT_MOD_CONTENTS);
-
-                    // modify the status quo table entry to contain the modified value
-                    memcpy(G_status_quo_table[device_index][sq_index].scan_value,
-                           G_scan_table.scan_elements[scan_index].scan_value, SIZE_HASH_ELEMENT);
-                }
-
-                // Check for Attributes Modifications
-                if (G_scan_table.scan_elements[scan_index].element_attributes !=
-                    G_status_quo_table[device_index][sq_index].element_attributes)
-                {
-                    // **** Attribute Modification Discovered ****
-
-                    // Increment the alert_ctr and update the row to note that this change has been noted
-                    alert_ctr++;
-                    G_status_quo_table[device_index][sq_index].alert_code =
-                            G_status_quo_table[device_index][sq_index].alert_code | MASK_MOD_ATTRIBS;
-
-                    // write to the alert log that element's attributes have been modified
-                    alertOnElementModification(device_index, G_scan_table.scan_elements[scan_index], ALERT_MOD_ATTRIBS);
-
-                    // modify the status quo table entry to contain the modified value
-                    G_status_quo_table[device_index][sq_index].element_attributes =
-                            G_scan_table.scan_elements[scan_index].element_attributes;
-                }
+                shard->status_quo[sq_index].alert_code =
+                        shard->status_quo[sq_index].alert_code | MASK_COMPARED;
+                alert_ctr += statusQuoTableDiffAddRow(device_index, diff, scan_index, sq_index);
                 break;   // Since we found it, we do not need to search for this scan entry anymore
             }
         }
@@ -2494,50 +3479,27 @@ short   statusQuoTableSearch(short device_index)
         // **** Check for new, added element ****
         if (found_flag != true)     // The scan entry is not in the SQ table, so this must be an added element
         {
-            // Add the entry to the SQ Table
-            alert_ctr++;
-            unsigned short sq_table_row    = G_device_table[device_index].status_element_ctr;
-            statusQuoTableAddRow (device_index, sq_table_row, G_scan_table.scan_elements[scan_index]);
-
-            // Flag that the comparison took place
-            G_status_quo_table[device_index][sq_table_row].alert_code =
-                    G_status_quo_table[device_index][sq_table_row].alert_code | MASK_COMPARED;
-            G_status_quo_table[device_index][sq_table_row].alert_code =
-                    G_status_quo_table[device_index][sq_table_row].alert_code | MASK_ADD_ELEMENT;
-
-            // Send out an alert
-            alertOnElementAddition(device_index, G_scan_table.scan_elements[scan_index]);
-
-            // Add the entry to the element_added_names view
-            int         return_value    = CS_SUCCESS;
-            char        mysql_insert[SIZE_CS_SQL_COMMAND];
-
-            sprintf(mysql_insert, "Insert into %s.%s "
-                                  "(monitor_id, device_id, element_identifier, element_name)"
-                                  "values (%llu, %llu, '%s', '%s')",
-                    CS_SQL_MONITOR_SCHEMA, CS_SQL_ELEMENT_ADDED_NAMES_VIEW,
-                    G_monitor_table.monitor_id,
-                    G_device_table[device_index].device_id,
-                    G_scan_table.scan_elements[scan_index].element_name_hash,
-                    G_scan_table.scan_elements[scan_index].element_name);
-            return_value = csl_UpdateDB(G_db_connection, mysql_insert);
+            alert_ctr += statusQuoTableAddElement(device_index, scan_index);
         }
     }
 
+    // Compare the last, partial block //
+    alert_ctr += statusQuoTableDiffFlush(device_index, diff);
+
     /********************************************
      * Finally, we check the sq table for entries for which there was no scan i.e., deleted elements
      * For each element in the sq table, we search the scan for a match ****
      ********************************************/
 
-    // SQ Table loop
-    for (unsigned short sq_index = 0; sq_index < G_device_table[device_index].status_element_ctr; sq_index++)
+    // SQ Table loop - a removed row's place is taken by the next, so sq_index only moves on past a kept row
+    for (unsigned int sq_index = 0; sq_index < shard->device.status_element_ctr; )
     {
-        if ((G_status_quo_table[device_index][sq_index].alert_code & MASK_COMPARED) == 0)
+        if ((shard->status_quo[sq_index].alert_code & MASK_COMPARED) == 0)
         {   // if the entry in sq table was not flagged,it was not in the scan
             alert_ctr++;
 
-            if (alertOnElementDeletion (G_status_quo_table[device_index][sq_index], G_device_table[device_index].device_id,
-                                        G_scan_table.scan_elements[0].scan_date) == false)
+            if (alertOnElementDeletion (device_index, shard->status_quo[sq_index],
+                                        scan_table->scan_elements[0].scan_date) == false)
             {
                 // todo - Throw an error flag
             }
@@ -2548,17 +3510,376 @@ short   statusQuoTableSearch(short device_index)
         }
         else
         {   // the element was found, therefore zero out the Flagged bit in preparation for the next scan
-            G_status_quo_table[device_index][sq_index].alert_code =
-                    G_status_quo_table[device_index][sq_index].alert_code ^ MASK_COMPARED;
+            shard->status_quo[sq_index].alert_code =
+                    shard->status_quo[sq_index].alert_code ^ MASK_COMPARED;
+            sq_index++;
         }
     }
 //    printf("\t<%s> Finished scan of [%d] for device_index[%d]\n",
-//           __PRETTY_FUNCTION__, G_scan_table.scan_element_ctr, G_scan_table.device_index);
-    if (scanTableInitialize(-1) != 0)
+//           __PRETTY_FUNCTION__, scan_table->scan_element_ctr, scan_table->device_index);
+    if (scanTableReset(scan_table, -1) != 0)
+    {
+        printf("\t<%s> Failed to initial scan table for device[%d]",
+               __PRETTY_FUNCTION__ ,device_index);
+    }
+
+    // A device whose alerts are held writes their summaries once its window is over, even with no new alerts //
+    alertAggregateFlush((unsigned short) device_index, false);
+    return alert_ctr;
+}
+
+/************************************************
+ * int statusQuoTableMerge
+ *  @param  short device_index  - The device column to search
+ *
+ *  @brief  Compares an ordered scan with the Status Quo Table in one merge of the two, and finds the same
+ *          modifications, additions and deletions statusQuoTableSearch() does
+ *
+ *  @author Kerry
+ *
+ *  @note
+ *      **** Caution: This function uses bit-wise operators ****
+ *
+ *      The scan must be in element_name_hash order (scan_structure.ordered). The Status Quo Table is sorted into
+ *      element_identifier order first, if it is not already, and kept in that order, so each scan after the first
+ *      is one pass down both tables:
+ *          * The same element in both  - compared a block at a time, as in statusQuoTableSearch()
+ *          * Only in the scan          - an addition. The row is appended, and merged into place at the end.
+ *          * Only in the table         - a deletion. The row is left without its COMPARED bit, and the table is
+ *                                        closed up in one pass once the alerts are sent.
+ *      A duplicated element_name_hash is not in order, so such a scan is always searched.
+ *
+ * @return  on success, the number of alerts found
+ *          On failure, CS_ERROR
+ ************************************************/
+int     statusQuoTableMerge(short device_index)
+{
+    int alert_ctr = 0;
+    device_shard    *shard      = G_device_shards[device_index];
+    scan_structure  *scan_table = shard->scan_table;
+    if (device_index != scan_table->device_index || scan_table->ordered == false)
+    {
+        printf("\t<%s> ERROR: Merging SQ Table for device [%d] with scan from device [%d]%s\n",
+               __PRETTY_FUNCTION__, device_index, scan_table->device_index,
+               scan_table->ordered ? "" : " out of order");
+        return CS_ERROR;
+    }
+
+    // The first ordered scan after a searched one (or a restart) puts the column in order //
+    unsigned int sq_ctr = shard->device.status_element_ctr;
+    if (shard->status_quo_ordered == false)
+    {
+        qsort(shard->status_quo, sq_ctr, sizeof(status_quo_record), statusQuoRowCompare);
+        shard->status_quo_ordered = true;
+    }
+
+    /********************************************
+     * Pass #1 - one step down the scan, the sq table, or both, each time round
+     * The rows added are appended after the sq_ctr rows being merged with
+     ********************************************/
+    status_quo_diff *diff = &G_status_quo_diff;
+    diff->block.row_ctr         = 0;
+    diff->compare_contents      = 0;
+    diff->compare_attributes    = 0;
+
+    unsigned int sq_index   = 0;
+    unsigned int added_ctr  = 0;
+    for (unsigned int scan_index = 0; scan_index < scan_table->scan_element_ctr; )
+    {
+        int order = -1;     // Once the sq table runs out, the rest of the scan is added
+        if (sq_index < sq_ctr)
+        {
+            order = memcmp(scan_table->scan_elements[scan_index].element_name_hash,
+                           shard->status_quo[sq_index].element_identifier, SIZE_HASH_NAME);
+        }
+
+        if (order == 0)
+        {
+            shard->status_quo[sq_index].alert_code =
+                    shard->status_quo[sq_index].alert_code | MASK_COMPARED;
+            alert_ctr += statusQuoTableDiffAddRow(device_index, diff, scan_index, sq_index);
+            scan_index++;
+            sq_index++;
+        }
+        else if (order < 0)
+        {
+            int added = statusQuoTableAddElement(device_index, scan_index);
+            alert_ctr   += added;
+            added_ctr   += (unsigned int) added;
+            scan_index++;
+        }
+        else
+        {
+            sq_index++;     // Not in the scan - found by pass #2
+        }
+    }
+    alert_ctr += statusQuoTableDiffFlush(device_index, diff);
+
+    /********************************************
+     * Pass #2 - the deletions, closing up the table as we go
+     ********************************************/
+    unsigned int kept_ctr = 0;
+    for (sq_index = 0; sq_index < shard->device.status_element_ctr; sq_index++)
+    {
+        if ((shard->status_quo[sq_index].alert_code & MASK_COMPARED) == 0)
+        {
+            alert_ctr++;
+            if (alertOnElementDeletion (device_index, shard->status_quo[sq_index],
+                                        scan_table->scan_elements[0].scan_date) == false)
+            {
+                // todo - Throw an error flag
+            }
+            continue;
+        }
+        shard->status_quo[sq_index].alert_code =
+                shard->status_quo[sq_index].alert_code ^ MASK_COMPARED;
+        if (kept_ctr != sq_index)
+        {
+            shard->status_quo[kept_ctr] = shard->status_quo[sq_index];
+        }
+        kept_ctr++;
+    }
+    shard->device.status_element_ctr = kept_ctr;
+
+    /********************************************
+     * The added rows are the last added_ctr, in order, and the rest are in order - merge them, from the end back
+     ********************************************/
+    shard->status_quo_ordered = true;
+    if (added_ctr > 0 && added_ctr < kept_ctr)
+    {
+        status_quo_record *added = malloc(added_ctr * sizeof(status_quo_record));
+        if (added == NULL)
+        {
+            qsort(shard->status_quo, kept_ctr, sizeof(status_quo_record), statusQuoRowCompare);
+        }
+        else
+        {
+            memcpy(added, &shard->status_quo[kept_ctr - added_ctr], added_ctr * sizeof(status_quo_record));
+            unsigned int old_row    = kept_ctr - added_ctr;     // one past the last of the old rows left
+            unsigned int added_row  = added_ctr;                // one past the last of the added rows left
+            unsigned int row        = kept_ctr;
+            while (added_row > 0)
+            {
+                if (old_row > 0 && statusQuoRowCompare(&shard->status_quo[old_row - 1], &added[added_row - 1]) > 0)
+                {
+                    shard->status_quo[--row] = shard->status_quo[--old_row];
+                }
+                else
+                {
+                    shard->status_quo[--row] = added[--added_row];
+                }
+            }
+            free(added);
+        }
+    }
+
+    if (scanTableReset(scan_table, -1) != 0)
     {
         printf("\t<%s> Failed to initial scan table for device[%d]",
                __PRETTY_FUNCTION__ ,device_index);
     }
+
+    // A device whose alerts are held writes their summaries once its window is over, even with no new alerts //
+    alertAggregateFlush((unsigned short) device_index, false);
+    return alert_ctr;
+}
+
+/************************************************
+ * int statusQuoTableAddElement
+ *  @param
+ *          short           device_index
+ *          unsigned int    scan_index      - The scan element that is not in the Status Quo Table
+ *
+ *  @brief  Appends a row for an added element, flags it, alerts on it and records it in the element_added_names view
+ *
+ *  @author Kerry
+ *
+ *  @note   An appended row is out of order, so status_quo_ordered is cleared
+ *
+ *  @return the number of alerts raised
+ ************************************************/
+int     statusQuoTableAddElement(short device_index, unsigned int scan_index)
+{
+    device_shard    *shard      = G_device_shards[device_index];
+    scan_structure  *scan_table = shard->scan_table;
+
+    // Add the entry to the SQ Table
+    unsigned int   sq_table_row    = shard->device.status_element_ctr;
+    if (statusQuoTableAddRow (device_index, sq_table_row, scan_table->scan_elements[scan_index]) == false)
+    {
+        return 0;
+    }
+    shard->status_quo_ordered = false;
+
+    // Flag that the comparison took place
+    shard->status_quo[sq_table_row].alert_code =
+            shard->status_quo[sq_table_row].alert_code | MASK_COMPARED;
+    shard->status_quo[sq_table_row].alert_code =
+            shard->status_quo[sq_table_row].alert_code | MASK_ADD_ELEMENT;
+
+    // Send out an alert
+    alertOnElementAddition(device_index, scan_table->scan_elements[scan_index]);
+
+    // Add the entry to the element_added_names view
+    char        mysql_insert[SIZE_CS_SQL_COMMAND];
+
+    sprintf(mysql_insert, "Insert into %s.%s "
+                          "(monitor_id, device_id, element_identifier, element_name)"
+                          "values (%llu, %llu, '%s', '%s')",
+            CS_SQL_MONITOR_SCHEMA, CS_SQL_ELEMENT_ADDED_NAMES_VIEW,
+            G_monitor_table.monitor_id,
+            shard->device.device_id,
+            scan_table->scan_elements[scan_index].element_name_hash,
+            scan_table->scan_elements[scan_index].element_name);
+    csl_SpoolUpdate(mysql_insert);
+    shard->spool_sequence = csl_SpoolSequence();
+    return 1;
+}
+
+/************************************************
+ * int statusQuoRowCompare
+ *  @param
+ *          const void  *row_one    - status_quo_record
+ *          const void  *row_two    - status_quo_record
+ *
+ *  @brief  Orders Status Quo Table rows by element_identifier, for qsort()
+ *
+ *  @author Kerry
+ *
+ *  @return <0, 0 or >0, as memcmp()
+ ************************************************/
+int     statusQuoRowCompare(const void *row_one, const void *row_two)
+{
+    return memcmp(((const status_quo_record *) row_one)->element_identifier,
+                  ((const status_quo_record *) row_two)->element_identifier, SIZE_HASH_NAME);
+}
+
+/************************************************
+ * int statusQuoTableDiffAddRow
+ *  @param
+ *          short               device_index
+ *          status_quo_diff     *diff
+ *          unsigned int        scan_index      - The scan element
+ *          unsigned int        sq_index        - The status quo row it matched
+ *
+ *  @brief  Adds a matched pair to the diff block, and compares the block once it is full
+ *
+ *  @author Kerry
+ *
+ *  @note   The element type of the scan element decides which changes are looked for (element_compare_masks[])
+ *
+ *  @return the number of alerts raised
+ ************************************************/
+int     statusQuoTableDiffAddRow(short device_index, status_quo_diff *diff, unsigned int scan_index,
+                                 unsigned int sq_index)
+{
+    device_shard        *shard          = G_device_shards[device_index];
+    csl_scan_record     *scan_element   = &shard->scan_table->scan_elements[scan_index];
+    status_quo_record   *sq_element     = &shard->status_quo[sq_index];
+    unsigned int        row             = diff->block.row_ctr++;
+
+    memcpy(diff->block.status_quo_values[row], sq_element->scan_value, SIZE_HASH_ELEMENT);
+    memcpy(diff->block.scan_values[row], scan_element->scan_value, SIZE_HASH_ELEMENT);
+    diff->block.status_quo_attributes[row]  = sq_element->element_attributes;
+    diff->block.scan_attributes[row]        = scan_element->element_attributes;
+    diff->scan_rows[row]                    = scan_index;
+    diff->status_quo_rows[row]              = sq_index;
+
+    unsigned char compare_mask = MASK_MOD_CONTENTS | MASK_MOD_ATTRIBS;
+    if (scan_element->element_type < sizeof(element_compare_masks) / sizeof(element_compare_masks[0]))
+    {
+        compare_mask = element_compare_masks[scan_element->element_type];
+    }
+    if ((compare_mask & MASK_MOD_CONTENTS) != 0)
+    {
+        diff->compare_contents      |= 1ULL << row;
+    }
+    if ((compare_mask & MASK_MOD_ATTRIBS) != 0)
+    {
+        diff->compare_attributes    |= 1ULL << row;
+    }
+
+    if (diff->block.row_ctr < DIFF_BLOCK_ROWS)
+    {
+        return 0;
+    }
+    return statusQuoTableDiffFlush(device_index, diff);
+}
+
+/************************************************
+ * int statusQuoTableDiffFlush
+ *  @param
+ *          short               device_index
+ *          status_quo_diff     *diff
+ *
+ *  @brief  Compares the pairs in the diff block, and for each set bit of the change bitmaps raises the alert and
+ *          updates the status quo row, as statusQuoTableSearch() describes. The block is then emptied.
+ *
+ *  @author Kerry
+ *
+ *  @note   **** Caution: This function uses bit-wise operators ****
+ *          A scan with no changes costs one csl_DiffBlock() per DIFF_BLOCK_ROWS elements, and nothing more
+ *
+ *  @return the number of alerts raised
+ ************************************************/
+int     statusQuoTableDiffFlush(short device_index, status_quo_diff *diff)
+{
+    int alert_ctr = 0;
+    if (diff->block.row_ctr == 0)
+    {
+        return alert_ctr;
+    }
+
+    uint64_t contents_changed;
+    uint64_t attributes_changed;
+    csl_DiffBlock(&diff->block, &contents_changed, &attributes_changed);
+    contents_changed    &= diff->compare_contents;
+    attributes_changed  &= diff->compare_attributes;
+
+    device_shard *shard = G_device_shards[device_index];
+    uint64_t changed    = contents_changed | attributes_changed;
+    while (changed != 0)
+    {
+        unsigned int        row             = (unsigned int) __builtin_ctzll(changed);
+        uint64_t            row_bit         = 1ULL << row;
+        csl_scan_record     *scan_element   = &shard->scan_table->scan_elements[diff->scan_rows[row]];
+        status_quo_record   *sq_element     = &shard->status_quo[diff->status_quo_rows[row]];
+        changed &= changed - 1;
+
+        if ((contents_changed & row_bit) != 0)
+        {
+            // **** Hash Modification Discovered ****
+
+            // Increment the alert_ctr and update the row to note that this change has been noted
+            alert_ctr++;
+            sq_element->alert_code = sq_element->alert_code | MASK_MOD_CONTENTS;
+
+            // write to the alert log that element's contents have been modified
+            alertOnElementModification(device_index, *scan_element, ALERT_MOD_CONTENTS);
+
+            // modify the status quo table entry to contain the modified value
+            memcpy(sq_element->scan_value, scan_element->scan_value, SIZE_HASH_ELEMENT);
+        }
+
+        if ((attributes_changed & row_bit) != 0)
+        {
+            // **** Attribute Modification Discovered ****
+
+            // Increment the alert_ctr and update the row to note that this change has been noted
+            alert_ctr++;
+            sq_element->alert_code = sq_element->alert_code | MASK_MOD_ATTRIBS;
+
+            // write to the alert log that element's attributes have been modified
+            alertOnElementModification(device_index, *scan_element, ALERT_MOD_ATTRIBS);
+
+            // modify the status quo table entry to contain the modified value
+            sq_element->element_attributes = scan_element->element_attributes;
+        }
+    }
+
+    diff->block.row_ctr         = 0;
+    diff->compare_contents      = 0;
+    diff->compare_attributes    = 0;
     return alert_ctr;
 }
 
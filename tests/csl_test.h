@@ -0,0 +1,54 @@
+/************************************************
+ * csl_test.h
+ * ==========
+ *
+ * This is the header file for the CS Test Library
+ *
+ * Author:      Kerry
+ * Version:     00.00.00
+ * Comments:    Just enough to write the tests in this directory as plain programs run by ctest - each test
+ *              program checks what it checks, prints each failure, and exits non-zero if there was any
+ ************************************************/
+
+#ifndef CRYTICAMONITOR_CSL_TEST_H
+#define CRYTICAMONITOR_CSL_TEST_H
+
+#include <stdio.h>
+#include <stdlib.h>
+
+/************************************************
+ * #defines
+ * ========
+ ************************************************/
+#define TEST_SEED                   20261019        // Every run of a test sees the same "random" inputs
+
+/************************************************
+ * Checks
+ * ======
+ * A failed check prints where it was and why, and is counted; the test goes on, so one run shows every failure.
+ * CSL_TEST_EXIT() ends main() with the verdict.
+ ************************************************/
+static unsigned int G_test_check_ctr;
+static unsigned int G_test_failure_ctr;
+
+#define CSL_TEST_CHECK(condition, ...)                                                  \
+    do                                                                                  \
+    {                                                                                   \
+        G_test_check_ctr++;                                                             \
+        if (!(condition))                                                               \
+        {                                                                               \
+            G_test_failure_ctr++;                                                       \
+            printf("\t<%s:%d> FAILED: %s - ", __FILE__, __LINE__, #condition);          \
+            printf(__VA_ARGS__);                                                        \
+            printf("\n");                                                               \
+        }                                                                               \
+    } while (0)
+
+#define CSL_TEST_EXIT()                                                                 \
+    do                                                                                  \
+    {                                                                                   \
+        printf("[%u] checks, [%u] failed\n", G_test_check_ctr, G_test_failure_ctr);     \
+        return G_test_failure_ctr == 0 ? EXIT_SUCCESS : EXIT_FAILURE;                   \
+    } while (0)
+
+#endif //CRYTICAMONITOR_CSL_TEST_H
@@ -0,0 +1,275 @@
+//
+// Created by kerry on 10/19/26.
+//
+
+/************************************************
+ * test_alerts
+ * ===========
+ * Alert aggregation (see Alert Aggregation in CryticaMonitor.h), against the SQLite backend:
+ *      * The cap       - a device alerting from far more directories than it has buckets never holds more than
+ *                        ALERT_MAX_BUCKETS, the overflow shares one ALERT_OTHER_DIRECTORY bucket per alert type,
+ *                        and every alert is still accounted for, as written or in a summary
+ *      * Reload        - monitorConfigUpdate() writes the summaries every device still holds before it releases
+ *                        the device shards
+ *      * Shut down     - monitorShutDown() writes them before it disconnects from the database
+ * Built from the monitor's own sources, without main.c's main() (see CSL_NO_MAIN). Only built with CSL_SQLITE.
+ ************************************************/
+
+#include <unistd.h>
+#include "CryticaMonitor.h"
+#include "csl_storage.h"
+#include "csl_test.h"
+
+#define TEST_ALERTS_DEVICES         2
+#define TEST_ALERTS_DIRECTORIES     1500            // Far more than ALERT_MAX_BUCKETS / ALERT_SCAN_TYPES
+#define TEST_ALERTS_HELD            10              // One written as it happens, the rest held
+#define TEST_ALERTS_NAME_FORMAT     "/opt/test/dir%04u/file%02u"
+#define TEST_ALERTS_DEVICE_FORMAT   "02:cf:be:00:00:%02x"
+
+static const short G_test_alert_types[ALERT_SCAN_TYPES] =
+        {ALERT_ADD_ELEMENT, ALERT_MOD_CONTENTS, ALERT_DEL_ELEMENT, ALERT_MOD_ATTRIBS};
+
+/************************************************
+ * The Alert Log
+ * =============
+ * What a device's rows of the alert log add up to - a row is one alert, or a summary of alert_data's count
+ ************************************************/
+typedef struct
+{
+    unsigned int        row_ctr;
+    unsigned int        summary_ctr;
+    unsigned long long  alert_ctr;
+} test_alert_log;
+
+static int test_alert_log_row(void *context, unsigned int column_ctr, char **fields)
+{
+    test_alert_log  *log    = context;
+    unsigned int    count   = 1;
+    if (column_ctr > 0 && fields[0] != NULL && sscanf(fields[0], "Summary: [%u]", &count) == 1)
+    {
+        log->summary_ctr++;
+    }
+    log->row_ctr++;
+    log->alert_ctr += count;
+    return CS_SUCCESS;
+}
+
+/************************************************
+ * test_alert_log test_alert_log_read()
+ *  @param  unsigned long long device_id    - 0 for every device
+ *
+ *  @brief  Adds up the alert log, for one device or all
+ *
+ *  @author Kerry
+ ************************************************/
+static test_alert_log test_alert_log_read(unsigned long long device_id)
+{
+    test_alert_log  log = {0, 0, 0};
+    char            query[SIZE_CS_SQL_COMMAND];
+    snprintf(query, SIZE_CS_SQL_COMMAND, "Select alert_data from %s.%s where device_id = %llu or %llu = 0",
+             CS_SQL_MONITOR_SCHEMA, CS_SQL_ALERT_LOG_VIEW, device_id, device_id);
+    CSL_TEST_CHECK(csl_StorageQuery(query, test_alert_log_row, &log) >= 0, "could not read the alert log");
+    return log;
+}
+
+/************************************************
+ * void test_alert_raise()
+ *  @param
+ *          short           device_index
+ *          short           alert_type
+ *          unsigned int    directory
+ *          unsigned int    file
+ *
+ *  @brief  Raises a scan alert, as a scan evaluation does - with the device's shard locked
+ *
+ *  @author Kerry
+ ************************************************/
+static void test_alert_raise(short device_index, short alert_type, unsigned int directory, unsigned int file)
+{
+    csl_scan_record scan_element;
+    memset(&scan_element, NULL_BINARY, sizeof(csl_scan_record));
+    snprintf(scan_element.element_name, SIZE_ELEMENT_NAME, TEST_ALERTS_NAME_FORMAT, directory, file);
+    scan_element.element_type   = ELEMENT_EXEC_FILE;
+    scan_element.scan_date      = time(NULL);
+
+    device_shard *shard = deviceShardLock(device_index);
+    alertOnElementModification((unsigned short) device_index, scan_element, alert_type);
+    deviceShardUnlock(shard);
+}
+
+/************************************************
+ * void test_alerts_hold()
+ *  @param  - None
+ *
+ *  @brief  Has every device hold TEST_ALERTS_HELD - 1 alerts of one directory and type, after writing the first
+ *
+ *  @author Kerry
+ ************************************************/
+static void test_alerts_hold()
+{
+    for (short device_index = 0; device_index < TEST_ALERTS_DEVICES; device_index++)
+    {
+        for (unsigned int file = 0; file < TEST_ALERTS_HELD; file++)
+        {
+            test_alert_raise(device_index, ALERT_MOD_CONTENTS, 0, file);
+        }
+        device_shard *shard = deviceShardLock(device_index);
+        CSL_TEST_CHECK(shard->alerts.bucket_ctr == 1 && shard->alerts.buckets[0].held_ctr == TEST_ALERTS_HELD - 1,
+                       "device [%d] holds [%u] buckets, expected 1 of [%u] alerts", device_index,
+                       shard->alerts.bucket_ctr, TEST_ALERTS_HELD - 1);
+        deviceShardUnlock(shard);
+    }
+}
+
+/************************************************
+ * void test_alerts_flushed()
+ *  @param
+ *          const char          *what
+ *          test_alert_log      before      - The whole alert log before the flush
+ *
+ *  @brief  Checks the alerts test_alerts_hold() held were written, as one summary per device
+ *
+ *  @author Kerry
+ ************************************************/
+static void test_alerts_flushed(const char *what, test_alert_log before)
+{
+    test_alert_log after = test_alert_log_read(0);
+    CSL_TEST_CHECK(after.summary_ctr == before.summary_ctr + TEST_ALERTS_DEVICES &&
+                   after.alert_ctr == before.alert_ctr + TEST_ALERTS_DEVICES * (TEST_ALERTS_HELD - 1),
+                   "%s wrote [%u] summaries of [%llu] alerts, expected [%u] of [%u]", what,
+                   after.summary_ctr - before.summary_ctr, after.alert_ctr - before.alert_ctr,
+                   TEST_ALERTS_DEVICES, TEST_ALERTS_DEVICES * (TEST_ALERTS_HELD - 1));
+}
+
+/************************************************
+ * int test_alerts_setup()
+ *  @param  - None
+ *
+ *  @brief  Starts the monitor on an empty SQLite database with TEST_ALERTS_DEVICES devices assigned to it,
+ *          and alerts held for alert_window_sec
+ *
+ *  @author Kerry
+ *
+ *  @return CS_SUCCESS, or an error code
+ ************************************************/
+static int test_alerts_setup()
+{
+    char config_file_name[PATH_MAX];
+    snprintf(config_file_name, PATH_MAX, "%s.config", FILE_STORAGE_SQLITE);
+    FILE *config_file = fopen(config_file_name, "w");
+    if (config_file == NULL)
+    {
+        return CS_ERROR;
+    }
+    fprintf(config_file, "storage_backend = %d\nspool_writes = 0\nalert_window_sec = %d\nalert_device_rate = %d\n",
+            STORAGE_SQLITE, CONFIG_DEFAULT_ALERT_WINDOW, CONFIG_DEFAULT_ALERT_DEVICE_RATE);
+    fclose(config_file);
+
+    const char *suffixes[] = {"", "-wal", "-shm"};
+    for (size_t s = 0; s < sizeof(suffixes) / sizeof(suffixes[0]); s++)
+    {
+        char file_name[PATH_MAX];
+        snprintf(file_name, PATH_MAX, "%s%s", FILE_STORAGE_SQLITE, suffixes[s]);
+        unlink(file_name);
+    }
+
+    int return_value = csl_ConfigLoad(config_file_name);
+    if (return_value == CS_SUCCESS)
+    {
+        return_value = csl_StorageOpen(STORAGE_SQLITE);
+    }
+    if (return_value == CS_SUCCESS)
+    {
+        return_value = monitorTablesInitialize();
+    }
+    for (unsigned int device = 1; return_value == CS_SUCCESS && device <= TEST_ALERTS_DEVICES; device++)
+    {
+        char statement[SIZE_CS_SQL_COMMAND];
+        snprintf(statement, SIZE_CS_SQL_COMMAND, "Insert into %s.%s (monitor_id, device_id, device_identifier) "
+                 "values (%llu, %u, '" TEST_ALERTS_DEVICE_FORMAT "')", CS_SQL_MONITOR_SCHEMA,
+                 CS_SQL_MONITOR_DEVICE_VIEW, (unsigned long long) DEFAULT_MONITOR_ID, device, device);
+        return_value = csl_StorageUpdate(statement);
+    }
+    if (return_value == CS_SUCCESS)
+    {
+        return_value = monitorConfigUpdate();
+    }
+    return return_value;
+}
+
+int main()
+{
+    if (test_alerts_setup() != CS_SUCCESS)
+    {
+        printf("Could not start the monitor on [%s]\n", FILE_STORAGE_SQLITE);
+        return EXIT_FAILURE;
+    }
+
+    /********************************************
+     * The cap - every alert type from every directory, on one device
+     ********************************************/
+    unsigned int submitted_ctr  = 0;
+    unsigned int most_buckets   = 0;
+    for (unsigned int directory = 0; directory < TEST_ALERTS_DIRECTORIES; directory++)
+    {
+        for (int t = 0; t < ALERT_SCAN_TYPES; t++)
+        {
+            test_alert_raise(0, G_test_alert_types[t], directory, 0);
+            submitted_ctr++;
+        }
+        device_shard *shard = deviceShardLock(0);
+        if (shard->alerts.bucket_ctr > most_buckets)
+        {
+            most_buckets = shard->alerts.bucket_ctr;
+        }
+        deviceShardUnlock(shard);
+    }
+    CSL_TEST_CHECK(most_buckets == ALERT_MAX_BUCKETS, "the device held up to [%u] buckets, expected [%d]",
+                   most_buckets, ALERT_MAX_BUCKETS);
+
+    device_shard *shard = deviceShardLock(0);
+    unsigned int other_types = 0;
+    for (unsigned int b = 0; b < shard->alerts.bucket_ctr; b++)
+    {
+        alert_bucket *bucket = &shard->alerts.buckets[b];
+        bool other = strcmp(bucket->directory, ALERT_OTHER_DIRECTORY) == 0;
+        CSL_TEST_CHECK(other == (b >= ALERT_MAX_BUCKETS - ALERT_SCAN_TYPES),
+                       "bucket [%u] is for directory [%s]", b, bucket->directory);
+        if (other)
+        {
+            other_types |= (unsigned int) bucket->alert_type;
+        }
+    }
+    CSL_TEST_CHECK(other_types == (ALERT_ADD_ELEMENT | ALERT_MOD_CONTENTS | ALERT_DEL_ELEMENT | ALERT_MOD_ATTRIBS),
+                   "the %s buckets are for alert types [%#x], expected one of each", ALERT_OTHER_DIRECTORY,
+                   other_types);
+    alertAggregateFlush(0, true);
+    CSL_TEST_CHECK(shard->alerts.bucket_ctr == 0, "[%u] buckets were left after the flush", shard->alerts.bucket_ctr);
+    unsigned long long device_id = shard->device.device_id;
+    deviceShardUnlock(shard);
+
+    test_alert_log log = test_alert_log_read(device_id);
+    CSL_TEST_CHECK(log.alert_ctr == submitted_ctr, "the alert log accounts for [%llu] alerts, expected [%u]",
+                   log.alert_ctr, submitted_ctr);
+    // alert_device_rate alerts written as they happened, and a summary per bucket (one of a single alert is plain)
+    CSL_TEST_CHECK(log.row_ctr <= CONFIG_DEFAULT_ALERT_DEVICE_RATE + ALERT_MAX_BUCKETS,
+                   "[%u] rows were written, at most [%d] expected", log.row_ctr,
+                   CONFIG_DEFAULT_ALERT_DEVICE_RATE + ALERT_MAX_BUCKETS);
+
+    /********************************************
+     * Reload, then shut down - each must write what every device holds
+     ********************************************/
+    test_alerts_hold();
+    test_alert_log before = test_alert_log_read(0);
+    CSL_TEST_CHECK(monitorConfigUpdate() == CS_SUCCESS, "the reload failed");
+    test_alerts_flushed("the reload", before);
+
+    test_alerts_hold();
+    before = test_alert_log_read(0);
+    monitorShutDown();
+    CSL_TEST_CHECK(csl_StorageOpen(STORAGE_SQLITE) == CS_SUCCESS, "could not reopen [%s]", FILE_STORAGE_SQLITE);
+    test_alerts_flushed("the shut down", before);
+    csl_StorageClose();
+
+    CSL_TEST_EXIT();
+}
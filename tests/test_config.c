@@ -0,0 +1,276 @@
+//
+// Created by kerry on 10/19/26.
+//
+
+/************************************************
+ * test_config
+ * ===========
+ * csl_ConfigLoad(), against a table of every key with the range and default it must have:
+ *      * With no config file, every key has its default
+ *      * Each key takes its min and its max
+ *      * Each key refuses (CS_ERROR, the value left as it was) below its min, above its max, a negative, an empty,
+ *        a non-numeric and a part-numeric value - so spool_fsync_msec = 0 or scan_receivers = 0 cannot reach
+ *        the monitor
+ * followed by the file format's own cases - comments, unknown keys, lines with no '=', a bad line among good ones,
+ * and initial_elements cut down to max_elements.
+ ************************************************/
+
+#include <stddef.h>
+#include <unistd.h>
+
+#include "csl_config.h"
+#include "csl_test.h"
+
+#ifndef TEST_CONFIG_FILE                        // CMake puts it in the build directory
+#define TEST_CONFIG_FILE            "test_config.config"
+#endif
+#define TEST_CONFIG_MISSING_FILE    TEST_CONFIG_FILE ".missing"
+#define TEST_CONFIG_TEXT_SIZE       (2 * CONFIG_LINE_SIZE)
+
+/************************************************
+ * Config Keys
+ * ===========
+ * What each key must take, written out here rather than read from csl_config.c, so a range changed there by
+ * mistake is caught
+ ************************************************/
+typedef struct
+{
+    const char          *key;
+    size_t              offset;         // of its field in csl_monitor_config
+    unsigned long long  min_value;
+    unsigned long long  max_value;
+    unsigned long long  default_value;
+    const char          *with;          // A line the key's values are loaded after, or NULL
+} test_config_key;
+
+#define TEST_CONFIG_KEY(field, min_value, max_value, default_value, with) \
+    {#field, offsetof(csl_monitor_config, field), min_value, max_value, default_value, with}
+
+static const test_config_key G_test_config_keys[] =
+        {
+                TEST_CONFIG_KEY(max_devices,                1,  9999,           1000,       NULL),
+                // With max_elements as high, so that initial_elements is not cut down to it //
+                TEST_CONFIG_KEY(initial_elements,           1,  UINT32_MAX,     1024,   "max_elements = 4294967295"),
+                TEST_CONFIG_KEY(max_elements,               1,  UINT32_MAX,     1000000,    NULL),
+                TEST_CONFIG_KEY(max_memory_mb,              0,  UINT32_MAX,     0,          NULL),
+                TEST_CONFIG_KEY(scan_receivers,             1,  10,             1,          NULL),
+                TEST_CONFIG_KEY(io_threads,                 0,  64,             0,          NULL),
+                TEST_CONFIG_KEY(rcvhwm,                     0,  INT32_MAX,      10000,      NULL),
+                TEST_CONFIG_KEY(sndhwm,                     0,  INT32_MAX,      1000,       NULL),
+                TEST_CONFIG_KEY(rcvbuf,                     0,  INT32_MAX,      0,          NULL),
+                TEST_CONFIG_KEY(tcp_keepalive_idle,         0,  INT32_MAX,      0,          NULL),
+                TEST_CONFIG_KEY(poll_msec,                  1,  1000,           1,          NULL),
+                TEST_CONFIG_KEY(max_concurrent_scans,       1,  9999,           4,          NULL),
+                TEST_CONFIG_KEY(scan_queue_high,            0,  UINT32_MAX,     5000,       NULL),
+                TEST_CONFIG_KEY(scan_grant_timeout_sec,     1,  UINT32_MAX,     300,        NULL),
+                TEST_CONFIG_KEY(scan_interval_sec,          1,  INT32_MAX,      60,         NULL),
+                TEST_CONFIG_KEY(scan_jitter_pct,            0,  100,            10,         NULL),
+                TEST_CONFIG_KEY(scan_startup_spread_sec,    0,  INT32_MAX,      60,         NULL),
+                TEST_CONFIG_KEY(scan_starts_per_minute,     0,  UINT32_MAX,     0,          NULL),
+                TEST_CONFIG_KEY(scan_batch_max,             1,  UINT32_MAX,     256,        NULL),
+                TEST_CONFIG_KEY(scan_session_timeout_sec,   1,  INT32_MAX / 1000, 60,       NULL),
+                TEST_CONFIG_KEY(scan_resume_window_sec,     0,  INT32_MAX / 1000, 300,      NULL),
+                TEST_CONFIG_KEY(metrics_port,               0,  65535,          0,          NULL),
+                TEST_CONFIG_KEY(metrics_publish_sec,        1,  INT32_MAX / 1000, 10,       NULL),
+                TEST_CONFIG_KEY(capture_frames,             0,  1,              0,          NULL),
+                TEST_CONFIG_KEY(storage_backend,            0,  1,              0,          NULL),
+                TEST_CONFIG_KEY(db_pool_size,               1,  64,             4,          NULL),
+                TEST_CONFIG_KEY(db_timeout_sec,             1,  3600,           10,         NULL),
+                TEST_CONFIG_KEY(spool_writes,               0,  1,              1,          NULL),
+                TEST_CONFIG_KEY(spool_fsync_msec,           1,  1000,           20,         NULL),
+                TEST_CONFIG_KEY(alert_window_sec,           0,  86400,          300,        NULL),
+                TEST_CONFIG_KEY(alert_device_rate,          0,  UINT32_MAX,     50,         NULL),
+                TEST_CONFIG_KEY(alert_publish,              0,  1,              1,          NULL),
+                TEST_CONFIG_KEY(ordered_scans,              0,  1,              1,          NULL),
+        };
+
+#define TEST_CONFIG_KEY_CTR         (sizeof(G_test_config_keys) / sizeof(G_test_config_keys[0]))
+
+/************************************************
+ * The File Format
+ * ===============
+ * Whole config files, and the one key each must leave at what value
+ ************************************************/
+typedef struct
+{
+    const char      *what;
+    const char      *text;
+    int             expected_return;
+    const char      *key;
+    unsigned int    expected_value;
+} test_config_file;
+
+static const test_config_file G_test_config_files[] =
+        {
+                {"comments and blank lines", "# spool_fsync_msec = 7\n\n   \nspool_fsync_msec = 5\n",
+                        CS_SUCCESS, "spool_fsync_msec", 5},
+                {"white space", "\t scan_receivers\t=  3 \r\n", CS_SUCCESS, "scan_receivers", 3},
+                {"an unknown key", "no_such_key = 9\nscan_receivers = 4\n", CS_SUCCESS, "scan_receivers", 4},
+                {"a line with no '='", "scan_receivers 6\n", CS_SUCCESS, "scan_receivers", 4},
+                {"the last of a repeated key", "poll_msec = 7\npoll_msec = 8\n", CS_SUCCESS, "poll_msec", 8},
+                {"a bad line among good ones", "scan_receivers = 2\nspool_fsync_msec = 0\npoll_msec = 9\n",
+                        CS_ERROR, "poll_msec", 9},
+                {"initial_elements cut down", "max_elements = 100\ninitial_elements = 5000\n",
+                        CS_SUCCESS, "initial_elements", 100},
+                {"initial_elements cut down by a later max", "initial_elements = 50\nmax_elements = 20\n",
+                        CS_SUCCESS, "initial_elements", 20},
+        };
+
+/************************************************
+ * unsigned int test_config_value()
+ *  @param  const test_config_key *key
+ *
+ *  @brief  The key's value in the monitor's config
+ *
+ *  @author Kerry
+ ************************************************/
+static unsigned int test_config_value(const test_config_key *key)
+{
+    return *(const unsigned int *) ((const char *) csl_Config() + key->offset);
+}
+
+/************************************************
+ * const test_config_key *test_config_find()
+ *  @param  const char *key
+ *
+ *  @author Kerry
+ *
+ *  @return The key's entry, NULL if the table has none
+ ************************************************/
+static const test_config_key *test_config_find(const char *key)
+{
+    for (size_t k = 0; k < TEST_CONFIG_KEY_CTR; k++)
+    {
+        if (strcmp(G_test_config_keys[k].key, key) == 0)
+        {
+            return &G_test_config_keys[k];
+        }
+    }
+    return NULL;
+}
+
+/************************************************
+ * int test_config_load()
+ *  @param  const char *text    - The whole config file
+ *
+ *  @brief  Writes the config file, and loads it
+ *
+ *  @author Kerry
+ *
+ *  @return csl_ConfigLoad()'s result, or CS_FATAL_ERROR if the file could not be written
+ ************************************************/
+static int test_config_load(const char *text)
+{
+    FILE *config_file = fopen(TEST_CONFIG_FILE, "w");
+    if (config_file == NULL)
+    {
+        printf("Could not write [%s]\n", TEST_CONFIG_FILE);
+        return CS_FATAL_ERROR;
+    }
+    fputs(text, config_file);
+    fclose(config_file);
+    return csl_ConfigLoad(TEST_CONFIG_FILE);
+}
+
+/************************************************
+ * void test_config_accept()
+ *  @param
+ *          const test_config_key   *key
+ *          unsigned long long      value
+ *
+ *  @brief  Checks the key takes the value
+ *
+ *  @author Kerry
+ ************************************************/
+static void test_config_accept(const test_config_key *key, unsigned long long value)
+{
+    char text[TEST_CONFIG_TEXT_SIZE];
+    snprintf(text, TEST_CONFIG_TEXT_SIZE, "%s\n%s = %llu\n", key->with != NULL ? key->with : "", key->key, value);
+    int return_value = test_config_load(text);
+    CSL_TEST_CHECK(return_value == CS_SUCCESS && test_config_value(key) == value,
+                   "%s = %llu returned [%d] and set [%u]", key->key, value, return_value, test_config_value(key));
+}
+
+/************************************************
+ * void test_config_reject()
+ *  @param
+ *          const test_config_key   *key
+ *          const char              *value
+ *
+ *  @brief  Checks the key refuses the value, and keeps the one it had
+ *
+ *  @author Kerry
+ ************************************************/
+static void test_config_reject(const test_config_key *key, const char *value)
+{
+    char text[TEST_CONFIG_TEXT_SIZE];
+    snprintf(text, TEST_CONFIG_TEXT_SIZE, "%s = %s\n", key->key, value);
+    unsigned int    before          = test_config_value(key);
+    int             return_value    = test_config_load(text);
+    CSL_TEST_CHECK(return_value == CS_ERROR && test_config_value(key) == before,
+                   "%s = [%s] returned [%d] and set [%u], expected [%d] and [%u]", key->key, value, return_value,
+                   test_config_value(key), CS_ERROR, before);
+}
+
+int main()
+{
+    /********************************************
+     * The defaults - before any file, and with the file missing
+     ********************************************/
+    CSL_TEST_CHECK(TEST_CONFIG_KEY_CTR * sizeof(unsigned int) == sizeof(csl_monitor_config),
+                   "the table has [%zu] keys, csl_monitor_config [%zu]", TEST_CONFIG_KEY_CTR,
+                   sizeof(csl_monitor_config) / sizeof(unsigned int));
+    unlink(TEST_CONFIG_MISSING_FILE);
+    CSL_TEST_CHECK(csl_ConfigLoad(TEST_CONFIG_MISSING_FILE) == CS_SUCCESS, "a missing config file is an error");
+    for (size_t k = 0; k < TEST_CONFIG_KEY_CTR; k++)
+    {
+        const test_config_key *key = &G_test_config_keys[k];
+        CSL_TEST_CHECK(test_config_value(key) == key->default_value, "%s defaults to [%u], expected [%llu]",
+                       key->key, test_config_value(key), key->default_value);
+    }
+
+    /********************************************
+     * The ranges - each key from its own value, so a rejected value is seen to change nothing
+     ********************************************/
+    for (size_t k = 0; k < TEST_CONFIG_KEY_CTR; k++)
+    {
+        const test_config_key   *key = &G_test_config_keys[k];
+        char                    value[TEST_CONFIG_TEXT_SIZE];
+
+        test_config_accept(key, key->min_value);
+        test_config_accept(key, key->max_value);
+        test_config_accept(key, key->default_value);
+
+        if (key->min_value > 0)
+        {
+            snprintf(value, TEST_CONFIG_TEXT_SIZE, "%llu", key->min_value - 1);
+            test_config_reject(key, value);
+        }
+        snprintf(value, TEST_CONFIG_TEXT_SIZE, "%llu", key->max_value + 1);
+        test_config_reject(key, value);
+        test_config_reject(key, "18446744073709551616");        // past what strtoull() can hold
+        test_config_reject(key, "-1");
+        test_config_reject(key, "");
+        test_config_reject(key, "ten");
+        test_config_reject(key, "10 seconds");
+        test_config_reject(key, "0x10");
+    }
+
+    /********************************************
+     * The file format
+     ********************************************/
+    for (size_t f = 0; f < sizeof(G_test_config_files) / sizeof(G_test_config_files[0]); f++)
+    {
+        const test_config_file  *file           = &G_test_config_files[f];
+        const test_config_key   *key            = test_config_find(file->key);
+        int                     return_value    = test_config_load(file->text);
+        CSL_TEST_CHECK(key != NULL && return_value == file->expected_return &&
+                       test_config_value(key) == file->expected_value,
+                       "%s returned [%d] and set %s to [%u], expected [%d] and [%u]", file->what, return_value,
+                       file->key, key != NULL ? test_config_value(key) : 0, file->expected_return,
+                       file->expected_value);
+    }
+
+    unlink(TEST_CONFIG_FILE);
+    CSL_TEST_EXIT();
+}
@@ -0,0 +1,144 @@
+//
+// Created by kerry on 10/19/26.
+//
+
+/************************************************
+ * test_diff
+ * =========
+ * Every diff kernel this CPU has must give exactly what the scalar kernel gives, for every row count of a block
+ * (0 to DIFF_BLOCK_ROWS) and whatever is in the rows past row_ctr.
+ * The scan values come out of a random buffer from an unaligned start, as a search copies them out of its scan
+ * records, and a changed value differs in one byte anywhere in it - so a kernel that skips part of a row, or
+ * a row at the end of a block, is caught. Each block is also checked against memcmp(), so the scalar kernel is not
+ * simply compared with itself.
+ ************************************************/
+
+#include <string.h>
+
+#include "csl_diff.h"
+#include "csl_test.h"
+
+#define TEST_DIFF_BLOCKS            500             // Random blocks per row count
+#define TEST_DIFF_SOURCE_SIZE       (DIFF_BLOCK_ROWS * SIZE_HASH_ELEMENT + DIFF_ALIGNMENT)
+
+static const char *G_test_kernels[] = {DIFF_KERNEL_SCALAR, DIFF_KERNEL_SSE42, DIFF_KERNEL_AVX2};
+
+/************************************************
+ * void test_diff_fill()
+ *  @param
+ *          csl_diff_block  *block
+ *          unsigned int    row_ctr
+ *
+ *  @brief  Fills every row of a block - about a third of the rows below row_ctr changed, the rest the same, and the
+ *          rows past row_ctr random
+ *
+ *  @author Kerry
+ ************************************************/
+static void test_diff_fill(csl_diff_block *block, unsigned int row_ctr)
+{
+    byte source[TEST_DIFF_SOURCE_SIZE];
+    for (size_t b = 0; b < TEST_DIFF_SOURCE_SIZE; b++)
+    {
+        source[b] = (byte) rand();
+    }
+    const byte *start = source + 1 + rand() % (DIFF_ALIGNMENT - 1);    // never aligned
+
+    for (unsigned int r = 0; r < DIFF_BLOCK_ROWS; r++)
+    {
+        memcpy(block->status_quo_values[r], start + r * SIZE_HASH_ELEMENT, SIZE_HASH_ELEMENT);
+        memcpy(block->scan_values[r], block->status_quo_values[r], SIZE_HASH_ELEMENT);
+        block->status_quo_attributes[r] = (unsigned short) rand();
+        block->scan_attributes[r]       = block->status_quo_attributes[r];
+
+        if (r >= row_ctr)
+        {
+            block->scan_values[r][rand() % SIZE_HASH_ELEMENT] ^= (byte) (1 + rand() % 255);
+            block->scan_attributes[r]   = (unsigned short) rand();
+            continue;
+        }
+        if (rand() % 3 == 0)
+        {
+            block->scan_values[r][rand() % SIZE_HASH_ELEMENT] ^= (byte) (1 + rand() % 255);
+        }
+        if (rand() % 3 == 0)
+        {
+            block->scan_attributes[r] ^= (unsigned short) (1 << rand() % 16);
+        }
+    }
+    block->row_ctr = row_ctr;
+}
+
+/************************************************
+ * void test_diff_expected()
+ *  @param
+ *          const csl_diff_block    *block
+ *          uint64_t                *contents_changed
+ *          uint64_t                *attributes_changed
+ *
+ *  @brief  What csl_DiffBlock() must report, worked out a row at a time with memcmp()
+ *
+ *  @author Kerry
+ ************************************************/
+static void test_diff_expected(const csl_diff_block *block, uint64_t *contents_changed, uint64_t *attributes_changed)
+{
+    *contents_changed   = 0;
+    *attributes_changed = 0;
+    for (unsigned int r = 0; r < block->row_ctr && r < DIFF_BLOCK_ROWS; r++)
+    {
+        if (memcmp(block->status_quo_values[r], block->scan_values[r], SIZE_HASH_ELEMENT) != 0)
+        {
+            *contents_changed |= 1ULL << r;
+        }
+        if (block->status_quo_attributes[r] != block->scan_attributes[r])
+        {
+            *attributes_changed |= 1ULL << r;
+        }
+    }
+}
+
+int main()
+{
+    static csl_diff_block block;
+    srand(TEST_SEED);
+
+    for (unsigned int row_ctr = 0; row_ctr <= DIFF_BLOCK_ROWS; row_ctr++)
+    {
+        for (unsigned int n = 0; n < TEST_DIFF_BLOCKS; n++)
+        {
+            test_diff_fill(&block, row_ctr);
+
+            uint64_t expected_contents, expected_attributes;
+            test_diff_expected(&block, &expected_contents, &expected_attributes);
+
+            uint64_t scalar_contents, scalar_attributes;
+            csl_DiffSelect(DIFF_KERNEL_SCALAR);
+            csl_DiffBlock(&block, &scalar_contents, &scalar_attributes);
+            CSL_TEST_CHECK(scalar_contents == expected_contents && scalar_attributes == expected_attributes,
+                           "scalar, row_ctr [%u] block [%u]: contents [%016llx] attributes [%016llx] "
+                           "expected [%016llx] [%016llx]", row_ctr, n,
+                           (unsigned long long) scalar_contents, (unsigned long long) scalar_attributes,
+                           (unsigned long long) expected_contents, (unsigned long long) expected_attributes);
+
+            for (size_t k = 1; k < sizeof(G_test_kernels) / sizeof(G_test_kernels[0]); k++)
+            {
+                if (csl_DiffSelect(G_test_kernels[k]) == false)
+                {
+                    continue;                           // not on this CPU
+                }
+                uint64_t contents, attributes;
+                csl_DiffBlock(&block, &contents, &attributes);
+                CSL_TEST_CHECK(contents == scalar_contents && attributes == scalar_attributes,
+                               "%s, row_ctr [%u] block [%u]: contents [%016llx] attributes [%016llx] "
+                               "scalar [%016llx] [%016llx]", G_test_kernels[k], row_ctr, n,
+                               (unsigned long long) contents, (unsigned long long) attributes,
+                               (unsigned long long) scalar_contents, (unsigned long long) scalar_attributes);
+            }
+        }
+    }
+
+    for (size_t k = 0; k < sizeof(G_test_kernels) / sizeof(G_test_kernels[0]); k++)
+    {
+        printf("%-8s %s\n", G_test_kernels[k], csl_DiffSelect(G_test_kernels[k]) ? "tested" : "not on this CPU");
+    }
+    CSL_TEST_EXIT();
+}
@@ -0,0 +1,432 @@
+//
+// Created by kerry on 10/19/26.
+//
+
+/************************************************
+ * test_merge
+ * ==========
+ * statusQuoTableMerge() must find exactly what statusQuoTableSearch() finds. Each case registers two devices with
+ * the same status quo, sends both the same scans - to the search device in an arbitrary order, to the merge device
+ * in element_name_hash order, as an ordered scan probe would - and after every scan requires both status quo
+ * columns, and both alert counts, to match what the scan should have done:
+ *      * the changed set   - the rows whose contents or attributes changed (MASK_MOD_CONTENTS, MASK_MOD_ATTRIBS)
+ *      * the added set     - the rows added (MASK_ADD_ELEMENT)
+ *      * the missing set   - the rows no longer in the status quo
+ * Built from the monitor's own sources, without main.c's main() (see CSL_NO_MAIN), and with no database: the
+ * alerts are counted, and their writes fail without changing what is compared.
+ ************************************************/
+
+#include "CryticaMonitor.h"
+#include "csl_test.h"
+
+#define TEST_MERGE_FILES            300             // Several diff blocks' worth
+#define TEST_MERGE_RANDOM_ROUNDS    8
+#define TEST_MERGE_NAME_FORMAT      "/opt/test/file%07u"
+#define TEST_MERGE_DEVICE_FORMAT    "02:cf:be:00:%02x:%02x"
+#define TEST_MERGE_ATTRIBUTES       0100755
+
+/************************************************
+ * The Test Elements
+ * =================
+ * Element r is the r'th of TEST_MERGE_FILES names in element_name_hash order, so an ordered scan is one in
+ * ascending r. A scan element is an element with the version of its contents and its attributes; its scan value
+ * is its name hash with the version in its last bytes, so a change is at the end of the value.
+ ************************************************/
+typedef struct
+{
+    unsigned int    element;
+    unsigned int    version;
+    unsigned short  attributes;
+} test_scan_element;
+
+typedef struct
+{
+    bool            present;
+    unsigned int    version;
+    unsigned short  attributes;
+    unsigned char   alert_code;
+} test_expected_row;
+
+typedef struct
+{
+    const char          *name;
+    short               search_index;
+    short               merge_index;
+    test_expected_row   expected[TEST_MERGE_FILES];
+    int                 expected_alerts;
+} test_merge_case;
+
+static char G_test_names[TEST_MERGE_FILES][SIZE_ELEMENT_NAME];
+static char G_test_hashes[TEST_MERGE_FILES][SIZE_HASH_NAME + 1];
+static unsigned int G_test_device_ctr;
+
+static int test_name_compare(const void *name_one, const void *name_two)
+{
+    char hash_one[SIZE_HASH_NAME + 1];
+    char hash_two[SIZE_HASH_NAME + 1];
+    MD5CharModule((char *) name_one, hash_one);
+    MD5CharModule((char *) name_two, hash_two);
+    return memcmp(hash_one, hash_two, SIZE_HASH_NAME);
+}
+
+/************************************************
+ * void test_elements_create()
+ *  @param  - None
+ *
+ *  @brief  Names the test elements, in element_name_hash order
+ *
+ *  @author Kerry
+ ************************************************/
+static void test_elements_create()
+{
+    for (unsigned int r = 0; r < TEST_MERGE_FILES; r++)
+    {
+        snprintf(G_test_names[r], SIZE_ELEMENT_NAME, TEST_MERGE_NAME_FORMAT, r);
+    }
+    qsort(G_test_names, TEST_MERGE_FILES, SIZE_ELEMENT_NAME, test_name_compare);
+    for (unsigned int r = 0; r < TEST_MERGE_FILES; r++)
+    {
+        MD5CharModule(G_test_names[r], G_test_hashes[r]);
+    }
+}
+
+/************************************************
+ * void test_scan_send()
+ *  @param
+ *          short                   device_index
+ *          const test_scan_element *scan
+ *          unsigned int            scan_ctr
+ *          bool                    ordered         - Send it in element order, rather than backwards
+ *
+ *  @brief  Loads the device's scan table through a scan session, as the message thread does
+ *
+ *  @author Kerry
+ ************************************************/
+static void test_scan_send(short device_index, const test_scan_element *scan, unsigned int scan_ctr, bool ordered)
+{
+    csl_scan_record record;
+    memset(&record, NULL_BINARY, sizeof(csl_scan_record));
+    record.element_type = ELEMENT_EXEC_FILE;
+    record.scan_date    = time(NULL);
+
+    scanSessionStart(device_index, 0);
+    for (unsigned int n = 0; n < scan_ctr; n++)
+    {
+        const test_scan_element *element = &scan[ordered ? n : scan_ctr - 1 - n];
+        snprintf(record.element_name, SIZE_ELEMENT_NAME, "%s", G_test_names[element->element]);
+        memcpy(record.element_name_hash, G_test_hashes[element->element], SIZE_HASH_NAME);
+        memcpy(record.scan_value, G_test_hashes[element->element], SIZE_HASH_ELEMENT);
+        memcpy(record.scan_value + SIZE_HASH_ELEMENT - sizeof(element->version), &element->version,
+               sizeof(element->version));
+        record.element_attributes = element->attributes;
+        scanTableAddRow(&record, device_index);
+    }
+}
+
+/************************************************
+ * void test_rows_check()
+ *  @param
+ *          test_merge_case *test_case
+ *          short           device_index
+ *          const char      *what           - "search" or "merge"
+ *          unsigned int    round
+ *
+ *  @brief  Checks the device's status quo column holds the expected rows, and only those
+ *
+ *  @author Kerry
+ ************************************************/
+static void test_rows_check(test_merge_case *test_case, short device_index, const char *what, unsigned int round)
+{
+    bool seen[TEST_MERGE_FILES] = {false};
+
+    device_shard *shard = deviceShardLock(device_index);
+    for (unsigned int sq_index = 0; sq_index < shard->device.status_element_ctr; sq_index++)
+    {
+        status_quo_record *row = &shard->status_quo[sq_index];
+        unsigned int r = 0;
+        while (r < TEST_MERGE_FILES && memcmp(row->element_identifier, G_test_hashes[r], SIZE_HASH_NAME) != 0)
+        {
+            r++;
+        }
+        CSL_TEST_CHECK(r < TEST_MERGE_FILES && seen[r] == false && test_case->expected[r].present,
+                       "%s, %s round [%u]: row [%u] is not expected, or is there twice", test_case->name, what,
+                       round, sq_index);
+        if (r == TEST_MERGE_FILES || seen[r])
+        {
+            continue;
+        }
+        seen[r] = true;
+
+        unsigned int version;
+        memcpy(&version, row->scan_value + SIZE_HASH_ELEMENT - sizeof(version), sizeof(version));
+        CSL_TEST_CHECK(version == test_case->expected[r].version &&
+                       row->element_attributes == test_case->expected[r].attributes &&
+                       row->alert_code == test_case->expected[r].alert_code,
+                       "%s, %s round [%u]: element [%u] has version [%u] attributes [%o] alert_code [%#x], "
+                       "expected [%u] [%o] [%#x]", test_case->name, what, round, r, version,
+                       row->element_attributes, row->alert_code, test_case->expected[r].version,
+                       test_case->expected[r].attributes, test_case->expected[r].alert_code);
+    }
+    deviceShardUnlock(shard);
+
+    for (unsigned int r = 0; r < TEST_MERGE_FILES; r++)
+    {
+        CSL_TEST_CHECK(seen[r] || test_case->expected[r].present == false,
+                       "%s, %s round [%u]: element [%u] is missing", test_case->name, what, round, r);
+    }
+}
+
+/************************************************
+ * void test_case_start()
+ *  @param
+ *          test_merge_case         *test_case
+ *          const char              *name
+ *          const test_scan_element *status_quo
+ *          unsigned int            status_quo_ctr
+ *
+ *  @brief  Registers the case's two devices, and builds the same status quo for both
+ *
+ *  @author Kerry
+ *
+ *  @note   The merge device's status quo is built from an unordered scan, so its first merge sorts it
+ ************************************************/
+static void test_case_start(test_merge_case *test_case, const char *name, const test_scan_element *status_quo,
+                            unsigned int status_quo_ctr)
+{
+    memset(test_case, NULL_BINARY, sizeof(test_merge_case));
+    test_case->name = name;
+
+    short *device_indexes[] = {&test_case->search_index, &test_case->merge_index};
+    for (int d = 0; d < 2; d++)
+    {
+        byte device_identifier[SIZE_DEVICE_IDENTIFIER] = {0};
+        G_test_device_ctr++;
+        snprintf((char *) device_identifier, SIZE_DEVICE_IDENTIFIER, TEST_MERGE_DEVICE_FORMAT,
+                 G_test_device_ctr / 256, G_test_device_ctr % 256);
+        *device_indexes[d] = deviceRegisterNew(device_identifier, G_test_device_ctr, device_identifier);
+
+        test_scan_send(*device_indexes[d], status_quo, status_quo_ctr, false);
+        device_shard *shard = deviceShardLock(*device_indexes[d]);
+        CSL_TEST_CHECK(statusQuoTableBuild((unsigned short) *device_indexes[d]),
+                       "%s: could not build the status quo", name);
+        scanTableReset(shard->scan_table, -1);
+        deviceShardUnlock(shard);
+    }
+
+    for (unsigned int n = 0; n < status_quo_ctr; n++)
+    {
+        test_expected_row *expected = &test_case->expected[status_quo[n].element];
+        expected->present       = true;
+        expected->version       = status_quo[n].version;
+        expected->attributes    = status_quo[n].attributes;
+    }
+    test_rows_check(test_case, test_case->search_index, "search", 0);
+    test_rows_check(test_case, test_case->merge_index, "merge", 0);
+}
+
+/************************************************
+ * void test_case_expect()
+ *  @param
+ *          test_merge_case         *test_case
+ *          const test_scan_element *scan           - In element order
+ *          unsigned int            scan_ctr
+ *
+ *  @brief  Works out what the scan should do to the status quo, and how many alerts it should raise
+ *
+ *  @author Kerry
+ ************************************************/
+static void test_case_expect(test_merge_case *test_case, const test_scan_element *scan, unsigned int scan_ctr)
+{
+    bool scanned[TEST_MERGE_FILES] = {false};
+    test_case->expected_alerts = 0;
+
+    for (unsigned int n = 0; n < scan_ctr; n++)
+    {
+        test_expected_row *expected = &test_case->expected[scan[n].element];
+        scanned[scan[n].element] = true;
+        if (expected->present == false)
+        {
+            expected->present       = true;
+            expected->alert_code    = MASK_ADD_ELEMENT;
+            test_case->expected_alerts++;
+        }
+        else
+        {
+            if (expected->version != scan[n].version)
+            {
+                expected->alert_code |= MASK_MOD_CONTENTS;
+                test_case->expected_alerts++;
+            }
+            if (expected->attributes != scan[n].attributes)
+            {
+                expected->alert_code |= MASK_MOD_ATTRIBS;
+                test_case->expected_alerts++;
+            }
+        }
+        expected->version       = scan[n].version;
+        expected->attributes    = scan[n].attributes;
+    }
+
+    for (unsigned int r = 0; r < TEST_MERGE_FILES; r++)
+    {
+        if (test_case->expected[r].present && scanned[r] == false)
+        {
+            memset(&test_case->expected[r], NULL_BINARY, sizeof(test_expected_row));
+            test_case->expected_alerts++;
+        }
+    }
+}
+
+/************************************************
+ * void test_case_scan()
+ *  @param
+ *          test_merge_case         *test_case
+ *          unsigned int            round
+ *          const test_scan_element *scan       - In element order, with no element twice
+ *          unsigned int            scan_ctr
+ *
+ *  @brief  Sends the scan to both devices, searches the one and merges the other, and checks both - and that the
+ *          merge kept its status quo in order
+ *
+ *  @author Kerry
+ ************************************************/
+static void test_case_scan(test_merge_case *test_case, unsigned int round, const test_scan_element *scan,
+                           unsigned int scan_ctr)
+{
+    test_case_expect(test_case, scan, scan_ctr);
+
+    test_scan_send(test_case->search_index, scan, scan_ctr, false);
+    device_shard *shard = deviceShardLock(test_case->search_index);
+    int search_alerts   = statusQuoTableSearch(test_case->search_index);
+    deviceShardUnlock(shard);
+
+    test_scan_send(test_case->merge_index, scan, scan_ctr, true);
+    shard               = deviceShardLock(test_case->merge_index);
+    CSL_TEST_CHECK(shard->scan_table->ordered, "%s round [%u]: an ordered scan was not seen as ordered",
+                   test_case->name, round);
+    int merge_alerts    = statusQuoTableMerge(test_case->merge_index);
+    bool in_order       = shard->status_quo_ordered;
+    for (unsigned int sq_index = 1; in_order && sq_index < shard->device.status_element_ctr; sq_index++)
+    {
+        in_order = statusQuoRowCompare(&shard->status_quo[sq_index - 1], &shard->status_quo[sq_index]) < 0;
+    }
+    deviceShardUnlock(shard);
+    CSL_TEST_CHECK(in_order, "%s round [%u]: the merge left the status quo out of order", test_case->name, round);
+
+    CSL_TEST_CHECK(search_alerts == test_case->expected_alerts && merge_alerts == test_case->expected_alerts,
+                   "%s round [%u]: search raised [%d] alerts and merge [%d], expected [%d]", test_case->name,
+                   round, search_alerts, merge_alerts, test_case->expected_alerts);
+    test_rows_check(test_case, test_case->search_index, "search", round);
+    test_rows_check(test_case, test_case->merge_index, "merge", round);
+}
+
+/************************************************
+ * unsigned int test_scan_random()
+ *  @param
+ *          const test_merge_case   *test_case
+ *          test_scan_element       *scan           - Room for TEST_MERGE_FILES elements
+ *
+ *  @brief  A scan of about three quarters of the elements - some added, some changed, the rest missing
+ *
+ *  @author Kerry
+ *
+ *  @return The elements in the scan
+ ************************************************/
+static unsigned int test_scan_random(const test_merge_case *test_case, test_scan_element *scan)
+{
+    unsigned int scan_ctr = 0;
+    for (unsigned int r = 0; r < TEST_MERGE_FILES; r++)
+    {
+        if (rand() % 4 == 0)
+        {
+            continue;
+        }
+        const test_expected_row *expected = &test_case->expected[r];
+        scan[scan_ctr].element      = r;
+        scan[scan_ctr].version      = expected->version + (rand() % 5 == 0 ? 1 : 0);
+        scan[scan_ctr].attributes   = expected->present ? expected->attributes : TEST_MERGE_ATTRIBUTES;
+        if (rand() % 5 == 0)
+        {
+            scan[scan_ctr].attributes ^= 0022;
+        }
+        scan_ctr++;
+    }
+    return scan_ctr;
+}
+
+int main()
+{
+    static test_merge_case  test_case;
+    static test_scan_element all[TEST_MERGE_FILES];
+    static test_scan_element evens[TEST_MERGE_FILES];
+    static test_scan_element odds[TEST_MERGE_FILES];
+    static test_scan_element scan[TEST_MERGE_FILES + 1];
+    unsigned int even_ctr   = 0;
+    unsigned int odd_ctr    = 0;
+
+    srand(TEST_SEED);
+    if (monitorTablesInitialize() != CS_SUCCESS)
+    {
+        printf("Could not initialize the monitor tables\n");
+        return EXIT_FAILURE;
+    }
+    test_elements_create();
+    for (unsigned int r = 0; r < TEST_MERGE_FILES; r++)
+    {
+        all[r] = (test_scan_element) {r, 0, TEST_MERGE_ATTRIBUTES};
+        if (r % 2 == 0)
+        {
+            evens[even_ctr++]   = all[r];
+        }
+        else
+        {
+            odds[odd_ctr++]     = all[r];
+        }
+    }
+
+    // **** Interleaved - every step of the merge alternates between the scan and the status quo **** //
+    test_case_start(&test_case, "interleaved", evens, even_ctr);
+    test_case_scan(&test_case, 1, odds, odd_ctr);           // every row added, every row missing
+    for (unsigned int r = 0; r < TEST_MERGE_FILES; r++)
+    {
+        scan[r] = all[r];
+        scan[r].version     = r % 3 == 0 ? 1 : 0;
+        scan[r].attributes  = r % 4 == 0 ? 0100700 : TEST_MERGE_ATTRIBUTES;
+    }
+    test_case_scan(&test_case, 2, scan, TEST_MERGE_FILES);  // the evens added back, a third of the odds changed
+    test_case_scan(&test_case, 3, evens, even_ctr);         // the odds missing, and the evens changed back
+
+    // **** Empty inputs **** //
+    test_case_start(&test_case, "empty scan", all, TEST_MERGE_FILES);
+    test_case_scan(&test_case, 1, NULL, 0);
+    test_case_scan(&test_case, 2, NULL, 0);                 // and an empty status quo too
+    test_case_start(&test_case, "empty status quo", NULL, 0);
+    test_case_scan(&test_case, 1, all, TEST_MERGE_FILES);
+    test_case_start(&test_case, "one element", NULL, 0);
+    test_case_scan(&test_case, 1, &all[TEST_MERGE_FILES - 1], 1);
+    test_case_scan(&test_case, 2, &all[1], 1);
+    test_case_scan(&test_case, 3, all, 2);                  // added before the one kept
+
+    // **** Random - each round adds, changes and misses about a quarter of the elements **** //
+    test_case_start(&test_case, "random", odds, odd_ctr);
+    for (unsigned int round = 1; round <= TEST_MERGE_RANDOM_ROUNDS; round++)
+    {
+        unsigned int scan_ctr = test_scan_random(&test_case, scan);
+        test_case_scan(&test_case, round, scan, scan_ctr);
+    }
+
+    // **** Duplicate - an element sent twice is not in order, so the scan is searched, never merged **** //
+    test_case_start(&test_case, "duplicate", all, TEST_MERGE_FILES);
+    memcpy(scan, all, 11 * sizeof(test_scan_element));
+    memcpy(&scan[11], &all[10], (TEST_MERGE_FILES - 10) * sizeof(test_scan_element));
+    scan[11].version = 1;
+    test_scan_send(test_case.merge_index, scan, TEST_MERGE_FILES + 1, true);
+    device_shard *shard = deviceShardLock(test_case.merge_index);
+    CSL_TEST_CHECK(shard->scan_table->ordered == false, "duplicate: a scan with an element twice was seen as ordered");
+    int merge_alerts    = statusQuoTableMerge(test_case.merge_index);
+    deviceShardUnlock(shard);
+    CSL_TEST_CHECK(merge_alerts == CS_ERROR, "duplicate: merge returned [%d], expected CS_ERROR", merge_alerts);
+    test_rows_check(&test_case, test_case.merge_index, "merge", 1);     // left as it was
+
+    CSL_TEST_EXIT();
+}
@@ -0,0 +1,315 @@
+//
+// Created by kerry on 10/19/26.
+//
+
+/************************************************
+ * test_spool
+ * ==========
+ * The spool (see The Spool in csl_spool.h), against the SQLite backend:
+ *      * Crash replay  - the writes a monitor spooled, but crashed before the database took, are run at the
+ *                        next start, once each, and a partial last record is dropped
+ *      * Ledger dedup  - the writes up to the ledger's sequence are not run again, those after it are
+ *                        (at least once)
+ *      * Retry         - a write the database could not be reached for (SQLITE_BUSY, so CS_ERROR_DB_CONNECTION)
+ *                        stays spooled, and is run once the database is back - neither dropped nor doubled
+ * Each write inserts one row into element_added_names, with its own device_id, so a row's count is how many
+ * times its write was run. Only built with CSL_SQLITE.
+ ************************************************/
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <sqlite3.h>
+#include "CryticaMonitor.h"
+#include "csl_spool.h"
+#include "csl_sqlite.h"
+#include "csl_test.h"
+
+#define TEST_SPOOL_FILE             FILE_STORAGE_SQLITE ".spool"
+#define TEST_SPOOL_WRITES           40
+#define TEST_SPOOL_LEDGER_AT        (TEST_SPOOL_WRITES / 2)
+#define TEST_SPOOL_RETRY_WRITES     5
+#define TEST_SPOOL_RETRY_BASE       1000            // The retry test's device_ids start here
+#define TEST_SPOOL_DB_TIMEOUT       1               // seconds - csl_SpoolWait()'s longest wait
+#define TEST_SPOOL_LOCKED_MSEC      (SQLITE_BUSY_TIMEOUT_MSEC + 1000)   // Long enough for a write to fail
+#define TEST_SPOOL_MAX_WAITS        (2 * SQLITE_BUSY_TIMEOUT_MSEC / 1000 + 5)
+
+/************************************************
+ * int test_spool_write()
+ *  @param  unsigned int device_id
+ *
+ *  @brief  Spools the insert of device_id's row
+ *
+ *  @author Kerry
+ *
+ *  @return csl_SpoolUpdate()'s result
+ ************************************************/
+static int test_spool_write(unsigned int device_id)
+{
+    char statement[SIZE_CS_SQL_COMMAND];
+    snprintf(statement, SIZE_CS_SQL_COMMAND, "Insert into %s.%s (monitor_id, device_id, element_identifier, "
+             "element_name) values (%llu, %u, 'test', '/opt/test/file%u')", CS_SQL_MONITOR_SCHEMA,
+             CS_SQL_ELEMENT_ADDED_NAMES_TABLE, (unsigned long long) DEFAULT_MONITOR_ID, device_id, device_id);
+    return csl_SpoolUpdate(statement);
+}
+
+/************************************************
+ * long long test_spool_rows()
+ *  @param  unsigned int device_id
+ *
+ *  @brief  How many times device_id's write was run
+ *
+ *  @author Kerry
+ *
+ *  @return The count of its rows, or an error code
+ ************************************************/
+static long long test_spool_rows(unsigned int device_id)
+{
+    char query[SIZE_CS_SQL_COMMAND];
+    snprintf(query, SIZE_CS_SQL_COMMAND, "Select device_id from %s.%s where device_id = %u", CS_SQL_MONITOR_SCHEMA,
+             CS_SQL_ELEMENT_ADDED_NAMES_TABLE, device_id);
+    return csl_StorageQuery(query, NULL, NULL);
+}
+
+/************************************************
+ * void test_spool_check_rows()
+ *  @param
+ *          const char      *what
+ *          unsigned int    first       - The device_ids first..last
+ *          unsigned int    last
+ *          long long       expected    - The rows each should have
+ *
+ *  @author Kerry
+ ************************************************/
+static void test_spool_check_rows(const char *what, unsigned int first, unsigned int last, long long expected)
+{
+    for (unsigned int device_id = first; device_id <= last; device_id++)
+    {
+        long long row_ctr = test_spool_rows(device_id);
+        CSL_TEST_CHECK(row_ctr == expected, "%s: write [%u] was run [%lld] times, expected [%lld]", what, device_id,
+                       row_ctr, expected);
+    }
+}
+
+/************************************************
+ * int test_spool_wait()
+ *  @param  unsigned long long sequence
+ *
+ *  @brief  csl_SpoolWait(), for as long as the drain may take to get past a busy database
+ *
+ *  @author Kerry
+ *
+ *  @return CS_SUCCESS once the writes up to sequence are run, CS_ERROR_DB_CONNECTION if they were not
+ ************************************************/
+static int test_spool_wait(unsigned long long sequence)
+{
+    int return_value = CS_ERROR_DB_CONNECTION;
+    for (int wait_ctr = 0; return_value != CS_SUCCESS && wait_ctr < TEST_SPOOL_MAX_WAITS; wait_ctr++)
+    {
+        return_value = csl_SpoolWait(sequence);
+    }
+    return return_value;
+}
+
+/************************************************
+ * void test_spool_crash()
+ *  @param  - None
+ *
+ *  @brief  The crashing monitor, run in a child - spools TEST_SPOOL_WRITES writes with no database to run them
+ *          against, starts one more record, and dies mid-write
+ *
+ *  @author Kerry
+ ************************************************/
+static void test_spool_crash()
+{
+    int exit_code = csl_SpoolOpen(TEST_SPOOL_FILE) == CS_SUCCESS ? EXIT_SUCCESS : EXIT_FAILURE;
+    for (unsigned int device_id = 1; exit_code == EXIT_SUCCESS && device_id <= TEST_SPOOL_WRITES; device_id++)
+    {
+        exit_code = test_spool_write(device_id) == CS_SUCCESS ? EXIT_SUCCESS : EXIT_FAILURE;
+    }
+
+    csl_spool_record record = {SPOOL_RECORD_MAGIC, SIZE_CS_SQL_COMMAND, TEST_SPOOL_WRITES + 1, SPOOL_UPDATE, 0};
+    int spool_file = open(TEST_SPOOL_FILE, O_WRONLY | O_APPEND);
+    if (spool_file < 0 || write(spool_file, &record, sizeof(csl_spool_record) / 2) < 0)
+    {
+        exit_code = EXIT_FAILURE;
+    }
+    fflush(stdout);
+    _exit(exit_code);
+}
+
+/************************************************
+ * int test_spool_restore()
+ *  @param
+ *          const char  *contents   - The spool file, as the crash left it
+ *          ssize_t     size
+ *
+ *  @brief  Puts the crashed spool file back, over whatever the spool holds now
+ *
+ *  @author Kerry
+ *
+ *  @return CS_SUCCESS, or CS_ERROR if it could not be written
+ ************************************************/
+static int test_spool_restore(const char *contents, ssize_t size)
+{
+    int spool_file = open(TEST_SPOOL_FILE, O_WRONLY | O_TRUNC);
+    if (spool_file < 0)
+    {
+        return CS_ERROR;
+    }
+    int return_value = size > 0 && write(spool_file, contents, (size_t) size) == size ? CS_SUCCESS : CS_ERROR;
+    close(spool_file);
+    return return_value;
+}
+
+/************************************************
+ * int test_spool_setup()
+ *  @param  - None
+ *
+ *  @brief  Loads a configuration with a short db_timeout_sec, and removes the last run's database and spool
+ *
+ *  @author Kerry
+ *
+ *  @return CS_SUCCESS, or an error code
+ ************************************************/
+static int test_spool_setup()
+{
+    char config_file_name[PATH_MAX];
+    snprintf(config_file_name, PATH_MAX, "%s.config", FILE_STORAGE_SQLITE);
+    FILE *config_file = fopen(config_file_name, "w");
+    if (config_file == NULL)
+    {
+        return CS_ERROR;
+    }
+    fprintf(config_file, "storage_backend = %d\nspool_writes = 1\ndb_timeout_sec = %d\n", STORAGE_SQLITE,
+            TEST_SPOOL_DB_TIMEOUT);
+    fclose(config_file);
+
+    const char *file_names[] = {FILE_STORAGE_SQLITE, FILE_STORAGE_SQLITE "-wal", FILE_STORAGE_SQLITE "-shm",
+                                TEST_SPOOL_FILE, TEST_SPOOL_FILE SPOOL_LEDGER_SUFFIX};
+    for (size_t f = 0; f < sizeof(file_names) / sizeof(file_names[0]); f++)
+    {
+        unlink(file_names[f]);
+    }
+    return csl_ConfigLoad(config_file_name);
+}
+
+int main()
+{
+    if (test_spool_setup() != CS_SUCCESS)
+    {
+        printf("Could not set up [%s]\n", FILE_STORAGE_SQLITE);
+        return EXIT_FAILURE;
+    }
+
+    /********************************************
+     * Crash replay - the child spools, with no database, and dies; the next start runs what it left
+     ********************************************/
+    fflush(stdout);
+    pid_t child = fork();
+    if (child == 0)
+    {
+        test_spool_crash();
+    }
+    int child_status = 0;
+    CSL_TEST_CHECK(child > 0 && waitpid(child, &child_status, 0) == child && WIFEXITED(child_status) &&
+                   WEXITSTATUS(child_status) == EXIT_SUCCESS, "the crashing monitor did not spool its writes");
+
+    // **** Keep what it left, for the ledger tests **** //
+    struct stat spool_stat;
+    char        *crashed_spool  = NULL;
+    ssize_t     crashed_size    = -1;
+    int         spool_file      = open(TEST_SPOOL_FILE, O_RDONLY);
+    if (spool_file >= 0 && fstat(spool_file, &spool_stat) == 0 && (crashed_spool = malloc(spool_stat.st_size)) != NULL)
+    {
+        crashed_size = read(spool_file, crashed_spool, spool_stat.st_size);
+    }
+    if (spool_file >= 0)
+    {
+        close(spool_file);
+    }
+    CSL_TEST_CHECK(crashed_size > (ssize_t) (TEST_SPOOL_WRITES * sizeof(csl_spool_record)),
+                   "the crashed spool holds [%zd] bytes", crashed_size);
+
+    if (csl_StorageOpen(STORAGE_SQLITE) != CS_SUCCESS || monitorTablesInitialize() != CS_SUCCESS)
+    {
+        printf("Could not open [%s]\n", FILE_STORAGE_SQLITE);
+        return EXIT_FAILURE;
+    }
+    CSL_TEST_CHECK(csl_SpoolOpen(TEST_SPOOL_FILE) == CS_SUCCESS, "could not reopen the spool");
+    CSL_TEST_CHECK(csl_SpoolSequence() == TEST_SPOOL_WRITES, "the spool resumed at [%llu], expected [%d]",
+                   csl_SpoolSequence(), TEST_SPOOL_WRITES);
+    CSL_TEST_CHECK(test_spool_wait(TEST_SPOOL_WRITES) == CS_SUCCESS, "the crashed writes were not run");
+    test_spool_check_rows("crash replay", 1, TEST_SPOOL_WRITES, 1);
+
+    // **** The partial record is gone, so what is spooled after it is read **** //
+    CSL_TEST_CHECK(test_spool_write(TEST_SPOOL_WRITES + 1) == CS_SUCCESS, "could not spool after the replay");
+    CSL_TEST_CHECK(test_spool_wait(csl_SpoolSequence()) == CS_SUCCESS, "the write after the replay was not run");
+    test_spool_check_rows("after the replay", TEST_SPOOL_WRITES + 1, TEST_SPOOL_WRITES + 1, 1);
+    csl_SpoolClose();
+    CSL_TEST_CHECK(stat(TEST_SPOOL_FILE, &spool_stat) == 0 && spool_stat.st_size == 0,
+                   "the drained spool still holds [%lld] bytes", (long long) spool_stat.st_size);
+
+    /********************************************
+     * Ledger dedup - the crashed spool again, as if the monitor died after running it but before emptying it
+     ********************************************/
+    CSL_TEST_CHECK(test_spool_restore(crashed_spool, crashed_size) == CS_SUCCESS, "could not restore the spool");
+    CSL_TEST_CHECK(csl_SpoolOpen(TEST_SPOOL_FILE) == CS_SUCCESS, "could not reopen the spool");
+    CSL_TEST_CHECK(csl_SpoolPending() == 0, "[%llu] writes the ledger covers are pending", csl_SpoolPending());
+    CSL_TEST_CHECK(csl_SpoolSequence() == TEST_SPOOL_WRITES + 1, "the spool resumed at [%llu], expected [%d]",
+                   csl_SpoolSequence(), TEST_SPOOL_WRITES + 1);
+    csl_SpoolClose();
+    test_spool_check_rows("ledger dedup", 1, TEST_SPOOL_WRITES + 1, 1);
+
+    // **** ... and with the ledger behind, as after a crash before the ledger's sync - only those after it run **** //
+    uint64_t ledger_sequence = TEST_SPOOL_LEDGER_AT;
+    int ledger_file = open(TEST_SPOOL_FILE SPOOL_LEDGER_SUFFIX, O_WRONLY);
+    CSL_TEST_CHECK(ledger_file >= 0 && pwrite(ledger_file, &ledger_sequence, sizeof(uint64_t), 0) == sizeof(uint64_t),
+                   "could not set the ledger back");
+    if (ledger_file >= 0)
+    {
+        close(ledger_file);
+    }
+    CSL_TEST_CHECK(test_spool_restore(crashed_spool, crashed_size) == CS_SUCCESS, "could not restore the spool");
+    CSL_TEST_CHECK(csl_SpoolOpen(TEST_SPOOL_FILE) == CS_SUCCESS, "could not reopen the spool");
+    CSL_TEST_CHECK(test_spool_wait(TEST_SPOOL_WRITES) == CS_SUCCESS, "the writes after the ledger were not run");
+    test_spool_check_rows("behind the ledger", 1, TEST_SPOOL_LEDGER_AT, 1);
+    test_spool_check_rows("after the ledger", TEST_SPOOL_LEDGER_AT + 1, TEST_SPOOL_WRITES, 2);
+    free(crashed_spool);
+
+    /********************************************
+     * Retry - another connection holds the write lock past the busy timeout, so the drain's write fails with
+     * CS_ERROR_DB_CONNECTION; once it lets go, every write is run once
+     ********************************************/
+    sqlite3 *blocker = NULL;
+    CSL_TEST_CHECK(sqlite3_open(FILE_STORAGE_SQLITE, &blocker) == SQLITE_OK &&
+                   sqlite3_exec(blocker, "Begin exclusive", NULL, NULL, NULL) == SQLITE_OK,
+                   "could not lock [%s]", FILE_STORAGE_SQLITE);
+    for (unsigned int w = 0; w < TEST_SPOOL_RETRY_WRITES; w++)
+    {
+        CSL_TEST_CHECK(test_spool_write(TEST_SPOOL_RETRY_BASE + w) == CS_SUCCESS,
+                       "write [%u] was not spooled while the database was locked", TEST_SPOOL_RETRY_BASE + w);
+    }
+    unsigned long long  retry_sequence  = csl_SpoolSequence();
+    int64_t             locked_usecs    = csl_MetricsNow();
+    int                 locked_flag     = CS_ERROR_DB_CONNECTION;
+    while (locked_flag == CS_ERROR_DB_CONNECTION &&
+           csl_MetricsNow() - locked_usecs < (int64_t) TEST_SPOOL_LOCKED_MSEC * 1000)
+    {
+        locked_flag = csl_SpoolWait(retry_sequence);
+    }
+    CSL_TEST_CHECK(locked_flag == CS_ERROR_DB_CONNECTION,
+                   "the spool reported its writes run while the database was locked");
+    CSL_TEST_CHECK(csl_SpoolPending() == TEST_SPOOL_RETRY_WRITES, "[%llu] writes pending while locked, expected [%d]",
+                   csl_SpoolPending(), TEST_SPOOL_RETRY_WRITES);
+    sqlite3_exec(blocker, "Commit", NULL, NULL, NULL);
+    sqlite3_close(blocker);
+
+    CSL_TEST_CHECK(test_spool_wait(retry_sequence) == CS_SUCCESS, "the writes were not run once the lock was let go");
+    test_spool_check_rows("retry", TEST_SPOOL_RETRY_BASE, TEST_SPOOL_RETRY_BASE + TEST_SPOOL_RETRY_WRITES - 1, 1);
+    csl_SpoolClose();
+    csl_StorageClose();
+
+    CSL_TEST_EXIT();
+}